@@ -0,0 +1,68 @@
+// Small loops that spend nearly all of their time dispatching cheap instructions, for measuring interpreter overhead.
+// Compile with `javac Dispatch.java`, then run `javabench Dispatch.class <method>` from this directory.
+public class Dispatch
+{
+    public static int arithmetic()
+    {
+        int value = 0;
+        for (int i = 0; i < 1000000; i++)
+        {
+            value += i;
+            value ^= i * 3;
+        }
+        return value;
+    }
+
+    public static long longs()
+    {
+        long value = 0;
+        for (int i = 0; i < 1000000; i++)
+            value = value * 31 + i;
+        return value;
+    }
+
+    public static double doubles()
+    {
+        double value = 0;
+        for (int i = 0; i < 1000000; i++)
+            value = value * 0.5 + i;
+        return value;
+    }
+
+    public static int calls()
+    {
+        int value = 0;
+        for (int i = 0; i < 1000000; i++)
+            value = add(value, i);
+        return value;
+    }
+
+    public static int switches()
+    {
+        int value = 0;
+        for (int i = 0; i < 1000000; i++)
+        {
+            switch (i & 3)
+            {
+                case 0:
+                    value += 1;
+                    break;
+                case 1:
+                    value -= 2;
+                    break;
+                case 2:
+                    value += 3;
+                    break;
+                default:
+                    value -= 4;
+                    break;
+            }
+        }
+        return value;
+    }
+
+    private static int add(int a, int b)
+    {
+        return a + b;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <AK/kmalloc.h>
+#include <LibJava/Arena.h>
+
+namespace Java
+{
+// Chunks double in size up to this, so that a big class doesn't take many of them, and a small one doesn't take much.
+static constexpr size_t max_chunk_size = 256 * KiB;
+
+Arena::Arena(size_t first_chunk_size) : m_next_chunk_size(clamp(first_chunk_size, 256, max_chunk_size)) {}
+
+Arena::~Arena()
+{
+    // In reverse, the same way destructors of locals run.
+    for (size_t i = m_destructors.size(); i > 0; i--)
+    {
+        auto& destructor = m_destructors[i - 1];
+        destructor.destroy(destructor.objects, destructor.count);
+    }
+
+    for (auto* chunk : m_chunks)
+        kfree(chunk);
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    auto* start = reinterpret_cast<u8*>(align_up_to<FlatPtr>(reinterpret_cast<FlatPtr>(m_top), alignment));
+    if (!m_top || start + size > m_end)
+    {
+        // What doesn't fit into a chunk of the usual size gets one of its own, which leaves the current one to fill.
+        if (size + alignment > m_next_chunk_size)
+        {
+            auto* chunk = static_cast<u8*>(kmalloc(size + alignment));
+            VERIFY(chunk);
+            m_chunks.append(chunk);
+            m_size += size;
+            return reinterpret_cast<u8*>(align_up_to<FlatPtr>(reinterpret_cast<FlatPtr>(chunk), alignment));
+        }
+
+        auto* chunk = static_cast<u8*>(kmalloc(m_next_chunk_size));
+        VERIFY(chunk);
+        m_chunks.append(chunk);
+        m_top = chunk;
+        m_end = chunk + m_next_chunk_size;
+        m_next_chunk_size = min(m_next_chunk_size * 2, max_chunk_size);
+        start = reinterpret_cast<u8*>(align_up_to<FlatPtr>(reinterpret_cast<FlatPtr>(m_top), alignment));
+    }
+
+    m_top = start + size;
+    m_size += size;
+    return start;
+}
+}
\ No newline at end of file
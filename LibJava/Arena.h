@@ -0,0 +1,91 @@
+#pragma once
+
+#include <AK/Noncopyable.h>
+#include <AK/Span.h>
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+
+namespace Java
+{
+// Where everything that is parsed out of one class file lives: the constant pool, the fields and methods, their
+// attributes and the code of the methods once it has been parsed. Allocating only takes bumping a pointer, what is
+// allocated one after the other ends up next to each other, and it is all freed in one go along with the arena.
+// Nothing is freed on its own, which suits metadata that lives for exactly as long as its class does.
+class Arena
+{
+    AK_MAKE_NONCOPYABLE(Arena);
+    AK_MAKE_NONMOVABLE(Arena);
+
+public:
+    // A good guess for the first chunk saves growing it a few times; a class takes about as much room in here as its
+    // class file does.
+    explicit Arena(size_t first_chunk_size = 4 * KiB);
+    ~Arena();
+
+    template<typename T, typename... Args>
+    T& make(Args&&... args)
+    {
+        auto* object = new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+        if constexpr (!IsTriviallyDestructible<T>)
+            m_destructors.append({&destroy<T>, object, 1});
+        return *object;
+    }
+
+    template<typename T>
+    Span<T> make_array(size_t count)
+    {
+        if (count == 0)
+            return {};
+
+        auto* objects = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++)
+            new (&objects[i]) T();
+        if constexpr (!IsTriviallyDestructible<T>)
+            m_destructors.append({&destroy<T>, objects, count});
+        return {objects, count};
+    }
+
+    // Copies what has been put together somewhere else, like a Vector with inline capacity that is on the stack.
+    template<typename T>
+    Span<T> copy(Span<const T> objects)
+    {
+        if (objects.is_empty())
+            return {};
+
+        auto* copies = static_cast<T*>(allocate(sizeof(T) * objects.size(), alignof(T)));
+        for (size_t i = 0; i < objects.size(); i++)
+            new (&copies[i]) T(objects[i]);
+        if constexpr (!IsTriviallyDestructible<T>)
+            m_destructors.append({&destroy<T>, copies, objects.size()});
+        return {copies, objects.size()};
+    }
+
+    // How many bytes have been handed out, which is less than what has been taken from the system.
+    size_t size() const { return m_size; }
+
+private:
+    struct Destructor
+    {
+        void (*destroy)(void*, size_t);
+        void* objects;
+        size_t count;
+    };
+
+    template<typename T>
+    static void destroy(void* objects, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            static_cast<T*>(objects)[i].~T();
+    }
+
+    void* allocate(size_t size, size_t alignment);
+
+    Vector<u8*> m_chunks;
+    u8* m_top{};
+    u8* m_end{};
+    size_t m_next_chunk_size;
+    size_t m_size{};
+    Vector<Destructor> m_destructors;
+};
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+#include <LibJava/Object.h>
+
+namespace Java
+{
+// 2.7 doesn't mandate a layout for arrays either. Ours are objects whose class is the type of their components, with
+// the length of the array after the header, followed by the components themselves, unboxed and right after each other
+// just like a C array of them would be. They start 16 bytes in, which is aligned for every primitive type, and for
+// 16-byte vectors whenever the array itself is.
+class Array : public Object
+{
+public:
+    static constexpr u32 length_offset = header_size;
+    static constexpr u32 elements_offset = 16;
+
+    // Rounded up like the size of any other object. The length has already been checked to not be negative, and at
+    // most 2^31 - 1 components of 8 bytes each can't overflow a size_t.
+    static size_t allocation_size(i32 length, u8 component_size)
+    {
+        return align_up_to<size_t>(elements_offset + static_cast<size_t>(length) * component_size, 8);
+    }
+
+    i32 length() const { return read<i32>(length_offset); }
+
+    void set_length(i32 length) { write<i32>(length_offset, length); }
+
+    template<typename T>
+    ALWAYS_INLINE T* elements()
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<u8*>(this) + elements_offset);
+    }
+
+    template<typename T>
+    ALWAYS_INLINE const T* elements() const
+    {
+        return reinterpret_cast<const T*>(reinterpret_cast<const u8*>(this) + elements_offset);
+    }
+
+    // The index has to have been checked against the length already.
+    template<typename T>
+    ALWAYS_INLINE T element(i32 index) const
+    {
+        return elements<T>()[index];
+    }
+
+    template<typename T>
+    ALWAYS_INLINE void set_element(i32 index, T value)
+    {
+        elements<T>()[index] = value;
+    }
+};
+
+static_assert(sizeof(Array) == sizeof(Object));
+static_assert(Array::length_offset + sizeof(i32) <= Array::elements_offset);
+}
\ No newline at end of file
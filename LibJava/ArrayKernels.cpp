@@ -0,0 +1,195 @@
+#include <AK/BitCast.h>
+#include <AK/SIMD.h>
+#include <LibJava/ArrayKernels.h>
+#include <LibJava/ResolvedClass.h>
+
+namespace Java::ArrayKernels
+{
+namespace
+{
+using AK::SIMD::u32x4;
+using AK::SIMD::u8x16;
+
+constexpr size_t vector_size = sizeof(u8x16);
+
+// Going through memcpy makes these unaligned loads and stores, and keeps them clear of the aliasing rules.
+ALWAYS_INLINE u8x16 load(const u8* address)
+{
+    u8x16 vector;
+    __builtin_memcpy(&vector, address, vector_size);
+    return vector;
+}
+
+ALWAYS_INLINE void store(u8* address, u8x16 vector)
+{
+    __builtin_memcpy(address, &vector, vector_size);
+}
+
+ALWAYS_INLINE bool is_zero(u8x16 vector)
+{
+    u64 halves[2];
+    __builtin_memcpy(halves, &vector, vector_size);
+    return (halves[0] | halves[1]) == 0;
+}
+
+template<typename T>
+ALWAYS_INLINE T load_component(const u8* elements, size_t index)
+{
+    T value;
+    __builtin_memcpy(&value, elements + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+// Float.floatToIntBits and Double.doubleToLongBits, which is what Arrays.equals and Arrays.hashCode go by.
+ALWAYS_INLINE u32 float_to_int_bits(float value)
+{
+    return value != value ? 0x7fc00000 : bit_cast<u32>(value);
+}
+
+ALWAYS_INLINE u64 double_to_long_bits(double value)
+{
+    return value != value ? 0x7ff8000000000000 : bit_cast<u64>(value);
+}
+
+bool components_equal(PrimitiveType component_type, const u8* a, const u8* b, size_t count)
+{
+    if (component_type == PrimitiveType::Float)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (float_to_int_bits(load_component<float>(a, i)) != float_to_int_bits(load_component<float>(b, i)))
+                return false;
+        }
+        return true;
+    }
+
+    if (component_type == PrimitiveType::Double)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (double_to_long_bits(load_component<double>(a, i)) != double_to_long_bits(load_component<double>(b, i)))
+                return false;
+        }
+        return true;
+    }
+
+    return __builtin_memcmp(a, b, count * component_size(component_type)) == 0;
+}
+
+// The hash of n components is 31^n plus the sum of the hash of every component i times 31^(n - 1 - i). Four sums in
+// a vector each take every fourth component, and are multiplied by 31^4 for every four components. Put together at the
+// end, that is the same as multiplying by 31 after every single one, which wraps around in the same way.
+template<typename T, typename Hash>
+i32 hash_components(const u8* elements, size_t count, Hash hash)
+{
+    constexpr u32 thirty_one_to_the_fourth = 31 * 31 * 31 * 31;
+
+    u32x4 sums{};
+    u32 power = 1;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        u32x4 hashes{hash(load_component<T>(elements, i)), hash(load_component<T>(elements, i + 1)),
+                     hash(load_component<T>(elements, i + 2)), hash(load_component<T>(elements, i + 3))};
+        sums = sums * thirty_one_to_the_fourth + hashes;
+        power *= thirty_one_to_the_fourth;
+    }
+
+    u32 result = power + sums[0] * 31 * 31 * 31 + sums[1] * 31 * 31 + sums[2] * 31 + sums[3];
+    for (; i < count; i++)
+        result = result * 31 + hash(load_component<T>(elements, i));
+
+    return static_cast<i32>(result);
+}
+}
+
+void fill(u8* destination, size_t count, const void* component, u8 component_size)
+{
+    // A vector is a whole number of components of any size, so repeating the same vector lines up with them all.
+    u8 pattern[vector_size];
+    for (size_t i = 0; i < vector_size; i += component_size)
+        __builtin_memcpy(pattern + i, component, component_size);
+    auto vector = load(pattern);
+
+    auto size = count * component_size;
+    size_t offset = 0;
+    for (; offset + vector_size <= size; offset += vector_size)
+        store(destination + offset, vector);
+
+    __builtin_memcpy(destination + offset, pattern, size - offset);
+}
+
+void copy(u8* destination, const u8* source, size_t size)
+{
+    // Every vector is loaded before it is stored, so going from the front to the back only ever overwrites what has
+    // already been read, unless the destination starts within the source. In that case, it goes the other way around.
+    if (destination <= source || destination >= source + size)
+    {
+        size_t offset = 0;
+        for (; offset + vector_size <= size; offset += vector_size)
+            store(destination + offset, load(source + offset));
+        for (; offset < size; offset++)
+            destination[offset] = source[offset];
+        return;
+    }
+
+    auto offset = size;
+    for (; offset >= vector_size; offset -= vector_size)
+        store(destination + offset - vector_size, load(source + offset - vector_size));
+    for (; offset > 0; offset--)
+        destination[offset - 1] = source[offset - 1];
+}
+
+bool equals(PrimitiveType component_type, const u8* a, const u8* b, size_t count)
+{
+    auto size = count * component_size(component_type);
+    auto is_floating_point = component_type == PrimitiveType::Float || component_type == PrimitiveType::Double;
+
+    // Bits that are the same are always equal components, so only a vector whose bits differ needs a closer look, in
+    // case that is down to NaNs.
+    size_t offset = 0;
+    for (; offset + vector_size <= size; offset += vector_size)
+    {
+        if (is_zero(load(a + offset) ^ load(b + offset)))
+            continue;
+
+        if (!is_floating_point ||
+            !components_equal(component_type, a + offset, b + offset, vector_size / component_size(component_type)))
+            return false;
+    }
+
+    return components_equal(component_type, a + offset, b + offset, (size - offset) / component_size(component_type));
+}
+
+i32 hash_code(PrimitiveType component_type, const u8* elements, size_t count)
+{
+    switch (component_type)
+    {
+        // Boolean.hashCode
+        case PrimitiveType::Boolean:
+            return hash_components<u8>(elements, count, [](u8 value) -> u32 { return value ? 1231 : 1237; });
+        case PrimitiveType::Byte:
+            return hash_components<i8>(elements, count, [](i8 value) -> u32 { return value; });
+        case PrimitiveType::Char:
+            return hash_components<u16>(elements, count, [](u16 value) -> u32 { return value; });
+        case PrimitiveType::Short:
+            return hash_components<i16>(elements, count, [](i16 value) -> u32 { return value; });
+        case PrimitiveType::Int:
+            return hash_components<i32>(elements, count, [](i32 value) -> u32 { return value; });
+        // Long.hashCode and Double.hashCode fold the high half into the low one.
+        case PrimitiveType::Long:
+            return hash_components<u64>(elements, count, [](u64 value) -> u32 { return value ^ (value >> 32); });
+        case PrimitiveType::Float:
+            return hash_components<float>(elements, count, [](float value) { return float_to_int_bits(value); });
+        case PrimitiveType::Double:
+            return hash_components<double>(elements, count, [](double value) -> u32 {
+                auto bits = double_to_long_bits(value);
+                return bits ^ (bits >> 32);
+            });
+        case PrimitiveType::ReturnAddress:
+            break;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <AK/Types.h>
+#include <LibJava/Types.h>
+
+// Bulk operations on the components of arrays of primitives. They work on 16 bytes at a time with the vector types
+// from AK/SIMD.h, which become SSE2 on x86-64 and NEON on AArch64, both of which every CPU of its kind has. All they
+// need is for the components to be right after each other, which Array makes sure of, so alignment doesn't matter.
+namespace Java::ArrayKernels
+{
+// Sets count components of the given size to the one that component points to.
+void fill(u8* destination, size_t count, const void* component, u8 component_size);
+
+// Like memmove, the two may overlap, which they do for System.arraycopy within the same array.
+void copy(u8* destination, const u8* source, size_t size);
+
+// Like Arrays.equals: components are equal when their bits are, except that every NaN is equal to every other one, as
+// Float.floatToIntBits and Double.doubleToLongBits turn them all into the same one.
+bool equals(PrimitiveType component_type, const u8* a, const u8* b, size_t count);
+
+// Like Arrays.hashCode: starting from 1, the hash of each component in turn is added to 31 times the hash so far.
+i32 hash_code(PrimitiveType component_type, const u8* elements, size_t count);
+}
\ No newline at end of file
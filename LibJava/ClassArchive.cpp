@@ -0,0 +1,255 @@
+#include <AK/HashTable.h>
+#include <LibJava/ClassArchive.h>
+#include <LibJava/Verifier.h>
+
+namespace Java
+{
+// The archive is made for the machine it is used on, so everything is in its byte order. Each part of it is aligned
+// to 4 bytes, so that it can be read in place.
+static constexpr char archive_magic[8] = {'P', 'E', 'R', 'I', 'L', 'C', 'D', 'S'};
+// Bumped whenever the layout changes, or what goes into it, like the reference maps, is worked out differently.
+static constexpr u32 archive_version = 2;
+
+// Followed by as many ClassEntry as there are classes, and then everything they point to.
+struct ClassArchive::Header
+{
+    char magic[8];
+    u32 version;
+    u32 class_count;
+};
+
+struct ClassArchive::ClassEntry
+{
+    u32 name_offset;
+    u32 name_length;
+    u32 bytes_offset;
+    u32 bytes_length;
+    // There is one MethodEntry for every method of the class, in the order of the class file.
+    u32 methods_offset;
+    u32 method_count;
+    // Of the bytes of the class and then the reference maps of its methods, see Checksum.
+    u64 checksum;
+};
+
+// The reference maps of a method, as they are laid out by ReferenceMaps. A method without code has no starts.
+struct ClassArchive::MethodEntry
+{
+    u32 starts_offset;
+    u32 starts_count;
+    u32 slots_offset;
+    u32 slots_count;
+};
+
+namespace
+{
+// FNV-1a. Classes from the archive aren't verified again, so this is what ties what is loaded to what was verified, in
+// case the archive has been changed since it was made.
+class Checksum
+{
+public:
+    void add(ReadonlyBytes bytes)
+    {
+        for (auto byte : bytes)
+            m_value = (m_value ^ byte) * 0x100000001b3;
+    }
+
+    // The counts of a method go in as well, so that the reference maps can't be cut up any differently.
+    void add_reference_maps(Span<const u32> starts, Span<const u32> slots)
+    {
+        u32 counts[2] = {static_cast<u32>(starts.size()), static_cast<u32>(slots.size())};
+        add({reinterpret_cast<const u8*>(counts), sizeof(counts)});
+        add({reinterpret_cast<const u8*>(starts.data()), starts.size() * sizeof(u32)});
+        add({reinterpret_cast<const u8*>(slots.data()), slots.size() * sizeof(u32)});
+    }
+
+    u64 value() const { return m_value; }
+
+private:
+    u64 m_value{0xcbf29ce484222325};
+};
+}
+
+// Works out whether a part of the archive is within it, without overflowing on the way there.
+static bool contains(ReadonlyBytes bytes, u64 offset, u64 count, u64 size)
+{
+    return offset % 4 == 0 && offset <= bytes.size() && count * size <= bytes.size() - offset;
+}
+
+ErrorOr<ByteBuffer> ClassArchive::try_create(Span<const NonnullRefPtr<ClassFile>> class_files)
+{
+    // The class entries are written last, once the offsets of everything they point to are known.
+    Vector<ClassEntry> class_entries;
+    ByteBuffer data;
+    u64 data_offset = sizeof(Header) + class_files.size() * sizeof(ClassEntry);
+    auto append = [&](const void* bytes, size_t size) -> ErrorOr<u32> {
+        auto offset = data_offset + data.size();
+        if (offset + size > NumericLimits<u32>::max())
+            return Error::from_string_literal("Class archive is too big");
+
+        static constexpr u8 padding[4]{};
+        TRY(data.try_append(bytes, size));
+        TRY(data.try_append(padding, align_up_to<size_t>(size, 4) - size));
+        return static_cast<u32>(offset);
+    };
+
+    HashTable<StringView> names;
+    for (auto& class_file : class_files)
+    {
+        auto name = class_file->constant_pool()[class_file->this_class().name_index - 1].get<ClassFile::Utf8>().value;
+        if (names.set(name) != HashSetResult::InsertedNewEntry)
+            return Error::from_string_literal("Class archive would have two classes with the same name");
+
+        ClassEntry class_entry{};
+        class_entry.name_offset = TRY(append(name.characters_without_null_termination(), name.length()));
+        class_entry.name_length = name.length();
+        class_entry.bytes_offset = TRY(append(class_file->bytes().data(), class_file->bytes().size()));
+        class_entry.bytes_length = class_file->bytes().size();
+
+        Checksum checksum;
+        checksum.add(class_file->bytes());
+        Vector<MethodEntry> method_entries;
+        for (auto& method : class_file->methods())
+        {
+            MethodEntry method_entry{};
+            if (method.has_code())
+            {
+                // The same as what VM::link does to a method, short of fusing its instructions, which the reference
+                // maps don't look at.
+                auto decoded_code = TRY(DecodedCode::try_decode(*TRY(method.code(*class_file))));
+                auto frames = TRY(Verifier::verify(*class_file, method, decoded_code));
+                auto reference_maps = ReferenceMaps::create(decoded_code, frames);
+
+                auto starts = reference_maps->starts();
+                auto slots = reference_maps->slots();
+                checksum.add_reference_maps(starts, slots);
+                method_entry.starts_offset = TRY(append(starts.data(), starts.size() * sizeof(u32)));
+                method_entry.starts_count = starts.size();
+                method_entry.slots_offset = TRY(append(slots.data(), slots.size() * sizeof(u32)));
+                method_entry.slots_count = slots.size();
+            }
+            else
+            {
+                checksum.add_reference_maps({}, {});
+            }
+            method_entries.append(method_entry);
+        }
+
+        class_entry.methods_offset = TRY(append(method_entries.data(), method_entries.size() * sizeof(MethodEntry)));
+        class_entry.method_count = method_entries.size();
+        class_entry.checksum = checksum.value();
+        class_entries.append(class_entry);
+    }
+
+    Header header{};
+    memcpy(header.magic, archive_magic, sizeof(archive_magic));
+    header.version = archive_version;
+    header.class_count = class_entries.size();
+
+    ByteBuffer archive;
+    TRY(archive.try_append(&header, sizeof(header)));
+    TRY(archive.try_append(class_entries.data(), class_entries.size() * sizeof(ClassEntry)));
+    TRY(archive.try_append(data.data(), data.size()));
+    return archive;
+}
+
+ErrorOr<NonnullRefPtr<ClassArchive>> ClassArchive::try_open(NonnullRefPtr<Core::MappedFile> file)
+{
+    auto bytes = file->bytes();
+    if (!contains(bytes, 0, 1, sizeof(Header)))
+        return Error::from_string_literal("Class archive is truncated");
+
+    auto& header = *reinterpret_cast<const Header*>(bytes.data());
+    if (memcmp(header.magic, archive_magic, sizeof(archive_magic)) != 0)
+        return Error::from_string_literal("Not a class archive");
+    if (header.version != archive_version)
+        return Error::from_string_literal("Class archive was made by another version of the VM");
+    if (!contains(bytes, sizeof(Header), header.class_count, sizeof(ClassEntry)))
+        return Error::from_string_literal("Class archive is truncated");
+
+    auto archive = adopt_ref(*new ClassArchive(move(file)));
+    for (size_t i = 0; i < header.class_count; i++)
+    {
+        auto& class_entry = archive->class_entry(i);
+        if (!contains(bytes, class_entry.name_offset, class_entry.name_length, 1) ||
+            !contains(bytes, class_entry.bytes_offset, class_entry.bytes_length, 1) ||
+            !contains(bytes, class_entry.methods_offset, class_entry.method_count, sizeof(MethodEntry)))
+            return Error::from_string_literal("Class archive is corrupt");
+
+        for (auto& method_entry : archive->method_entries(class_entry))
+        {
+            if (!contains(bytes, method_entry.starts_offset, method_entry.starts_count, sizeof(u32)) ||
+                !contains(bytes, method_entry.slots_offset, method_entry.slots_count, sizeof(u32)))
+                return Error::from_string_literal("Class archive is corrupt");
+        }
+
+        StringView name(bytes.slice(class_entry.name_offset, class_entry.name_length));
+        if (archive->m_class_indices.contains(name))
+            return Error::from_string_literal("Class archive has two classes with the same name");
+        archive->m_class_indices.set(name, i);
+    }
+
+    return archive;
+}
+
+const ClassArchive::ClassEntry& ClassArchive::class_entry(size_t class_index) const
+{
+    auto* class_entries = reinterpret_cast<const ClassEntry*>(m_file->bytes().data() + sizeof(Header));
+    return class_entries[class_index];
+}
+
+Span<const ClassArchive::MethodEntry> ClassArchive::method_entries(const ClassEntry& class_entry) const
+{
+    auto* method_entries = reinterpret_cast<const MethodEntry*>(m_file->bytes().data() + class_entry.methods_offset);
+    return {method_entries, class_entry.method_count};
+}
+
+Span<const u32> ClassArchive::u32s_at(u32 offset, u32 count) const
+{
+    return {reinterpret_cast<const u32*>(m_file->bytes().data() + offset), count};
+}
+
+Optional<size_t> ClassArchive::find(StringView name) const
+{
+    return m_class_indices.get(name);
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> ClassArchive::try_load(size_t class_index) const
+{
+    auto& class_entry = this->class_entry(class_index);
+    auto class_bytes = m_file->bytes().slice(class_entry.bytes_offset, class_entry.bytes_length);
+
+    Checksum checksum;
+    checksum.add(class_bytes);
+    for (auto& method_entry : method_entries(class_entry))
+    {
+        checksum.add_reference_maps(u32s_at(method_entry.starts_offset, method_entry.starts_count),
+                                    u32s_at(method_entry.slots_offset, method_entry.slots_count));
+    }
+    if (checksum.value() != class_entry.checksum)
+        return Error::from_string_literal("Class archive has a class that was changed after it was verified");
+
+    auto class_file = TRY(ClassFile::try_parse(m_file, class_bytes));
+
+    // The reference maps are looked up by the index of the method, which only holds for the class they were made for.
+    auto name = class_file->constant_pool()[class_file->this_class().name_index - 1].get<ClassFile::Utf8>().value;
+    auto entry_name = StringView(m_file->bytes().slice(class_entry.name_offset, class_entry.name_length));
+    if (name != entry_name || class_file->methods().size() != class_entry.method_count)
+        return Error::from_string_literal("Class archive has a class under the wrong name");
+
+    return class_file;
+}
+
+ErrorOr<NonnullOwnPtr<ReferenceMaps>> ClassArchive::try_create_reference_maps(size_t class_index, size_t method_index,
+                                                                             const DecodedCode& decoded_code) const
+{
+    auto& class_entry = this->class_entry(class_index);
+    VERIFY(method_index < class_entry.method_count);
+
+    auto& method_entry = method_entries(class_entry)[method_index];
+    if (method_entry.starts_count == 0)
+        return Error::from_string_literal("Class archive has no reference maps for the method");
+
+    return ReferenceMaps::try_create_over(decoded_code, u32s_at(method_entry.starts_offset, method_entry.starts_count),
+                                          u32s_at(method_entry.slots_offset, method_entry.slots_count));
+}
+}
\ No newline at end of file
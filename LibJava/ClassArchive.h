@@ -0,0 +1,59 @@
+#pragma once
+
+#include <AK/ByteBuffer.h>
+#include <AK/Error.h>
+#include <AK/HashMap.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/NonnullRefPtr.h>
+#include <AK/Optional.h>
+#include <AK/RefCounted.h>
+#include <AK/Span.h>
+#include <AK/StringView.h>
+#include <LibCore/MappedFile.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/ReferenceMaps.h>
+
+namespace Java
+{
+// Class data sharing: classes that have been parsed and verified once, ahead of time, in one file that the VM maps and
+// uses as it is. A class from it is parsed in place, right out of the mapping, without opening a file of its own. Its
+// methods aren't verified again when they are linked, as the archive has the reference maps that verifying them led
+// to. Everything in there is found by its offset from the start of the file, so it works wherever it is mapped.
+// The archive has the bytes of its classes in it, so it can't go stale on its own, but it does have to be made again
+// for any change to them to be seen.
+class ClassArchive : public RefCounted<ClassArchive>
+{
+public:
+    // Verifies every method of the classes, and lays them out along with their reference maps.
+    static ErrorOr<ByteBuffer> try_create(Span<const NonnullRefPtr<ClassFile>>);
+
+    // Only checks that what the archive says is in it is where it says, which is cheap. The classes themselves are
+    // parsed when they are loaded.
+    static ErrorOr<NonnullRefPtr<ClassArchive>> try_open(NonnullRefPtr<Core::MappedFile>);
+
+    // The index of the class with the name, to load it by.
+    Optional<size_t> find(StringView name) const;
+    // Fails if the class or its reference maps have been changed since the archive was made.
+    ErrorOr<NonnullRefPtr<ClassFile>> try_load(size_t class_index) const;
+
+    // For a method of a class that was loaded from here, by its index in the methods of the class.
+    ErrorOr<NonnullOwnPtr<ReferenceMaps>> try_create_reference_maps(size_t class_index, size_t method_index,
+                                                                    const DecodedCode&) const;
+
+private:
+    struct Header;
+    struct ClassEntry;
+    struct MethodEntry;
+
+    explicit ClassArchive(NonnullRefPtr<Core::MappedFile> file) : m_file(move(file)) {}
+
+    const ClassEntry& class_entry(size_t class_index) const;
+    Span<const MethodEntry> method_entries(const ClassEntry&) const;
+    Span<const u32> u32s_at(u32 offset, u32 count) const;
+
+    NonnullRefPtr<Core::MappedFile> m_file;
+    // The names are views into the file.
+    HashMap<StringView, size_t> m_class_indices;
+};
+}
\ No newline at end of file
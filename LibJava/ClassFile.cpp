@@ -1,24 +1,82 @@
+#include <AK/MemoryStream.h>
 #include <LibJava/ClassFile.h>
 
 namespace Java
 {
 constexpr u32 class_file_magic = 0xCAFEBABE;
 
-ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
+// Takes the next bytes of the class file as a view of them, instead of copying them out.
+static ErrorOr<ReadonlyBytes> read_view(InputMemoryStream& stream, size_t length)
 {
+    if (length > stream.remaining())
+        return Error::from_string_literal("Class file is truncated");
+
+    auto view = stream.bytes().slice(stream.offset(), length);
+    stream.discard_or_error(length);
+    return view;
+}
+
+static ReadonlyBytes all_bytes_of(const Variant<Empty, ByteBuffer, NonnullRefPtr<Core::MappedFile>>& owner)
+{
+    return owner.visit([](Empty) -> ReadonlyBytes { VERIFY_NOT_REACHED(); },
+                       [](const ByteBuffer& buffer) { return buffer.bytes(); },
+                       [](const NonnullRefPtr<Core::MappedFile>& file) { return file->bytes(); });
+}
+
+ClassFile::ClassFile(Variant<Empty, ByteBuffer, NonnullRefPtr<Core::MappedFile>> owner, Optional<ReadonlyBytes> bytes)
+    : m_owner(move(owner)), m_bytes(bytes.has_value() ? bytes.value() : all_bytes_of(m_owner)), m_arena(m_bytes.size())
+{
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> ClassFile::try_parse(ByteBuffer bytes)
+{
+    auto class_file = adopt_ref(*new ClassFile(move(bytes), {}));
+    TRY(class_file->parse());
+    return class_file;
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> ClassFile::try_parse(NonnullRefPtr<Core::MappedFile> file)
+{
+    auto class_file = adopt_ref(*new ClassFile(move(file), {}));
+    TRY(class_file->parse());
+    return class_file;
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> ClassFile::try_parse(NonnullRefPtr<Core::MappedFile> file, ReadonlyBytes part)
+{
+    auto class_file = adopt_ref(*new ClassFile(move(file), part));
+    TRY(class_file->parse());
+    return class_file;
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> ClassFile::try_parse_unowned(ReadonlyBytes bytes)
+{
+    auto class_file = adopt_ref(*new ClassFile(Empty{}, bytes));
+    TRY(class_file->parse());
+    return class_file;
+}
+
+ErrorOr<void> ClassFile::parse()
+{
+    InputMemoryStream stream(m_bytes);
+
     BigEndian<u32> magic;
     stream >> magic;
 
     if (magic != class_file_magic)
         return Error::from_string_literal("Invalid file magic");
 
-    ClassFile class_file;
-    stream >> class_file.m_minor_version;
-    stream >> class_file.m_major_version;
+    stream >> m_minor_version;
+    stream >> m_major_version;
 
     BigEndian<u16> constant_pool_count;
     stream >> constant_pool_count;
-    for (auto i = 0; i < constant_pool_count - 1; i++)
+    if (constant_pool_count == 0)
+        return Error::from_string_literal("Constant pool count is zero");
+
+    auto& constant_pool = m_constant_pool;
+    constant_pool = arena().make_array<ConstantType>(constant_pool_count - 1);
+    for (size_t i = 0; i < constant_pool.size(); i++)
     {
         u8 tag;
         stream >> tag;
@@ -32,20 +90,17 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 BigEndian<u16> length;
                 stream >> length;
 
-                auto buffer = TRY(ByteBuffer::create_uninitialized(length));
-                stream >> buffer;
-
                 Utf8 constant;
-                constant.value = move(buffer);
+                constant.value = StringView(TRY(read_view(stream, length)));
 
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 3:
             {
                 BigEndian<i32> constant;
                 stream >> constant;
-                class_file.m_constant_pool.append(Integer(constant));
+                constant_pool[i] = Integer(constant);
             }
             break;
             case 4:
@@ -55,16 +110,17 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 stream >> constant;
                 auto constant_value = constant.operator unsigned int();
                 auto* constant_value_as_float = reinterpret_cast<float*>(&constant_value);
-                class_file.m_constant_pool.append(Float(*constant_value_as_float));
+                constant_pool[i] = Float(*constant_value_as_float);
             }
             break;
             case 5:
             {
                 BigEndian<i64> constant;
                 stream >> constant;
-                class_file.m_constant_pool.append(Long(constant));
                 // The constant_pool index n+1 must be valid but is considered unusable.
-                class_file.m_constant_pool.append({});
+                if (i + 1 == constant_pool.size())
+                    return Error::from_string_literal("Constant pool ends in the middle of an 8-byte constant");
+                constant_pool[i] = Long(constant);
                 // ... the next usable entry in the table is located at index n+2
                 i++;
             }
@@ -76,9 +132,10 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 stream >> constant;
                 auto constant_value = constant.operator unsigned long();
                 auto* constant_value_as_double = reinterpret_cast<double*>(&constant_value);
-                class_file.m_constant_pool.append(Double(*constant_value_as_double));
                 // The constant_pool index n+1 must be valid but is considered unusable.
-                class_file.m_constant_pool.append({});
+                if (i + 1 == constant_pool.size())
+                    return Error::from_string_literal("Constant pool ends in the middle of an 8-byte constant");
+                constant_pool[i] = Double(*constant_value_as_double);
                 // ... the next usable entry in the table is located at index n+2
                 i++;
             }
@@ -87,14 +144,14 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
             {
                 Class constant;
                 stream >> constant.name_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 8:
             {
                 String constant;
                 stream >> constant.string_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 9:
@@ -102,7 +159,7 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 FieldRef constant;
                 stream >> constant.class_index;
                 stream >> constant.name_and_type_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 10:
@@ -110,7 +167,7 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 MethodRef constant;
                 stream >> constant.class_index;
                 stream >> constant.name_and_type_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 11:
@@ -118,7 +175,7 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 InterfaceMethodRef constant;
                 stream >> constant.class_index;
                 stream >> constant.name_and_type_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 12:
@@ -126,7 +183,7 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 NameAndType constant;
                 stream >> constant.name_index;
                 stream >> constant.descriptor_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 15:
@@ -134,14 +191,14 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 MethodHandle constant;
                 stream >> constant.reference_kind;
                 stream >> constant.reference_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 16:
             {
                 MethodType constant;
                 stream >> constant.descriptor_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 17:
@@ -149,7 +206,7 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 Dynamic constant;
                 stream >> constant.bootstrap_method_attr_index;
                 stream >> constant.name_and_type_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 18:
@@ -157,21 +214,21 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
                 InvokeDynamic constant;
                 stream >> constant.bootstrap_method_attr_index;
                 stream >> constant.name_and_type_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 19:
             {
                 Module constant;
                 stream >> constant.name_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             case 20:
             {
                 Package constant;
                 stream >> constant.name_index;
-                class_file.m_constant_pool.append(move(constant));
+                constant_pool[i] = move(constant);
             }
             break;
             default:
@@ -186,139 +243,173 @@ ErrorOr<ClassFile> ClassFile::try_parse(InputStream& stream)
     stream >> access_flags;
     stream >> this_class;
     stream >> super_class;
-    class_file.m_access_flags = static_cast<AccessFlags>(access_flags.operator unsigned short());
-    class_file.m_this_class = this_class;
-    class_file.m_super_class = super_class;
+    m_access_flags = static_cast<AccessFlags>(access_flags.operator unsigned short());
+    m_this_class = this_class;
+    m_super_class = super_class;
 
     BigEndian<u16> interfaces_count;
     stream >> interfaces_count;
 
+    auto interfaces = arena().make_array<const Class*>(interfaces_count);
     for (auto i = 0; i < interfaces_count; i++)
     {
         BigEndian<u16> interface_index;
         stream >> interface_index;
-        auto& interface = class_file.m_constant_pool.at(interface_index - 1);
+        auto& interface = m_constant_pool.at(interface_index - 1);
         if (!interface.has<Class>())
             return Error::from_string_literal("Interface index into constant pool is not a Class");
 
-        auto& interface_name_index = class_file.m_constant_pool.at(interface.get<Class>().name_index - 1);
+        auto& interface_name_index = m_constant_pool.at(interface.get<Class>().name_index - 1);
         if (!interface_name_index.has<Utf8>())
             return Error::from_string_literal("Interface name index into constant pool is not a Utf8");
 
-        class_file.m_interfaces.append(interface.get_pointer<Class>());
+        interfaces[i] = interface.get_pointer<Class>();
     }
+    m_interfaces = interfaces;
 
     BigEndian<u16> fields_count;
     stream >> fields_count;
 
+    m_fields = arena().make_array<FieldInfo>(fields_count);
     for (auto i = 0; i < fields_count; i++)
     {
-        FieldInfo info;
+        auto& info = m_fields[i];
         BigEndian<u16> field_access_flags;
         stream >> field_access_flags;
         stream >> info.name_index;
         stream >> info.descriptor_index;
         info.access_flags = static_cast<FieldInfo::AccessFlags>(field_access_flags.operator unsigned short());
 
-        if (!class_file.m_constant_pool.at(info.name_index - 1).has<Utf8>())
+        if (!m_constant_pool.at(info.name_index - 1).has<Utf8>())
             return Error::from_string_literal("Field name index into constant pool is not a Utf8");
 
-        if (!class_file.m_constant_pool.at(info.descriptor_index - 1).has<Utf8>())
+        if (!m_constant_pool.at(info.descriptor_index - 1).has<Utf8>())
             return Error::from_string_literal("Field descriptor index into constant pool is not a Utf8");
 
         BigEndian<u16> attribute_count;
         stream >> attribute_count;
-        for (auto j = 0; j < attribute_count; j++)
+        // TODO: Verify these attributes are applicable to fields
+        info.attributes = try_parse_attributes(stream, attribute_count);
+        for (auto& attribute : info.attributes)
         {
-            BigEndian<u16> attribute_name_index;
-            stream >> attribute_name_index;
-
-            auto& name = class_file.m_constant_pool.at(attribute_name_index - 1).get<Utf8>();
-            // TODO: Verify this attribute is applicable to fields
-            auto attribute_or_error = class_file.try_parse_attribute(stream, name);
-
-            // FIXME: This should be fatal
-            if (!attribute_or_error.is_error())
-            {
-                info.attributes.append(attribute_or_error.release_value());
-
-                auto& attribute_in_vector = info.attributes.last();
-                if (attribute_in_vector.has<ConstantValue>())
-                    info.constant_value = info.attributes.last().get_pointer<ConstantValue>();
-            }
+            if (attribute.has<ConstantValue>())
+                info.constant_value = attribute.get_pointer<ConstantValue>();
         }
-
-        class_file.m_fields.append(move(info));
     }
 
     BigEndian<u16> method_count;
     stream >> method_count;
 
+    m_methods = arena().make_array<MethodInfo>(method_count);
     for (auto i = 0; i < method_count; i++)
     {
-        MethodInfo info;
+        auto& info = m_methods[i];
         BigEndian<u16> method_access_flags;
         stream >> method_access_flags;
         stream >> info.name_index;
         stream >> info.descriptor_index;
         info.access_flags = static_cast<MethodInfo::AccessFlags>(method_access_flags.operator unsigned short());
 
-        if (!class_file.m_constant_pool.at(info.name_index - 1).has<Utf8>())
+        if (!m_constant_pool.at(info.name_index - 1).has<Utf8>())
             return Error::from_string_literal("Method name index into constant pool is not a Utf8");
 
-        if (!class_file.m_constant_pool.at(info.descriptor_index - 1).has<Utf8>())
+        if (!m_constant_pool.at(info.descriptor_index - 1).has<Utf8>())
             return Error::from_string_literal("Method descriptor index into constant pool is not a Utf8");
 
         BigEndian<u16> attribute_count;
         stream >> attribute_count;
+        Vector<Attribute, 4> attributes;
         for (auto j = 0; j < attribute_count; j++)
         {
             BigEndian<u16> attribute_name_index;
             stream >> attribute_name_index;
 
-            auto& name = class_file.m_constant_pool.at(attribute_name_index - 1).get<Utf8>();
+            auto& name = m_constant_pool.at(attribute_name_index - 1).get<Utf8>();
+            if (name.value == "Code"sv)
+            {
+                // 4.7.3: "If the method is either native or abstract [...], its method_info structure must not have a
+                // Code attribute in its attributes table. Otherwise, its method_info structure must have exactly one
+                // Code attribute"
+                if (info.code_attribute.has_value())
+                    return Error::from_string_literal("Method has more than one Code attribute");
+
+                BigEndian<u32> attribute_length;
+                stream >> attribute_length;
+                info.code_attribute = TRY(read_view(stream, attribute_length));
+                continue;
+            }
+
             // TODO: Verify this attribute is applicable to methods
-            auto attribute_or_error = class_file.try_parse_attribute(stream, name);
+            auto attribute_or_error = try_parse_attribute(stream, name);
 
             // FIXME: This should be fatal
             if (!attribute_or_error.is_error())
-            {
-                info.attributes.append(attribute_or_error.release_value());
-
-                auto& attribute_in_vector = info.attributes.last();
-                if (attribute_in_vector.has<Code>())
-                    info.code = info.attributes.last().get_pointer<Code>();
-            }
+                attributes.append(attribute_or_error.release_value());
         }
+        info.attributes = arena().copy<Attribute>(attributes.span());
+
+        MethodKey key{m_constant_pool[info.name_index - 1].get<Utf8>().value,
+                      m_constant_pool[info.descriptor_index - 1].get<Utf8>().value};
+        if (m_method_table.contains(key))
+            return Error::from_string_literal("Class has two methods with the same name and descriptor");
 
-        class_file.m_methods.append(move(info));
+        m_method_table.set(key, i);
     }
 
     BigEndian<u16> attributes_count;
     stream >> attributes_count;
+    // TODO: Verify these attributes are applicable to class files
+    m_attributes = try_parse_attributes(stream, attributes_count);
+
+    // The class file must not be truncated or have extra bytes at the end.
+    if (!stream.unreliable_eof())
+        return Error::from_string_literal("Class file has extra bytes at the end");
+
+    return {};
+}
+
+const ClassFile::MethodInfo* ClassFile::find_method(StringView name, StringView descriptor) const
+{
+    auto index = m_method_table.get({name, descriptor});
+    if (!index.has_value())
+        return nullptr;
+
+    return &m_methods[index.value()];
+}
 
-    for (auto i = 0; i < attributes_count; i++)
+ErrorOr<const ClassFile::Code*> ClassFile::MethodInfo::code(const ClassFile& class_file) const
+{
+    if (!parsed_code)
+    {
+        if (!code_attribute.has_value())
+            return Error::from_string_literal("Method has no Code attribute");
+
+        parsed_code = TRY(class_file.try_parse_code(*code_attribute));
+    }
+
+    return parsed_code;
+}
+
+Span<const ClassFile::Attribute> ClassFile::try_parse_attributes(InputMemoryStream& stream, u16 count) const
+{
+    Vector<Attribute, 4> attributes;
+    for (auto i = 0; i < count; i++)
     {
         BigEndian<u16> attribute_name_index;
         stream >> attribute_name_index;
 
-        auto& name = class_file.m_constant_pool.at(attribute_name_index - 1).get<Utf8>();
-        // TODO: Verify this attribute is applicable to class files
-        auto attribute_or_error = class_file.try_parse_attribute(stream, name);
+        auto& name = m_constant_pool.at(attribute_name_index - 1).get<Utf8>();
+        auto attribute_or_error = try_parse_attribute(stream, name);
 
         // FIXME: This should be fatal
         if (!attribute_or_error.is_error())
-            class_file.m_attributes.append(attribute_or_error.release_value());
+            attributes.append(attribute_or_error.release_value());
     }
 
-    // The class file must not be truncated or have extra bytes at the end.
-    if (!stream.unreliable_eof())
-        return Error::from_string_literal("Class file has extra bytes at the end");
-
-    return class_file;
+    return arena().copy<Attribute>(attributes.span());
 }
 
-ErrorOr<ClassFile::Attribute> ClassFile::try_parse_attribute(InputStream& stream, Utf8& name)
+ErrorOr<ClassFile::Attribute> ClassFile::try_parse_attribute(InputMemoryStream& stream, const Utf8& name) const
 {
     BigEndian<u32> attribute_length;
     stream >> attribute_length;
@@ -330,57 +421,164 @@ ErrorOr<ClassFile::Attribute> ClassFile::try_parse_attribute(InputStream& stream
 
         return attribute;
     }
-    else if (name.value == "Code"sv)
+    else if (name.value == "ConstantValue"sv)
     {
-        Code code;
-        BigEndian<u32> code_length;
+        ConstantValue attribute;
+        stream >> attribute.constant_value_index;
 
-        stream >> code.max_stacks;
-        stream >> code.max_locals;
-        stream >> code_length;
+        return attribute;
+    }
+    else if (name.value == "StackMapTable"sv)
+    {
+        // Frames come in many sizes, so the attribute is taken in one go, and a broken one doesn't throw off the rest.
+        return TRY(try_parse_stack_map_table(TRY(read_view(stream, attribute_length))));
+    }
+    else
+    {
+        stream.discard_or_error(attribute_length);
+        return Error::from_string_literal(AK::String::formatted("Don't know how to parse attribute {}", name.value));
+    }
+}
 
-        code.code.resize(code_length);
-        stream >> code.code.span();
+// 4.7.3 The Code Attribute
+ErrorOr<const ClassFile::Code*> ClassFile::try_parse_code(ReadonlyBytes bytes) const
+{
+    InputMemoryStream stream(bytes);
 
-        BigEndian<u16> exception_table_length;
-        stream >> exception_table_length;
-        code.exception_table.resize(exception_table_length);
+    Code code;
+    BigEndian<u32> code_length;
 
-        for (auto i = 0; i < exception_table_length; i++)
-        {
-            auto& exception_handler = code.exception_table[i];
-            stream >> exception_handler.start_pc;
-            stream >> exception_handler.end_pc;
-            stream >> exception_handler.handler_pc;
-            stream >> exception_handler.catch_type;
-        }
+    stream >> code.max_stacks;
+    stream >> code.max_locals;
+    stream >> code_length;
 
-        BigEndian<u16> code_attributes_count;
-        stream >> code_attributes_count;
+    code.code = TRY(read_view(stream, code_length));
 
-        for (auto i = 0; i < code_attributes_count; i++)
-        {
-            BigEndian<u16> code_attribute_name_index;
-            stream >> code_attribute_name_index;
+    BigEndian<u16> exception_table_length;
+    stream >> exception_table_length;
+    auto exception_table = TRY(read_view(stream, exception_table_length * sizeof(Code::ExceptionHandler)));
+    code.exception_table = {reinterpret_cast<const Code::ExceptionHandler*>(exception_table.data()),
+                            exception_table_length};
 
-            auto& code_attribute_name = m_constant_pool.at(code_attribute_name_index - 1).get<Utf8>();
-            // TODO: Don't discard these attributes
-            (void)try_parse_attribute(stream, code_attribute_name);
-        }
+    BigEndian<u16> code_attributes_count;
+    stream >> code_attributes_count;
 
-        return code;
-    }
-    else if (name.value == "ConstantValue"sv)
+    for (auto i = 0; i < code_attributes_count; i++)
     {
-        ConstantValue attribute;
-        stream >> attribute.constant_value_index;
+        BigEndian<u16> code_attribute_name_index;
+        stream >> code_attribute_name_index;
 
-        return attribute;
+        auto& code_attribute_name = m_constant_pool.at(code_attribute_name_index - 1).get<Utf8>();
+        auto code_attribute = try_parse_attribute(stream, code_attribute_name);
+        if (!code_attribute.is_error() && code_attribute.value().has<StackMapTable>())
+            code.stack_map_table = move(code_attribute.value().get<StackMapTable>());
     }
-    else
+
+    if (stream.handle_any_error() || !stream.unreliable_eof())
+        return Error::from_string_literal("Code is not as long as its attribute");
+
+    return &arena().make<Code>(move(code));
+}
+
+ErrorOr<ClassFile::StackMapTable> ClassFile::try_parse_stack_map_table(ReadonlyBytes bytes) const
+{
+    InputMemoryStream stream(bytes);
+
+    auto read_types = [&](Span<const VerificationTypeInfo>& types, size_t count) -> ErrorOr<void> {
+        auto infos = arena().make_array<VerificationTypeInfo>(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            u8 tag;
+            stream >> tag;
+            if (tag > to_underlying(VerificationTypeInfo::Tag::Uninitialized))
+                return Error::from_string_literal("StackMapTable has unknown verification type");
+
+            VerificationTypeInfo type;
+            type.tag = static_cast<VerificationTypeInfo::Tag>(tag);
+            if (type.tag == VerificationTypeInfo::Tag::Object || type.tag == VerificationTypeInfo::Tag::Uninitialized)
+            {
+                BigEndian<u16> operand;
+                stream >> operand;
+                type.operand = operand;
+            }
+            infos[i] = type;
+        }
+
+        types = infos;
+        return {};
+    };
+
+    BigEndian<u16> number_of_entries;
+    stream >> number_of_entries;
+
+    auto entries = arena().make_array<StackMapFrame>(number_of_entries);
+    for (auto i = 0; i < number_of_entries; i++)
     {
-        stream.discard_or_error(attribute_length);
-        return Error::from_string_literal(AK::String::formatted("Don't know how to parse attribute {}", name.value));
+        u8 frame_type;
+        stream >> frame_type;
+
+        auto& frame = entries[i];
+        auto read_offset_delta = [&] {
+            BigEndian<u16> offset_delta;
+            stream >> offset_delta;
+            frame.offset_delta = offset_delta;
+        };
+
+        if (frame_type <= 63)
+        {
+            frame.kind = StackMapFrame::Kind::Same;
+            frame.offset_delta = frame_type;
+        }
+        else if (frame_type <= 127)
+        {
+            frame.kind = StackMapFrame::Kind::SameLocals1StackItem;
+            frame.offset_delta = frame_type - 64;
+            TRY(read_types(frame.stack, 1));
+        }
+        // "Frame types in the range 128-246 are reserved for future use."
+        else if (frame_type <= 246)
+        {
+            return Error::from_string_literal("StackMapTable has reserved frame type");
+        }
+        else if (frame_type == 247)
+        {
+            frame.kind = StackMapFrame::Kind::SameLocals1StackItem;
+            read_offset_delta();
+            TRY(read_types(frame.stack, 1));
+        }
+        else if (frame_type <= 250)
+        {
+            frame.kind = StackMapFrame::Kind::Chop;
+            frame.chopped_locals = 251 - frame_type;
+            read_offset_delta();
+        }
+        else if (frame_type == 251)
+        {
+            frame.kind = StackMapFrame::Kind::Same;
+            read_offset_delta();
+        }
+        else if (frame_type <= 254)
+        {
+            frame.kind = StackMapFrame::Kind::Append;
+            read_offset_delta();
+            TRY(read_types(frame.locals, frame_type - 251));
+        }
+        else
+        {
+            frame.kind = StackMapFrame::Kind::Full;
+            read_offset_delta();
+            BigEndian<u16> number_of_locals;
+            stream >> number_of_locals;
+            TRY(read_types(frame.locals, number_of_locals));
+            BigEndian<u16> number_of_stack_items;
+            stream >> number_of_stack_items;
+            TRY(read_types(frame.stack, number_of_stack_items));
+        }
     }
+
+    if (stream.handle_any_error() || !stream.unreliable_eof())
+        return Error::from_string_literal("StackMapTable is not as long as its attribute");
+
+    return StackMapTable{entries};
 }
 }
\ No newline at end of file
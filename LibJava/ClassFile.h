@@ -1,18 +1,31 @@
 #pragma once
 
+#include <AK/ByteBuffer.h>
 #include <AK/EnumBits.h>
 #include <AK/Error.h>
-#include <AK/Stream.h>
+#include <AK/HashMap.h>
+#include <AK/MemoryStream.h>
+#include <AK/Noncopyable.h>
+#include <AK/RefCounted.h>
+#include <AK/RefPtr.h>
 #include <AK/String.h>
 #include <AK/Variant.h>
 #include <AK/Vector.h>
+#include <LibCore/MappedFile.h>
+#include <LibJava/Arena.h>
 #include <LibJava/Types.h>
 
 namespace Java
 {
 // 4.1 The ClassFile Structure
-class ClassFile
+// A class is parsed once, and everything that uses it shares it from there on, VMs included. Nothing about it changes
+// after parsing, except that the Code of a method is parsed the first time it is asked for, which isn't synchronized:
+// VMs that share a class have to run on the same thread.
+class ClassFile : public RefCounted<ClassFile>
 {
+    AK_MAKE_NONCOPYABLE(ClassFile);
+    AK_MAKE_NONMOVABLE(ClassFile);
+
 public:
     // Table 4.1-B. Class access and property modifiers
     // Table 4.5-A. Field access and property flags
@@ -22,7 +35,7 @@ public:
         Final = 0x0010,
         Super = 0x0020,
         Interface = 0x0200,
-        Abstract = 0x4000,
+        Abstract = 0x0400,
         Synthetic = 0x1000,
         Annotation = 0x2000,
         Enum = 0x4000,
@@ -67,8 +80,8 @@ public:
 
     struct Utf8
     {
-        // TODO: This is different than what the JVM Specification says. Is this okay?
-        AK::String value;
+        // A view of the bytes in the class file, which are modified UTF-8 (4.4.7) and not quite the same as UTF-8.
+        StringView value;
     };
 
     struct MethodHandle
@@ -114,24 +127,93 @@ public:
         BigEndian<u16> constant_value_index;
     };
 
+    // 4.7.4 The StackMapTable Attribute
+    struct VerificationTypeInfo
+    {
+        enum class Tag : u8
+        {
+            Top = 0,
+            Integer = 1,
+            Float = 2,
+            Double = 3,
+            Long = 4,
+            Null = 5,
+            UninitializedThis = 6,
+            Object = 7,
+            Uninitialized = 8,
+        };
+
+        Tag tag{};
+        // The constant pool index of the class for Object, the offset of the new instruction that created the object
+        // for Uninitialized.
+        u16 operand{};
+
+        // "The Long and Double types each take up two local variables or operand stack entries", while there is only
+        // one of these for them.
+        bool is_category_2() const { return tag == Tag::Long || tag == Tag::Double; }
+
+        bool is_reference() const
+        {
+            return tag == Tag::Null || tag == Tag::UninitializedThis || tag == Tag::Object ||
+                   tag == Tag::Uninitialized;
+        }
+    };
+
+    // The extended forms of the frame types are folded into the ones they extend, as they only differ in how big
+    // offset_delta can be.
+    struct StackMapFrame
+    {
+        enum class Kind : u8
+        {
+            // same_frame and same_frame_extended: the same locals as the previous frame, and an empty stack.
+            Same,
+            // same_locals_1_stack_item_frame and its extended form: the same locals, and one item on the stack.
+            SameLocals1StackItem,
+            // chop_frame: the same locals but for the last few, and an empty stack.
+            Chop,
+            // append_frame: the same locals and a few more, and an empty stack.
+            Append,
+            // full_frame
+            Full,
+        };
+
+        Kind kind{};
+        u16 offset_delta{};
+        // For Chop, how many locals are gone.
+        u8 chopped_locals{};
+        // The locals that are added for Append, and all of them for Full.
+        Span<const VerificationTypeInfo> locals;
+        Span<const VerificationTypeInfo> stack;
+    };
+
+    struct StackMapTable
+    {
+        Span<const StackMapFrame> entries;
+    };
+
+    // The code and the exception table are views of the bytes in the class file, which is why the exception handlers
+    // are laid out just like they are in there.
     struct Code
     {
-        struct ExceptionHandler
+        struct [[gnu::packed]] ExceptionHandler
         {
             BigEndian<u16> start_pc;
             BigEndian<u16> end_pc;
             BigEndian<u16> handler_pc;
             BigEndian<u16> catch_type;
         };
+        static_assert(sizeof(ExceptionHandler) == 8);
 
         BigEndian<u16> max_stacks;
         BigEndian<u16> max_locals;
-        Vector<u8> code;
-        Vector<ExceptionHandler> exception_table;
-        // TODO: Attributes
+        ReadonlyBytes code;
+        Span<const ExceptionHandler> exception_table;
+        // 4.7.4: "There may be at most one StackMapTable attribute in the attributes table of a Code attribute."
+        // The other attributes of a Code attribute aren't kept.
+        Optional<StackMapTable> stack_map_table;
     };
 
-    using Attribute = Variant<SourceFile, Code, ConstantValue>;
+    using Attribute = Variant<SourceFile, ConstantValue, StackMapTable>;
 
     struct FieldInfo
     {
@@ -152,8 +234,8 @@ public:
         BigEndian<u16> name_index;
         BigEndian<u16> descriptor_index;
 
-        Optional<ConstantValue*> constant_value;
-        Vector<Attribute> attributes;
+        Optional<const ConstantValue*> constant_value;
+        Span<const Attribute> attributes;
     };
 
     struct MethodInfo
@@ -178,8 +260,28 @@ public:
         BigEndian<u16> name_index;
         BigEndian<u16> descriptor_index;
 
-        Optional<Code*> code;
-        Vector<Attribute> attributes;
+        // Most methods of a class never run, so their Code attribute is only parsed the first time it is asked for,
+        // which needs the constant pool of the class file the method is in.
+        bool has_code() const { return code_attribute.has_value(); }
+        ErrorOr<const Code*> code(const ClassFile&) const;
+
+        // The bytes of the Code attribute, after its name and length, and what they have been parsed into so far.
+        Optional<ReadonlyBytes> code_attribute;
+        mutable const Code* parsed_code{};
+        Span<const Attribute> attributes;
+    };
+
+    // 4.6: "No two methods in one class file may have the same name and descriptor"
+    // The views point into the Utf8 entries of the constant pool.
+    struct MethodKey
+    {
+        StringView name;
+        StringView descriptor;
+
+        bool operator==(const MethodKey& other) const
+        {
+            return name == other.name && descriptor == other.descriptor;
+        }
     };
 
     // The Empty is specifically used for gaps in the constant pool table, which occur with Long and Double types
@@ -190,11 +292,22 @@ public:
         Variant<Class, FieldRef, MethodRef, InterfaceMethodRef, String, Integer, Float, Long, Double, NameAndType, Utf8,
                 MethodHandle, MethodType, Dynamic, InvokeDynamic, Module, Package, Empty>;
 
-    static ErrorOr<ClassFile> try_parse(InputStream&);
+    // The Utf8 constants and the code of methods are views of the bytes of the class file instead of copies of them,
+    // and everything else is allocated from an arena of the class file, so that parsing a class takes next to no
+    // allocations. These keep the bytes alive for as long as the ClassFile is.
+    static ErrorOr<NonnullRefPtr<ClassFile>> try_parse(ByteBuffer);
+    static ErrorOr<NonnullRefPtr<ClassFile>> try_parse(NonnullRefPtr<Core::MappedFile>);
+    // For a class file that is only part of what is mapped, as in a ClassArchive.
+    static ErrorOr<NonnullRefPtr<ClassFile>> try_parse(NonnullRefPtr<Core::MappedFile>, ReadonlyBytes part);
+    // The bytes stay with the caller, who has to keep them alive for as long as the ClassFile is.
+    static ErrorOr<NonnullRefPtr<ClassFile>> try_parse_unowned(ReadonlyBytes);
+
+    // What the class was parsed from, as it is in the class file.
+    ReadonlyBytes bytes() const { return m_bytes; }
 
     AccessFlags access_flags() const { return m_access_flags; }
 
-    const Vector<ConstantType>& constant_pool() const { return m_constant_pool; }
+    Span<const ConstantType> constant_pool() const { return m_constant_pool; }
 
     const ClassFile::Class& this_class() const { return m_constant_pool[m_this_class - 1].get<Class>(); }
 
@@ -207,34 +320,46 @@ public:
     // java.lang.Object.
     bool has_super_class() const { return m_super_class != 0; }
 
-    const Vector<FieldInfo>& fields() const { return m_fields; }
+    Span<const FieldInfo> fields() const { return m_fields; }
 
-    const Vector<MethodInfo>& methods() const { return m_methods; }
+    Span<const MethodInfo> methods() const { return m_methods; }
 
-    const Vector<Attribute>& attributes() const { return m_attributes; }
+    // 5.4.3.3 Method Resolution
+    // Only looks at the methods declared by this class, not at any of its superclasses or superinterfaces.
+    const MethodInfo* find_method(StringView name, StringView descriptor) const;
 
-    bool operator==(const ClassFile& other) const
-    {
-        auto& this_name = constant_pool()[this_class().name_index - 1].get<Java::ClassFile::Utf8>();
-        auto& other_name = other.constant_pool()[other.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
-        return this_name.value == other_name.value;
-    }
+    Span<const Attribute> attributes() const { return m_attributes; }
 
 private:
-    ClassFile() = default;
+    // Without any bytes, the class file is all of what the owner has.
+    ClassFile(Variant<Empty, ByteBuffer, NonnullRefPtr<Core::MappedFile>> owner, Optional<ReadonlyBytes> bytes);
+    ErrorOr<void> parse();
+
+    // What the views point into, which is Empty when the caller owns it.
+    Variant<Empty, ByteBuffer, NonnullRefPtr<Core::MappedFile>> m_owner;
+    ReadonlyBytes m_bytes;
+    // Code that is parsed after the fact is allocated from this too, so it can be had from a const ClassFile.
+    mutable Arena m_arena;
     // Table 4.1-A. class file format major versions
     BigEndian<u16> m_minor_version;
     BigEndian<u16> m_major_version;
-    Vector<ConstantType> m_constant_pool;
+    Span<ConstantType> m_constant_pool;
     AccessFlags m_access_flags{};
     u16 m_this_class{};
     u16 m_super_class{};
-    Vector<Class*> m_interfaces;
-    Vector<FieldInfo> m_fields;
-    Vector<MethodInfo> m_methods;
-    Vector<Attribute> m_attributes;
-
-    ErrorOr<Attribute> try_parse_attribute(InputStream&, Utf8&);
+    Span<const Class*> m_interfaces;
+    Span<FieldInfo> m_fields;
+    Span<MethodInfo> m_methods;
+    // Indices into m_methods
+    HashMap<MethodKey, size_t> m_method_table;
+    Span<const Attribute> m_attributes;
+
+    Arena& arena() const { return m_arena; }
+    // The ones that can't be parsed are left out, which is why this may give back fewer than it is asked for.
+    Span<const Attribute> try_parse_attributes(InputMemoryStream&, u16 count) const;
+    ErrorOr<Attribute> try_parse_attribute(InputMemoryStream&, const Utf8&) const;
+    ErrorOr<const Code*> try_parse_code(ReadonlyBytes) const;
+    ErrorOr<StackMapTable> try_parse_stack_map_table(ReadonlyBytes) const;
 };
 
 AK_ENUM_BITWISE_OPERATORS(ClassFile::AccessFlags);
@@ -245,12 +370,11 @@ AK_ENUM_BITWISE_OPERATORS(ClassFile::MethodInfo::AccessFlags);
 namespace AK
 {
 template<>
-struct Traits<Java::ClassFile> : public GenericTraits<Java::ClassFile>
+struct Traits<Java::ClassFile::MethodKey> : public GenericTraits<Java::ClassFile::MethodKey>
 {
-    static unsigned hash(const Java::ClassFile& value)
+    static unsigned hash(const Java::ClassFile::MethodKey& value)
     {
-        auto& name = value.constant_pool()[value.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
-        return string_hash(name.value.characters(), name.value.length());
+        return pair_int_hash(value.name.hash(), value.descriptor.hash());
     }
 };
 }
\ No newline at end of file
@@ -0,0 +1,500 @@
+#include <LibJava/DecodedCode.h>
+
+namespace Java
+{
+namespace
+{
+class CodeReader
+{
+public:
+    explicit CodeReader(ReadonlyBytes code) : m_code(code) {}
+
+    bool has_bytes(size_t count) const { return m_offset + count <= m_code.size(); }
+
+    size_t offset() const { return m_offset; }
+
+    void skip(size_t count) { m_offset += count; }
+
+    u8 read_u8() { return m_code[m_offset++]; }
+
+    i8 read_i8() { return static_cast<i8>(read_u8()); }
+
+    u16 read_u16()
+    {
+        u16 value = m_code[m_offset] << 8 | m_code[m_offset + 1];
+        m_offset += 2;
+        return value;
+    }
+
+    i16 read_i16() { return static_cast<i16>(read_u16()); }
+
+    i32 read_i32()
+    {
+        u32 value = m_code[m_offset] << 24 | m_code[m_offset + 1] << 16 | m_code[m_offset + 2] << 8 |
+                    m_code[m_offset + 3];
+        m_offset += 4;
+        return static_cast<i32>(value);
+    }
+
+private:
+    ReadonlyBytes m_code;
+    size_t m_offset{};
+};
+
+// How many operand bytes follow the opcode, for everything that isn't variable-length.
+Optional<u8> operand_length(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::bipush:
+        case Opcode::ldc:
+        case Opcode::iload:
+        case Opcode::lload:
+        case Opcode::fload:
+        case Opcode::dload:
+        case Opcode::aload:
+        case Opcode::istore:
+        case Opcode::lstore:
+        case Opcode::fstore:
+        case Opcode::dstore:
+        case Opcode::astore:
+        case Opcode::ret:
+        case Opcode::newarray:
+            return 1;
+        case Opcode::sipush:
+        case Opcode::ldc_w:
+        case Opcode::ldc2_w:
+        case Opcode::iinc:
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+        case Opcode::goto_:
+        case Opcode::jsr:
+        case Opcode::getstatic:
+        case Opcode::putstatic:
+        case Opcode::getfield:
+        case Opcode::putfield:
+        case Opcode::invokevirtual:
+        case Opcode::invokespecial:
+        case Opcode::invokestatic:
+        case Opcode::new_:
+        case Opcode::anewarray:
+        case Opcode::checkcast:
+        case Opcode:: instanceof:
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+            return 2;
+        case Opcode::multianewarray:
+            return 3;
+        case Opcode::invokeinterface:
+        case Opcode::invokedynamic:
+        case Opcode::goto_w:
+        case Opcode::jsr_w:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+bool is_branch(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+        case Opcode::goto_:
+        case Opcode::jsr:
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Loads and stores with the local variable index baked into the opcode (iload_0, astore_3, ...) are turned into
+// their general form, so the interpreter only has to deal with one of each.
+Optional<Instruction> expand_implicit_local_index(Opcode opcode)
+{
+    auto value = static_cast<u8>(opcode);
+
+    if (value >= static_cast<u8>(Opcode::iload_0) && value <= static_cast<u8>(Opcode::aload_3))
+    {
+        auto group = (value - static_cast<u8>(Opcode::iload_0)) / 4;
+        auto index = (value - static_cast<u8>(Opcode::iload_0)) % 4;
+        return Instruction{static_cast<Opcode>(static_cast<u8>(Opcode::iload) + group), 0, index, 0};
+    }
+
+    if (value >= static_cast<u8>(Opcode::istore_0) && value <= static_cast<u8>(Opcode::astore_3))
+    {
+        auto group = (value - static_cast<u8>(Opcode::istore_0)) / 4;
+        auto index = (value - static_cast<u8>(Opcode::istore_0)) % 4;
+        return Instruction{static_cast<Opcode>(static_cast<u8>(Opcode::istore) + group), 0, index, 0};
+    }
+
+    return {};
+}
+
+// The value an instruction pushes, if all it does is push a constant int.
+Optional<i32> int_constant(const Instruction& instruction, const ClassFile& class_file)
+{
+    switch (instruction.opcode)
+    {
+        case Opcode::iconst_m1:
+        case Opcode::iconst_0:
+        case Opcode::iconst_1:
+        case Opcode::iconst_2:
+        case Opcode::iconst_3:
+        case Opcode::iconst_4:
+        case Opcode::iconst_5:
+            return static_cast<u8>(instruction.opcode) - static_cast<u8>(Opcode::iconst_0);
+        case Opcode::bipush:
+        case Opcode::sipush:
+            return instruction.operand;
+        case Opcode::ldc:
+        {
+            auto& value = class_file.constant_pool()[instruction.operand - 1];
+            if (value.has<Integer>())
+                return value.get<Integer>().value();
+
+            return {};
+        }
+        default:
+            return {};
+    }
+}
+}
+
+ErrorOr<DecodedCode> DecodedCode::try_decode(const ClassFile::Code& code)
+{
+    if (code.code.is_empty())
+        return Error::from_string_literal("Code must not be empty");
+
+    DecodedCode decoded(code);
+
+    // Branches are decoded with the raw bytecode offset of their target, and fixed up to an instruction index
+    // once we know where every instruction starts.
+    Vector<i32> instruction_index_at_offset;
+    instruction_index_at_offset.resize(code.code.size());
+    for (auto& index : instruction_index_at_offset)
+        index = -1;
+
+    CodeReader reader(code.code);
+
+    while (reader.has_bytes(1))
+    {
+        auto pc = reader.offset();
+        auto opcode = static_cast<Opcode>(reader.read_u8());
+
+        if (!opcode_names.contains(opcode) || is_quick_opcode(opcode) || superinstruction_length(opcode) > 0)
+            return Error::from_string_literal("Encountered invalid opcode");
+
+        instruction_index_at_offset[pc] = decoded.m_instructions.size();
+
+        Instruction instruction{opcode, static_cast<u16>(pc), 0, 0};
+
+        if (auto expanded = expand_implicit_local_index(opcode); expanded.has_value())
+        {
+            instruction = expanded.release_value();
+            instruction.pc = pc;
+            decoded.m_instructions.append(instruction);
+            continue;
+        }
+
+        if (opcode == Opcode::tableswitch || opcode == Opcode::lookupswitch)
+        {
+            // 0-3 bytes of padding, so that the default offset starts at an address that is a multiple of four bytes
+            // from the start of the current method
+            reader.skip((4 - reader.offset() % 4) % 4);
+
+            if (!reader.has_bytes(8))
+                return Error::from_string_literal("Truncated switch instruction");
+
+            SwitchTable table;
+            table.default_target = pc + reader.read_i32();
+
+            if (opcode == Opcode::tableswitch)
+            {
+                if (!reader.has_bytes(8))
+                    return Error::from_string_literal("Truncated tableswitch");
+
+                auto low = reader.read_i32();
+                auto high = reader.read_i32();
+                if (low > high)
+                    return Error::from_string_literal("tableswitch low must be less than or equal to high");
+
+                auto count = static_cast<i64>(high) - low + 1;
+                if (!reader.has_bytes(count * 4))
+                    return Error::from_string_literal("Truncated tableswitch");
+
+                for (i64 i = 0; i < count; i++)
+                    table.cases.append({static_cast<i32>(low + i), static_cast<u32>(pc + reader.read_i32())});
+            }
+            else
+            {
+                auto count = reader.read_i32();
+                if (count < 0 || !reader.has_bytes(static_cast<size_t>(count) * 8))
+                    return Error::from_string_literal("Truncated lookupswitch");
+
+                for (auto i = 0; i < count; i++)
+                {
+                    auto key = reader.read_i32();
+                    // 6.5 lookupswitch: "The match-offset pairs are sorted in increasing numerical order by match."
+                    if (!table.cases.is_empty() && table.cases.last().key >= key)
+                        return Error::from_string_literal("lookupswitch keys must be sorted");
+
+                    table.cases.append({key, static_cast<u32>(pc + reader.read_i32())});
+                }
+            }
+
+            instruction.operand = decoded.m_switch_tables.size();
+            decoded.m_switch_tables.append(move(table));
+            decoded.m_instructions.append(instruction);
+            continue;
+        }
+
+        if (opcode == Opcode::wide)
+        {
+            if (!reader.has_bytes(3))
+                return Error::from_string_literal("Truncated wide instruction");
+
+            instruction.opcode = static_cast<Opcode>(reader.read_u8());
+            instruction.operand = reader.read_u16();
+
+            switch (instruction.opcode)
+            {
+                case Opcode::iload:
+                case Opcode::lload:
+                case Opcode::fload:
+                case Opcode::dload:
+                case Opcode::aload:
+                case Opcode::istore:
+                case Opcode::lstore:
+                case Opcode::fstore:
+                case Opcode::dstore:
+                case Opcode::astore:
+                case Opcode::ret:
+                    break;
+                case Opcode::iinc:
+                    if (!reader.has_bytes(2))
+                        return Error::from_string_literal("Truncated wide iinc");
+
+                    instruction.second_operand = reader.read_i16();
+                    break;
+                default:
+                    return Error::from_string_literal("wide used with an opcode that it cannot modify");
+            }
+
+            decoded.m_instructions.append(instruction);
+            continue;
+        }
+
+        auto length = operand_length(opcode).value();
+        if (!reader.has_bytes(length))
+            return Error::from_string_literal("Truncated instruction");
+
+        switch (opcode)
+        {
+            case Opcode::bipush:
+                instruction.operand = reader.read_i8();
+                break;
+            case Opcode::sipush:
+                instruction.operand = reader.read_i16();
+                break;
+            case Opcode::ldc_w:
+                instruction.opcode = Opcode::ldc;
+                instruction.operand = reader.read_u16();
+                break;
+            case Opcode::iinc:
+                instruction.operand = reader.read_u8();
+                instruction.second_operand = reader.read_i8();
+                break;
+            case Opcode::newarray:
+                instruction.second_operand = reader.read_u8();
+                break;
+            case Opcode::multianewarray:
+                instruction.operand = reader.read_u16();
+                instruction.second_operand = reader.read_u8();
+                break;
+            case Opcode::invokeinterface:
+                instruction.operand = reader.read_u16();
+                instruction.second_operand = reader.read_u8();
+                reader.skip(1);
+                break;
+            case Opcode::invokedynamic:
+                instruction.operand = reader.read_u16();
+                reader.skip(2);
+                break;
+            case Opcode::goto_w:
+                instruction.opcode = Opcode::goto_;
+                instruction.operand = pc + reader.read_i32();
+                break;
+            case Opcode::jsr_w:
+                instruction.opcode = Opcode::jsr;
+                instruction.operand = pc + reader.read_i32();
+                break;
+            default:
+                if (is_branch(opcode))
+                    instruction.operand = pc + reader.read_i16();
+                else if (length == 1)
+                    instruction.operand = reader.read_u8();
+                else if (length == 2)
+                    instruction.operand = reader.read_u16();
+                break;
+        }
+
+        decoded.m_instructions.append(instruction);
+    }
+
+    auto resolve_target = [&](i64 offset) -> ErrorOr<u32> {
+        if (offset < 0 || offset >= static_cast<i64>(instruction_index_at_offset.size()) ||
+            instruction_index_at_offset[offset] == -1)
+            return Error::from_string_literal("Branch target is not the start of an instruction");
+
+        return instruction_index_at_offset[offset];
+    };
+
+    for (auto& instruction : decoded.m_instructions)
+    {
+        if (is_branch(instruction.opcode))
+            instruction.operand = TRY(resolve_target(instruction.operand));
+    }
+
+    for (auto& table : decoded.m_switch_tables)
+    {
+        table.default_target = TRY(resolve_target(table.default_target));
+        for (auto& switch_case : table.cases)
+            switch_case.target = TRY(resolve_target(switch_case.target));
+    }
+
+    return decoded;
+}
+
+void DecodedCode::quicken(size_t instruction_index, Opcode opcode, i32 operand)
+{
+    VERIFY(is_quick_opcode(opcode));
+
+    auto& instruction = m_instructions[instruction_index];
+    instruction.opcode = opcode;
+    instruction.operand = operand;
+}
+
+void DecodedCode::quicken(size_t instruction_index, Opcode opcode, i32 operand, i32 second_operand)
+{
+    quicken(instruction_index, opcode, operand);
+    m_instructions[instruction_index].second_operand = second_operand;
+}
+
+// The sequences are the loop condition, the increment and the simplest loop body of a counted loop as javac emits it:
+// for (int i = 0; i < n; i++) value += i;
+// This is a fixed list. The opcode pairs javabench reports when built with PERIL_COUNT_INSTRUCTIONS can tell whether
+// another sequence would be worth adding to it, but nothing is picked from them when code is linked.
+void DecodedCode::fuse_superinstructions(const ClassFile& class_file)
+{
+    for (size_t i = 0; i < m_instructions.size(); i++)
+    {
+        auto& instruction = m_instructions[i];
+        auto followed_by = [&](size_t offset, Opcode opcode) {
+            return i + offset < m_instructions.size() && m_instructions[i + offset].opcode == opcode;
+        };
+
+        // Any branch into the middle of a sequence still finds the instructions it was fused from there, so it doesn't
+        // matter where the basic blocks start.
+        if (instruction.opcode == Opcode::iload)
+        {
+            if (followed_by(1, Opcode::iload) && followed_by(2, Opcode::iadd) && followed_by(3, Opcode::istore))
+            {
+                instruction.opcode = Opcode::iload_iload_iadd_istore;
+            }
+            else if (followed_by(1, Opcode::iload) && followed_by(2, Opcode::if_icmpge))
+            {
+                instruction.opcode = Opcode::iload_iload_if_icmpge;
+            }
+            else if (followed_by(2, Opcode::if_icmpge))
+            {
+                if (auto constant = int_constant(m_instructions[i + 1], class_file); constant.has_value())
+                {
+                    instruction.opcode = Opcode::iload_iconst_if_icmpge;
+                    instruction.second_operand = constant.value();
+                }
+            }
+        }
+        else if (instruction.opcode == Opcode::iinc && followed_by(1, Opcode::goto_))
+        {
+            instruction.opcode = Opcode::iinc_goto;
+        }
+
+        // Sequences never overlap, so that the instructions of one are left alone.
+        if (auto length = superinstruction_length(instruction.opcode); length > 0)
+            i += length - 1;
+    }
+}
+
+Vector<Instruction> DecodedCode::unfused_instructions() const
+{
+    auto instructions = m_instructions;
+
+    for (auto& instruction : instructions)
+    {
+        switch (instruction.opcode)
+        {
+            case Opcode::iload_iload_iadd_istore:
+            case Opcode::iload_iload_if_icmpge:
+                instruction.opcode = Opcode::iload;
+                break;
+            case Opcode::iload_iconst_if_icmpge:
+                instruction.opcode = Opcode::iload;
+                instruction.second_operand = 0;
+                break;
+            case Opcode::iinc_goto:
+                instruction.opcode = Opcode::iinc;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return instructions;
+}
+
+size_t DecodedCode::add_resolved_static_field(Slot* slot)
+{
+    m_resolved_static_fields.append(slot);
+    return m_resolved_static_fields.size() - 1;
+}
+
+size_t DecodedCode::add_resolved_method(ResolvedMethod* method)
+{
+    m_resolved_methods.append(method);
+    return m_resolved_methods.size() - 1;
+}
+
+size_t DecodedCode::add_resolved_class(const ResolvedClass* resolved_class)
+{
+    m_resolved_classes.append(resolved_class);
+    return m_resolved_classes.size() - 1;
+}
+}
\ No newline at end of file
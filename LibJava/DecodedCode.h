@@ -0,0 +1,113 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Vector.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/Opcode.h>
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+struct ResolvedClass;
+struct ResolvedMethod;
+
+// A single instruction of a Code attribute, with its operands already pulled out of the raw big-endian bytes.
+// Instructions that only differ by the width of their operands are folded together: iload_<n> becomes iload n,
+// wide iinc becomes iinc, goto_w becomes goto, ldc_w becomes ldc, and so on.
+struct Instruction
+{
+    Opcode opcode{};
+
+    // The offset of this instruction in the original code array, for anything that still speaks in terms of raw
+    // bytecode (exception tables, the disassembler, error messages).
+    // 4.7.3: "The value of code_length must be greater than zero (as the code array must not be empty) and less
+    // than 65536."
+    u16 pc{};
+
+    // What this operand means depends on the opcode:
+    // - the local variable index for loads, stores, iinc and ret
+    // - the (sign-extended) immediate value for bipush and sipush
+    // - the constant pool index for ldc, ldc2_w, field, method and class references
+    // - the index into the SwitchTable for tableswitch and lookupswitch
+    // - the index of the target instruction for branches
+    // - the index into the resolved static fields for getstatic_quick and putstatic_quick
+    // - the index into the resolved methods for invokestatic_quick and invokespecial_quick
+    // - the index into the resolved classes for new_quick and newarray_quick
+    // - the offset of the field into the object for the quick forms of getfield and putfield
+    // - the operand of the first instruction it was fused from for superinstructions
+    i32 operand{};
+
+    // The (sign-extended) constant for iinc, the dimensions for multianewarray, the count for invokeinterface,
+    // the primitive array type for newarray, the constant that is compared against for iload_iconst_if_icmpge and the
+    // index into the resolved classes for the quick forms of getfield and putfield.
+    i32 second_operand{};
+};
+
+struct SwitchTable
+{
+    struct Case
+    {
+        i32 key{};
+        u32 target{};
+    };
+
+    u32 default_target{};
+    // For tableswitch these are every key from low to high, for lookupswitch these are sorted by their key.
+    Vector<Case> cases;
+};
+
+class DecodedCode
+{
+public:
+    static ErrorOr<DecodedCode> try_decode(const ClassFile::Code&);
+
+    const Vector<Instruction>& instructions() const { return m_instructions; }
+
+    const Vector<SwitchTable>& switch_tables() const { return m_switch_tables; }
+
+    const ClassFile::Code& code() const { return *m_code; }
+
+    // Rewrites an instruction into its quick form, once whatever it refers to has been resolved.
+    void quicken(size_t instruction_index, Opcode, i32 operand);
+    void quicken(size_t instruction_index, Opcode, i32 operand, i32 second_operand);
+
+    // Rewrites the first instruction of every sequence that has a superinstruction into that superinstruction. This
+    // never adds, removes or moves instructions, so branch targets stay the same, and undoing it only takes rewriting
+    // the first instruction back.
+    void fuse_superinstructions(const ClassFile&);
+
+    // The instructions as they were before fuse_superinstructions, for anything that would rather not know about
+    // superinstructions.
+    Vector<Instruction> unfused_instructions() const;
+
+    Slot* resolved_static_field(size_t index) const { return m_resolved_static_fields[index]; }
+
+    size_t add_resolved_static_field(Slot*);
+
+    ResolvedMethod* resolved_method(size_t index) const { return m_resolved_methods[index]; }
+
+    size_t add_resolved_method(ResolvedMethod*);
+
+    const ResolvedClass* resolved_class(size_t index) const { return m_resolved_classes[index]; }
+
+    size_t add_resolved_class(const ResolvedClass*);
+
+#ifdef PERIL_THREADED_DISPATCH
+    // The address of the interpreter's handler for each instruction, filled in by VM::interpret.
+    Vector<void*>& threaded_code() { return m_threaded_code; }
+#endif
+
+private:
+    explicit DecodedCode(const ClassFile::Code& code) : m_code(&code) {}
+
+    const ClassFile::Code* m_code;
+    Vector<Instruction> m_instructions;
+    Vector<SwitchTable> m_switch_tables;
+    Vector<Slot*> m_resolved_static_fields;
+    Vector<ResolvedMethod*> m_resolved_methods;
+    Vector<const ResolvedClass*> m_resolved_classes;
+#ifdef PERIL_THREADED_DISPATCH
+    Vector<void*> m_threaded_code;
+#endif
+};
+}
\ No newline at end of file
@@ -104,6 +104,15 @@ ErrorOr<MethodDescriptor> MethodDescriptor::try_parse(StringView value)
     return descriptor;
 }
 
+bool FieldDescriptor::is_category_2() const
+{
+    if (m_array_dimensions > 0 || !m_type.has<PrimitiveType>())
+        return false;
+
+    auto type = m_type.get<PrimitiveType>();
+    return type == PrimitiveType::Long || type == PrimitiveType::Double;
+}
+
 String FieldDescriptor::to_string() const
 {
     StringBuilder builder;
@@ -117,6 +126,16 @@ String FieldDescriptor::to_string() const
     return builder.to_string();
 }
 
+size_t MethodDescriptor::parameter_slot_count() const
+{
+    size_t slots = 0;
+
+    for (auto& parameter : m_parameters)
+        slots += parameter.is_category_2() ? 2 : 1;
+
+    return slots;
+}
+
 String MethodDescriptor::parameters_to_string() const
 {
     StringBuilder builder;
@@ -30,6 +30,10 @@ public:
 
     void set_array_dimensions(u8 value) { m_array_dimensions = value; }
 
+    // 2.11.1: long and double are category 2 computational types, and take up two local variables or two units of
+    // operand stack depth.
+    bool is_category_2() const;
+
     String to_string() const;
 
 private:
@@ -47,6 +51,9 @@ public:
     const Vector<FieldDescriptor>& parameters() const { return m_parameters; }
     const Variant<FieldDescriptor, Empty>& return_type() const { return m_return_type; }
 
+    // How many local variables the parameters take up, which is not the same as how many parameters there are.
+    size_t parameter_slot_count() const;
+
     String return_type_to_string() const;
     String parameters_to_string() const;
     String to_string() const;
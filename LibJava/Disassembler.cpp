@@ -10,20 +10,11 @@ Disassembler::Disassembler(ClassFile& class_file) : m_class_file(class_file) {}
 //        Failing miserably isn't great but the error checking is in some places unnecessary
 ErrorOr<Vector<String>> Disassembler::disassemble(const ClassFile::MethodInfo& method)
 {
-    const ClassFile::Code* code = nullptr;
-
-    for (auto& attribute : method.attributes)
-    {
-        if (attribute.has<ClassFile::Code>())
-        {
-            code = attribute.get_pointer<ClassFile::Code>();
-            break;
-        }
-    }
-
-    if (!code)
+    if (!method.has_code())
         return Error::from_string_literal("Method does not have code");
 
+    auto* code = TRY(method.code(m_class_file));
+
     Vector<String> disassembled_instructions;
 
     for (auto i = 0; i < code->code.size(); i++)
@@ -32,7 +23,7 @@ ErrorOr<Vector<String>> Disassembler::disassemble(const ClassFile::MethodInfo& m
 
         auto op = static_cast<Java::Opcode>(code->code[i]);
         auto maybe_op_name = opcode_names.get(op);
-        if (!maybe_op_name.has_value())
+        if (!maybe_op_name.has_value() || is_quick_opcode(op) || superinstruction_length(op) > 0)
             return Error::from_string_literal("Encountered invalid opcode");
 
         auto op_name = maybe_op_name.release_value();
@@ -0,0 +1,194 @@
+#include <AK/QuickSort.h>
+#include <AK/StdLibExtras.h>
+#include <LibJava/ArrayKernels.h>
+#include <LibJava/GC/MarkCompact.h>
+
+namespace Java::GC
+{
+MarkCompact::MarkCompact(Heap& heap, const Heap::Roots& roots) : m_heap(heap), m_roots(roots) {}
+
+void MarkCompact::run()
+{
+    mark();
+    compute_destinations();
+    update_references();
+    move_objects();
+}
+
+void MarkCompact::mark()
+{
+    // Finding out whether an address is where an object starts means walking the objects on its card, which needs
+    // their headers as they are, so nothing is marked until that is done for all of them.
+    for (auto& slots : m_roots.ambiguous)
+    {
+        for (auto& slot : slots)
+        {
+            if (auto* object = m_heap.find_old_object(bit_cast<FlatPtr>(slot.as_reference())))
+                m_pinned_objects.append(object);
+        }
+    }
+
+    quick_sort(m_pinned_objects);
+    Vector<Object*> pinned_objects;
+    for (auto* object : m_pinned_objects)
+    {
+        if (object->header() & marked_bit)
+            continue;
+
+        object->header() |= marked_bit;
+        pinned_objects.append(object);
+        m_mark_stack.append(object);
+    }
+    m_pinned_objects = move(pinned_objects);
+
+    for (auto* root : m_roots.precise)
+    {
+        auto* referent = root->as_reference();
+        if (!m_heap.is_old(referent) || (referent->header() & marked_bit))
+            continue;
+
+        referent->header() |= marked_bit;
+        m_mark_stack.append(referent);
+    }
+
+    m_heap.for_each_young_object([&](Object* object) { mark_referents(*object, object->resolved_class()); });
+
+    while (!m_mark_stack.is_empty())
+    {
+        auto* object = m_mark_stack.take_last();
+        mark_referents(*object, *bit_cast<const ResolvedClass*>(object->header() & ~marked_bit));
+    }
+}
+
+void MarkCompact::mark_referents(const Object& object, const ResolvedClass& resolved_class)
+{
+    for (auto offset : resolved_class.reference_field_offsets)
+    {
+        auto* referent = object.read<Object*>(offset);
+        if (!m_heap.is_old(referent) || (referent->header() & marked_bit))
+            continue;
+
+        referent->header() |= marked_bit;
+        m_mark_stack.append(referent);
+    }
+}
+
+void MarkCompact::compute_destinations()
+{
+    auto* free = m_heap.m_old_base;
+    size_t next_pinned_object = 0;
+
+    for (auto* address = m_heap.m_old_base; address < m_heap.m_old_top;)
+    {
+        auto* object = reinterpret_cast<Object*>(address);
+        auto header = object->header();
+        auto& resolved_class = *bit_cast<const ResolvedClass*>(header & ~marked_bit);
+        auto size = Heap::size_of(*object, resolved_class);
+
+        if (header & marked_bit)
+        {
+            // Everything in front of a pinned object has always fit in front of it.
+            auto* destination = free;
+            if (next_pinned_object < m_pinned_objects.size() && m_pinned_objects[next_pinned_object] == object)
+            {
+                next_pinned_object++;
+                if (free < address)
+                    m_gaps.append({free, address});
+                destination = address;
+            }
+
+            object->header() = encode(destination, resolved_class);
+            free = destination + size;
+        }
+
+        address += size;
+    }
+
+    m_new_top = free;
+}
+
+void MarkCompact::update_references()
+{
+    // Whatever is dirty now is either garbage, or moving elsewhere. The cards are marked again for what is left, at
+    // where it is going.
+    auto first_card = m_heap.card_of(m_heap.m_old_base);
+    auto end_card = m_heap.card_of(m_heap.m_old_top + Heap::card_size - 1);
+    __builtin_memset(m_heap.m_card_table + first_card, 0, end_card - first_card);
+
+    for (auto* address = m_heap.m_old_base; address < m_heap.m_old_top;)
+    {
+        auto* object = reinterpret_cast<Object*>(address);
+        if (!(object->header() & marked_bit))
+        {
+            address += Heap::size_of(*object, object->resolved_class());
+            continue;
+        }
+
+        auto& resolved_class = class_of(*object);
+        auto* destination = destination_of(*object);
+        address += Heap::size_of(*object, resolved_class);
+
+        for (auto offset : resolved_class.reference_field_offsets)
+        {
+            auto* referent = object->read<Object*>(offset);
+            if (m_heap.is_old(referent))
+                object->write(offset, reinterpret_cast<Object*>(destination_of(*referent)));
+            else if (m_heap.is_young(referent))
+                m_heap.record_reference_store(reinterpret_cast<Object*>(destination), offset);
+        }
+    }
+
+    for (auto* root : m_roots.precise)
+    {
+        auto* referent = root->as_reference();
+        if (m_heap.is_old(referent))
+            *root = Slot::from_reference(reinterpret_cast<Object*>(destination_of(*referent)));
+    }
+
+    m_heap.for_each_young_object([&](Object* object) {
+        for (auto offset : object->resolved_class().reference_field_offsets)
+        {
+            auto* referent = object->read<Object*>(offset);
+            if (m_heap.is_old(referent))
+                object->write(offset, reinterpret_cast<Object*>(destination_of(*referent)));
+        }
+    });
+}
+
+void MarkCompact::move_objects()
+{
+    // Objects only ever move down, and never past the start of the one before them, so nothing gets overwritten
+    // before it has been moved itself.
+    for (auto* address = m_heap.m_old_base; address < m_heap.m_old_top;)
+    {
+        auto* object = reinterpret_cast<Object*>(address);
+        if (!(object->header() & marked_bit))
+        {
+            address += Heap::size_of(*object, object->resolved_class());
+            continue;
+        }
+
+        auto& resolved_class = class_of(*object);
+        auto* destination = destination_of(*object);
+        auto size = Heap::size_of(*object, resolved_class);
+        address += size;
+
+        if (destination != reinterpret_cast<u8*>(object))
+            ArrayKernels::copy(destination, reinterpret_cast<u8*>(object), size);
+        reinterpret_cast<Object*>(destination)->set_resolved_class(resolved_class);
+        m_heap.record_object_start(destination, size);
+    }
+
+    for (auto& gap : m_gaps)
+        m_heap.fill(gap.start, gap.end);
+
+    m_heap.m_old_used_before = max(m_heap.m_old_used_before, m_heap.m_old_top);
+    m_heap.m_old_top = m_new_top;
+}
+
+FlatPtr MarkCompact::encode(const u8* destination, const ResolvedClass& resolved_class) const
+{
+    auto offset = static_cast<FlatPtr>(destination - m_heap.m_base) / 8;
+    return offset << destination_shift | static_cast<FlatPtr>(resolved_class.id) << 1 | marked_bit;
+}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <LibJava/Heap.h>
+
+namespace Java::GC
+{
+// Collects the old generation by sliding whatever in it is still reachable down to its bottom, in the same order the
+// objects were in. This is the LISP2 algorithm, which takes four passes:
+// 1. Marking everything that is reachable. Every object in the young generation counts as reachable for this, whether
+//    it is or not, so that the young generation doesn't have to be collected along with it.
+// 2. Working out where each reachable object goes, from the bottom up.
+// 3. Updating every reference to an object in the old generation to where it goes.
+// 4. Moving the objects there.
+// There is no room in the header to keep where an object goes next to its class, so from the second pass on, the class
+// is swapped for its id, and the header is (where the object goes - base of the heap) / 8 << 24 | id << 1 | 1.
+// Objects that ambiguous roots point to are pinned, and stay where they are. Whatever room that leaves in front of them
+// is filled.
+class MarkCompact
+{
+public:
+    static constexpr u32 max_class_count = 1 << 23;
+
+    MarkCompact(Heap&, const Heap::Roots&);
+
+    void run();
+
+private:
+    static constexpr FlatPtr marked_bit = 1;
+    static constexpr u32 destination_shift = 24;
+
+    void mark();
+    void mark_referents(const Object&, const ResolvedClass&);
+    void compute_destinations();
+    void update_references();
+    void move_objects();
+
+    FlatPtr encode(const u8* destination, const ResolvedClass&) const;
+
+    ALWAYS_INLINE u8* destination_of(Object& object) const
+    {
+        return m_heap.m_base + (object.header() >> destination_shift) * 8;
+    }
+
+    ALWAYS_INLINE const ResolvedClass& class_of(Object& object) const
+    {
+        return *m_heap.m_classes[(object.header() >> 1) & (max_class_count - 1)];
+    }
+
+    Heap& m_heap;
+    const Heap::Roots& m_roots;
+    Vector<Object*> m_mark_stack;
+    // In the order they are in.
+    Vector<Object*> m_pinned_objects;
+    Vector<Heap::Range> m_gaps;
+    u8* m_new_top{};
+};
+}
\ No newline at end of file
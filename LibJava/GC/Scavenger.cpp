@@ -0,0 +1,324 @@
+#include <AK/BinarySearch.h>
+#include <AK/QuickSort.h>
+#include <LibJava/GC/Scavenger.h>
+#include <sched.h>
+
+namespace Java::GC
+{
+Scavenger::Scavenger(Heap& heap) : m_heap(heap), m_pool(heap.m_configuration.collector_threads)
+{
+    for (u32 worker = 0; worker < m_pool.worker_count(); worker++)
+        m_workers.append(make<Worker>());
+}
+
+void Scavenger::run(const Heap::Roots& roots)
+{
+    size_t young_bytes = 0;
+    for (auto& range : m_heap.m_young_ranges)
+        young_bytes += range.end - range.start;
+    for (auto* object : m_heap.m_pinned_young_objects)
+        young_bytes += Heap::size_of(*object, object->resolved_class());
+
+    m_pinned_objects = find_pinned_objects(roots);
+    size_t pinned_bytes = 0;
+    for (auto* object : m_pinned_objects)
+    {
+        pinned_bytes += Heap::size_of(*object, object->resolved_class());
+        object->header() |= pinned_bit;
+    }
+
+    // Copies go onto cards of their own, as the worker that scans the last card might otherwise clear it right after
+    // another one has marked it for one of them.
+    auto* scan_end = bit_cast<u8*>(align_up_to<FlatPtr>(bit_cast<FlatPtr>(m_heap.m_old_top), Heap::card_size));
+    m_heap.fill(m_heap.m_old_top, scan_end);
+    m_heap.m_old_top = scan_end;
+
+    m_precise_roots = &roots.precise;
+    m_next_precise_root.store(0);
+    m_next_pinned_object.store(0);
+    m_next_card.store(m_heap.card_of(m_heap.m_old_base));
+    m_end_card = m_heap.card_of(scan_end);
+    m_scan_end = scan_end;
+    m_old_top.store(bit_cast<FlatPtr>(m_heap.m_old_top));
+    m_idle_workers.store(0);
+
+    m_pool.run([this](u32 worker_index) { work(worker_index); });
+
+    u64 promoted_bytes = 0;
+    for (auto& worker : m_workers)
+    {
+        retire_promotion_buffer(*worker);
+        promoted_bytes += worker->promoted_bytes;
+        worker->promoted_bytes = 0;
+    }
+    m_heap.m_old_top = bit_cast<u8*>(m_old_top.load());
+
+    for (auto* object : m_pinned_objects)
+        object->header() &= ~pinned_bit;
+    m_precise_roots = nullptr;
+
+    m_heap.m_statistics.promoted_bytes += promoted_bytes;
+    m_heap.m_statistics.reclaimed_bytes += young_bytes - promoted_bytes - pinned_bytes;
+    m_heap.reset_young_generation(move(m_pinned_objects));
+}
+
+Vector<Object*> Scavenger::find_pinned_objects(const Heap::Roots& roots)
+{
+    Vector<FlatPtr> addresses;
+    for (auto& slots : roots.ambiguous)
+    {
+        for (auto& slot : slots)
+        {
+            auto address = bit_cast<FlatPtr>(slot.as_reference());
+            if (address % 8 == 0 && m_heap.is_young(bit_cast<void*>(address)))
+                addresses.append(address);
+        }
+    }
+
+    if (addresses.is_empty())
+        return {};
+
+    // Only addresses that an object starts at count. Anything else can't be a reference, so it must be something else
+    // that happens to look like one.
+    quick_sort(addresses);
+    Vector<Object*> pinned_objects;
+    m_heap.for_each_young_object([&](Object* object) {
+        if (binary_search(addresses, bit_cast<FlatPtr>(object)))
+            pinned_objects.append(object);
+    });
+
+    // The young generation is allocated around them in order.
+    quick_sort(pinned_objects);
+    return pinned_objects;
+}
+
+void Scavenger::work(u32 worker_index)
+{
+    auto& worker = *m_workers[worker_index];
+
+    for (;;)
+    {
+        auto index = m_next_precise_root.fetch_add(1, AK::memory_order_relaxed);
+        if (index >= m_precise_roots->size())
+            break;
+
+        update(worker, *m_precise_roots->at(index));
+    }
+
+    for (;;)
+    {
+        auto index = m_next_pinned_object.fetch_add(1, AK::memory_order_relaxed);
+        if (index >= m_pinned_objects.size())
+            break;
+
+        scan(worker, m_pinned_objects[index]);
+    }
+
+    for (;;)
+    {
+        auto first_card = m_next_card.fetch_add(cards_per_chunk, AK::memory_order_relaxed);
+        if (first_card >= m_end_card)
+            break;
+
+        for (auto card = first_card; card < min(first_card + cards_per_chunk, m_end_card); card++)
+        {
+            if (m_heap.m_card_table[card] == Heap::dirty_card)
+                scan_card(worker, card);
+        }
+
+        // Leaves less for the others to steal, but keeps the queue from overflowing.
+        drain(worker);
+    }
+
+    do
+    {
+        drain(worker);
+        while (steal(worker_index))
+            drain(worker);
+    } while (!offer_termination());
+}
+
+void Scavenger::drain(Worker& worker)
+{
+    for (;;)
+    {
+        if (auto object = worker.queue.pop(); object.has_value())
+            scan(worker, object.value());
+        else if (!worker.overflow.is_empty())
+            scan(worker, worker.overflow.take_last());
+        else
+            return;
+    }
+}
+
+bool Scavenger::steal(u32 worker_index)
+{
+    auto& worker = *m_workers[worker_index];
+    for (size_t i = 1; i < m_workers.size(); i++)
+    {
+        auto& victim = *m_workers[(worker_index + i) % m_workers.size()];
+        if (auto object = victim.queue.steal(); object.has_value())
+        {
+            scan(worker, object.value());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// A worker only goes idle once it has nothing left of its own, and an idle worker never gives anything to anyone else,
+// so once all of them are idle, they are done.
+bool Scavenger::offer_termination()
+{
+    m_idle_workers.fetch_add(1);
+    for (;;)
+    {
+        if (m_idle_workers.load() == m_workers.size())
+            return true;
+
+        for (auto& worker : m_workers)
+        {
+            if (!worker->queue.is_empty())
+            {
+                m_idle_workers.fetch_sub(1);
+                return false;
+            }
+        }
+
+        sched_yield();
+    }
+}
+
+void Scavenger::push(Worker& worker, Object* object)
+{
+    if (!worker.queue.try_push(object))
+        worker.overflow.append(object);
+}
+
+void Scavenger::scan(Worker& worker, Object* object)
+{
+    auto& resolved_class = *bit_cast<const ResolvedClass*>(object->header() & ~header_bits);
+    for (auto offset : resolved_class.reference_field_offsets)
+        update(worker, object, offset);
+}
+
+void Scavenger::scan_card(Worker& worker, size_t card)
+{
+    m_heap.m_card_table[card] = 0;
+
+    auto* card_start = m_heap.m_base + (card << Heap::card_shift);
+    auto* card_end = min(card_start + Heap::card_size, m_scan_end);
+
+    // Objects may start on an earlier card, or end on a later one, but only their fields on this one are looked at.
+    auto* address = reinterpret_cast<u8*>(m_heap.first_object_on_card(card));
+    while (address < card_end)
+    {
+        auto* object = reinterpret_cast<Object*>(address);
+        auto& resolved_class = object->resolved_class();
+        address += Heap::size_of(*object, resolved_class);
+
+        for (auto offset : resolved_class.reference_field_offsets)
+        {
+            auto* field = reinterpret_cast<u8*>(object) + offset;
+            if (field >= card_start && field < card_end)
+                update(worker, object, offset);
+        }
+    }
+}
+
+void Scavenger::update(Worker& worker, Object* holder, u32 offset)
+{
+    auto* referent = holder->read<Object*>(offset);
+    if (!m_heap.is_young(referent))
+        return;
+
+    referent = evacuate(worker, referent);
+    holder->write<Object*>(offset, referent);
+
+    // Only pinned objects stay in the young generation, and the next collection needs to know what points at them.
+    if (m_heap.is_young(referent) && !m_heap.is_young(holder))
+        m_heap.record_reference_store(holder, offset);
+}
+
+void Scavenger::update(Worker& worker, Slot& root)
+{
+    auto* referent = root.as_reference();
+    if (m_heap.is_young(referent))
+        root = Slot::from_reference(evacuate(worker, referent));
+}
+
+Object* Scavenger::evacuate(Worker& worker, Object* object)
+{
+    auto* header = &object->header();
+    auto value = AK::atomic_load(header, AK::memory_order_acquire);
+    if (value & forwarded_bit)
+        return bit_cast<Object*>(value & ~header_bits);
+    if (value & pinned_bit)
+        return object;
+
+    auto& resolved_class = *bit_cast<const ResolvedClass*>(value);
+    auto size = Heap::size_of(*object, resolved_class);
+    auto* copy = allocate(worker, size);
+    __builtin_memcpy(copy, object, size);
+    reinterpret_cast<Object*>(copy)->header() = value;
+
+    // Another worker may be copying the same object at the same time, and only one of the copies can be the one.
+    if (!AK::atomic_compare_exchange_strong(header, value, bit_cast<FlatPtr>(copy) | forwarded_bit,
+                                            AK::memory_order_acq_rel))
+    {
+        unallocate(worker, copy, size);
+        return bit_cast<Object*>(value & ~header_bits);
+    }
+
+    m_heap.record_object_start(copy, size);
+    worker.promoted_bytes += size;
+    if (!resolved_class.reference_field_offsets.is_empty())
+        push(worker, reinterpret_cast<Object*>(copy));
+
+    return reinterpret_cast<Object*>(copy);
+}
+
+u8* Scavenger::allocate(Worker& worker, size_t size)
+{
+    if (static_cast<size_t>(worker.promotion_end - worker.promotion_top) < size)
+    {
+        // Anything that would waste more than an eighth of a buffer gets memory of its own.
+        if (size > promotion_buffer_size / 8)
+            return take_from_old_generation(size);
+
+        retire_promotion_buffer(worker);
+        worker.promotion_top = take_from_old_generation(promotion_buffer_size);
+        worker.promotion_end = worker.promotion_top + promotion_buffer_size;
+    }
+
+    auto* memory = worker.promotion_top;
+    worker.promotion_top += size;
+    return memory;
+}
+
+void Scavenger::unallocate(Worker& worker, u8* memory, size_t size)
+{
+    if (memory + size == worker.promotion_top)
+        worker.promotion_top = memory;
+    else
+        m_heap.fill(memory, memory + size);
+}
+
+u8* Scavenger::take_from_old_generation(size_t size)
+{
+    // The heap has made sure there is enough room before it started.
+    auto* memory = bit_cast<u8*>(m_old_top.fetch_add(size, AK::memory_order_relaxed));
+    VERIFY(memory + size <= m_heap.m_end);
+    return memory;
+}
+
+void Scavenger::retire_promotion_buffer(Worker& worker)
+{
+    if (worker.promotion_top)
+        m_heap.fill(worker.promotion_top, worker.promotion_end);
+
+    worker.promotion_top = nullptr;
+    worker.promotion_end = nullptr;
+}
+}
\ No newline at end of file
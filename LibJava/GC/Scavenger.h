@@ -0,0 +1,90 @@
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <LibJava/GC/WorkStealingQueue.h>
+#include <LibJava/GC/WorkerPool.h>
+#include <LibJava/Heap.h>
+
+namespace Java::GC
+{
+// Collects the young generation by copying whatever in it is still reachable into the old generation, after which all
+// of it can be allocated from again, but for the objects that are pinned.
+// Every worker of the pool takes part. They start out by dividing the precise roots, the pinned objects and the dirty
+// cards up among themselves, and every object one of them copies goes onto its own queue, to have its fields looked at
+// later. Once a worker has nothing left of its own, it steals from the others, until none of them has anything left.
+// Survivors go straight to the old generation. Keeping them in the young generation for a few more collections would
+// take an age, and there is no room left in the header for one.
+class Scavenger
+{
+public:
+    // Every worker copies into a buffer of its own in the old generation, so that it only has to synchronize with the
+    // others when it needs another one.
+    static constexpr size_t promotion_buffer_size = 64 * KiB;
+
+    // Nothing takes up more room once it is copied, but whatever is left at the end of a buffer when the next object
+    // doesn't fit is thrown away, which is never more than an eighth of one. The last buffer of every worker may also
+    // be mostly empty, and copying starts on a fresh card.
+    static size_t old_bytes_needed(size_t young_bytes, u32 worker_count)
+    {
+        return young_bytes + young_bytes / 7 + worker_count * promotion_buffer_size + Heap::card_size;
+    }
+
+    explicit Scavenger(Heap&);
+
+    void run(const Heap::Roots&);
+
+private:
+    struct Worker
+    {
+        WorkStealingQueue<Object*, 8 * KiB> queue;
+        // Whatever doesn't fit into the queue, which only this worker gets to.
+        Vector<Object*> overflow;
+        u8* promotion_top{};
+        u8* promotion_end{};
+        u64 promoted_bytes{};
+    };
+
+    // While it runs, the header of an object that has been copied is the address of the copy with this bit set.
+    static constexpr FlatPtr forwarded_bit = 1;
+    static constexpr FlatPtr pinned_bit = 2;
+    static constexpr FlatPtr header_bits = 7;
+    static constexpr size_t cards_per_chunk = 64;
+
+    Vector<Object*> find_pinned_objects(const Heap::Roots&);
+    void work(u32 worker_index);
+    void drain(Worker&);
+    bool steal(u32 worker_index);
+    bool offer_termination();
+
+    void push(Worker&, Object*);
+    void scan(Worker&, Object*);
+    void scan_card(Worker&, size_t card);
+    void update(Worker&, Object* holder, u32 offset);
+    void update(Worker&, Slot& root);
+    Object* evacuate(Worker&, Object*);
+
+    u8* allocate(Worker&, size_t size);
+    void unallocate(Worker&, u8* memory, size_t size);
+    u8* take_from_old_generation(size_t size);
+    void retire_promotion_buffer(Worker&);
+
+    Heap& m_heap;
+    WorkerPool m_pool;
+    Vector<NonnullOwnPtr<Worker>> m_workers;
+
+    // What the workers share while they run.
+    const Vector<Slot*>* m_precise_roots{};
+    Atomic<size_t> m_next_precise_root{0};
+    Vector<Object*> m_pinned_objects;
+    Atomic<size_t> m_next_pinned_object{0};
+    Atomic<size_t> m_next_card{0};
+    size_t m_end_card{};
+    // Only the old generation as it was before anything was copied into it is scanned for dirty cards.
+    u8* m_scan_end{};
+    Atomic<FlatPtr> m_old_top{0};
+    Atomic<u32> m_idle_workers{0};
+};
+}
\ No newline at end of file
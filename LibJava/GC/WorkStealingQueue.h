@@ -0,0 +1,88 @@
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/Atomic.h>
+#include <AK/Optional.h>
+#include <AK/Types.h>
+
+namespace Java::GC
+{
+// A double-ended queue that one thread, its owner, pushes to and pops from at the bottom, while any other thread may
+// steal from the top at the same time, without any locks. This is the one by Chase and Lev, with the memory orders from
+// "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê, Pop, Cohen and Zappa Nardelli (2013).
+// It doesn't grow: once it is full, pushing fails, and the owner has to keep whatever didn't fit to itself.
+template<typename T, size_t capacity>
+class WorkStealingQueue
+{
+    static_assert((capacity & (capacity - 1)) == 0, "The capacity has to be a power of two");
+
+public:
+    // Only the owner may call this.
+    bool try_push(T value)
+    {
+        auto bottom = m_bottom.load(AK::memory_order_relaxed);
+        auto top = m_top.load(AK::memory_order_acquire);
+        if (bottom - top >= static_cast<i64>(capacity))
+            return false;
+
+        AK::atomic_store(&m_elements[bottom & (capacity - 1)], value, AK::memory_order_relaxed);
+        AK::atomic_thread_fence(AK::memory_order_release);
+        m_bottom.store(bottom + 1, AK::memory_order_relaxed);
+        return true;
+    }
+
+    // Only the owner may call this. Takes the value that was pushed last.
+    Optional<T> pop()
+    {
+        auto bottom = m_bottom.load(AK::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, AK::memory_order_relaxed);
+        AK::atomic_thread_fence(AK::memory_order_seq_cst);
+        auto top = m_top.load(AK::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, AK::memory_order_relaxed);
+            return {};
+        }
+
+        auto value = AK::atomic_load(&m_elements[bottom & (capacity - 1)], AK::memory_order_relaxed);
+        if (top < bottom)
+            return value;
+
+        // This is the last one, which a thief may be after as well. Whoever moves the top past it gets it.
+        bool won = m_top.compare_exchange_strong(top, top + 1, AK::memory_order_seq_cst);
+        m_bottom.store(bottom + 1, AK::memory_order_relaxed);
+        if (!won)
+            return {};
+        return value;
+    }
+
+    // Any thread but the owner may call this. Takes the value that was pushed first, unless it comes up empty, which it
+    // may also do when another thread got there first.
+    Optional<T> steal()
+    {
+        auto top = m_top.load(AK::memory_order_acquire);
+        AK::atomic_thread_fence(AK::memory_order_seq_cst);
+        auto bottom = m_bottom.load(AK::memory_order_acquire);
+        if (top >= bottom)
+            return {};
+
+        auto value = AK::atomic_load(&m_elements[top & (capacity - 1)], AK::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, AK::memory_order_seq_cst))
+            return {};
+        return value;
+    }
+
+    // Only a hint, as it may change right after.
+    bool is_empty() const
+    {
+        return m_top.load(AK::memory_order_relaxed) >= m_bottom.load(AK::memory_order_relaxed);
+    }
+
+private:
+    // The owner and the thieves work on opposite ends, so these are kept apart to not share a cache line.
+    alignas(64) Atomic<i64> m_top{0};
+    alignas(64) Atomic<i64> m_bottom{0};
+    AK::Array<T, capacity> m_elements{};
+};
+}
\ No newline at end of file
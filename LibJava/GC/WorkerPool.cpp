@@ -0,0 +1,81 @@
+#include <LibJava/GC/WorkerPool.h>
+
+namespace Java::GC
+{
+WorkerPool::WorkerPool(u32 worker_count)
+{
+    VERIFY(worker_count > 0);
+
+    for (u32 worker = 1; worker < worker_count; worker++)
+    {
+        auto thread = make<Thread>();
+        thread->pool = this;
+        thread->worker = worker;
+        if (pthread_create(&thread->thread, nullptr, thread_main, thread.ptr()) != 0)
+        {
+            // Fewer workers only make collecting slower.
+            break;
+        }
+
+        m_threads.append(move(thread));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_exiting = true;
+    pthread_cond_broadcast(&m_task_available);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (auto& thread : m_threads)
+        pthread_join(thread->thread, nullptr);
+}
+
+void WorkerPool::run(const Function<void(u32)>& task)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_task = &task;
+    m_generation++;
+    m_running = m_threads.size();
+    pthread_cond_broadcast(&m_task_available);
+    pthread_mutex_unlock(&m_mutex);
+
+    task(0);
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_running > 0)
+        pthread_cond_wait(&m_task_done, &m_mutex);
+    m_task = nullptr;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* WorkerPool::thread_main(void* argument)
+{
+    auto& thread = *static_cast<Thread*>(argument);
+    auto& pool = *thread.pool;
+    u64 generation = 0;
+
+    pthread_mutex_lock(&pool.m_mutex);
+    for (;;)
+    {
+        while (!pool.m_exiting && pool.m_generation == generation)
+            pthread_cond_wait(&pool.m_task_available, &pool.m_mutex);
+        if (pool.m_exiting)
+            break;
+
+        generation = pool.m_generation;
+        auto& task = *pool.m_task;
+        pthread_mutex_unlock(&pool.m_mutex);
+
+        task(thread.worker);
+
+        pthread_mutex_lock(&pool.m_mutex);
+        if (--pool.m_running == 0)
+            pthread_cond_signal(&pool.m_task_done);
+    }
+    pthread_mutex_unlock(&pool.m_mutex);
+
+    return nullptr;
+}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/Noncopyable.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <pthread.h>
+
+namespace Java::GC
+{
+// The threads the garbage collector works on. They are started along with the pool and then sleep until there is
+// something to do, so that a collection doesn't have to pay for starting them every time.
+class WorkerPool
+{
+    AK_MAKE_NONCOPYABLE(WorkerPool);
+    AK_MAKE_NONMOVABLE(WorkerPool);
+
+public:
+    // The thread that runs tasks counts as one of the workers, so this starts one thread fewer than that.
+    explicit WorkerPool(u32 worker_count);
+    ~WorkerPool();
+
+    u32 worker_count() const { return m_threads.size() + 1; }
+
+    // Runs the task on every worker at the same time, and returns once it has returned on all of them. The calling
+    // thread is worker 0.
+    void run(const Function<void(u32 worker)>& task);
+
+private:
+    struct Thread
+    {
+        WorkerPool* pool{};
+        u32 worker{};
+        pthread_t thread{};
+    };
+
+    static void* thread_main(void*);
+
+    Vector<NonnullOwnPtr<Thread>> m_threads;
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t m_task_available = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t m_task_done = PTHREAD_COND_INITIALIZER;
+    const Function<void(u32)>* m_task{};
+    // Bumped for every task, so that a thread can tell a new one from the one it has already run.
+    u64 m_generation{};
+    u32 m_running{};
+    bool m_exiting{};
+};
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include <AK/StdLibExtras.h>
+#include <LibJava/ArrayKernels.h>
+#include <LibJava/GC/MarkCompact.h>
+#include <LibJava/GC/Scavenger.h>
+#include <LibJava/Heap.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace Java
+{
+static u64 now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<u64>(time.tv_sec) * 1'000'000'000 + static_cast<u64>(time.tv_nsec);
+}
+
+static ErrorOr<u8*> map(size_t size)
+{
+    auto* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+        return Error::from_errno(errno);
+
+    return static_cast<u8*>(memory);
+}
+
+// Fresh pages are always zeroed, so only memory that has been used before needs clearing.
+static void clear(u8* start, u8* end, u8* used_before)
+{
+    static constexpr u8 zero = 0;
+    if (start < used_before)
+        ArrayKernels::fill(start, min(end, used_before) - start, &zero, 1);
+}
+
+Heap::Heap()
+{
+    m_filler_class.name = "filler"sv;
+    m_filler_class.instance_size = Object::header_size;
+    m_array_filler_class.name = "filler"sv;
+    m_array_filler_class.component_type = PrimitiveType::Byte;
+    register_class(m_filler_class);
+    register_class(m_array_filler_class);
+}
+
+Heap::~Heap()
+{
+    // The collector threads go first, as they may still be looking at the heap for all they know.
+    m_scavenger = nullptr;
+
+    if (m_base)
+    {
+        auto card_count = m_configuration.size >> card_shift;
+        munmap(m_base, m_configuration.size);
+        munmap(m_card_table, card_count);
+        munmap(m_first_objects_on_cards, card_count * sizeof(u32));
+    }
+}
+
+ErrorOr<void> Heap::configure(Configuration configuration)
+{
+    VERIFY(!m_base);
+
+    // The old generation needs at least as much room as the young generation, for it to survive into. The first
+    // objects on cards are kept in 32 bits, counting in 8 bytes.
+    if (configuration.young_generation_size == 0 || configuration.young_generation_size % card_size != 0 ||
+        configuration.size % card_size != 0 || configuration.young_generation_size * 2 > configuration.size ||
+        configuration.size > 32 * GiB)
+        return Error::from_string_literal("Invalid heap configuration");
+
+    m_configuration = configuration;
+    return {};
+}
+
+ErrorOr<void> Heap::reserve()
+{
+    // Most programs never allocate an object, so the address space is only reserved once the first one is.
+    m_base = TRY(map(m_configuration.size));
+    m_old_base = m_base + m_configuration.young_generation_size;
+    m_end = m_base + m_configuration.size;
+
+    m_young_top = m_base;
+    m_young_gap_end = m_old_base;
+    m_young_used_before = m_base;
+    m_old_top = m_old_base;
+    m_old_used_before = m_old_base;
+
+    // The base of the heap is page aligned, and so on a card boundary, which makes this the same as counting the cards
+    // from the base.
+    auto card_count = m_configuration.size >> card_shift;
+    m_card_table = TRY(map(card_count));
+    m_biased_card_table =
+        bit_cast<u8*>(bit_cast<FlatPtr>(m_card_table) - (bit_cast<FlatPtr>(m_base) >> card_shift));
+    m_first_objects_on_cards = reinterpret_cast<u32*>(TRY(map(card_count * sizeof(u32))));
+
+    if (m_configuration.collector_threads == 0)
+        m_configuration.collector_threads = max<long>(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+    m_started_at = now();
+    return {};
+}
+
+void Heap::register_class(ResolvedClass& resolved_class)
+{
+    resolved_class.id = m_classes.size();
+    VERIFY(resolved_class.id < GC::MarkCompact::max_class_count);
+    m_classes.append(&resolved_class);
+}
+
+ErrorOr<Object*> Heap::allocate(AllocationBuffer& buffer, size_t size)
+{
+    if (!m_base)
+        TRY(reserve());
+
+    if (size > max_buffered_allocation_size)
+        return allocate_in_old_generation(size);
+
+    // Whatever is left in the old buffer is too small to be of use, and is simply abandoned.
+    retire_allocation_buffer();
+    if (!refill(buffer, size))
+    {
+        TRY(collect_garbage(0));
+        if (!refill(buffer, size))
+            return Error::from_string_literal("OutOfMemoryError");
+    }
+
+    auto* object = buffer.try_allocate(size);
+    VERIFY(object);
+    return object;
+}
+
+bool Heap::refill(AllocationBuffer& buffer, size_t size)
+{
+    while (static_cast<size_t>(m_young_gap_end - m_young_top) < size)
+    {
+        if (m_next_pinned_young_object == m_pinned_young_objects.size())
+            return false;
+
+        auto* pinned_object = m_pinned_young_objects[m_next_pinned_young_object++];
+        m_young_top = reinterpret_cast<u8*>(pinned_object) + size_of(*pinned_object, pinned_object->resolved_class());
+        m_young_gap_end = m_next_pinned_young_object < m_pinned_young_objects.size()
+                              ? reinterpret_cast<u8*>(m_pinned_young_objects[m_next_pinned_young_object])
+                              : m_old_base;
+    }
+
+    auto* start = m_young_top;
+    auto* end = start + min(allocation_buffer_size, static_cast<size_t>(m_young_gap_end - start));
+    m_young_top = end;
+
+    clear(start, end, m_young_used_before);
+    m_young_used_before = max(m_young_used_before, end);
+
+    buffer.top = start;
+    buffer.end = end;
+    m_allocation_buffer = &buffer;
+    m_allocation_buffer_start = start;
+    return true;
+}
+
+void Heap::retire_allocation_buffer()
+{
+    if (!m_allocation_buffer)
+        return;
+
+    auto* top = m_allocation_buffer->top;
+    if (top > m_allocation_buffer_start)
+        m_young_ranges.append({m_allocation_buffer_start, top});
+    m_statistics.allocated_bytes += top - m_allocation_buffer_start;
+
+    *m_allocation_buffer = {};
+    m_allocation_buffer = nullptr;
+}
+
+ErrorOr<Object*> Heap::allocate_in_old_generation(size_t size)
+{
+    size = align_up_to<size_t>(size, 8);
+    if (static_cast<size_t>(m_end - m_old_top) < size)
+        TRY(collect_garbage(size));
+
+    auto* memory = m_old_top;
+    m_old_top += size;
+
+    clear(memory, m_old_top, m_old_used_before);
+    record_object_start(memory, size);
+    m_statistics.allocated_bytes += size;
+    return reinterpret_cast<Object*>(memory);
+}
+
+size_t Heap::old_bytes_needed_by_young_collection() const
+{
+    size_t young_bytes = 0;
+    for (auto& range : m_young_ranges)
+        young_bytes += range.end - range.start;
+    for (auto* object : m_pinned_young_objects)
+        young_bytes += size_of(*object, object->resolved_class());
+
+    return GC::Scavenger::old_bytes_needed(young_bytes, m_configuration.collector_threads);
+}
+
+ErrorOr<void> Heap::collect_garbage(size_t old_bytes_needed)
+{
+    retire_allocation_buffer();
+    auto roots = gather_roots ? gather_roots() : Roots{};
+
+    auto record_pause = [&](u64 started_at, u64& pause_time) {
+        auto pause = now() - started_at;
+        pause_time += pause;
+        m_statistics.longest_pause = max(m_statistics.longest_pause, pause);
+    };
+
+    auto has_enough_room = [&] {
+        return static_cast<size_t>(m_end - m_old_top) >= old_bytes_needed_by_young_collection() + old_bytes_needed;
+    };
+
+    if (!has_enough_room())
+    {
+        auto started_at = now();
+        auto old_bytes = m_old_top - m_old_base;
+        GC::MarkCompact(*this, roots).run();
+        m_statistics.old_collections++;
+        m_statistics.reclaimed_bytes += old_bytes - (m_old_top - m_old_base);
+        record_pause(started_at, m_statistics.old_pause_time);
+
+        // 2.5.3 "If a computation requires more heap than can be made available by the automatic storage management
+        // system, the Java Virtual Machine throws an OutOfMemoryError."
+        if (!has_enough_room())
+            return Error::from_string_literal("OutOfMemoryError");
+    }
+
+    auto started_at = now();
+    if (!m_scavenger)
+        m_scavenger = make<GC::Scavenger>(*this);
+    m_scavenger->run(roots);
+    m_statistics.young_collections++;
+    record_pause(started_at, m_statistics.young_pause_time);
+    return {};
+}
+
+void Heap::reset_young_generation(Vector<Object*> pinned_objects)
+{
+    m_pinned_young_objects = move(pinned_objects);
+    m_next_pinned_young_object = 0;
+    m_young_top = m_base;
+    m_young_gap_end =
+        m_pinned_young_objects.is_empty() ? m_old_base : reinterpret_cast<u8*>(m_pinned_young_objects.first());
+    m_young_ranges.clear();
+}
+
+void Heap::fill(u8* start, u8* end)
+{
+    if (start == end)
+        return;
+
+    auto* filler = reinterpret_cast<Object*>(start);
+    if (end - start == Object::header_size)
+    {
+        filler->set_resolved_class(m_filler_class);
+    }
+    else
+    {
+        filler->set_resolved_class(m_array_filler_class);
+        static_cast<Array*>(filler)->set_length(end - start - Array::elements_offset);
+    }
+
+    record_object_start(start, end - start);
+}
+
+void Heap::record_object_start(const u8* object, size_t size)
+{
+    auto offset = static_cast<size_t>(object - m_base);
+    auto first_card = (offset + card_size - 1) >> card_shift;
+    auto end_card = (offset + size + card_size - 1) >> card_shift;
+    for (auto card = first_card; card < end_card; card++)
+        m_first_objects_on_cards[card] = offset / 8;
+}
+
+Object* Heap::find_old_object(FlatPtr address) const
+{
+    auto* pointer = bit_cast<u8*>(address);
+    if (address % 8 != 0 || !is_old(pointer))
+        return nullptr;
+
+    auto* object = first_object_on_card(card_of(pointer));
+    while (reinterpret_cast<u8*>(object) < pointer)
+        object = reinterpret_cast<Object*>(reinterpret_cast<u8*>(object) + size_of(*object, object->resolved_class()));
+
+    if (reinterpret_cast<u8*>(object) != pointer)
+        return nullptr;
+
+    // Fillers are never reachable, whatever happens to point at them.
+    auto& resolved_class = object->resolved_class();
+    if (&resolved_class == &m_filler_class || &resolved_class == &m_array_filler_class)
+        return nullptr;
+
+    return object;
+}
+
+Heap::Statistics Heap::statistics() const
+{
+    auto statistics = m_statistics;
+    if (m_allocation_buffer)
+        statistics.allocated_bytes += m_allocation_buffer->top - m_allocation_buffer_start;
+    if (m_base)
+        statistics.elapsed_time = now() - m_started_at;
+
+    return statistics;
+}
+
+size_t Heap::used() const
+{
+    return (m_young_top - m_base) + (m_old_top - m_old_base);
+}
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Function.h>
+#include <AK/Noncopyable.h>
+#include <AK/OwnPtr.h>
+#include <AK/Span.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <LibJava/Array.h>
+#include <LibJava/Object.h>
+#include <LibJava/ResolvedClass.h>
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+namespace GC
+{
+class MarkCompact;
+class Scavenger;
+}
+
+// 2.5.3 Heap
+// "The heap is the run-time data area from which memory for all class instances and arrays is allocated."
+// "Heap storage for objects is reclaimed by an automatic storage management system (known as a garbage collector)"
+// Ours is one contiguous range of address space of a fixed size, which is reserved up front but only backed by memory
+// once it is touched. It is split into two generations:
+// - New objects are allocated at the bottom, in the young generation. Once that is full, whatever in it is still
+//   reachable is copied into the old generation by several threads at once (GC::Scavenger), and the young generation
+//   starts over. Most objects are already unreachable by then, and they cost nothing to get rid of.
+// - The old generation takes up the rest. It fills up with whatever survived the young generation, and with objects
+//   that are too big to be worth copying. Once it might not have enough room left for the young generation to survive
+//   into, it is compacted (GC::MarkCompact).
+// Collecting the young generation on its own needs to know about every reference from the old generation into it. The
+// heap is split into cards for that, and storing a reference into an object marks the card of the field as dirty.
+// Only objects on dirty cards have to be looked at for references into the young generation.
+// Which slots of a frame hold references is known at the instructions that may collect garbage (see ReferenceMaps), and
+// those are updated when an object moves. The slots of any other frame might hold anything, so whatever they seem to
+// point to stays where it is instead (it is pinned), and the young generation is allocated around it.
+class Heap
+{
+    AK_MAKE_NONCOPYABLE(Heap);
+    AK_MAKE_NONMOVABLE(Heap);
+
+public:
+    // A thread-local allocation buffer: a chunk of the young generation that only one thread allocates from, so that
+    // allocating an object only takes bumping a pointer, without having to synchronize with anyone else. The compiled
+    // code does it inline, so the layout of this matters.
+    struct AllocationBuffer
+    {
+        u8* top{};
+        u8* end{};
+
+        ALWAYS_INLINE Object* try_allocate(size_t size)
+        {
+            if (static_cast<size_t>(end - top) < size)
+                return nullptr;
+
+            auto* object = reinterpret_cast<Object*>(top);
+            top += size;
+            return object;
+        }
+    };
+
+    struct Configuration
+    {
+        size_t size{1 * GiB};
+        size_t young_generation_size{32 * MiB};
+        // How many threads collect the young generation, the one that ran out of memory included. Zero means as many
+        // as there are processors.
+        u32 collector_threads{};
+    };
+
+    // Everything outside of the heap that may point into it.
+    struct Roots
+    {
+        // Slots that may just as well hold something else than a reference. Whatever they point to is kept alive, and
+        // pinned.
+        Vector<Span<Slot>> ambiguous;
+        // Slots that are known to hold a reference, or null. They are updated when what they point to moves.
+        Vector<Slot*> precise;
+    };
+
+    // All times are in nanoseconds. A pause lasts from running out of memory to the program carrying on.
+    struct Statistics
+    {
+        u32 young_collections{};
+        u32 old_collections{};
+        u64 young_pause_time{};
+        u64 old_pause_time{};
+        u64 longest_pause{};
+        u64 allocated_bytes{};
+        // Copied from the young generation into the old one.
+        u64 promoted_bytes{};
+        u64 reclaimed_bytes{};
+        // Since the first allocation.
+        u64 elapsed_time{};
+
+        // The share of the time that the program got to run instead of waiting for the garbage collector.
+        double throughput() const
+        {
+            if (elapsed_time == 0)
+                return 1;
+            return 1 - static_cast<double>(young_pause_time + old_pause_time) / static_cast<double>(elapsed_time);
+        }
+    };
+
+    static constexpr size_t allocation_buffer_size = 256 * KiB;
+    // Anything bigger than this is allocated in the old generation right away, so that it doesn't throw away most of a
+    // buffer, and so that it never has to be copied.
+    static constexpr size_t max_buffered_allocation_size = allocation_buffer_size / 8;
+
+    static constexpr u32 card_shift = 9;
+    static constexpr size_t card_size = 1 << card_shift;
+    static constexpr u8 dirty_card = 1;
+
+    Heap();
+    ~Heap();
+
+    // Only before the first allocation.
+    ErrorOr<void> configure(Configuration);
+
+    // For when the buffer has run out: hands it a fresh chunk of the young generation and allocates from that, unless
+    // the object is big enough to go to the old generation. Either may have to collect garbage first.
+    ErrorOr<Object*> allocate(AllocationBuffer&, size_t size);
+
+    // Before an instance of a class is allocated, the class has to be registered, to get its id.
+    void register_class(ResolvedClass&);
+
+    // Called whenever garbage is collected.
+    Function<Roots()> gather_roots;
+
+    // The write barrier, for after a reference has been stored into a field of an object.
+    ALWAYS_INLINE void record_reference_store(const Object* object, u32 offset)
+    {
+        m_biased_card_table[(bit_cast<FlatPtr>(object) + offset) >> card_shift] = dirty_card;
+    }
+
+    // Compiled code marks cards inline: the card of an address is at this plus the address shifted by card_shift.
+    // It is only set once the first object is allocated, but then no field can be stored to before that either.
+    u8* const* biased_card_table() const { return &m_biased_card_table; }
+
+    Statistics statistics() const;
+
+    size_t size() const { return m_configuration.size; }
+
+    // Including whatever is left in allocation buffers that have been handed out.
+    size_t used() const;
+
+    ALWAYS_INLINE static size_t size_of(const Object& object, const ResolvedClass& resolved_class)
+    {
+        if (resolved_class.component_type.has_value())
+        {
+            auto& array = static_cast<const Array&>(object);
+            return Array::allocation_size(array.length(), component_size(resolved_class.component_type.value()));
+        }
+
+        return resolved_class.instance_size;
+    }
+
+private:
+    friend class GC::MarkCompact;
+    friend class GC::Scavenger;
+
+    struct Range
+    {
+        u8* start{};
+        u8* end{};
+    };
+
+    ErrorOr<void> reserve();
+    ErrorOr<void> collect_garbage(size_t old_bytes_needed);
+    ErrorOr<Object*> allocate_in_old_generation(size_t size);
+    bool refill(AllocationBuffer&, size_t size);
+    void retire_allocation_buffer();
+    void reset_young_generation(Vector<Object*> pinned);
+
+    // How much room the old generation needs for a collection of the young generation to be sure to succeed.
+    size_t old_bytes_needed_by_young_collection() const;
+
+    // Turns memory that doesn't hold an object into one that is never reachable, so that the heap can still be walked
+    // from one object to the next.
+    void fill(u8* start, u8* end);
+
+    // Notes where an object that was just put into the old generation starts, for every card that starts within it.
+    void record_object_start(const u8* object, size_t size);
+
+    ALWAYS_INLINE Object* first_object_on_card(size_t card) const
+    {
+        return reinterpret_cast<Object*>(m_base + static_cast<size_t>(m_first_objects_on_cards[card]) * 8);
+    }
+
+    ALWAYS_INLINE size_t card_of(const void* address) const
+    {
+        return (static_cast<const u8*>(address) - m_base) >> card_shift;
+    }
+
+    ALWAYS_INLINE bool is_young(const void* address) const
+    {
+        return bit_cast<FlatPtr>(address) - bit_cast<FlatPtr>(m_base) < m_configuration.young_generation_size;
+    }
+
+    ALWAYS_INLINE bool is_old(const void* address) const
+    {
+        return address >= m_old_base && address < m_old_top;
+    }
+
+    // Every object in the young generation, reachable or not, in no particular order.
+    template<typename Callback>
+    void for_each_young_object(Callback callback)
+    {
+        for (auto& range : m_young_ranges)
+        {
+            for (auto* address = range.start; address < range.end;)
+            {
+                auto* object = reinterpret_cast<Object*>(address);
+                address += size_of(*object, object->resolved_class());
+                callback(object);
+            }
+        }
+
+        for (auto* object : m_pinned_young_objects)
+            callback(object);
+    }
+
+    // The object that starts at the given address in the old generation, if any. The address doesn't have to be one
+    // that is known to point to anything.
+    Object* find_old_object(FlatPtr address) const;
+
+    Configuration m_configuration;
+
+    u8* m_base{};
+    u8* m_old_base{};
+    u8* m_end{};
+
+    // The young generation is handed out from gaps between the objects that are pinned in it, from the bottom up.
+    Vector<Object*> m_pinned_young_objects;
+    size_t m_next_pinned_young_object{};
+    u8* m_young_top{};
+    u8* m_young_gap_end{};
+    // Below this, memory has been used before, and has to be cleared before it is handed out again.
+    u8* m_young_used_before{};
+    // What has been allocated from the young generation since it was last collected, in buffers that have been
+    // retired. There is only ever one thread allocating, so there is only one buffer in use at a time.
+    Vector<Range> m_young_ranges;
+    AllocationBuffer* m_allocation_buffer{};
+    u8* m_allocation_buffer_start{};
+
+    u8* m_old_top{};
+    u8* m_old_used_before{};
+
+    u8* m_card_table{};
+    u8* m_biased_card_table{};
+    // For every card in the old generation, the object that covers its first byte, in 8 bytes from the base of the
+    // heap. Cards can be walked from there, as objects follow each other without gaps.
+    u32* m_first_objects_on_cards{};
+
+    // Indexed by the id of a class.
+    Vector<const ResolvedClass*> m_classes;
+    // Gaps are turned into one of these, the first one for gaps of 8 bytes, the other one, as an array of bytes, for
+    // any bigger one.
+    ResolvedClass m_filler_class;
+    ResolvedClass m_array_filler_class;
+
+    OwnPtr<GC::Scavenger> m_scavenger;
+
+    Statistics m_statistics;
+    u64 m_started_at{};
+};
+}
\ No newline at end of file
@@ -0,0 +1,494 @@
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+
+namespace Java::JIT
+{
+// Just enough of an x86-64 assembler for the two compilers. Every memory operand is a base register plus
+// a 32-bit displacement, which covers both the slots of a frame and anything we have the address of in a register.
+class Assembler
+{
+public:
+    enum class Reg : u8
+    {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RSP = 4,
+        RBP = 5,
+        RSI = 6,
+        RDI = 7,
+        R8 = 8,
+        R9 = 9,
+        R10 = 10,
+        R11 = 11,
+        R12 = 12,
+        R13 = 13,
+        R14 = 14,
+        R15 = 15,
+    };
+
+    enum class XMM : u8
+    {
+        XMM0 = 0,
+        XMM1 = 1,
+    };
+
+    // The low nibble of the Jcc opcode.
+    enum class Condition : u8
+    {
+        Equal = 0x4,
+        NotEqual = 0x5,
+        // These four compare unsigned, for addresses and for array indices, which makes negative ones out of bounds.
+        Below = 0x2,
+        AboveOrEqual = 0x3,
+        BelowOrEqual = 0x6,
+        Above = 0x7,
+        LessThan = 0xc,
+        GreaterThanOrEqualTo = 0xd,
+        LessThanOrEqualTo = 0xe,
+        GreaterThan = 0xf,
+    };
+
+    // The opcode of the "reg, r/m" form of each of these.
+    enum class ALU : u8
+    {
+        Add = 0x03,
+        Or = 0x0b,
+        And = 0x23,
+        Sub = 0x2b,
+        Xor = 0x33,
+        Compare = 0x3b,
+    };
+
+    // Scalar SSE operations, which only differ in their prefix between float (F3) and double (F2).
+    enum class Precision : u8
+    {
+        Single = 0xf3,
+        Double = 0xf2,
+    };
+
+    enum class SSE : u8
+    {
+        Add = 0x58,
+        Multiply = 0x59,
+        Subtract = 0x5c,
+        Divide = 0x5e,
+    };
+
+    // Jcc opcodes come in pairs that only differ in the lowest bit, one for a condition and one for its opposite.
+    static Condition invert(Condition condition) { return static_cast<Condition>(to_underlying(condition) ^ 1); }
+
+    struct Label
+    {
+        Optional<size_t> offset;
+        // Where the rel32 of every jump to this label that was emitted before it was bound lives.
+        Vector<size_t> pending_jumps;
+    };
+
+    const Vector<u8>& code() const { return m_code; }
+
+    size_t offset() const { return m_code.size(); }
+
+    void load32(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {0x8b}, encoding(destination), base, displacement);
+    }
+
+    void load64(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(true, {0x8b}, encoding(destination), base, displacement);
+    }
+
+    void store32(Reg base, i32 displacement, Reg source)
+    {
+        emit_memory_operation(false, {0x89}, encoding(source), base, displacement);
+    }
+
+    void store64(Reg base, i32 displacement, Reg source)
+    {
+        emit_memory_operation(true, {0x89}, encoding(source), base, displacement);
+    }
+
+    // The narrow loads extend to 32 bits, which clears the high half of the register like any other 32-bit write.
+    void load8_sign_extend(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {0x0f, 0xbe}, encoding(destination), base, displacement);
+    }
+
+    void load16_sign_extend(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {0x0f, 0xbf}, encoding(destination), base, displacement);
+    }
+
+    void load16_zero_extend(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {0x0f, 0xb7}, encoding(destination), base, displacement);
+    }
+
+    // Only works with the legacy registers as the source, without a REX prefix SPL-DIL would be AH-BH.
+    void store8(Reg base, i32 displacement, Reg source)
+    {
+        emit_memory_operation(false, {0x88}, encoding(source), base, displacement);
+    }
+
+    void store16(Reg base, i32 displacement, Reg source)
+    {
+        emit8(0x66);
+        emit_memory_operation(false, {0x89}, encoding(source), base, displacement);
+    }
+
+    void store32_immediate(Reg base, i32 displacement, i32 value)
+    {
+        emit_memory_operation(false, {0xc7}, 0, base, displacement);
+        emit32(value);
+    }
+
+    // The immediate is sign-extended to 64 bits.
+    void store64_immediate(Reg base, i32 displacement, i32 value)
+    {
+        emit_memory_operation(true, {0xc7}, 0, base, displacement);
+        emit32(value);
+    }
+
+    void add32_immediate(Reg base, i32 displacement, i32 value)
+    {
+        emit_memory_operation(false, {0x81}, 0, base, displacement);
+        emit32(value);
+    }
+
+    void move64_immediate(Reg destination, u64 value)
+    {
+        emit_rex(true, 0, encoding(destination));
+        emit8(0xb8 | (encoding(destination) & 7));
+        emit64(value);
+    }
+
+    void move64(Reg destination, Reg source)
+    {
+        emit_register_operation(true, {0x89}, encoding(source), encoding(destination));
+    }
+
+    // Writing to the low 32 bits of a register clears the high ones, which is what Slot::from_int does as well.
+    void move32(Reg destination, Reg source)
+    {
+        emit_register_operation(false, {0x89}, encoding(source), encoding(destination));
+    }
+
+    void move32_immediate(Reg destination, i32 value)
+    {
+        emit_rex(false, 0, encoding(destination));
+        emit8(0xb8 | (encoding(destination) & 7));
+        emit32(value);
+    }
+
+    // The immediate is sign-extended to 64 bits.
+    void add64_immediate(Reg reg, i32 value)
+    {
+        emit_register_operation(true, {0x81}, 0, encoding(reg));
+        emit32(value);
+    }
+
+    void lea(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(true, {0x8d}, encoding(destination), base, displacement);
+    }
+
+    void alu32(ALU operation, Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {to_underlying(operation)}, encoding(destination), base, displacement);
+    }
+
+    void alu32(ALU operation, Reg destination, Reg source)
+    {
+        emit_register_operation(false, {to_underlying(operation)}, encoding(destination), encoding(source));
+    }
+
+    // The immediate forms all share one opcode, and tell the operations apart by what would otherwise be the register
+    // operand, which happens to be bits 3-5 of the opcode of the other form.
+    void alu32_immediate(ALU operation, Reg reg, i32 value)
+    {
+        emit_register_operation(false, {0x81}, to_underlying(operation) >> 3, encoding(reg));
+        emit32(value);
+    }
+
+    void alu64(ALU operation, Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(true, {to_underlying(operation)}, encoding(destination), base, displacement);
+    }
+
+    void alu64(ALU operation, Reg destination, Reg source)
+    {
+        emit_register_operation(true, {to_underlying(operation)}, encoding(destination), encoding(source));
+    }
+
+    void shift_left64_immediate(Reg reg, u8 count)
+    {
+        emit_register_operation(true, {0xc1}, 4, encoding(reg));
+        emit8(count);
+    }
+
+    void shift_right64_immediate(Reg reg, u8 count)
+    {
+        emit_register_operation(true, {0xc1}, 5, encoding(reg));
+        emit8(count);
+    }
+
+    void multiply32(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(false, {0x0f, 0xaf}, encoding(destination), base, displacement);
+    }
+
+    void multiply32(Reg destination, Reg source)
+    {
+        emit_register_operation(false, {0x0f, 0xaf}, encoding(destination), encoding(source));
+    }
+
+    void multiply32_immediate(Reg destination, Reg source, i32 value)
+    {
+        emit_register_operation(false, {0x69}, encoding(destination), encoding(source));
+        emit32(value);
+    }
+
+    void multiply64(Reg destination, Reg base, i32 displacement)
+    {
+        emit_memory_operation(true, {0x0f, 0xaf}, encoding(destination), base, displacement);
+    }
+
+    void compare32_immediate(Reg reg, i32 value)
+    {
+        emit_register_operation(false, {0x81}, 7, encoding(reg));
+        emit32(value);
+    }
+
+    void compare32_immediate(Reg base, i32 displacement, i32 value)
+    {
+        emit_memory_operation(false, {0x81}, 7, base, displacement);
+        emit32(value);
+    }
+
+    // The immediate is sign-extended to 64 bits.
+    void compare64_immediate(Reg reg, i32 value)
+    {
+        emit_register_operation(true, {0x81}, 7, encoding(reg));
+        emit32(value);
+    }
+
+    void xor32_immediate(Reg reg, u32 value)
+    {
+        emit_register_operation(false, {0x81}, 6, encoding(reg));
+        emit32(value);
+    }
+
+    void xor64(Reg destination, Reg source)
+    {
+        emit_register_operation(true, {0x31}, encoding(source), encoding(destination));
+    }
+
+    void test32(Reg a, Reg b) { emit_register_operation(false, {0x85}, encoding(b), encoding(a)); }
+
+    void test64(Reg a, Reg b) { emit_register_operation(true, {0x85}, encoding(b), encoding(a)); }
+
+    void test8(Reg a, Reg b) { emit_register_operation(false, {0x84}, encoding(b), encoding(a)); }
+
+    void negate32(Reg reg) { emit_register_operation(false, {0xf7}, 3, encoding(reg)); }
+
+    void negate64(Reg reg) { emit_register_operation(true, {0xf7}, 3, encoding(reg)); }
+
+    // Divides EDX:EAX (or RDX:RAX) by the given register, after sign-extending EAX (or RAX) into EDX (or RDX).
+    void sign_extend_and_divide32(Reg divisor)
+    {
+        emit8(0x99);
+        emit_register_operation(false, {0xf7}, 7, encoding(divisor));
+    }
+
+    void sign_extend_and_divide64(Reg divisor)
+    {
+        emit_rex(true, 0, 0);
+        emit8(0x99);
+        emit_register_operation(true, {0xf7}, 7, encoding(divisor));
+    }
+
+    void sign_extend32_to_64(Reg destination, Reg source)
+    {
+        emit_register_operation(true, {0x63}, encoding(destination), encoding(source));
+    }
+
+    // These only work on the legacy registers, which is all we need them for.
+    void sign_extend8_to_32(Reg destination, Reg source)
+    {
+        emit_register_operation(false, {0x0f, 0xbe}, encoding(destination), encoding(source));
+    }
+
+    void sign_extend16_to_32(Reg destination, Reg source)
+    {
+        emit_register_operation(false, {0x0f, 0xbf}, encoding(destination), encoding(source));
+    }
+
+    void zero_extend16_to_32(Reg destination, Reg source)
+    {
+        emit_register_operation(false, {0x0f, 0xb7}, encoding(destination), encoding(source));
+    }
+
+    void load_scalar(Precision precision, XMM destination, Reg base, i32 displacement)
+    {
+        emit8(to_underlying(precision));
+        emit_memory_operation(false, {0x0f, 0x10}, encoding(destination), base, displacement);
+    }
+
+    void store_scalar(Precision precision, Reg base, i32 displacement, XMM source)
+    {
+        emit8(to_underlying(precision));
+        emit_memory_operation(false, {0x0f, 0x11}, encoding(source), base, displacement);
+    }
+
+    void scalar_operation(SSE operation, Precision precision, XMM destination, Reg base, i32 displacement)
+    {
+        emit8(to_underlying(precision));
+        emit_memory_operation(false, {0x0f, to_underlying(operation)}, encoding(destination), base, displacement);
+    }
+
+    // CVTSI2SS and CVTSI2SD, from a 32-bit or a 64-bit integer register.
+    void convert_integer_to_scalar(Precision precision, XMM destination, Reg source, bool source_is_64_bit)
+    {
+        emit8(to_underlying(precision));
+        emit_register_operation(source_is_64_bit, {0x0f, 0x2a}, encoding(destination), encoding(source));
+    }
+
+    // CVTTSS2SI and CVTTSD2SI, into a 32-bit or a 64-bit integer register. Anything that doesn't fit, NaN included,
+    // gives the smallest integer there is.
+    void convert_scalar_to_integer(Precision precision, Reg destination, XMM source, bool destination_is_64_bit)
+    {
+        emit8(to_underlying(precision));
+        emit_register_operation(destination_is_64_bit, {0x0f, 0x2c}, encoding(destination), encoding(source));
+    }
+
+    // CVTSS2SD for Single, CVTSD2SS for Double.
+    void convert_scalar_precision(Precision source_precision, XMM destination, XMM source)
+    {
+        emit8(to_underlying(source_precision));
+        emit_register_operation(false, {0x0f, 0x5a}, encoding(destination), encoding(source));
+    }
+
+    void push(Reg reg)
+    {
+        emit_rex(false, 0, encoding(reg));
+        emit8(0x50 | (encoding(reg) & 7));
+    }
+
+    void pop(Reg reg)
+    {
+        emit_rex(false, 0, encoding(reg));
+        emit8(0x58 | (encoding(reg) & 7));
+    }
+
+    void call(Reg reg) { emit_register_operation(false, {0xff}, 2, encoding(reg)); }
+
+    void ret() { emit8(0xc3); }
+
+    void trap()
+    {
+        emit8(0x0f);
+        emit8(0x0b);
+    }
+
+    void jump(Label& label)
+    {
+        emit8(0xe9);
+        emit_label_reference(label);
+    }
+
+    void jump_if(Condition condition, Label& label)
+    {
+        emit8(0x0f);
+        emit8(0x80 | to_underlying(condition));
+        emit_label_reference(label);
+    }
+
+    void bind(Label& label)
+    {
+        VERIFY(!label.offset.has_value());
+        label.offset = offset();
+
+        for (auto pending_jump : label.pending_jumps)
+            patch32(pending_jump, offset() - (pending_jump + 4));
+        label.pending_jumps.clear();
+    }
+
+private:
+    static u8 encoding(Reg reg) { return to_underlying(reg); }
+
+    static u8 encoding(XMM reg) { return to_underlying(reg); }
+
+    void emit8(u8 value) { m_code.append(value); }
+
+    void emit32(u32 value)
+    {
+        for (auto i = 0; i < 4; i++)
+            emit8(value >> (i * 8));
+    }
+
+    void emit64(u64 value)
+    {
+        for (auto i = 0; i < 8; i++)
+            emit8(value >> (i * 8));
+    }
+
+    void patch32(size_t at, u32 value)
+    {
+        for (auto i = 0; i < 4; i++)
+            m_code[at + i] = value >> (i * 8);
+    }
+
+    // REX is only emitted when it is needed, which is either for a 64-bit operand size or to reach R8-R15.
+    void emit_rex(bool is_64_bit, u8 reg, u8 rm)
+    {
+        u8 rex = 0x40 | (is_64_bit ? 0x08 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+        if (rex != 0x40)
+            emit8(rex);
+    }
+
+    void emit_opcode(std::initializer_list<u8> opcode)
+    {
+        for (auto byte : opcode)
+            emit8(byte);
+    }
+
+    void emit_register_operation(bool is_64_bit, std::initializer_list<u8> opcode, u8 reg, u8 rm)
+    {
+        emit_rex(is_64_bit, reg, rm);
+        emit_opcode(opcode);
+        emit8(0xc0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    // Always uses a 32-bit displacement (mod 10), so that the length of an instruction doesn't depend on it.
+    void emit_memory_operation(bool is_64_bit, std::initializer_list<u8> opcode, u8 reg, Reg base, i32 displacement)
+    {
+        emit_rex(is_64_bit, reg, encoding(base));
+        emit_opcode(opcode);
+        emit8(0x80 | (reg & 7) << 3 | (encoding(base) & 7));
+        // RSP and R12 can only be used as a base through a SIB byte.
+        if ((encoding(base) & 7) == 4)
+            emit8(0x24);
+        emit32(displacement);
+    }
+
+    void emit_label_reference(Label& label)
+    {
+        if (label.offset.has_value())
+        {
+            emit32(label.offset.value() - (offset() + 4));
+            return;
+        }
+
+        label.pending_jumps.append(offset());
+        emit32(0);
+    }
+
+    Vector<u8> m_code;
+};
+}
\ No newline at end of file
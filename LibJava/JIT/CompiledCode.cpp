@@ -0,0 +1,45 @@
+#include <LibJava/JIT/CompiledCode.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace Java::JIT
+{
+ErrorOr<NonnullOwnPtr<CompiledCode>> CompiledCode::try_create(const Vector<u8>& code, Vector<OSREntry> osr_entries)
+{
+    VERIFY(!code.is_empty());
+
+    // The memory is never writable and executable at the same time: we copy the code in first, and only then flip it
+    // over to being executable.
+    auto* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return Error::from_errno(errno);
+
+    memcpy(memory, code.data(), code.size());
+
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) < 0)
+    {
+        auto error = errno;
+        munmap(memory, code.size());
+        return Error::from_errno(error);
+    }
+
+    return adopt_own(*new CompiledCode(memory, code.size(), move(osr_entries)));
+}
+
+CompiledCode::Entry CompiledCode::osr_entry(u32 instruction_index, u16 stack_depth) const
+{
+    for (auto& osr_entry : m_osr_entries)
+    {
+        if (osr_entry.instruction_index == instruction_index && osr_entry.stack_depth == stack_depth)
+            return reinterpret_cast<Entry>(static_cast<u8*>(m_memory) + osr_entry.offset);
+    }
+
+    return nullptr;
+}
+
+CompiledCode::~CompiledCode()
+{
+    munmap(m_memory, m_size);
+}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Noncopyable.h>
+#include <AK/Vector.h>
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+class VM;
+}
+
+namespace Java::JIT
+{
+// The machine code of one method, in memory of its own that is executable but no longer writable.
+class CompiledCode
+{
+    AK_MAKE_NONCOPYABLE(CompiledCode);
+    AK_MAKE_NONMOVABLE(CompiledCode);
+
+public:
+    enum class Exit : u8
+    {
+        // The error is waiting in the VM.
+        Failed,
+        Returned,
+        // The compiled code ran into an instruction that it can't handle yet, and hands the frame back to the
+        // interpreter. Result holds a Deoptimization that says where to pick it up.
+        Deoptimized,
+        // Baseline code has taken enough backward branches to be worth optimizing. Result holds a Deoptimization for
+        // the loop header it was about to branch to, which is where the frame carries on once the method has been
+        // optimized.
+        Optimize,
+    };
+
+    // Runs the method on a frame that has already been pushed, starting at locals, and stores what it returns in
+    // result.
+    using Entry = Exit (*)(Slot* locals, Slot* result, VM*);
+
+    struct Deoptimization
+    {
+        u32 instruction_index{};
+        u16 stack_depth{};
+
+        u64 encode() const { return instruction_index | static_cast<u64>(stack_depth) << 32; }
+
+        static Deoptimization decode(Slot slot)
+        {
+            auto bits = static_cast<u64>(slot.as_long());
+            return {static_cast<u32>(bits), static_cast<u16>(bits >> 32)};
+        }
+    };
+
+    // An entry point in the middle of the method, at the header of a loop, for on-stack replacement: it picks up a
+    // frame that the interpreter has been running so far, with whatever is in its local variables and operand stack.
+    struct OSREntry
+    {
+        u32 instruction_index{};
+        u16 stack_depth{};
+        size_t offset{};
+    };
+
+    static ErrorOr<NonnullOwnPtr<CompiledCode>> try_create(const Vector<u8>& code, Vector<OSREntry> osr_entries);
+
+    ~CompiledCode();
+
+    Entry entry() const { return reinterpret_cast<Entry>(m_memory); }
+
+    // Only loop headers have one, and only if the operand stack is as deep as the compiled code expects it to be.
+    Entry osr_entry(u32 instruction_index, u16 stack_depth) const;
+
+    size_t size() const { return m_size; }
+
+private:
+    CompiledCode(void* memory, size_t size, Vector<OSREntry> osr_entries)
+        : m_memory(memory), m_size(size), m_osr_entries(move(osr_entries))
+    {
+    }
+
+    void* m_memory;
+    size_t m_size;
+    Vector<OSREntry> m_osr_entries;
+};
+}
\ No newline at end of file
@@ -0,0 +1,1235 @@
+#include <AK/BitCast.h>
+#include <AK/HashTable.h>
+#include <AK/Platform.h>
+#include <LibJava/Array.h>
+#include <LibJava/Descriptor.h>
+#include <LibJava/JIT/Compiler.h>
+#include <LibJava/VM.h>
+
+namespace Java::JIT
+{
+namespace
+{
+using Reg = Assembler::Reg;
+using XMM = Assembler::XMM;
+using Condition = Assembler::Condition;
+using ALU = Assembler::ALU;
+using Precision = Assembler::Precision;
+using SSE = Assembler::SSE;
+
+// These are callee-saved in the System V ABI, so they survive calls back into the VM.
+constexpr auto locals_register = Reg::RBX;
+constexpr auto result_register = Reg::R12;
+constexpr auto vm_register = Reg::R13;
+
+struct StackEffect
+{
+    u16 pops{};
+    u16 pushes{};
+};
+
+StackEffect invoke_stack_effect(const ResolvedMethod& method)
+{
+    u16 pushes = 0;
+    if (method.return_kind == ResolvedMethod::ReturnKind::Category1)
+        pushes = 1;
+    else if (method.return_kind == ResolvedMethod::ReturnKind::Category2)
+        pushes = 2;
+
+    return {static_cast<u16>(method.argument_slots), pushes};
+}
+
+// For instructions that haven't been resolved yet, all we have to go by are the descriptors in the constant pool.
+ErrorOr<bool> is_category_2_field(const ClassFile& class_file, u16 field_ref_index)
+{
+    auto& field_ref = class_file.constant_pool()[field_ref_index - 1].get<ClassFile::FieldRef>();
+    auto& name_and_type = class_file.constant_pool()[field_ref.name_and_type_index - 1].get<ClassFile::NameAndType>();
+    auto& descriptor = class_file.constant_pool()[name_and_type.descriptor_index - 1].get<ClassFile::Utf8>();
+    return TRY(FieldDescriptor::try_parse(descriptor.value)).is_category_2();
+}
+
+// The object an instance method is invoked on isn't part of its descriptor.
+ErrorOr<StackEffect> unresolved_invoke_stack_effect(const ClassFile& class_file, u16 method_ref_index,
+                                                    bool has_receiver)
+{
+    auto& method_ref = class_file.constant_pool()[method_ref_index - 1].get<ClassFile::MethodRef>();
+    auto& name_and_type = class_file.constant_pool()[method_ref.name_and_type_index - 1].get<ClassFile::NameAndType>();
+    auto& descriptor_string = class_file.constant_pool()[name_and_type.descriptor_index - 1].get<ClassFile::Utf8>();
+    auto descriptor = TRY(MethodDescriptor::try_parse(descriptor_string.value));
+
+    u16 pushes = 0;
+    if (descriptor.return_type().has<FieldDescriptor>())
+        pushes = descriptor.return_type().get<FieldDescriptor>().is_category_2() ? 2 : 1;
+
+    return StackEffect{static_cast<u16>(descriptor.parameter_slot_count() + (has_receiver ? 1 : 0)), pushes};
+}
+
+// How many slots an instruction takes off the operand stack and puts back onto it, for everything we can compile.
+ErrorOr<StackEffect> stack_effect(const Instruction& instruction, const ResolvedMethod& method)
+{
+    switch (instruction.opcode)
+    {
+        case Opcode::nop:
+        case Opcode::iinc:
+        case Opcode::goto_:
+        case Opcode::return_:
+            return StackEffect{0, 0};
+        case Opcode::iconst_m1:
+        case Opcode::iconst_0:
+        case Opcode::iconst_1:
+        case Opcode::iconst_2:
+        case Opcode::iconst_3:
+        case Opcode::iconst_4:
+        case Opcode::iconst_5:
+        case Opcode::bipush:
+        case Opcode::sipush:
+        case Opcode::ldc:
+        case Opcode::iload:
+        case Opcode::fload:
+        case Opcode::aload:
+        case Opcode::aconst_null:
+        case Opcode::getstatic_quick:
+        case Opcode::new_:
+        case Opcode::new_quick:
+            return StackEffect{0, 1};
+        case Opcode::lconst_0:
+        case Opcode::lconst_1:
+        case Opcode::dconst_0:
+        case Opcode::dconst_1:
+        case Opcode::ldc2_w:
+        case Opcode::lload:
+        case Opcode::dload:
+        case Opcode::getstatic2_quick:
+            return StackEffect{0, 2};
+        case Opcode::istore:
+        case Opcode::fstore:
+        case Opcode::putstatic_quick:
+        case Opcode::pop:
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+        case Opcode::ireturn:
+        case Opcode::freturn:
+        case Opcode::astore:
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+        case Opcode::areturn:
+            return StackEffect{1, 0};
+        case Opcode::lstore:
+        case Opcode::dstore:
+        case Opcode::putstatic2_quick:
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+        case Opcode::lreturn:
+        case Opcode::dreturn:
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+        case Opcode::putfield_boolean_quick:
+        case Opcode::putfield_byte_quick:
+        case Opcode::putfield_short_quick:
+        case Opcode::putfield_quick:
+        case Opcode::putfield_reference_quick:
+            return StackEffect{2, 0};
+        case Opcode::putfield2_quick:
+        case Opcode::iastore:
+        case Opcode::fastore:
+        case Opcode::bastore:
+        case Opcode::castore:
+        case Opcode::sastore:
+            return StackEffect{3, 0};
+        case Opcode::lastore:
+        case Opcode::dastore:
+            return StackEffect{4, 0};
+        case Opcode::ineg:
+        case Opcode::fneg:
+        case Opcode::i2b:
+        case Opcode::i2c:
+        case Opcode::i2s:
+        case Opcode::i2f:
+        case Opcode::f2i:
+        case Opcode::getfield_byte_quick:
+        case Opcode::getfield_char_quick:
+        case Opcode::getfield_short_quick:
+        case Opcode::getfield_quick:
+        case Opcode::getfield_reference_quick:
+        case Opcode::newarray:
+        case Opcode::newarray_quick:
+        case Opcode::arraylength:
+            return StackEffect{1, 1};
+        case Opcode::i2l:
+        case Opcode::i2d:
+        case Opcode::f2d:
+        case Opcode::f2l:
+        case Opcode::dup:
+        case Opcode::getfield2_quick:
+            return StackEffect{1, 2};
+        case Opcode::iadd:
+        case Opcode::isub:
+        case Opcode::imul:
+        case Opcode::idiv:
+        case Opcode::iand:
+        case Opcode::ior:
+        case Opcode::ixor:
+        case Opcode::fadd:
+        case Opcode::fsub:
+        case Opcode::fmul:
+        case Opcode::fdiv:
+        case Opcode::l2i:
+        case Opcode::l2f:
+        case Opcode::d2f:
+        case Opcode::d2i:
+        case Opcode::iaload:
+        case Opcode::faload:
+        case Opcode::baload:
+        case Opcode::caload:
+        case Opcode::saload:
+            return StackEffect{2, 1};
+        case Opcode::lneg:
+        case Opcode::dneg:
+        case Opcode::l2d:
+        case Opcode::d2l:
+        case Opcode::laload:
+        case Opcode::daload:
+            return StackEffect{2, 2};
+        case Opcode::ladd:
+        case Opcode::lsub:
+        case Opcode::lmul:
+        case Opcode::ldiv:
+        case Opcode::land:
+        case Opcode::lor:
+        case Opcode::lxor:
+        case Opcode::dadd:
+        case Opcode::dsub:
+        case Opcode::dmul:
+        case Opcode::ddiv:
+            return StackEffect{4, 2};
+        case Opcode::invokestatic_quick:
+        case Opcode::invokespecial_quick:
+            return invoke_stack_effect(*method.decoded_code->resolved_method(instruction.operand));
+        case Opcode::getstatic:
+        case Opcode::putstatic:
+        {
+            u16 slots = TRY(is_category_2_field(*method.class_file, instruction.operand)) ? 2 : 1;
+            if (instruction.opcode == Opcode::getstatic)
+                return StackEffect{0, slots};
+
+            return StackEffect{slots, 0};
+        }
+        case Opcode::getfield:
+        case Opcode::putfield:
+        {
+            u16 slots = TRY(is_category_2_field(*method.class_file, instruction.operand)) ? 2 : 1;
+            if (instruction.opcode == Opcode::getfield)
+                return StackEffect{1, slots};
+
+            return StackEffect{static_cast<u16>(1 + slots), 0};
+        }
+        case Opcode::invokestatic:
+        case Opcode::invokespecial:
+            return unresolved_invoke_stack_effect(*method.class_file, instruction.operand,
+                                                  instruction.opcode == Opcode::invokespecial);
+        default:
+            return Error::from_string_literal(
+                String::formatted("The JIT cannot compile {}", *opcode_names.get(instruction.opcode)));
+    }
+}
+
+u8 array_component_size(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::baload:
+        case Opcode::bastore:
+            return 1;
+        case Opcode::caload:
+        case Opcode::saload:
+        case Opcode::castore:
+        case Opcode::sastore:
+            return 2;
+        case Opcode::iaload:
+        case Opcode::faload:
+        case Opcode::iastore:
+        case Opcode::fastore:
+            return 4;
+        case Opcode::laload:
+        case Opcode::daload:
+        case Opcode::lastore:
+        case Opcode::dastore:
+            return 8;
+        default:
+            VERIFY_NOT_REACHED();
+    }
+}
+
+Optional<Condition> branch_condition(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::ifeq:
+        case Opcode::if_icmpeq:
+        case Opcode::ifnull:
+        case Opcode::if_acmpeq:
+            return Condition::Equal;
+        case Opcode::ifne:
+        case Opcode::if_icmpne:
+        case Opcode::ifnonnull:
+        case Opcode::if_acmpne:
+            return Condition::NotEqual;
+        case Opcode::iflt:
+        case Opcode::if_icmplt:
+            return Condition::LessThan;
+        case Opcode::ifge:
+        case Opcode::if_icmpge:
+            return Condition::GreaterThanOrEqualTo;
+        case Opcode::ifgt:
+        case Opcode::if_icmpgt:
+            return Condition::GreaterThan;
+        case Opcode::ifle:
+        case Opcode::if_icmple:
+            return Condition::LessThanOrEqualTo;
+        default:
+            return {};
+    }
+}
+
+bool is_return(Opcode opcode)
+{
+    return opcode == Opcode::return_ || opcode == Opcode::ireturn || opcode == Opcode::freturn ||
+           opcode == Opcode::lreturn || opcode == Opcode::dreturn || opcode == Opcode::areturn;
+}
+}
+
+Compiler::Compiler(VM& vm, const ResolvedMethod& method, Optional<u32> optimize_at_backedges)
+    : m_vm(vm), m_method(method), m_decoded_code(*method.decoded_code),
+      m_instructions(m_decoded_code.unfused_instructions()), m_max_locals(method.code->max_locals),
+      m_optimize_at_backedges(optimize_at_backedges)
+{
+    m_stack_depths.resize(m_instructions.size());
+    m_instruction_labels.resize(m_instructions.size());
+}
+
+ErrorOr<NonnullOwnPtr<CompiledCode>> Compiler::compile(VM& vm, const ResolvedMethod& method,
+                                                      Optional<u32> optimize_at_backedges)
+{
+#if ARCH(X86_64)
+    Compiler compiler(vm, method, optimize_at_backedges);
+    TRY(compiler.compute_stack_depths());
+
+    compiler.emit_prologue();
+    for (size_t i = 0; i < compiler.m_instructions.size(); i++)
+    {
+        compiler.m_assembler.bind(compiler.m_instruction_labels[i]);
+        TRY(compiler.compile_instruction(i));
+    }
+
+    // Every path ends in a return, which compute_stack_depths made sure of, so this is never reached.
+    compiler.m_assembler.trap();
+
+    compiler.m_assembler.bind(compiler.m_returned);
+    compiler.emit_epilogue(CompiledCode::Exit::Returned);
+    compiler.m_assembler.bind(compiler.m_failed);
+    compiler.emit_epilogue(CompiledCode::Exit::Failed);
+    compiler.m_assembler.bind(compiler.m_deoptimized);
+    compiler.emit_epilogue(CompiledCode::Exit::Deoptimized);
+    compiler.m_assembler.bind(compiler.m_optimize);
+    compiler.emit_epilogue(CompiledCode::Exit::Optimize);
+
+    auto osr_entries = compiler.emit_osr_entries();
+
+    return CompiledCode::try_create(compiler.m_assembler.code(), move(osr_entries));
+#else
+    (void)vm;
+    (void)method;
+    (void)optimize_at_backedges;
+    return Error::from_string_literal("The JIT only supports x86-64");
+#endif
+}
+
+// The templates need to know which slot is the top of the operand stack, so we follow every path through the method
+// once, the same way verification by type inference (4.10.2.2) would, except that all we track is the depth.
+ErrorOr<void> Compiler::compute_stack_depths()
+{
+    auto& instructions = m_instructions;
+
+    Vector<size_t> worklist;
+    m_stack_depths[0] = 0;
+    worklist.append(0);
+
+    while (!worklist.is_empty())
+    {
+        auto index = worklist.take_last();
+        auto& instruction = instructions[index];
+        auto depth = m_stack_depths[index].value();
+
+        auto effect = TRY(stack_effect(instruction, m_method));
+        if (depth < effect.pops)
+            return Error::from_string_literal("Operand stack underflow");
+
+        u16 new_depth = depth - effect.pops + effect.pushes;
+        if (new_depth > m_method.code->max_stacks)
+            return Error::from_string_literal("Operand stack overflow");
+
+        auto flow_into = [&](size_t successor) -> ErrorOr<void> {
+            if (successor >= instructions.size())
+                return Error::from_string_literal("Method code execution reached the end without returning");
+
+            auto& successor_depth = m_stack_depths[successor];
+            if (!successor_depth.has_value())
+            {
+                successor_depth = new_depth;
+                worklist.append(successor);
+            }
+            else if (successor_depth.value() != new_depth)
+            {
+                return Error::from_string_literal("Operand stack depths don't match where control flow merges");
+            }
+
+            return {};
+        };
+
+        if (is_return(instruction.opcode))
+            continue;
+
+        if (instruction.opcode == Opcode::goto_ || branch_condition(instruction.opcode).has_value())
+            TRY(flow_into(instruction.operand));
+
+        if (instruction.opcode != Opcode::goto_)
+            TRY(flow_into(index + 1));
+    }
+
+    return {};
+}
+
+// Exit entry(Slot* locals, Slot* result, VM*)
+void Compiler::emit_prologue()
+{
+    // Pushing three registers on top of the return address leaves the stack 16-byte aligned again for calls.
+    m_assembler.push(locals_register);
+    m_assembler.push(result_register);
+    m_assembler.push(vm_register);
+    m_assembler.move64(locals_register, Reg::RDI);
+    m_assembler.move64(result_register, Reg::RSI);
+    m_assembler.move64(vm_register, Reg::RDX);
+}
+
+// Every loop header gets its own copy of the prologue, which then jumps right into the middle of the method. The frame
+// is laid out exactly the same way for the interpreter, so there is nothing to carry over.
+Vector<CompiledCode::OSREntry> Compiler::emit_osr_entries()
+{
+    auto& instructions = m_instructions;
+
+    HashTable<u32> loop_headers;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        auto& instruction = instructions[i];
+        if (!m_stack_depths[i].has_value())
+            continue;
+
+        if (instruction.opcode == Opcode::goto_ || branch_condition(instruction.opcode).has_value())
+        {
+            if (static_cast<size_t>(instruction.operand) <= i)
+                loop_headers.set(instruction.operand);
+        }
+    }
+
+    Vector<CompiledCode::OSREntry> osr_entries;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        if (!loop_headers.contains(i))
+            continue;
+
+        osr_entries.append({static_cast<u32>(i), m_stack_depths[i].value(), m_assembler.offset()});
+        emit_prologue();
+        m_assembler.jump(m_instruction_labels[i]);
+    }
+
+    return osr_entries;
+}
+
+void Compiler::emit_epilogue(CompiledCode::Exit exit)
+{
+    m_assembler.move64_immediate(Reg::RAX, to_underlying(exit));
+    m_assembler.pop(vm_register);
+    m_assembler.pop(result_register);
+    m_assembler.pop(locals_register);
+    m_assembler.ret();
+}
+
+void Compiler::emit_backward_branch(u32 target)
+{
+    auto& a = m_assembler;
+    if (!m_optimize_at_backedges.has_value())
+    {
+        a.jump(m_instruction_labels[target]);
+        return;
+    }
+
+    a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&m_method.profile->backedge_count));
+    a.add32_immediate(Reg::RAX, 0, 1);
+    a.compare32_immediate(Reg::RAX, 0, m_optimize_at_backedges.value());
+    a.jump_if(Condition::LessThan, m_instruction_labels[target]);
+    a.move64_immediate(Reg::RAX, CompiledCode::Deoptimization{target, m_stack_depths[target].value()}.encode());
+    a.store64(result_register, 0, Reg::RAX);
+    a.jump(m_optimize);
+}
+
+// Hands the frame over to the interpreter, which carries on right at the given instruction.
+void Compiler::emit_deoptimization(size_t index)
+{
+    auto& a = m_assembler;
+    auto depth = m_stack_depths[index].value();
+    a.move64_immediate(Reg::RAX, CompiledCode::Deoptimization{static_cast<u32>(index), depth}.encode());
+    a.store64(result_register, 0, Reg::RAX);
+    a.jump(m_deoptimized);
+}
+
+// Tells the garbage collector which instruction the frame is at, before calling out to anything that may collect.
+void Compiler::emit_safepoint(size_t index)
+{
+    auto& a = m_assembler;
+    a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&m_vm.m_current_frame));
+    a.load64(Reg::RAX, Reg::RAX, 0);
+    a.store32_immediate(Reg::RAX, offsetof(VM::Frame, safepoint), static_cast<i32>(index));
+}
+
+ErrorOr<void> Compiler::compile_instruction(size_t index)
+{
+    auto& instruction = m_instructions[index];
+    if (!m_stack_depths[index].has_value())
+        return {};
+
+    auto depth = m_stack_depths[index].value();
+    auto& a = m_assembler;
+
+    // Ints and floats only ever touch the low 32 bits of their slot, just like Slot::as_int and Slot::as_float.
+    auto push_int_constant = [&](i32 value) { a.store32_immediate(locals_register, stack(depth), value); };
+
+    auto int_operation = [&](ALU operation) {
+        a.load32(Reg::RAX, locals_register, stack(depth - 2));
+        a.alu32(operation, Reg::RAX, locals_register, stack(depth - 1));
+        a.store32(locals_register, stack(depth - 2), Reg::RAX);
+    };
+
+    auto long_operation = [&](ALU operation) {
+        a.load64(Reg::RAX, locals_register, stack(depth - 4));
+        a.alu64(operation, Reg::RAX, locals_register, stack(depth - 2));
+        a.store64(locals_register, stack(depth - 4), Reg::RAX);
+    };
+
+    auto float_operation = [&](SSE operation) {
+        a.load_scalar(Precision::Single, XMM::XMM0, locals_register, stack(depth - 2));
+        a.scalar_operation(operation, Precision::Single, XMM::XMM0, locals_register, stack(depth - 1));
+        a.store_scalar(Precision::Single, locals_register, stack(depth - 2), XMM::XMM0);
+    };
+
+    auto double_operation = [&](SSE operation) {
+        a.load_scalar(Precision::Double, XMM::XMM0, locals_register, stack(depth - 4));
+        a.scalar_operation(operation, Precision::Double, XMM::XMM0, locals_register, stack(depth - 2));
+        a.store_scalar(Precision::Double, locals_register, stack(depth - 4), XMM::XMM0);
+    };
+
+    // Backward branches have to count towards optimizing the method on their way to the loop header, so they skip
+    // over that when not taken instead.
+    auto emit_branch = [&] {
+        auto condition = branch_condition(instruction.opcode).value();
+        if (static_cast<size_t>(instruction.operand) > index || !m_optimize_at_backedges.has_value())
+        {
+            a.jump_if(condition, m_instruction_labels[instruction.operand]);
+            return;
+        }
+
+        Assembler::Label not_taken;
+        a.jump_if(Assembler::invert(condition), not_taken);
+        emit_backward_branch(instruction.operand);
+        a.bind(not_taken);
+    };
+
+    // A null object leaves the frame to the interpreter, which is the one that throws the NullPointerException.
+    // Otherwise, the object is left in RAX.
+    auto emit_null_check = [&](i32 object) {
+        Assembler::Label not_null;
+        a.load64(Reg::RAX, locals_register, object);
+        a.test64(Reg::RAX, Reg::RAX);
+        a.jump_if(Condition::NotEqual, not_null);
+        emit_deoptimization(index);
+        a.bind(not_null);
+    };
+
+    // An object that is neither of the class of the field reference nor of a subclass of it leaves the frame to the
+    // interpreter as well, which is the one that throws for it. Otherwise, the object is left in RAX.
+    auto emit_field_class_check = [&](i32 object, const ResolvedClass& resolved_class) {
+        Assembler::Label is_subclass;
+        Assembler::Label done;
+        emit_null_check(object);
+        a.move64_immediate(Reg::RCX, bit_cast<FlatPtr>(&resolved_class));
+        a.alu64(ALU::Compare, Reg::RCX, Reg::RAX, 0);
+        a.jump_if(Condition::Equal, done);
+
+        // Objects of a subclass are the uncommon case, so those go through the VM.
+        a.load64(Reg::RDI, Reg::RAX, 0);
+        a.move64(Reg::RSI, Reg::RCX);
+        a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&VM::is_subclass_from_compiled_code));
+        a.call(Reg::RAX);
+        a.test8(Reg::RAX, Reg::RAX);
+        a.jump_if(Condition::NotEqual, is_subclass);
+        emit_deoptimization(index);
+        a.bind(is_subclass);
+        a.load64(Reg::RAX, locals_register, object);
+        a.bind(done);
+    };
+
+    // Leaves the address of the component in RAX, less Array::elements_offset, which the load or store that comes next
+    // takes as its displacement. A null array or an index out of bounds leaves the frame to the interpreter as well.
+    auto emit_component_address = [&](i32 array, i32 component_index, u8 component_size) {
+        Assembler::Label in_bounds;
+        emit_null_check(array);
+        a.load32(Reg::RCX, locals_register, component_index);
+        a.alu32(ALU::Compare, Reg::RCX, Reg::RAX, Array::length_offset);
+        a.jump_if(Condition::Below, in_bounds);
+        emit_deoptimization(index);
+        a.bind(in_bounds);
+
+        // The index has been zero-extended by loading it, and is known to not be negative by now anyway.
+        if (component_size > 1)
+            a.shift_left64_immediate(Reg::RCX, __builtin_ctz(component_size));
+        a.alu64(ALU::Add, Reg::RAX, Reg::RCX);
+    };
+
+    // Slots are copied as a whole no matter what is in them, which is always correct and never slower.
+    auto copy_slot = [&](i32 from, i32 to) {
+        a.load64(Reg::RAX, locals_register, from);
+        a.store64(locals_register, to, Reg::RAX);
+    };
+
+    switch (instruction.opcode)
+    {
+        case Opcode::nop:
+            break;
+        case Opcode::iconst_m1:
+        case Opcode::iconst_0:
+        case Opcode::iconst_1:
+        case Opcode::iconst_2:
+        case Opcode::iconst_3:
+        case Opcode::iconst_4:
+        case Opcode::iconst_5:
+            push_int_constant(static_cast<u8>(instruction.opcode) - static_cast<u8>(Opcode::iconst_0));
+            break;
+        case Opcode::bipush:
+        case Opcode::sipush:
+            push_int_constant(instruction.operand);
+            break;
+        case Opcode::lconst_0:
+        case Opcode::lconst_1:
+            a.store64_immediate(locals_register, stack(depth),
+                                instruction.opcode == Opcode::lconst_0 ? 0 : 1);
+            break;
+        case Opcode::dconst_0:
+        case Opcode::dconst_1:
+            a.move64_immediate(Reg::RAX, bit_cast<u64>(instruction.opcode == Opcode::dconst_0 ? 0.0 : 1.0));
+            a.store64(locals_register, stack(depth), Reg::RAX);
+            break;
+        case Opcode::ldc:
+        {
+            auto& value = m_method.class_file->constant_pool()[instruction.operand - 1];
+
+            if (value.has<Integer>())
+                push_int_constant(value.get<Integer>().value());
+            else if (value.has<Float>())
+                push_int_constant(bit_cast<i32>(value.get<Float>().value()));
+            else
+                return Error::from_string_literal("The JIT only supports Integer and Float constants in ldc");
+
+            break;
+        }
+        case Opcode::ldc2_w:
+        {
+            auto& value = m_method.class_file->constant_pool()[instruction.operand - 1];
+
+            if (value.has<Long>())
+                a.move64_immediate(Reg::RAX, value.get<Long>().value());
+            else if (value.has<Double>())
+                a.move64_immediate(Reg::RAX, bit_cast<u64>(value.get<Double>().value()));
+            else
+                return Error::from_string_literal("Cannot use ldc2_w on types other than Long and Double");
+
+            a.store64(locals_register, stack(depth), Reg::RAX);
+            break;
+        }
+
+        case Opcode::aconst_null:
+            a.store64_immediate(locals_register, stack(depth), 0);
+            break;
+
+        case Opcode::iload:
+        case Opcode::fload:
+        case Opcode::lload:
+        case Opcode::dload:
+        case Opcode::aload:
+            copy_slot(local(instruction.operand), stack(depth));
+            break;
+        case Opcode::istore:
+        case Opcode::fstore:
+        case Opcode::astore:
+            copy_slot(stack(depth - 1), local(instruction.operand));
+            break;
+        case Opcode::lstore:
+        case Opcode::dstore:
+            copy_slot(stack(depth - 2), local(instruction.operand));
+            break;
+        case Opcode::iinc:
+            a.add32_immediate(locals_register, local(instruction.operand), instruction.second_operand);
+            break;
+
+        case Opcode::iadd:
+            int_operation(ALU::Add);
+            break;
+        case Opcode::isub:
+            int_operation(ALU::Sub);
+            break;
+        case Opcode::iand:
+            int_operation(ALU::And);
+            break;
+        case Opcode::ior:
+            int_operation(ALU::Or);
+            break;
+        case Opcode::ixor:
+            int_operation(ALU::Xor);
+            break;
+        case Opcode::imul:
+            a.load32(Reg::RAX, locals_register, stack(depth - 2));
+            a.multiply32(Reg::RAX, locals_register, stack(depth - 1));
+            a.store32(locals_register, stack(depth - 2), Reg::RAX);
+            break;
+        case Opcode::ladd:
+            long_operation(ALU::Add);
+            break;
+        case Opcode::lsub:
+            long_operation(ALU::Sub);
+            break;
+        case Opcode::land:
+            long_operation(ALU::And);
+            break;
+        case Opcode::lor:
+            long_operation(ALU::Or);
+            break;
+        case Opcode::lxor:
+            long_operation(ALU::Xor);
+            break;
+        case Opcode::lmul:
+            a.load64(Reg::RAX, locals_register, stack(depth - 4));
+            a.multiply64(Reg::RAX, locals_register, stack(depth - 2));
+            a.store64(locals_register, stack(depth - 4), Reg::RAX);
+            break;
+        case Opcode::idiv:
+        case Opcode::ldiv:
+        {
+            // 6.5 idiv: "if the dividend is the negative integer of largest possible magnitude for the int type, and
+            // the divisor is -1, then overflow occurs, and the result is equal to the dividend."
+            // IDIV raises #DE for that instead, so dividing by -1 is done by negating. It raises it for a divisor of 0
+            // as well, which leaves the frame to the interpreter, where it throws the ArithmeticException.
+            auto is_long = instruction.opcode == Opcode::ldiv;
+            auto dividend = stack(depth - (is_long ? 4 : 2));
+            auto divisor = stack(depth - (is_long ? 2 : 1));
+            Assembler::Label not_zero;
+            Assembler::Label divide;
+            Assembler::Label done;
+
+            if (is_long)
+            {
+                a.load64(Reg::RAX, locals_register, dividend);
+                a.load64(Reg::RCX, locals_register, divisor);
+                a.test64(Reg::RCX, Reg::RCX);
+                a.jump_if(Condition::NotEqual, not_zero);
+                emit_deoptimization(index);
+                a.bind(not_zero);
+                a.compare64_immediate(Reg::RCX, -1);
+                a.jump_if(Condition::NotEqual, divide);
+                a.negate64(Reg::RAX);
+                a.jump(done);
+                a.bind(divide);
+                a.sign_extend_and_divide64(Reg::RCX);
+                a.bind(done);
+                a.store64(locals_register, dividend, Reg::RAX);
+            }
+            else
+            {
+                a.load32(Reg::RAX, locals_register, dividend);
+                a.load32(Reg::RCX, locals_register, divisor);
+                a.test32(Reg::RCX, Reg::RCX);
+                a.jump_if(Condition::NotEqual, not_zero);
+                emit_deoptimization(index);
+                a.bind(not_zero);
+                a.compare32_immediate(Reg::RCX, -1);
+                a.jump_if(Condition::NotEqual, divide);
+                a.negate32(Reg::RAX);
+                a.jump(done);
+                a.bind(divide);
+                a.sign_extend_and_divide32(Reg::RCX);
+                a.bind(done);
+                a.store32(locals_register, dividend, Reg::RAX);
+            }
+            break;
+        }
+        case Opcode::ineg:
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            a.negate32(Reg::RAX);
+            a.store32(locals_register, stack(depth - 1), Reg::RAX);
+            break;
+        case Opcode::lneg:
+            a.load64(Reg::RAX, locals_register, stack(depth - 2));
+            a.negate64(Reg::RAX);
+            a.store64(locals_register, stack(depth - 2), Reg::RAX);
+            break;
+
+        case Opcode::fadd:
+            float_operation(SSE::Add);
+            break;
+        case Opcode::fsub:
+            float_operation(SSE::Subtract);
+            break;
+        case Opcode::fmul:
+            float_operation(SSE::Multiply);
+            break;
+        case Opcode::fdiv:
+            float_operation(SSE::Divide);
+            break;
+        case Opcode::dadd:
+            double_operation(SSE::Add);
+            break;
+        case Opcode::dsub:
+            double_operation(SSE::Subtract);
+            break;
+        case Opcode::dmul:
+            double_operation(SSE::Multiply);
+            break;
+        case Opcode::ddiv:
+            double_operation(SSE::Divide);
+            break;
+        // Negating a float or a double only flips its sign bit, even for NaN and zero.
+        case Opcode::fneg:
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            a.xor32_immediate(Reg::RAX, 0x80000000);
+            a.store32(locals_register, stack(depth - 1), Reg::RAX);
+            break;
+        case Opcode::dneg:
+            a.load64(Reg::RAX, locals_register, stack(depth - 2));
+            a.move64_immediate(Reg::RCX, 0x8000000000000000);
+            a.xor64(Reg::RAX, Reg::RCX);
+            a.store64(locals_register, stack(depth - 2), Reg::RAX);
+            break;
+
+        case Opcode::i2l:
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            a.sign_extend32_to_64(Reg::RAX, Reg::RAX);
+            a.store64(locals_register, stack(depth - 1), Reg::RAX);
+            break;
+        case Opcode::l2i:
+            // The low half of a long already is the int.
+            a.load32(Reg::RAX, locals_register, stack(depth - 2));
+            a.store32(locals_register, stack(depth - 2), Reg::RAX);
+            break;
+        case Opcode::i2b:
+        case Opcode::i2c:
+        case Opcode::i2s:
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            if (instruction.opcode == Opcode::i2b)
+                a.sign_extend8_to_32(Reg::RAX, Reg::RAX);
+            else if (instruction.opcode == Opcode::i2c)
+                a.zero_extend16_to_32(Reg::RAX, Reg::RAX);
+            else
+                a.sign_extend16_to_32(Reg::RAX, Reg::RAX);
+            a.store32(locals_register, stack(depth - 1), Reg::RAX);
+            break;
+        case Opcode::i2f:
+        case Opcode::i2d:
+        {
+            auto precision = instruction.opcode == Opcode::i2f ? Precision::Single : Precision::Double;
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            a.convert_integer_to_scalar(precision, XMM::XMM0, Reg::RAX, false);
+            a.store_scalar(precision, locals_register, stack(depth - 1), XMM::XMM0);
+            break;
+        }
+        case Opcode::l2f:
+        case Opcode::l2d:
+        {
+            auto precision = instruction.opcode == Opcode::l2f ? Precision::Single : Precision::Double;
+            a.load64(Reg::RAX, locals_register, stack(depth - 2));
+            a.convert_integer_to_scalar(precision, XMM::XMM0, Reg::RAX, true);
+            a.store_scalar(precision, locals_register, stack(depth - 2), XMM::XMM0);
+            break;
+        }
+        case Opcode::f2d:
+            a.load_scalar(Precision::Single, XMM::XMM0, locals_register, stack(depth - 1));
+            a.convert_scalar_precision(Precision::Single, XMM::XMM0, XMM::XMM0);
+            a.store_scalar(Precision::Double, locals_register, stack(depth - 1), XMM::XMM0);
+            break;
+        case Opcode::d2f:
+            a.load_scalar(Precision::Double, XMM::XMM0, locals_register, stack(depth - 2));
+            a.convert_scalar_precision(Precision::Double, XMM::XMM0, XMM::XMM0);
+            a.store_scalar(Precision::Single, locals_register, stack(depth - 2), XMM::XMM0);
+            break;
+        case Opcode::f2i:
+        case Opcode::f2l:
+        case Opcode::d2i:
+        case Opcode::d2l:
+        {
+            // The conversion gives the smallest integer for anything that doesn't fit, which is right for some of them,
+            // and otherwise left to VM::convert_to_integer(). It takes the value where it still is, in XMM0.
+            auto is_double = instruction.opcode == Opcode::d2i || instruction.opcode == Opcode::d2l;
+            auto is_long = instruction.opcode == Opcode::f2l || instruction.opcode == Opcode::d2l;
+            auto precision = is_double ? Precision::Double : Precision::Single;
+            auto value = stack(depth - (is_double ? 2 : 1));
+            Assembler::Label done;
+
+            a.load_scalar(precision, XMM::XMM0, locals_register, value);
+            a.convert_scalar_to_integer(precision, Reg::RAX, XMM::XMM0, is_long);
+            if (is_long)
+            {
+                a.move64_immediate(Reg::RCX, 0x8000000000000000);
+                a.alu64(ALU::Compare, Reg::RAX, Reg::RCX);
+            }
+            else
+            {
+                a.compare32_immediate(Reg::RAX, NumericLimits<i32>::min());
+            }
+            a.jump_if(Condition::NotEqual, done);
+
+            FlatPtr convert;
+            if (instruction.opcode == Opcode::f2i)
+                convert = bit_cast<FlatPtr>(&VM::convert_to_integer<i32, float>);
+            else if (instruction.opcode == Opcode::f2l)
+                convert = bit_cast<FlatPtr>(&VM::convert_to_integer<i64, float>);
+            else if (instruction.opcode == Opcode::d2i)
+                convert = bit_cast<FlatPtr>(&VM::convert_to_integer<i32, double>);
+            else
+                convert = bit_cast<FlatPtr>(&VM::convert_to_integer<i64, double>);
+            a.move64_immediate(Reg::RAX, convert);
+            a.call(Reg::RAX);
+
+            a.bind(done);
+            if (is_long)
+                a.store64(locals_register, value, Reg::RAX);
+            else
+                a.store32(locals_register, value, Reg::RAX);
+            break;
+        }
+
+        case Opcode::dup:
+            copy_slot(stack(depth - 1), stack(depth));
+            break;
+        case Opcode::pop:
+            break;
+
+        case Opcode::getstatic_quick:
+        case Opcode::getstatic2_quick:
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(m_decoded_code.resolved_static_field(instruction.operand)));
+            a.load64(Reg::RCX, Reg::RAX, 0);
+            a.store64(locals_register, stack(depth), Reg::RCX);
+            break;
+        case Opcode::putstatic_quick:
+        case Opcode::putstatic2_quick:
+            a.load64(Reg::RCX, locals_register, stack(depth - (instruction.opcode == Opcode::putstatic_quick ? 1 : 2)));
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(m_decoded_code.resolved_static_field(instruction.operand)));
+            a.store64(Reg::RAX, 0, Reg::RCX);
+            break;
+
+        case Opcode::new_quick:
+        {
+            // Bumps the allocation buffer right here, and only calls into the VM once it has run out. The memory is
+            // already zeroed, so all that is left to do is to fill in the header.
+            auto* resolved_class = m_decoded_code.resolved_class(instruction.operand);
+            Assembler::Label slow_path;
+            Assembler::Label done;
+
+            a.move64_immediate(Reg::RDX, bit_cast<FlatPtr>(&m_vm.m_allocation_buffer));
+            a.load64(Reg::RAX, Reg::RDX, offsetof(Heap::AllocationBuffer, top));
+            a.lea(Reg::RCX, Reg::RAX, resolved_class->instance_size);
+            a.alu64(ALU::Compare, Reg::RCX, Reg::RDX, offsetof(Heap::AllocationBuffer, end));
+            a.jump_if(Condition::Above, slow_path);
+            a.store64(Reg::RDX, offsetof(Heap::AllocationBuffer, top), Reg::RCX);
+            a.move64_immediate(Reg::RCX, bit_cast<FlatPtr>(resolved_class));
+            a.store64(Reg::RAX, 0, Reg::RCX);
+            a.store64(locals_register, stack(depth), Reg::RAX);
+            a.jump(done);
+
+            a.bind(slow_path);
+            emit_safepoint(index);
+            a.move64(Reg::RDI, vm_register);
+            a.move64_immediate(Reg::RSI, bit_cast<FlatPtr>(resolved_class));
+            a.lea(Reg::RDX, locals_register, stack(depth));
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&VM::allocate_from_compiled_code));
+            a.call(Reg::RAX);
+            a.test8(Reg::RAX, Reg::RAX);
+            a.jump_if(Condition::Equal, m_failed);
+            a.bind(done);
+            break;
+        }
+
+        // The operand of these is the offset of the field into the object, and the second one the class of the field
+        // reference.
+        case Opcode::getfield_byte_quick:
+        case Opcode::getfield_char_quick:
+        case Opcode::getfield_short_quick:
+        case Opcode::getfield_quick:
+        case Opcode::getfield2_quick:
+        case Opcode::getfield_reference_quick:
+        {
+            auto object = stack(depth - 1);
+            emit_field_class_check(object, *m_decoded_code.resolved_class(instruction.second_operand));
+
+            if (instruction.opcode == Opcode::getfield_byte_quick)
+                a.load8_sign_extend(Reg::RCX, Reg::RAX, instruction.operand);
+            else if (instruction.opcode == Opcode::getfield_char_quick)
+                a.load16_zero_extend(Reg::RCX, Reg::RAX, instruction.operand);
+            else if (instruction.opcode == Opcode::getfield_short_quick)
+                a.load16_sign_extend(Reg::RCX, Reg::RAX, instruction.operand);
+            else if (instruction.opcode == Opcode::getfield_quick)
+                a.load32(Reg::RCX, Reg::RAX, instruction.operand);
+            else
+                a.load64(Reg::RCX, Reg::RAX, instruction.operand);
+
+            a.store64(locals_register, object, Reg::RCX);
+            break;
+        }
+        case Opcode::putfield_boolean_quick:
+        case Opcode::putfield_byte_quick:
+        case Opcode::putfield_short_quick:
+        case Opcode::putfield_quick:
+        case Opcode::putfield2_quick:
+        case Opcode::putfield_reference_quick:
+        {
+            auto value = stack(depth - (instruction.opcode == Opcode::putfield2_quick ? 2 : 1));
+            emit_field_class_check(value - static_cast<i32>(sizeof(Slot)),
+                                   *m_decoded_code.resolved_class(instruction.second_operand));
+            a.load64(Reg::RCX, locals_register, value);
+
+            if (instruction.opcode == Opcode::putfield_boolean_quick)
+            {
+                a.alu32_immediate(ALU::And, Reg::RCX, 1);
+                a.store8(Reg::RAX, instruction.operand, Reg::RCX);
+            }
+            else if (instruction.opcode == Opcode::putfield_byte_quick)
+            {
+                a.store8(Reg::RAX, instruction.operand, Reg::RCX);
+            }
+            else if (instruction.opcode == Opcode::putfield_short_quick)
+            {
+                a.store16(Reg::RAX, instruction.operand, Reg::RCX);
+            }
+            else if (instruction.opcode == Opcode::putfield_quick)
+            {
+                a.store32(Reg::RAX, instruction.operand, Reg::RCX);
+            }
+            else
+            {
+                a.store64(Reg::RAX, instruction.operand, Reg::RCX);
+            }
+
+            // The write barrier, as in Heap::record_reference_store.
+            if (instruction.opcode == Opcode::putfield_reference_quick)
+            {
+                a.lea(Reg::RCX, Reg::RAX, instruction.operand);
+                a.shift_right64_immediate(Reg::RCX, Heap::card_shift);
+                a.move64_immediate(Reg::RDX, bit_cast<FlatPtr>(m_vm.m_heap.biased_card_table()));
+                a.load64(Reg::RDX, Reg::RDX, 0);
+                a.alu64(ALU::Add, Reg::RCX, Reg::RDX);
+                a.move32_immediate(Reg::RDX, Heap::dirty_card);
+                a.store8(Reg::RCX, 0, Reg::RDX);
+            }
+            break;
+        }
+
+        case Opcode::newarray_quick:
+        {
+            // How much to allocate depends on the length, which has to be checked first anyway, so unlike new_quick,
+            // this always goes through the VM.
+            auto length = stack(depth - 1);
+            emit_safepoint(index);
+            a.move64(Reg::RDI, vm_register);
+            a.move64_immediate(Reg::RSI, bit_cast<FlatPtr>(m_decoded_code.resolved_class(instruction.operand)));
+            a.load32(Reg::RDX, locals_register, length);
+            a.lea(Reg::RCX, locals_register, length);
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&VM::allocate_array_from_compiled_code));
+            a.call(Reg::RAX);
+            a.test8(Reg::RAX, Reg::RAX);
+            a.jump_if(Condition::Equal, m_failed);
+            break;
+        }
+        case Opcode::arraylength:
+            emit_null_check(stack(depth - 1));
+            a.load32(Reg::RCX, Reg::RAX, Array::length_offset);
+            a.store64(locals_register, stack(depth - 1), Reg::RCX);
+            break;
+        case Opcode::baload:
+        case Opcode::caload:
+        case Opcode::saload:
+        case Opcode::iaload:
+        case Opcode::faload:
+        case Opcode::laload:
+        case Opcode::daload:
+        {
+            auto array = stack(depth - 2);
+            emit_component_address(array, stack(depth - 1), array_component_size(instruction.opcode));
+
+            if (instruction.opcode == Opcode::baload)
+                a.load8_sign_extend(Reg::RCX, Reg::RAX, Array::elements_offset);
+            else if (instruction.opcode == Opcode::caload)
+                a.load16_zero_extend(Reg::RCX, Reg::RAX, Array::elements_offset);
+            else if (instruction.opcode == Opcode::saload)
+                a.load16_sign_extend(Reg::RCX, Reg::RAX, Array::elements_offset);
+            else if (instruction.opcode == Opcode::iaload || instruction.opcode == Opcode::faload)
+                a.load32(Reg::RCX, Reg::RAX, Array::elements_offset);
+            else
+                a.load64(Reg::RCX, Reg::RAX, Array::elements_offset);
+
+            a.store64(locals_register, array, Reg::RCX);
+            break;
+        }
+        case Opcode::bastore:
+        case Opcode::castore:
+        case Opcode::sastore:
+        case Opcode::iastore:
+        case Opcode::fastore:
+        case Opcode::lastore:
+        case Opcode::dastore:
+        {
+            auto size = array_component_size(instruction.opcode);
+            auto array = stack(depth - (size == 8 ? 4 : 3));
+            auto value = stack(depth - (size == 8 ? 2 : 1));
+            emit_component_address(array, array + static_cast<i32>(sizeof(Slot)), size);
+            a.load64(Reg::RDX, locals_register, value);
+
+            // 6.5 bastore: "If the arrayref refers to an array whose components are of type boolean, then the int
+            // value is narrowed by taking the bitwise AND of value and 1"
+            if (instruction.opcode == Opcode::bastore)
+            {
+                auto* boolean_array_class = TRY(m_vm.resolve_primitive_array_class(PrimitiveType::Boolean));
+                Assembler::Label store;
+                a.load64(Reg::RCX, locals_register, array);
+                a.load64(Reg::RCX, Reg::RCX, 0);
+                a.move64_immediate(Reg::RSI, bit_cast<FlatPtr>(boolean_array_class));
+                a.alu64(ALU::Compare, Reg::RCX, Reg::RSI);
+                a.jump_if(Condition::NotEqual, store);
+                a.alu32_immediate(ALU::And, Reg::RDX, 1);
+                a.bind(store);
+            }
+
+            if (size == 1)
+                a.store8(Reg::RAX, Array::elements_offset, Reg::RDX);
+            else if (size == 2)
+                a.store16(Reg::RAX, Array::elements_offset, Reg::RDX);
+            else if (size == 4)
+                a.store32(Reg::RAX, Array::elements_offset, Reg::RDX);
+            else
+                a.store64(Reg::RAX, Array::elements_offset, Reg::RDX);
+            break;
+        }
+
+        case Opcode::invokestatic_quick:
+        case Opcode::invokespecial_quick:
+        {
+            // The callee may well not be compiled, so this always goes back through the VM, which picks whatever
+            // runs it fastest. Its return value ends up where its arguments were, which is the top of our stack.
+            auto* method = m_decoded_code.resolved_method(instruction.operand);
+            auto arguments = stack(depth - method->argument_slots);
+
+            if (instruction.opcode == Opcode::invokespecial_quick)
+                emit_null_check(arguments);
+
+            emit_safepoint(index);
+            a.move64(Reg::RDI, vm_register);
+            a.move64_immediate(Reg::RSI, bit_cast<FlatPtr>(method));
+            a.lea(Reg::RDX, locals_register, arguments);
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&VM::invoke_from_compiled_code));
+            a.call(Reg::RAX);
+            a.test8(Reg::RAX, Reg::RAX);
+            a.jump_if(Condition::Equal, m_failed);
+            break;
+        }
+
+        // Whatever these refer to hasn't been resolved when the method was compiled, and resolving it may have to load
+        // and initialize classes, so this is left to the interpreter. It takes over the frame as it is, and carries on
+        // right at this instruction.
+        case Opcode::getstatic:
+        case Opcode::putstatic:
+        case Opcode::invokestatic:
+        case Opcode::new_:
+        case Opcode::getfield:
+        case Opcode::putfield:
+        case Opcode::invokespecial:
+        case Opcode::newarray:
+            emit_deoptimization(index);
+            break;
+
+        case Opcode::goto_:
+            if (static_cast<size_t>(instruction.operand) <= index)
+                emit_backward_branch(instruction.operand);
+            else
+                a.jump(m_instruction_labels[instruction.operand]);
+            break;
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+            a.load32(Reg::RAX, locals_register, stack(depth - 1));
+            a.test32(Reg::RAX, Reg::RAX);
+            emit_branch();
+            break;
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+            a.load32(Reg::RAX, locals_register, stack(depth - 2));
+            a.alu32(ALU::Compare, Reg::RAX, locals_register, stack(depth - 1));
+            emit_branch();
+            break;
+        // References are compared as the whole slot, which is nothing but their address.
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+            a.load64(Reg::RAX, locals_register, stack(depth - 1));
+            a.test64(Reg::RAX, Reg::RAX);
+            emit_branch();
+            break;
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+            a.load64(Reg::RAX, locals_register, stack(depth - 2));
+            a.alu64(ALU::Compare, Reg::RAX, locals_register, stack(depth - 1));
+            emit_branch();
+            break;
+
+        case Opcode::return_:
+            a.jump(m_returned);
+            break;
+        case Opcode::ireturn:
+        case Opcode::freturn:
+        case Opcode::areturn:
+            a.load64(Reg::RAX, locals_register, stack(depth - 1));
+            a.store64(result_register, 0, Reg::RAX);
+            a.jump(m_returned);
+            break;
+        case Opcode::lreturn:
+        case Opcode::dreturn:
+            a.load64(Reg::RAX, locals_register, stack(depth - 2));
+            a.store64(result_register, 0, Reg::RAX);
+            a.jump(m_returned);
+            break;
+
+        default:
+            // compute_stack_depths has already turned down everything else.
+            VERIFY_NOT_REACHED();
+    }
+
+    return {};
+}
+}
\ No newline at end of file
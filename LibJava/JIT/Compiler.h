@@ -0,0 +1,69 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/JIT/Assembler.h>
+#include <LibJava/JIT/CompiledCode.h>
+#include <LibJava/ResolvedMethod.h>
+
+namespace Java
+{
+class VM;
+}
+
+namespace Java::JIT
+{
+// A baseline compiler: every instruction is translated on its own into a fixed sequence of machine code (a template),
+// which works directly on the slots of the frame in the VM stack, the same way the interpreter does. Nothing is kept
+// in registers across instructions, but there is no dispatch, no decoding of operands and no bounds checks on the
+// operand stack anymore, since its depth at every instruction is worked out up front.
+// Only a subset of the instruction set is supported. A method that uses anything else is not compiled at all, and
+// simply stays in the interpreter. Instructions that haven't been quickened yet are compiled into an exit that hands
+// the frame back to the interpreter.
+// If the method is to be optimized later on, backward branches count towards that in the profile of the method, and
+// once they have reached the given number, the next one exits instead so that the VM can optimize the method.
+class Compiler
+{
+public:
+    // The VM has to stay where it is for as long as the code is around, as the code allocates from its allocation
+    // buffer directly.
+    static ErrorOr<NonnullOwnPtr<CompiledCode>> compile(VM&, const ResolvedMethod&,
+                                                         Optional<u32> optimize_at_backedges = {});
+
+private:
+    Compiler(VM&, const ResolvedMethod&, Optional<u32> optimize_at_backedges);
+
+    ErrorOr<void> compute_stack_depths();
+    ErrorOr<void> compile_instruction(size_t index);
+    void emit_prologue();
+    void emit_epilogue(CompiledCode::Exit);
+    void emit_backward_branch(u32 target);
+    void emit_deoptimization(size_t index);
+    void emit_safepoint(size_t index);
+    Vector<CompiledCode::OSREntry> emit_osr_entries();
+
+    // Where the given local variable, or the operand stack slot at the given depth, lives relative to the locals.
+    i32 local(u32 index) const { return index * sizeof(Slot); }
+    i32 stack(u32 depth) const { return (m_max_locals + depth) * sizeof(Slot); }
+
+    VM& m_vm;
+    const ResolvedMethod& m_method;
+    const DecodedCode& m_decoded_code;
+    // Every instruction gets its own template, so superinstructions are of no use here.
+    Vector<Instruction> m_instructions;
+    u32 m_max_locals{};
+    Optional<u32> m_optimize_at_backedges;
+
+    Assembler m_assembler;
+    // The depth of the operand stack right before each instruction, or nothing if it is unreachable.
+    Vector<Optional<u16>> m_stack_depths;
+    Vector<Assembler::Label> m_instruction_labels;
+    Assembler::Label m_returned;
+    Assembler::Label m_failed;
+    Assembler::Label m_deoptimized;
+    Assembler::Label m_optimize;
+};
+}
\ No newline at end of file
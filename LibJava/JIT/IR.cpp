@@ -0,0 +1,866 @@
+#include <AK/HashTable.h>
+#include <LibJava/JIT/IR.h>
+
+namespace Java::JIT::IR
+{
+namespace
+{
+// 2.11.1: "the Java Virtual Machine internally converts the values of boolean, byte, short and char to type int"
+bool is_int(const FieldDescriptor& descriptor)
+{
+    if (descriptor.array_dimensions() > 0 || !descriptor.type().has<PrimitiveType>())
+        return false;
+
+    switch (descriptor.type().get<PrimitiveType>())
+    {
+        case PrimitiveType::Boolean:
+        case PrimitiveType::Byte:
+        case PrimitiveType::Char:
+        case PrimitiveType::Short:
+        case PrimitiveType::Int:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Optional<Condition> branch_condition(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::ifeq:
+        case Opcode::if_icmpeq:
+            return Condition::Equal;
+        case Opcode::ifne:
+        case Opcode::if_icmpne:
+            return Condition::NotEqual;
+        case Opcode::iflt:
+        case Opcode::if_icmplt:
+            return Condition::LessThan;
+        case Opcode::ifge:
+        case Opcode::if_icmpge:
+            return Condition::GreaterThanOrEqualTo;
+        case Opcode::ifgt:
+        case Opcode::if_icmpgt:
+            return Condition::GreaterThan;
+        case Opcode::ifle:
+        case Opcode::if_icmple:
+            return Condition::LessThanOrEqualTo;
+        default:
+            return {};
+    }
+}
+
+bool compares_two_operands(Opcode opcode)
+{
+    return opcode >= Opcode::if_icmpeq && opcode <= Opcode::if_icmple;
+}
+
+// Instructions that haven't been quickened yet are left to the interpreter, so they end a block.
+bool deoptimizes(Opcode opcode)
+{
+    return opcode == Opcode::getstatic || opcode == Opcode::putstatic || opcode == Opcode::invokestatic;
+}
+
+bool ends_block(Opcode opcode)
+{
+    return opcode == Opcode::goto_ || branch_condition(opcode).has_value() || opcode == Opcode::ireturn ||
+           opcode == Opcode::return_ || opcode == Opcode::freturn || opcode == Opcode::lreturn ||
+           opcode == Opcode::dreturn || deoptimizes(opcode);
+}
+}
+
+size_t BasicBlock::index_of_predecessor(const BasicBlock& predecessor) const
+{
+    for (size_t i = 0; i < predecessors.size(); i++)
+    {
+        if (predecessors[i] == &predecessor)
+            return i;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+ErrorOr<Graph> Graph::try_build(const ResolvedMethod& method)
+{
+    Graph graph;
+    graph.m_method = &method;
+    graph.m_max_locals = method.code->max_locals;
+    graph.m_max_stack = method.code->max_stacks;
+    TRY(graph.build());
+    return graph;
+}
+
+BasicBlock& Graph::create_block()
+{
+    auto block = make<BasicBlock>();
+    block->id = m_next_block_id++;
+    auto& block_reference = *block;
+    m_blocks.append(move(block));
+    return block_reference;
+}
+
+Value& Graph::create_value(Operation operation, BasicBlock* block, Vector<Value*> inputs)
+{
+    auto value = make<Value>();
+    value->operation = operation;
+    value->id = m_values.size();
+    value->block = block;
+    value->inputs = move(inputs);
+    auto& value_reference = *value;
+    m_values.append(move(value));
+    return value_reference;
+}
+
+Value& Graph::append(BasicBlock& block, Operation operation, Vector<Value*> inputs)
+{
+    auto& value = create_value(operation, &block, move(inputs));
+    block.values.append(&value);
+    return value;
+}
+
+Value& Graph::constant(i32 value)
+{
+    if (auto existing = m_constants.get(value); existing.has_value())
+        return *existing.value();
+
+    auto& constant = create_value(Operation::Constant, nullptr);
+    constant.immediate = value;
+    m_constants.set(value, &constant);
+    return constant;
+}
+
+// Works on the decoded instructions with the help of the operand stack depths, the same way the baseline compiler
+// does, except that instead of templates, every instruction is turned into the values it computes from the values in
+// the slots it reads, as if it was interpreted with values that aren't known yet.
+ErrorOr<void> Graph::build()
+{
+    auto& method = *m_method;
+    auto& decoded_code = *method.decoded_code;
+    // Superinstructions save dispatches in the interpreter, but here they would only be in the way.
+    auto instructions = decoded_code.unfused_instructions();
+
+    // The object an instance method is invoked on is a reference, which the optimizing compiler knows nothing about.
+    if (!has_flag(method.method->access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+        return Error::from_string_literal("The optimizing compiler only supports static methods");
+
+    for (auto& parameter : method.descriptor.parameters())
+    {
+        if (!is_int(parameter))
+            return Error::from_string_literal("The optimizing compiler only supports int parameters");
+    }
+    if (method.descriptor.return_type().has<FieldDescriptor>() &&
+        !is_int(method.descriptor.return_type().get<FieldDescriptor>()))
+        return Error::from_string_literal("The optimizing compiler only supports methods that return int or void");
+
+    // Split the instructions into basic blocks. A block starts at the first instruction, at the target of every branch
+    // and after every instruction that doesn't simply fall through to the next one.
+    Vector<bool> is_leader;
+    is_leader.resize(instructions.size() + 1);
+    is_leader[0] = true;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        auto& instruction = instructions[i];
+        if (instruction.opcode == Opcode::goto_ || branch_condition(instruction.opcode).has_value())
+            is_leader[instruction.operand] = true;
+        if (ends_block(instruction.opcode))
+            is_leader[i + 1] = true;
+    }
+
+    auto& method_entry = create_block();
+    method_entry.entry = BasicBlock::Entry::Method;
+
+    Vector<BasicBlock*> block_at;
+    block_at.resize(instructions.size());
+    Vector<size_t> block_start;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        if (!is_leader[i])
+            continue;
+
+        block_at[i] = &create_block();
+        block_start.append(i);
+    }
+
+    auto block_end = [&](BasicBlock& block) {
+        // Every block but the method entry starts at an instruction, in order.
+        auto i = block_start[block.id - 1] + 1;
+        while (i < instructions.size() && !is_leader[i])
+            i++;
+        return i;
+    };
+
+    method_entry.terminator.successors.append(block_at[0]);
+    for (size_t i = 0; i < block_start.size(); i++)
+    {
+        auto& block = *block_at[block_start[i]];
+        auto end = block_end(block);
+        auto& last = instructions[end - 1];
+
+        if (last.opcode == Opcode::goto_)
+        {
+            block.terminator.successors.append(block_at[last.operand]);
+        }
+        else if (branch_condition(last.opcode).has_value())
+        {
+            block.terminator.successors.append(block_at[last.operand]);
+            if (end >= instructions.size())
+                return Error::from_string_literal("Method code execution reached the end without returning");
+            block.terminator.successors.append(block_at[end]);
+        }
+        else if (!ends_block(last.opcode))
+        {
+            if (end >= instructions.size())
+                return Error::from_string_literal("Method code execution reached the end without returning");
+            block.terminator.successors.append(block_at[end]);
+        }
+    }
+
+    // Loop headers are what the interpreter offers to hand its frame over at, which is wherever a branch goes back to.
+    // Each of them gets an entry of its own, which is set up as if it was just another way to get to the loop.
+    HashTable<BasicBlock*> reachable;
+    Vector<BasicBlock*> worklist;
+    worklist.append(&method_entry);
+    reachable.set(&method_entry);
+    while (!worklist.is_empty())
+    {
+        auto* block = worklist.take_last();
+        for (auto* successor : block->terminator.successors)
+        {
+            if (reachable.set(successor) == HashSetResult::InsertedNewEntry)
+                worklist.append(successor);
+        }
+    }
+
+    HashMap<BasicBlock*, BasicBlock*> osr_entries;
+    for (size_t i = 0; i < block_start.size(); i++)
+    {
+        auto& block = *block_at[block_start[i]];
+        if (!reachable.contains(&block))
+            continue;
+
+        auto branch_index = block_end(block) - 1;
+        auto& last = instructions[branch_index];
+        if (last.opcode != Opcode::goto_ && !branch_condition(last.opcode).has_value())
+            continue;
+        if (static_cast<size_t>(last.operand) > branch_index)
+            continue;
+
+        auto* header = block_at[last.operand];
+        if (osr_entries.contains(header))
+            continue;
+
+        auto& osr_entry = create_block();
+        osr_entry.entry = BasicBlock::Entry::OSR;
+        osr_entry.instruction_index = last.operand;
+        osr_entry.terminator.successors.append(header);
+        osr_entries.set(header, &osr_entry);
+    }
+
+    for (auto& block : m_blocks)
+    {
+        if (block->entry == BasicBlock::Entry::None && !reachable.contains(block.ptr()))
+            continue;
+
+        for (auto* successor : block->terminator.successors)
+            successor->predecessors.append(block.ptr());
+    }
+
+    // The slots of the frame (the locals, then the operand stack) as they are at the end of each block.
+    Vector<Optional<Vector<Value*>>> exit_slots;
+    exit_slots.resize(m_blocks.size());
+
+    Vector<Value*> slots;
+    for (size_t i = 0; i < m_max_locals; i++)
+    {
+        // Locals that aren't arguments can't be read before they've been written to (4.10.2.2), so what they are
+        // doesn't matter.
+        if (i < method.argument_slots)
+        {
+            auto& argument = append(method_entry, Operation::FrameSlot);
+            argument.immediate = i;
+            slots.append(&argument);
+        }
+        else
+        {
+            slots.append(&constant(0));
+        }
+    }
+    method_entry.terminator.kind = Terminator::Kind::Jump;
+    exit_slots[method_entry.id] = move(slots);
+
+    for (auto* block : reverse_postorder())
+    {
+        if (block->entry != BasicBlock::Entry::None)
+            continue;
+
+        // A block we get to from just one place picks up right where that left off, everywhere else control flow
+        // merges, so every slot gets a phi. Most of them are trivial, and removed again later.
+        Optional<size_t> slot_count;
+        for (auto* predecessor : block->predecessors)
+        {
+            if (exit_slots[predecessor->id].has_value())
+            {
+                slot_count = exit_slots[predecessor->id]->size();
+                break;
+            }
+        }
+        VERIFY(slot_count.has_value());
+
+        if (block->predecessors.size() == 1)
+        {
+            slots = exit_slots[block->predecessors.first()->id].value();
+        }
+        else
+        {
+            slots.clear();
+            for (size_t i = 0; i < slot_count.value(); i++)
+            {
+                auto& phi = create_value(Operation::Phi, block);
+                block->phis.append(&phi);
+                slots.append(&phi);
+            }
+        }
+
+        auto depth = [&] { return slots.size() - m_max_locals; };
+
+        auto pop = [&]() -> ErrorOr<Value*> {
+            if (depth() == 0)
+                return Error::from_string_literal("Operand stack underflow");
+            return slots.take_last();
+        };
+
+        auto push = [&](Value& value) -> ErrorOr<void> {
+            if (depth() >= m_max_stack)
+                return Error::from_string_literal("Operand stack overflow");
+            slots.append(&value);
+            return {};
+        };
+
+        auto check_local = [&](i32 index) -> ErrorOr<void> {
+            if (index < 0 || index >= m_max_locals)
+                return Error::from_string_literal("Local variable index out of range");
+            return {};
+        };
+
+        auto binary = [&](Operation operation) -> ErrorOr<void> {
+            auto* b = TRY(pop());
+            auto* a = TRY(pop());
+            return push(append(*block, operation, {a, b}));
+        };
+
+        auto unary = [&](Operation operation) -> ErrorOr<void> {
+            auto* a = TRY(pop());
+            return push(append(*block, operation, {a}));
+        };
+
+        block->terminator.kind = Terminator::Kind::Jump;
+
+        auto end = block_end(*block);
+        for (auto i = block_start[block->id - 1]; i < end; i++)
+        {
+            auto& instruction = instructions[i];
+            switch (instruction.opcode)
+            {
+                case Opcode::nop:
+                    break;
+                case Opcode::iconst_m1:
+                case Opcode::iconst_0:
+                case Opcode::iconst_1:
+                case Opcode::iconst_2:
+                case Opcode::iconst_3:
+                case Opcode::iconst_4:
+                case Opcode::iconst_5:
+                    TRY(push(constant(static_cast<u8>(instruction.opcode) - static_cast<u8>(Opcode::iconst_0))));
+                    break;
+                case Opcode::bipush:
+                case Opcode::sipush:
+                    TRY(push(constant(instruction.operand)));
+                    break;
+                case Opcode::ldc:
+                {
+                    auto& value = method.class_file->constant_pool()[instruction.operand - 1];
+                    if (!value.has<Integer>())
+                        return Error::from_string_literal("The optimizing compiler only supports Integer constants");
+
+                    TRY(push(constant(value.get<Integer>().value())));
+                    break;
+                }
+
+                case Opcode::iload:
+                    TRY(check_local(instruction.operand));
+                    TRY(push(*slots[instruction.operand]));
+                    break;
+                case Opcode::istore:
+                {
+                    TRY(check_local(instruction.operand));
+                    slots[instruction.operand] = TRY(pop());
+                    break;
+                }
+                case Opcode::iinc:
+                {
+                    TRY(check_local(instruction.operand));
+                    auto& slot = slots[instruction.operand];
+                    slot = &append(*block, Operation::Add, {slot, &constant(instruction.second_operand)});
+                    break;
+                }
+
+                case Opcode::iadd:
+                    TRY(binary(Operation::Add));
+                    break;
+                case Opcode::isub:
+                    TRY(binary(Operation::Subtract));
+                    break;
+                case Opcode::imul:
+                    TRY(binary(Operation::Multiply));
+                    break;
+                case Opcode::idiv:
+                {
+                    // 6.5 idiv: "if the value of the divisor in an int division is 0, idiv throws an
+                    // ArithmeticException." That is left to the interpreter, so unless the divisor is known not to be
+                    // zero, the block is split in front of the division, with a branch to a deoptimization for zero.
+                    if (depth() < 2)
+                        return Error::from_string_literal("Operand stack underflow");
+
+                    auto* divisor = slots.last();
+                    if (!divisor->is_constant() || divisor->immediate == 0)
+                    {
+                        auto& deoptimization = create_block();
+                        deoptimization.terminator.kind = Terminator::Kind::Deoptimize;
+                        deoptimization.terminator.inputs = slots;
+                        deoptimization.terminator.instruction_index = i;
+                        deoptimization.predecessors.append(block);
+
+                        auto& continuation = create_block();
+                        continuation.terminator = move(block->terminator);
+                        for (auto* successor : continuation.terminator.successors)
+                        {
+                            for (auto& predecessor : successor->predecessors)
+                            {
+                                if (predecessor == block)
+                                    predecessor = &continuation;
+                            }
+                        }
+                        continuation.predecessors.append(block);
+
+                        block->terminator = {};
+                        block->terminator.kind = Terminator::Kind::Branch;
+                        block->terminator.condition = Condition::Equal;
+                        block->terminator.inputs = {divisor, &constant(0)};
+                        block->terminator.successors = {&deoptimization, &continuation};
+                        exit_slots.resize(m_blocks.size());
+                        exit_slots[block->id] = slots;
+                        block = &continuation;
+                    }
+
+                    TRY(binary(Operation::Divide));
+                    break;
+                }
+                case Opcode::iand:
+                    TRY(binary(Operation::And));
+                    break;
+                case Opcode::ior:
+                    TRY(binary(Operation::Or));
+                    break;
+                case Opcode::ixor:
+                    TRY(binary(Operation::Xor));
+                    break;
+                case Opcode::ineg:
+                    TRY(unary(Operation::Negate));
+                    break;
+                case Opcode::i2b:
+                    TRY(unary(Operation::IntToByte));
+                    break;
+                case Opcode::i2c:
+                    TRY(unary(Operation::IntToChar));
+                    break;
+                case Opcode::i2s:
+                    TRY(unary(Operation::IntToShort));
+                    break;
+
+                case Opcode::dup:
+                {
+                    auto* value = TRY(pop());
+                    TRY(push(*value));
+                    TRY(push(*value));
+                    break;
+                }
+                case Opcode::pop:
+                    TRY(pop());
+                    break;
+
+                case Opcode::getstatic_quick:
+                {
+                    auto& load = append(*block, Operation::LoadStatic);
+                    load.static_field = decoded_code.resolved_static_field(instruction.operand);
+                    TRY(push(load));
+                    break;
+                }
+                case Opcode::putstatic_quick:
+                {
+                    auto* value = TRY(pop());
+                    auto& store = append(*block, Operation::StoreStatic, {value});
+                    store.static_field = decoded_code.resolved_static_field(instruction.operand);
+                    break;
+                }
+                case Opcode::invokestatic_quick:
+                {
+                    auto* callee = decoded_code.resolved_method(instruction.operand);
+                    if (callee->return_kind == ResolvedMethod::ReturnKind::Category2)
+                        return Error::from_string_literal("The optimizing compiler only supports calls to methods that "
+                                                          "return int or void");
+
+                    Vector<Value*> arguments;
+                    arguments.resize(callee->argument_slots);
+                    for (size_t argument = callee->argument_slots; argument > 0; argument--)
+                        arguments[argument - 1] = TRY(pop());
+
+                    auto& call = append(*block, Operation::Call, move(arguments));
+                    call.method = callee;
+                    call.caller = &method;
+                    call.instruction_index = i;
+                    call.produces_value = callee->return_kind == ResolvedMethod::ReturnKind::Category1;
+                    if (call.produces_value)
+                        TRY(push(call));
+                    break;
+                }
+
+                case Opcode::getstatic:
+                case Opcode::putstatic:
+                case Opcode::invokestatic:
+                    block->terminator.kind = Terminator::Kind::Deoptimize;
+                    block->terminator.inputs = slots;
+                    block->terminator.instruction_index = i;
+                    break;
+
+                case Opcode::goto_:
+                    break;
+                case Opcode::ifeq:
+                case Opcode::ifne:
+                case Opcode::iflt:
+                case Opcode::ifge:
+                case Opcode::ifgt:
+                case Opcode::ifle:
+                case Opcode::if_icmpeq:
+                case Opcode::if_icmpne:
+                case Opcode::if_icmplt:
+                case Opcode::if_icmpge:
+                case Opcode::if_icmpgt:
+                case Opcode::if_icmple:
+                {
+                    auto* b = compares_two_operands(instruction.opcode) ? TRY(pop()) : &constant(0);
+                    auto* a = TRY(pop());
+                    block->terminator.kind = Terminator::Kind::Branch;
+                    block->terminator.condition = branch_condition(instruction.opcode).value();
+                    block->terminator.inputs = {a, b};
+                    break;
+                }
+
+                case Opcode::ireturn:
+                    block->terminator.kind = Terminator::Kind::Return;
+                    block->terminator.inputs = {TRY(pop())};
+                    break;
+                case Opcode::return_:
+                    block->terminator.kind = Terminator::Kind::Return;
+                    break;
+
+                default:
+                    return Error::from_string_literal(String::formatted("The optimizing compiler cannot compile {}",
+                                                                        *opcode_names.get(instruction.opcode)));
+            }
+        }
+
+        exit_slots[block->id] = move(slots);
+    }
+
+    // An OSR entry takes every slot from the frame as it is when the interpreter branches to the loop header.
+    for (auto& osr_entry : osr_entries)
+    {
+        auto& header = *osr_entry.key;
+        auto& entry = *osr_entry.value;
+        // Having the OSR entry as a predecessor makes every loop header a merge, so it has a phi for each slot.
+        auto slot_count = header.phis.size();
+        entry.stack_depth = slot_count - m_max_locals;
+        entry.terminator.kind = Terminator::Kind::Jump;
+        slots.clear();
+        for (size_t i = 0; i < slot_count; i++)
+        {
+            auto& slot = append(entry, Operation::FrameSlot);
+            slot.immediate = i;
+            slots.append(&slot);
+        }
+        exit_slots[entry.id] = move(slots);
+    }
+
+    for (auto* block : reverse_postorder())
+    {
+        if (block->predecessors.size() < 2)
+            continue;
+
+        for (auto* predecessor : block->predecessors)
+        {
+            auto& predecessor_slots = exit_slots[predecessor->id].value();
+            if (predecessor_slots.size() != block->phis.size())
+                return Error::from_string_literal("Operand stack depths don't match where control flow merges");
+
+            for (size_t i = 0; i < block->phis.size(); i++)
+                block->phis[i]->inputs.append(predecessor_slots[i]);
+        }
+    }
+
+    // Anything that can't be reached is left without a terminator, so it has to go before anyone looks at it.
+    remove_blocks_except(reverse_postorder());
+    remove_trivial_phis();
+    return {};
+}
+
+Vector<BasicBlock*> Graph::reverse_postorder()
+{
+    // Every entry gets an order of its own, starting with the method entry, and each one only has what the ones before
+    // it haven't already gotten to. OSR entries usually only have themselves, since the loop they go to can be reached
+    // from the start of the method as well. Branches list where they go when taken first, so the block they fall
+    // through to is laid out right after them.
+    Vector<BasicBlock*> roots;
+    roots.append(&entry());
+    for (auto& block : m_blocks)
+    {
+        if (block->entry == BasicBlock::Entry::OSR)
+            roots.append(block.ptr());
+    }
+
+    HashTable<BasicBlock*> visited;
+    Vector<BasicBlock*> order;
+    struct Visit
+    {
+        BasicBlock* block;
+        size_t next_successor;
+    };
+    Vector<Visit> stack;
+
+    for (auto* root : roots)
+    {
+        Vector<BasicBlock*> postorder;
+        visited.set(root);
+        stack.append({root, 0});
+
+        while (!stack.is_empty())
+        {
+            auto& visit = stack.last();
+            auto& successors = visit.block->terminator.successors;
+            if (visit.next_successor == successors.size())
+            {
+                postorder.append(visit.block);
+                stack.take_last();
+                continue;
+            }
+
+            auto* successor = successors[visit.next_successor++];
+            if (visited.set(successor) == HashSetResult::InsertedNewEntry)
+                stack.append({successor, 0});
+        }
+
+        for (size_t i = postorder.size(); i > 0; i--)
+            order.append(postorder[i - 1]);
+    }
+
+    return order;
+}
+
+void Graph::apply_replacements()
+{
+    auto is_replaced = [](Value* value) { return value->replacement != nullptr; };
+
+    for (auto& block : m_blocks)
+    {
+        block->phis.remove_all_matching(is_replaced);
+        block->values.remove_all_matching(is_replaced);
+
+        for (auto* phi : block->phis)
+        {
+            for (auto& input : phi->inputs)
+                input = resolve(input);
+        }
+        for (auto* value : block->values)
+        {
+            for (auto& input : value->inputs)
+                input = resolve(input);
+        }
+        for (auto& input : block->terminator.inputs)
+            input = resolve(input);
+    }
+}
+
+void Graph::remove_trivial_phis()
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto& block : m_blocks)
+        {
+            for (auto* phi : block->phis)
+            {
+                if (phi->replacement)
+                    continue;
+
+                Value* only_input = nullptr;
+                bool is_trivial = true;
+                for (auto* input : phi->inputs)
+                {
+                    input = resolve(input);
+                    if (input == phi || input == only_input)
+                        continue;
+                    if (only_input)
+                    {
+                        is_trivial = false;
+                        break;
+                    }
+                    only_input = input;
+                }
+
+                if (!is_trivial)
+                    continue;
+
+                // A phi that only ever gets itself is in a loop that can't be entered, whatever it is doesn't matter.
+                phi->replacement = only_input ? only_input : &constant(0);
+                changed = true;
+            }
+        }
+    }
+
+    apply_replacements();
+}
+
+void Graph::remove_predecessor(BasicBlock& block, size_t index)
+{
+    block.predecessors.remove(index);
+    for (auto* phi : block.phis)
+        phi->inputs.remove(index);
+}
+
+void Graph::remove_blocks_except(const Vector<BasicBlock*>& blocks_to_keep)
+{
+    HashTable<BasicBlock*> keep;
+    for (auto* block : blocks_to_keep)
+        keep.set(block);
+
+    for (auto& block : m_blocks)
+    {
+        if (!keep.contains(block.ptr()))
+            continue;
+
+        for (size_t i = block->predecessors.size(); i > 0; i--)
+        {
+            if (!keep.contains(block->predecessors[i - 1]))
+                remove_predecessor(*block, i - 1);
+        }
+    }
+
+    // The method entry is always reachable, so it stays the first block.
+    m_blocks.remove_all_matching([&](auto& block) { return !keep.contains(block.ptr()); });
+}
+
+void Graph::inline_call(Value& call, Graph callee)
+{
+    VERIFY(call.operation == Operation::Call && call.method == callee.m_method);
+    m_inlined_calls.append({call.caller, call.instruction_index, callee.m_method});
+
+    // The callee is only ever entered through the call, so its OSR entries go, along with the phi inputs for them.
+    for (auto& block : callee.m_blocks)
+    {
+        if (block->entry == BasicBlock::Entry::OSR)
+            block->entry = BasicBlock::Entry::None;
+    }
+    callee.remove_blocks_except(callee.reverse_postorder());
+
+    // Everything after the call goes into a block of its own, which the callee returns to.
+    auto& block = *call.block;
+    auto& continuation = create_block();
+    auto call_index = block.values.find_first_index(&call).value();
+    for (size_t i = call_index + 1; i < block.values.size(); i++)
+    {
+        block.values[i]->block = &continuation;
+        continuation.values.append(block.values[i]);
+    }
+    block.values.shrink(call_index);
+
+    continuation.terminator = move(block.terminator);
+    for (auto* successor : continuation.terminator.successors)
+    {
+        for (auto& predecessor : successor->predecessors)
+        {
+            if (predecessor == &block)
+                predecessor = &continuation;
+        }
+    }
+
+    auto& callee_entry = callee.entry();
+    callee_entry.entry = BasicBlock::Entry::None;
+    callee_entry.predecessors.append(&block);
+    block.terminator = {};
+    block.terminator.kind = Terminator::Kind::Jump;
+    block.terminator.successors.append(&callee_entry);
+
+    Vector<Value*> return_values;
+    for (auto& callee_block : callee.m_blocks)
+    {
+        auto& terminator = callee_block->terminator;
+        VERIFY(terminator.kind != Terminator::Kind::Deoptimize);
+        if (terminator.kind != Terminator::Kind::Return)
+            continue;
+
+        if (call.produces_value)
+            return_values.append(terminator.inputs.first());
+        terminator.kind = Terminator::Kind::Jump;
+        terminator.inputs.clear();
+        terminator.successors.append(&continuation);
+        continuation.predecessors.append(callee_block.ptr());
+    }
+
+    // The callee reads its arguments from the frame in its method entry, which is where the values it is called with
+    // come in instead.
+    for (auto* value : callee_entry.values)
+    {
+        if (value->operation == Operation::FrameSlot)
+            value->replacement = call.inputs[value->immediate];
+    }
+
+    for (auto& value : callee.m_values)
+    {
+        if (value->is_constant())
+            value->replacement = &constant(value->immediate);
+        else if (value->operation == Operation::Call)
+            value->inlining_depth = call.inlining_depth + 1;
+    }
+    for (size_t i = 0; i < callee.m_values.size(); i++)
+        callee.m_values[i]->id = m_values.size() + i;
+    for (auto& callee_block : callee.m_blocks)
+        callee_block->id = m_next_block_id++;
+    m_values.extend(move(callee.m_values));
+    m_blocks.extend(move(callee.m_blocks));
+
+    if (call.produces_value)
+    {
+        // A callee that never returns leaves the rest of the block unreachable, so what the call produces doesn't
+        // matter.
+        if (return_values.is_empty())
+        {
+            call.replacement = &constant(0);
+        }
+        else if (return_values.size() == 1)
+        {
+            call.replacement = return_values.first();
+        }
+        else
+        {
+            auto& phi = create_value(Operation::Phi, &continuation, move(return_values));
+            continuation.phis.append(&phi);
+            call.replacement = &phi;
+        }
+    }
+
+    apply_replacements();
+    remove_blocks_except(reverse_postorder());
+    remove_trivial_phis();
+}
+}
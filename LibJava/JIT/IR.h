@@ -0,0 +1,202 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/HashMap.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <LibJava/ResolvedMethod.h>
+
+namespace Java::JIT::IR
+{
+struct BasicBlock;
+
+// The intermediate representation of the optimizing compiler is a graph of basic blocks, with the values in them in
+// static single assignment form: every value is computed by exactly one operation, and every local variable or operand
+// stack slot that could hold different values depending on where control flow came from becomes a phi.
+// Only ints are supported so far. Byte, short, char and boolean are ints as well (2.11.1), and anything else that only
+// ever gets moved around without being looked at, like a float that goes from a static field into a call, is carried
+// along in the same 32 bits.
+enum class Operation : u8
+{
+    Constant,
+    // A local variable or operand stack slot, as it is in the frame when the compiled code is entered.
+    FrameSlot,
+    Phi,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    And,
+    Or,
+    Xor,
+    Negate,
+    IntToByte,
+    IntToChar,
+    IntToShort,
+    LoadStatic,
+    StoreStatic,
+    Call,
+};
+
+enum class Condition : u8
+{
+    Equal,
+    NotEqual,
+    LessThan,
+    GreaterThanOrEqualTo,
+    GreaterThan,
+    LessThanOrEqualTo,
+};
+
+struct Value
+{
+    Operation operation{};
+    // Never reused, not even once the value has been removed, so that passes can keep tables indexed by it.
+    u32 id{};
+    // Constants don't belong to any block, they can be used from anywhere.
+    BasicBlock* block{};
+    Vector<Value*> inputs;
+
+    // The value of a Constant, or the index of the slot for a FrameSlot, counting the operand stack after the locals.
+    i32 immediate{};
+    Slot* static_field{};
+    ResolvedMethod* method{};
+    // Calls to methods that return void don't produce a value, everything else does.
+    bool produces_value{true};
+
+    // For calls, the method that the invokestatic is in, which is a method that has been inlined if it isn't the one
+    // being compiled, and the index of the instruction. The depth is how many inlined calls the call is nested in.
+    const ResolvedMethod* caller{};
+    u32 instruction_index{};
+    u8 inlining_depth{};
+
+    // Set once this value turned out to be the same as another one, which all of its uses are moved over to by
+    // Graph::apply_replacements.
+    Value* replacement{};
+
+    bool is_constant() const { return operation == Operation::Constant; }
+
+    bool has_side_effects() const { return operation == Operation::StoreStatic || operation == Operation::Call; }
+};
+
+struct Terminator
+{
+    enum class Kind : u8
+    {
+        Jump,
+        // Goes to the first successor if the condition holds for the two inputs, and to the second one otherwise.
+        Branch,
+        // Returns the input, if there is one.
+        Return,
+        // Writes the inputs back into the frame (the locals, then the operand stack) and hands it to the interpreter,
+        // which carries on at the given instruction. This is how instructions that haven't been quickened yet are
+        // compiled, just like in the baseline compiler.
+        Deoptimize,
+    };
+
+    Kind kind{};
+    Condition condition{};
+    Vector<Value*> inputs;
+    Vector<BasicBlock*> successors;
+    u32 instruction_index{};
+};
+
+struct BasicBlock
+{
+    // Blocks without predecessors are where compiled code can be entered: the start of the method, and, in front of
+    // every loop header, one for on-stack replacement that picks up all the slots of the frame.
+    enum class Entry : u8
+    {
+        None,
+        Method,
+        OSR,
+    };
+
+    u32 id{};
+    Vector<Value*> phis;
+    Vector<Value*> values;
+    Terminator terminator;
+    // Every phi has one input for each predecessor, in this order.
+    Vector<BasicBlock*> predecessors;
+
+    Entry entry{Entry::None};
+    // For OSR entries, where the interpreter leaves off.
+    u32 instruction_index{};
+    u16 stack_depth{};
+
+    size_t index_of_predecessor(const BasicBlock& predecessor) const;
+};
+
+// A call that has been replaced with the body of the method it calls.
+struct InlinedCall
+{
+    const ResolvedMethod* caller{};
+    u32 instruction_index{};
+    const ResolvedMethod* callee{};
+};
+
+class Graph
+{
+public:
+    static ErrorOr<Graph> try_build(const ResolvedMethod&);
+
+    const ResolvedMethod& method() const { return *m_method; }
+
+    u16 max_locals() const { return m_max_locals; }
+    u16 max_stack() const { return m_max_stack; }
+
+    Vector<NonnullOwnPtr<BasicBlock>>& blocks() { return m_blocks; }
+
+    // The first block is always where the method starts.
+    BasicBlock& entry() { return *m_blocks.first(); }
+
+    size_t value_count() const { return m_values.size(); }
+
+    BasicBlock& create_block();
+    Value& create_value(Operation, BasicBlock*, Vector<Value*> inputs = {});
+    Value& append(BasicBlock&, Operation, Vector<Value*> inputs = {});
+    Value& constant(i32);
+
+    // Every block that can be reached from an entry, with each block before its successors unless it is a loop header
+    // reached through a backward edge. The first block is the entry of the method, the OSR entries come last.
+    Vector<BasicBlock*> reverse_postorder();
+
+    void apply_replacements();
+    // Phis that only ever get one value (apart from themselves) are replaced by that value.
+    void remove_trivial_phis();
+    // Cuts the edge from the predecessor at the given index, along with the inputs of the phis for it.
+    void remove_predecessor(BasicBlock&, size_t index);
+    // Removes every block that isn't in the given set, along with the edges coming out of them.
+    void remove_blocks_except(const Vector<BasicBlock*>&);
+
+    // Replaces the call with the graph of the method it calls: the block is split at the call, the arguments are used
+    // wherever the callee reads them from its frame, and every return jumps to the rest of the block. The callee must
+    // not deoptimize, since there is no frame of its own to hand to the interpreter.
+    void inline_call(Value& call, Graph callee);
+    const Vector<InlinedCall>& inlined_calls() const { return m_inlined_calls; }
+
+private:
+    Graph() = default;
+
+    ErrorOr<void> build();
+
+    const ResolvedMethod* m_method{};
+    u16 m_max_locals{};
+    u16 m_max_stack{};
+    Vector<NonnullOwnPtr<BasicBlock>> m_blocks;
+    // Like the ids of values, the ids of blocks are never reused.
+    u32 m_next_block_id{};
+    Vector<NonnullOwnPtr<Value>> m_values;
+    HashMap<i32, Value*> m_constants;
+    Vector<InlinedCall> m_inlined_calls;
+};
+
+// Follows replacements until it gets to a value that is still in use.
+inline Value* resolve(Value* value)
+{
+    while (value->replacement)
+        value = value->replacement;
+    return value;
+}
+}
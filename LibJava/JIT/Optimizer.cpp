@@ -0,0 +1,741 @@
+#include <AK/HashTable.h>
+#include <AK/QuickSort.h>
+#include <LibJava/JIT/Optimizer.h>
+
+namespace Java::JIT::Optimizer
+{
+using IR::BasicBlock;
+using IR::Condition;
+using IR::Operation;
+using IR::Terminator;
+using IR::Value;
+
+namespace
+{
+// Mirrors what the interpreter does for each operation, including wrapping around on overflow (2.11.3).
+Optional<i32> fold(Operation operation, const Vector<i32>& inputs)
+{
+    auto a = static_cast<u32>(inputs[0]);
+    auto b = inputs.size() > 1 ? static_cast<u32>(inputs[1]) : 0;
+
+    switch (operation)
+    {
+        case Operation::Add:
+            return static_cast<i32>(a + b);
+        case Operation::Subtract:
+            return static_cast<i32>(a - b);
+        case Operation::Multiply:
+            return static_cast<i32>(a * b);
+        case Operation::Divide:
+            // Dividing by zero deoptimizes instead, see Graph::build().
+            if (b == 0)
+                return {};
+            if (static_cast<i32>(b) == -1)
+                return static_cast<i32>(0 - a);
+            return static_cast<i32>(a) / static_cast<i32>(b);
+        case Operation::And:
+            return static_cast<i32>(a & b);
+        case Operation::Or:
+            return static_cast<i32>(a | b);
+        case Operation::Xor:
+            return static_cast<i32>(a ^ b);
+        case Operation::Negate:
+            return static_cast<i32>(0 - a);
+        case Operation::IntToByte:
+            return static_cast<i8>(a);
+        case Operation::IntToChar:
+            return static_cast<u16>(a);
+        case Operation::IntToShort:
+            return static_cast<i16>(a);
+        default:
+            return {};
+    }
+}
+
+bool holds(Condition condition, i32 a, i32 b)
+{
+    switch (condition)
+    {
+        case Condition::Equal:
+            return a == b;
+        case Condition::NotEqual:
+            return a != b;
+        case Condition::LessThan:
+            return a < b;
+        case Condition::GreaterThanOrEqualTo:
+            return a >= b;
+        case Condition::GreaterThan:
+            return a > b;
+        case Condition::LessThanOrEqualTo:
+            return a <= b;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+// Whether the value can be computed before the loop it is in instead, without changing what the method does even if
+// the loop would never have gotten to it. Dividing might trap, so it stays where it is.
+bool can_be_hoisted(const Value& value)
+{
+    switch (value.operation)
+    {
+        case Operation::Add:
+        case Operation::Subtract:
+        case Operation::Multiply:
+        case Operation::And:
+        case Operation::Or:
+        case Operation::Xor:
+        case Operation::Negate:
+        case Operation::IntToByte:
+        case Operation::IntToChar:
+        case Operation::IntToShort:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The same limits as HotSpot's MaxInlineSize and (before JDK 14) MaxInlineLevel, in bytes of Code of the callee and
+// in inlined calls nested in each other. On top of that, the code inlined into a method in total
+// is capped, so that a method that calls lots of small methods doesn't blow up.
+constexpr size_t max_inlined_code_size = 35;
+constexpr u8 max_inlining_depth = 9;
+constexpr size_t inlining_budget = 1000;
+
+// The graph of the method the call goes to, if it can take the place of the call.
+Optional<IR::Graph> graph_to_inline(IR::Graph& graph, const Value& call, size_t budget)
+{
+    auto& callee = *call.method;
+    if (callee.native_method)
+        return {};
+
+    auto code_size = callee.code->code.size();
+    if (code_size > max_inlined_code_size || code_size > budget || call.inlining_depth >= max_inlining_depth)
+        return {};
+    // Inlining a recursive call would only ever inline the method into itself again, until the limits kick in.
+    if (&callee == &graph.method() || &callee == call.caller)
+        return {};
+
+    auto callee_graph = IR::Graph::try_build(callee);
+    if (callee_graph.is_error())
+        return {};
+
+    for (auto& block : callee_graph.value().blocks())
+    {
+        if (block->terminator.kind == Terminator::Kind::Deoptimize)
+            return {};
+
+        // The arguments of calls go into the operand stack of the frame of the method being compiled, see
+        // OptimizingCompiler::emit_value(), which is only guaranteed to be large enough for its own calls.
+        for (auto* value : block->values)
+        {
+            if (value->operation == Operation::Call && value->inputs.size() > graph.max_stack())
+                return {};
+        }
+    }
+
+    return callee_graph.release_value();
+}
+
+u64 edge_key(const BasicBlock& from, const BasicBlock& to)
+{
+    return static_cast<u64>(from.id) << 32 | to.id;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm". Blocks are numbered in reverse postorder, and
+// every entry is dominated by a virtual root (-1) above all of them, since there is one for each OSR entry.
+class DominatorTree
+{
+public:
+    explicit DominatorTree(IR::Graph& graph) : m_order(graph.reverse_postorder())
+    {
+        for (size_t i = 0; i < m_order.size(); i++)
+            m_index.set(m_order[i], i);
+
+        m_immediate_dominators.resize(m_order.size());
+        for (size_t i = 0; i < m_order.size(); i++)
+            m_immediate_dominators[i] = m_order[i]->entry == BasicBlock::Entry::None ? undefined : root;
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (size_t i = 0; i < m_order.size(); i++)
+            {
+                if (m_order[i]->entry != BasicBlock::Entry::None)
+                    continue;
+
+                auto new_immediate_dominator = undefined;
+                for (auto* predecessor : m_order[i]->predecessors)
+                {
+                    auto index = m_index.get(predecessor).value();
+                    if (m_immediate_dominators[index] == undefined)
+                        continue;
+
+                    new_immediate_dominator = new_immediate_dominator == undefined
+                                                  ? index
+                                                  : intersect(index, new_immediate_dominator);
+                }
+
+                if (m_immediate_dominators[i] != new_immediate_dominator)
+                {
+                    m_immediate_dominators[i] = new_immediate_dominator;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    const Vector<BasicBlock*>& order() const { return m_order; }
+
+    bool dominates(const BasicBlock& a, const BasicBlock& b) const
+    {
+        auto index_of_a = m_index.get(const_cast<BasicBlock*>(&a)).value();
+        auto index = static_cast<ssize_t>(m_index.get(const_cast<BasicBlock*>(&b)).value());
+        while (index > static_cast<ssize_t>(index_of_a))
+            index = m_immediate_dominators[index];
+        return index == static_cast<ssize_t>(index_of_a);
+    }
+
+private:
+    static constexpr ssize_t root = -1;
+    static constexpr ssize_t undefined = -2;
+
+    ssize_t intersect(ssize_t a, ssize_t b) const
+    {
+        while (a != b)
+        {
+            while (a > b)
+                a = m_immediate_dominators[a];
+            while (b > a)
+                b = m_immediate_dominators[b];
+        }
+        return a;
+    }
+
+    Vector<BasicBlock*> m_order;
+    HashMap<BasicBlock*, size_t> m_index;
+    Vector<ssize_t> m_immediate_dominators;
+};
+
+struct Loop
+{
+    BasicBlock* header{};
+    HashTable<BasicBlock*> body;
+};
+
+// Natural loops: a branch to a block that dominates it closes a loop, which is made up of every block that can get to
+// that branch without going through the header. Loops that share a header are merged.
+Vector<Loop> find_loops(const DominatorTree& dominators)
+{
+    Vector<Loop> loops;
+    for (auto* header : dominators.order())
+    {
+        Loop loop;
+        loop.header = header;
+        loop.body.set(header);
+
+        Vector<BasicBlock*> worklist;
+        for (auto* predecessor : header->predecessors)
+        {
+            if (!dominators.dominates(*header, *predecessor))
+                continue;
+            if (loop.body.set(predecessor) == HashSetResult::InsertedNewEntry)
+                worklist.append(predecessor);
+        }
+
+        if (worklist.is_empty())
+            continue;
+
+        while (!worklist.is_empty())
+        {
+            auto* block = worklist.take_last();
+            for (auto* predecessor : block->predecessors)
+            {
+                if (loop.body.set(predecessor) == HashSetResult::InsertedNewEntry)
+                    worklist.append(predecessor);
+            }
+        }
+
+        loops.append(move(loop));
+    }
+
+    return loops;
+}
+
+// Everything that comes into the header from outside the loop is moved over to a new block in front of it, with phis
+// of its own if it is entered from more than one place.
+void insert_preheader(IR::Graph& graph, Loop& loop)
+{
+    auto& header = *loop.header;
+
+    Vector<size_t> outside;
+    Vector<size_t> inside;
+    for (size_t i = 0; i < header.predecessors.size(); i++)
+    {
+        if (loop.body.contains(header.predecessors[i]))
+            inside.append(i);
+        else
+            outside.append(i);
+    }
+
+    if (outside.size() == 1)
+    {
+        auto& predecessor = *header.predecessors[outside.first()];
+        if (predecessor.entry == BasicBlock::Entry::None && predecessor.terminator.successors.size() == 1)
+            return;
+    }
+
+    auto& preheader = graph.create_block();
+    preheader.terminator.kind = Terminator::Kind::Jump;
+    preheader.terminator.successors.append(&header);
+
+    for (auto index : outside)
+    {
+        auto* predecessor = header.predecessors[index];
+        preheader.predecessors.append(predecessor);
+    }
+
+    // A block that branches to the header both ways comes in twice, but only has its successor replaced once.
+    HashTable<BasicBlock*> redirected;
+    for (auto* predecessor : preheader.predecessors)
+    {
+        if (redirected.set(predecessor) != HashSetResult::InsertedNewEntry)
+            continue;
+
+        for (auto& successor : predecessor->terminator.successors)
+        {
+            if (successor == &header)
+                successor = &preheader;
+        }
+    }
+
+    for (auto* phi : header.phis)
+    {
+        Value* from_outside;
+        if (outside.size() == 1)
+        {
+            from_outside = phi->inputs[outside.first()];
+        }
+        else
+        {
+            auto& preheader_phi = graph.create_value(Operation::Phi, &preheader);
+            for (auto index : outside)
+                preheader_phi.inputs.append(phi->inputs[index]);
+            preheader.phis.append(&preheader_phi);
+            from_outside = &preheader_phi;
+        }
+
+        Vector<Value*> inputs;
+        inputs.append(from_outside);
+        for (auto index : inside)
+            inputs.append(phi->inputs[index]);
+        phi->inputs = move(inputs);
+    }
+
+    Vector<BasicBlock*> predecessors;
+    predecessors.append(&preheader);
+    for (auto index : inside)
+        predecessors.append(header.predecessors[index]);
+    header.predecessors = move(predecessors);
+}
+}
+
+void inline_calls(IR::Graph& graph)
+{
+    // Calls that come with the inlined code are looked at as well, so this goes on until there are none left that can
+    // be inlined.
+    auto budget = inlining_budget;
+    HashTable<Value*> rejected;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto* block : graph.reverse_postorder())
+        {
+            for (auto* value : block->values)
+            {
+                if (value->operation != Operation::Call || rejected.contains(value))
+                    continue;
+
+                auto callee_graph = graph_to_inline(graph, *value, budget);
+                if (!callee_graph.has_value())
+                {
+                    rejected.set(value);
+                    continue;
+                }
+
+                budget -= value->method->code->code.size();
+                graph.inline_call(*value, callee_graph.release_value());
+                changed = true;
+                break;
+            }
+
+            // Inlining changes the blocks, so the search starts over.
+            if (changed)
+                break;
+        }
+    }
+}
+
+void propagate_constants(IR::Graph& graph)
+{
+    struct Lattice
+    {
+        enum class State : u8
+        {
+            // Nothing has been seen for this value yet, which for now means it could still be anything.
+            Unknown,
+            Constant,
+            // Known to not always be the same.
+            Overdefined,
+        };
+
+        State state{State::Unknown};
+        i32 constant{};
+
+        bool operator==(const Lattice& other) const
+        {
+            return state == other.state && (state != State::Constant || constant == other.constant);
+        }
+    };
+    using State = Lattice::State;
+
+    Vector<Lattice> lattice;
+    lattice.resize(graph.value_count());
+
+    // Which values and terminators use each value, so that they can be looked at again when it changes.
+    Vector<Vector<Value*>> value_users;
+    Vector<Vector<BasicBlock*>> terminator_users;
+    value_users.resize(graph.value_count());
+    terminator_users.resize(graph.value_count());
+    for (auto& block : graph.blocks())
+    {
+        for (auto* phi : block->phis)
+        {
+            for (auto* input : phi->inputs)
+                value_users[input->id].append(phi);
+        }
+        for (auto* value : block->values)
+        {
+            for (auto* input : value->inputs)
+                value_users[input->id].append(value);
+        }
+        for (auto* input : block->terminator.inputs)
+            terminator_users[input->id].append(block.ptr());
+    }
+
+    HashTable<BasicBlock*> executable_blocks;
+    HashTable<u64> executable_edges;
+    Vector<BasicBlock*> block_worklist;
+    Vector<Value*> value_worklist;
+    Vector<BasicBlock*> terminator_worklist;
+
+    auto lattice_of = [&](Value& value) -> Lattice {
+        if (value.is_constant())
+            return {State::Constant, value.immediate};
+        return lattice[value.id];
+    };
+
+    auto update = [&](Value& value, Lattice new_lattice) {
+        if (lattice[value.id] == new_lattice)
+            return;
+
+        lattice[value.id] = new_lattice;
+        value_worklist.extend(value_users[value.id]);
+        terminator_worklist.extend(terminator_users[value.id]);
+    };
+
+    auto mark_edge = [&](BasicBlock& from, BasicBlock& to) {
+        if (executable_edges.set(edge_key(from, to)) != HashSetResult::InsertedNewEntry)
+            return;
+
+        if (executable_blocks.set(&to) == HashSetResult::InsertedNewEntry)
+        {
+            block_worklist.append(&to);
+            return;
+        }
+
+        // Another way into the block can change what its phis come out as.
+        value_worklist.extend(to.phis);
+    };
+
+    auto evaluate = [&](Value& value) {
+        if (!executable_blocks.contains(value.block))
+            return;
+
+        if (value.operation == Operation::Phi)
+        {
+            Lattice result;
+            for (size_t i = 0; i < value.inputs.size(); i++)
+            {
+                if (!executable_edges.contains(edge_key(*value.block->predecessors[i], *value.block)))
+                    continue;
+
+                auto input = lattice_of(*value.inputs[i]);
+                if (input.state == State::Unknown)
+                    continue;
+                if (result.state == State::Unknown)
+                    result = input;
+                else if (!(result == input))
+                    result = {State::Overdefined, 0};
+            }
+
+            update(value, result);
+            return;
+        }
+
+        Vector<i32> inputs;
+        for (auto* input : value.inputs)
+        {
+            auto input_lattice = lattice_of(*input);
+            if (input_lattice.state == State::Overdefined)
+            {
+                update(value, {State::Overdefined, 0});
+                return;
+            }
+            if (input_lattice.state == State::Unknown)
+                return;
+            inputs.append(input_lattice.constant);
+        }
+
+        auto folded = value.inputs.is_empty() ? Optional<i32>{} : fold(value.operation, inputs);
+        if (folded.has_value())
+            update(value, {State::Constant, folded.value()});
+        else
+            update(value, {State::Overdefined, 0});
+    };
+
+    auto evaluate_terminator = [&](BasicBlock& block) {
+        if (!executable_blocks.contains(&block))
+            return;
+
+        auto& terminator = block.terminator;
+        if (terminator.kind == Terminator::Kind::Jump)
+        {
+            mark_edge(block, *terminator.successors.first());
+        }
+        else if (terminator.kind == Terminator::Kind::Branch)
+        {
+            auto a = lattice_of(*terminator.inputs[0]);
+            auto b = lattice_of(*terminator.inputs[1]);
+            if (a.state == State::Constant && b.state == State::Constant)
+            {
+                mark_edge(block, *terminator.successors[holds(terminator.condition, a.constant, b.constant) ? 0 : 1]);
+            }
+            else if (a.state == State::Overdefined || b.state == State::Overdefined)
+            {
+                mark_edge(block, *terminator.successors[0]);
+                mark_edge(block, *terminator.successors[1]);
+            }
+        }
+    };
+
+    for (auto& block : graph.blocks())
+    {
+        if (block->entry != BasicBlock::Entry::None)
+        {
+            executable_blocks.set(block.ptr());
+            block_worklist.append(block.ptr());
+        }
+    }
+
+    while (!block_worklist.is_empty() || !value_worklist.is_empty() || !terminator_worklist.is_empty())
+    {
+        while (!block_worklist.is_empty())
+        {
+            auto& block = *block_worklist.take_last();
+            for (auto* phi : block.phis)
+                evaluate(*phi);
+            for (auto* value : block.values)
+                evaluate(*value);
+            evaluate_terminator(block);
+        }
+
+        while (!value_worklist.is_empty())
+            evaluate(*value_worklist.take_last());
+
+        while (!terminator_worklist.is_empty())
+            evaluate_terminator(*terminator_worklist.take_last());
+    }
+
+    // Branches that can only ever go one way become jumps.
+    for (auto& block : graph.blocks())
+    {
+        auto& terminator = block->terminator;
+        if (!executable_blocks.contains(block.ptr()) || terminator.kind != Terminator::Kind::Branch)
+            continue;
+
+        auto taken = executable_edges.contains(edge_key(*block, *terminator.successors[0]));
+        auto not_taken = executable_edges.contains(edge_key(*block, *terminator.successors[1]));
+        if (taken == not_taken)
+            continue;
+
+        auto& dropped = *terminator.successors[taken ? 1 : 0];
+        graph.remove_predecessor(dropped, dropped.index_of_predecessor(*block));
+        terminator.kind = Terminator::Kind::Jump;
+        terminator.inputs.clear();
+        terminator.successors.remove(taken ? 1 : 0);
+    }
+
+    for (auto& block : graph.blocks())
+    {
+        if (!executable_blocks.contains(block.ptr()))
+            continue;
+
+        auto replace_if_constant = [&](Value& value) {
+            auto value_lattice = lattice[value.id];
+            if (value_lattice.state == State::Constant && !value.has_side_effects())
+                value.replacement = &graph.constant(value_lattice.constant);
+        };
+
+        for (auto* phi : block->phis)
+            replace_if_constant(*phi);
+        for (auto* value : block->values)
+            replace_if_constant(*value);
+    }
+
+    Vector<BasicBlock*> executable;
+    for (auto& block : graph.blocks())
+    {
+        if (executable_blocks.contains(block.ptr()))
+            executable.append(block.ptr());
+    }
+    graph.remove_blocks_except(executable);
+    graph.apply_replacements();
+    graph.remove_trivial_phis();
+}
+
+void eliminate_dead_code(IR::Graph& graph)
+{
+    Vector<bool> is_live;
+    is_live.resize(graph.value_count());
+    Vector<Value*> worklist;
+
+    auto mark = [&](Value& value) {
+        if (is_live[value.id])
+            return;
+        is_live[value.id] = true;
+        worklist.append(&value);
+    };
+
+    for (auto& block : graph.blocks())
+    {
+        for (auto* value : block->values)
+        {
+            if (value->has_side_effects())
+                mark(*value);
+        }
+        for (auto* input : block->terminator.inputs)
+            mark(*input);
+    }
+
+    while (!worklist.is_empty())
+    {
+        for (auto* input : worklist.take_last()->inputs)
+            mark(*input);
+    }
+
+    for (auto& block : graph.blocks())
+    {
+        block->phis.remove_all_matching([&](auto* phi) { return !is_live[phi->id]; });
+        block->values.remove_all_matching([&](auto* value) { return !is_live[value->id]; });
+    }
+}
+
+void hoist_loop_invariants(IR::Graph& graph)
+{
+    {
+        DominatorTree dominators(graph);
+        auto loops = find_loops(dominators);
+        for (auto& loop : loops)
+            insert_preheader(graph, loop);
+        graph.remove_trivial_phis();
+    }
+
+    DominatorTree dominators(graph);
+    auto loops = find_loops(dominators);
+
+    // Inner loops go first, so that what they hoist can move on out of the loops around them.
+    quick_sort(loops, [](auto& a, auto& b) { return a.body.size() < b.body.size(); });
+
+    for (auto& loop : loops)
+    {
+        BasicBlock* preheader = nullptr;
+        for (auto* predecessor : loop.header->predecessors)
+        {
+            if (loop.body.contains(predecessor))
+                continue;
+            if (preheader)
+            {
+                preheader = nullptr;
+                break;
+            }
+            preheader = predecessor;
+        }
+
+        if (!preheader || preheader->terminator.successors.size() != 1)
+            continue;
+
+        // Static fields are only read before the loop if nothing in it could write to them.
+        bool writes_memory = false;
+        for (auto* block : loop.body)
+        {
+            for (auto* value : block->values)
+            {
+                if (value->has_side_effects())
+                    writes_memory = true;
+            }
+        }
+
+        auto is_invariant = [&](Value& value) {
+            if (!can_be_hoisted(value) && !(value.operation == Operation::LoadStatic && !writes_memory))
+                return false;
+
+            for (auto* input : value.inputs)
+            {
+                if (!input->is_constant() && loop.body.contains(input->block))
+                    return false;
+            }
+
+            return true;
+        };
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto* block : dominators.order())
+            {
+                if (!loop.body.contains(block))
+                    continue;
+
+                for (size_t i = 0; i < block->values.size();)
+                {
+                    auto& value = *block->values[i];
+                    if (!is_invariant(value))
+                    {
+                        i++;
+                        continue;
+                    }
+
+                    block->values.remove(i);
+                    value.block = preheader;
+                    preheader->values.append(&value);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void optimize(IR::Graph& graph)
+{
+    // Inlining goes first, since what the callees do with their arguments is where the other passes find the most to
+    // do with the values at the call site.
+    inline_calls(graph);
+    propagate_constants(graph);
+    eliminate_dead_code(graph);
+    hoist_loop_invariants(graph);
+}
+}
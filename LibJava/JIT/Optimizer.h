@@ -0,0 +1,25 @@
+#pragma once
+
+#include <LibJava/JIT/IR.h>
+
+namespace Java::JIT::Optimizer
+{
+// Replaces calls to small static methods with their code, which saves the call, and lets the other passes work across
+// what used to be the call. Only calls to methods that can be compiled on their own without ever deoptimizing are
+// inlined. Recursive calls are left alone, and inlined calls only nest so deep, which is what ends mutual recursion.
+void inline_calls(IR::Graph&);
+
+// Sparse conditional constant propagation (Wegman and Zadeck): values that are known to be the same constant on every
+// path that can actually be taken are replaced by it, branches that always go the same way become jumps, and whatever
+// can't be reached anymore is removed.
+void propagate_constants(IR::Graph&);
+
+// Removes every value that nothing with a side effect, no branch and no return depends on.
+void eliminate_dead_code(IR::Graph&);
+
+// Gives every loop a preheader, a block that is only ever left for the loop header and is run once before the loop,
+// and moves everything in the loop that computes the same value on every iteration there.
+void hoist_loop_invariants(IR::Graph&);
+
+void optimize(IR::Graph&);
+}
@@ -0,0 +1,822 @@
+#include <AK/BitCast.h>
+#include <AK/HashTable.h>
+#include <AK/Platform.h>
+#include <AK/QuickSort.h>
+#include <LibJava/JIT/Optimizer.h>
+#include <LibJava/JIT/OptimizingCompiler.h>
+#include <LibJava/VM.h>
+
+namespace Java::JIT
+{
+namespace
+{
+using Reg = Assembler::Reg;
+using Condition = Assembler::Condition;
+using ALU = Assembler::ALU;
+using IR::BasicBlock;
+using IR::Operation;
+using IR::Terminator;
+using IR::Value;
+
+// The same as in baseline code, so that the two look alike to the VM.
+constexpr auto locals_register = Reg::RBX;
+constexpr auto result_register = Reg::R12;
+constexpr auto vm_register = Reg::R13;
+
+// Never handed out, so that any instruction can use them in between: RAX and RDX for division, R11 for everything
+// else that needs a register of its own for a moment.
+constexpr auto scratch_register = Reg::R11;
+
+// Caller-saved registers come first, which leaves the callee-saved ones for the values that are live across calls,
+// since those are the only ones that can be.
+constexpr Reg allocatable_registers[] = {
+    Reg::RCX, Reg::RSI, Reg::RDI, Reg::R8, Reg::R9, Reg::R10, Reg::RBP, Reg::R14, Reg::R15,
+};
+constexpr Reg callee_saved_registers[] = {Reg::RBP, Reg::R14, Reg::R15};
+
+Condition condition(IR::Condition condition)
+{
+    switch (condition)
+    {
+        case IR::Condition::Equal:
+            return Condition::Equal;
+        case IR::Condition::NotEqual:
+            return Condition::NotEqual;
+        case IR::Condition::LessThan:
+            return Condition::LessThan;
+        case IR::Condition::GreaterThanOrEqualTo:
+            return Condition::GreaterThanOrEqualTo;
+        case IR::Condition::GreaterThan:
+            return Condition::GreaterThan;
+        case IR::Condition::LessThanOrEqualTo:
+            return Condition::LessThanOrEqualTo;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+// The condition that holds for (b, a) whenever the given one holds for (a, b).
+Condition swap_operands(Condition condition)
+{
+    switch (condition)
+    {
+        case Condition::LessThan:
+            return Condition::GreaterThan;
+        case Condition::GreaterThan:
+            return Condition::LessThan;
+        case Condition::LessThanOrEqualTo:
+            return Condition::GreaterThanOrEqualTo;
+        case Condition::GreaterThanOrEqualTo:
+            return Condition::LessThanOrEqualTo;
+        default:
+            return condition;
+    }
+}
+
+Optional<ALU> alu_operation(Operation operation)
+{
+    switch (operation)
+    {
+        case Operation::Add:
+            return ALU::Add;
+        case Operation::Subtract:
+            return ALU::Sub;
+        case Operation::And:
+            return ALU::And;
+        case Operation::Or:
+            return ALU::Or;
+        case Operation::Xor:
+            return ALU::Xor;
+        default:
+            return {};
+    }
+}
+
+// Liveness is tracked with one flag per value, which is plenty for the size of methods we compile.
+using LiveSet = Vector<bool>;
+}
+
+OptimizingCompiler::OptimizingCompiler(IR::Graph& graph)
+    : m_graph(graph), m_max_locals(graph.max_locals()), m_order(graph.reverse_postorder())
+{
+    for (size_t i = 0; i < m_order.size(); i++)
+        m_order_index.set(m_order[i], i);
+
+    m_block_starts.resize(m_order.size());
+    m_block_ends.resize(m_order.size());
+    m_positions.resize(m_graph.value_count());
+    m_live_ranges.resize(m_graph.value_count());
+    m_locations.resize(m_graph.value_count());
+    m_block_labels.resize(m_order.size());
+
+    u32 position = 0;
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        m_block_starts[i] = position++;
+        for (auto* phi : m_order[i]->phis)
+            m_positions[phi->id] = m_block_starts[i];
+        for (auto* value : m_order[i]->values)
+        {
+            m_positions[value->id] = position++;
+            if (value->operation == Operation::Call)
+                m_call_positions.append(m_positions[value->id]);
+        }
+        m_block_ends[i] = position++;
+    }
+}
+
+ErrorOr<NonnullOwnPtr<CompiledCode>>
+OptimizingCompiler::compile(const ResolvedMethod& method, const Function<void(const IR::InlinedCall&)>& on_inline)
+{
+#if ARCH(X86_64)
+    auto graph = TRY(IR::Graph::try_build(method));
+    Optimizer::optimize(graph);
+
+    OptimizingCompiler compiler(graph);
+    compiler.compute_live_ranges();
+    compiler.allocate_registers();
+
+    auto osr_entries = compiler.emit_blocks();
+
+    compiler.m_assembler.bind(compiler.m_returned);
+    compiler.emit_epilogue(CompiledCode::Exit::Returned);
+    compiler.m_assembler.bind(compiler.m_failed);
+    compiler.emit_epilogue(CompiledCode::Exit::Failed);
+    compiler.m_assembler.bind(compiler.m_deoptimized);
+    compiler.emit_epilogue(CompiledCode::Exit::Deoptimized);
+
+    auto compiled_code = TRY(CompiledCode::try_create(compiler.m_assembler.code(), move(osr_entries)));
+    if (on_inline)
+    {
+        for (auto& inlined_call : graph.inlined_calls())
+            on_inline(inlined_call);
+    }
+    return compiled_code;
+#else
+    (void)method;
+    (void)on_inline;
+    return Error::from_string_literal("The JIT only supports x86-64");
+#endif
+}
+
+// A value is live from where it is computed to the last place it is used, on every path in between. Live sets are
+// worked out per block by going backwards until nothing changes anymore (with the input of a phi being live at the
+// end of the predecessor it comes from, not in the block of the phi), and then every value gets the smallest range of
+// positions that covers everywhere it is live. That may cover blocks it isn't actually live in, but never too little.
+void OptimizingCompiler::compute_live_ranges()
+{
+    Vector<LiveSet> live_in;
+    live_in.resize(m_order.size());
+    for (auto& set : live_in)
+        set.resize(m_graph.value_count());
+
+    auto add = [](LiveSet& set, Value* value) {
+        if (!value->is_constant())
+            set[value->id] = true;
+    };
+
+    auto live_out = [&](BasicBlock& block) {
+        LiveSet set;
+        set.resize(m_graph.value_count());
+        for (auto* successor : block.terminator.successors)
+        {
+            auto& successor_live_in = live_in[m_order_index.get(successor).value()];
+            for (size_t id = 0; id < set.size(); id++)
+            {
+                if (successor_live_in[id])
+                    set[id] = true;
+            }
+
+            auto index = successor->index_of_predecessor(block);
+            for (auto* phi : successor->phis)
+                add(set, phi->inputs[index]);
+        }
+        return set;
+    };
+
+    // Calls back for every value that is live at a position in the block, going backwards.
+    auto walk_block = [&](size_t index, auto callback) {
+        auto& block = *m_order[index];
+        auto live = live_out(block);
+        for (size_t id = 0; id < live.size(); id++)
+        {
+            if (live[id])
+                callback(id, m_block_ends[index]);
+        }
+
+        for (auto* input : block.terminator.inputs)
+        {
+            if (input->is_constant())
+                continue;
+            add(live, input);
+            callback(input->id, m_block_ends[index]);
+        }
+
+        for (size_t i = block.values.size(); i > 0; i--)
+        {
+            auto& value = *block.values[i - 1];
+            auto position = m_positions[value.id];
+            callback(value.id, position);
+            live[value.id] = false;
+            for (auto* input : value.inputs)
+            {
+                if (input->is_constant())
+                    continue;
+                add(live, input);
+                callback(input->id, position);
+            }
+        }
+
+        for (auto* phi : block.phis)
+        {
+            callback(phi->id, m_block_starts[index]);
+            live[phi->id] = false;
+        }
+
+        for (size_t id = 0; id < live.size(); id++)
+        {
+            if (live[id])
+                callback(id, m_block_starts[index]);
+        }
+
+        return live;
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = m_order.size(); i > 0; i--)
+        {
+            auto live = walk_block(i - 1, [](auto, auto) {});
+            if (live != live_in[i - 1])
+            {
+                live_in[i - 1] = move(live);
+                changed = true;
+            }
+        }
+    }
+
+    Vector<Value*> values_by_id;
+    values_by_id.resize(m_graph.value_count());
+    for (auto* block : m_order)
+    {
+        for (auto* phi : block->phis)
+            values_by_id[phi->id] = phi;
+        for (auto* value : block->values)
+            values_by_id[value->id] = value;
+    }
+
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        walk_block(i, [&](size_t id, u32 position) {
+            auto& live_range = m_live_ranges[id];
+            if (!live_range.has_value())
+            {
+                live_range = LiveRange{values_by_id[id], position, position};
+                return;
+            }
+            live_range->from = min(live_range->from, position);
+            live_range->to = max(live_range->to, position);
+        });
+    }
+}
+
+void OptimizingCompiler::allocate_registers()
+{
+    Vector<LiveRange> live_ranges;
+    for (auto& live_range : m_live_ranges)
+    {
+        // Stores and calls to methods that return void are the only values that don't produce anything.
+        if (live_range.has_value() && live_range->value->operation != Operation::StoreStatic &&
+            live_range->value->produces_value)
+            live_ranges.append(live_range.value());
+    }
+    quick_sort(live_ranges, [](auto& a, auto& b) { return a.from < b.from; });
+
+    auto is_live_across_call = [&](const LiveRange& live_range) {
+        for (auto position : m_call_positions)
+        {
+            if (live_range.from < position && position < live_range.to)
+                return true;
+        }
+        return false;
+    };
+
+    auto spill = [&](Value& value) {
+        m_locations[value.id] = {Location::Kind::Spill, {}, m_spill_slot_count++};
+    };
+
+    Vector<LiveRange> active;
+    HashTable<u8> registers_in_use;
+    for (auto& live_range : live_ranges)
+    {
+        active.remove_all_matching([&](auto& other) {
+            if (other.to >= live_range.from)
+                return false;
+            registers_in_use.remove(to_underlying(m_locations[other.value->id].reg));
+            return true;
+        });
+
+        auto live_across_call = is_live_across_call(live_range);
+        Span<const Reg> candidates = live_across_call ? Span<const Reg>(callee_saved_registers)
+                                                      : Span<const Reg>(allocatable_registers);
+
+        Optional<Reg> free_register;
+        for (auto reg : candidates)
+        {
+            if (!registers_in_use.contains(to_underlying(reg)))
+            {
+                free_register = reg;
+                break;
+            }
+        }
+
+        if (free_register.has_value())
+        {
+            m_locations[live_range.value->id] = {Location::Kind::Register, free_register.value(), 0};
+            registers_in_use.set(to_underlying(free_register.value()));
+            active.append(live_range);
+            continue;
+        }
+
+        // Whichever of the values that could give up their register stays live the longest is spilled, which might
+        // just as well be this one.
+        Optional<size_t> victim;
+        for (size_t i = 0; i < active.size(); i++)
+        {
+            auto reg = m_locations[active[i].value->id].reg;
+            if (!candidates.contains_slow(reg))
+                continue;
+            if (!victim.has_value() || active[i].to > active[victim.value()].to)
+                victim = i;
+        }
+
+        if (!victim.has_value() || active[victim.value()].to <= live_range.to)
+        {
+            spill(*live_range.value);
+            continue;
+        }
+
+        auto reg = m_locations[active[victim.value()].value->id].reg;
+        spill(*active[victim.value()].value);
+        active.remove(victim.value());
+        m_locations[live_range.value->id] = {Location::Kind::Register, reg, 0};
+        active.append(live_range);
+    }
+}
+
+// Exit entry(Slot* locals, Slot* result, VM*)
+void OptimizingCompiler::emit_prologue()
+{
+    m_assembler.push(locals_register);
+    m_assembler.push(result_register);
+    m_assembler.push(vm_register);
+    m_assembler.push(Reg::RBP);
+    m_assembler.push(Reg::R14);
+    m_assembler.push(Reg::R15);
+    // Six registers on top of the return address leave the stack 8 bytes off from 16-byte alignment, so there is
+    // always an odd number of spill slots.
+    m_assembler.add64_immediate(Reg::RSP, -static_cast<i32>((m_spill_slot_count | 1) * sizeof(u64)));
+    m_assembler.move64(locals_register, Reg::RDI);
+    m_assembler.move64(result_register, Reg::RSI);
+    m_assembler.move64(vm_register, Reg::RDX);
+}
+
+void OptimizingCompiler::emit_epilogue(CompiledCode::Exit exit)
+{
+    m_assembler.add64_immediate(Reg::RSP, (m_spill_slot_count | 1) * sizeof(u64));
+    m_assembler.move64_immediate(Reg::RAX, to_underlying(exit));
+    m_assembler.pop(Reg::R15);
+    m_assembler.pop(Reg::R14);
+    m_assembler.pop(Reg::RBP);
+    m_assembler.pop(vm_register);
+    m_assembler.pop(result_register);
+    m_assembler.pop(locals_register);
+    m_assembler.ret();
+}
+
+// Every entry, the start of the method and each OSR entry, gets the prologue right in front of it. Since nothing can
+// jump to an entry, nothing ever falls through into one either.
+Vector<CompiledCode::OSREntry> OptimizingCompiler::emit_blocks()
+{
+    Vector<CompiledCode::OSREntry> osr_entries;
+    for (size_t i = 0; i < m_order.size(); i++)
+    {
+        auto& block = *m_order[i];
+        if (block.entry == BasicBlock::Entry::OSR)
+            osr_entries.append({block.instruction_index, block.stack_depth, m_assembler.offset()});
+        if (block.entry != BasicBlock::Entry::None)
+            emit_prologue();
+
+        m_assembler.bind(m_block_labels[i]);
+        for (auto* value : block.values)
+            emit_value(*value);
+        emit_terminator(i);
+    }
+
+    return osr_entries;
+}
+
+OptimizingCompiler::Operand OptimizingCompiler::operand(Value& value) const
+{
+    if (value.is_constant())
+        return {value.immediate, {}};
+    return {{}, m_locations[value.id]};
+}
+
+// Ints only ever take up the low 32 bits of a register. Writing them clears the high ones, so storing the whole
+// register into a slot afterwards leaves it exactly like Slot::from_int would.
+void OptimizingCompiler::load(Reg destination, const Operand& operand)
+{
+    if (operand.immediate.has_value())
+        m_assembler.move32_immediate(destination, operand.immediate.value());
+    else if (operand.location.kind == Location::Kind::Register && operand.location.reg != destination)
+        m_assembler.move32(destination, operand.location.reg);
+    else if (operand.location.kind == Location::Kind::Spill)
+        m_assembler.load32(destination, Reg::RSP, spill_slot(operand.location.spill_slot));
+}
+
+void OptimizingCompiler::store(const Location& location, Reg source)
+{
+    if (location.kind == Location::Kind::Register && location.reg != source)
+        m_assembler.move32(location.reg, source);
+    else if (location.kind == Location::Kind::Spill)
+        m_assembler.store32(Reg::RSP, spill_slot(location.spill_slot), source);
+}
+
+Reg OptimizingCompiler::target_register(Value& value, Optional<Reg> avoid) const
+{
+    auto& location = m_locations[value.id];
+    if (location.kind == Location::Kind::Register && (!avoid.has_value() || location.reg != avoid.value()))
+        return location.reg;
+    return Reg::RAX;
+}
+
+void OptimizingCompiler::emit_value(Value& value)
+{
+    auto& a = m_assembler;
+    auto& location = m_locations[value.id];
+
+    switch (value.operation)
+    {
+        case Operation::FrameSlot:
+        {
+            auto target = target_register(value);
+            a.load32(target, locals_register, frame_slot(value.immediate));
+            store(location, target);
+            break;
+        }
+
+        case Operation::Add:
+        case Operation::Subtract:
+        case Operation::Multiply:
+        case Operation::And:
+        case Operation::Or:
+        case Operation::Xor:
+        {
+            auto rhs = operand(*value.inputs[1]);
+            // The left-hand side is loaded into the target first, which mustn't overwrite the right-hand side.
+            auto target = target_register(value, rhs.location.kind == Location::Kind::Register
+                                                     ? Optional<Reg>(rhs.location.reg)
+                                                     : Optional<Reg>{});
+            load(target, *value.inputs[0]);
+
+            auto alu = alu_operation(value.operation);
+            if (rhs.immediate.has_value())
+            {
+                if (alu.has_value())
+                    a.alu32_immediate(alu.value(), target, rhs.immediate.value());
+                else
+                    a.multiply32_immediate(target, target, rhs.immediate.value());
+            }
+            else if (rhs.location.kind == Location::Kind::Register)
+            {
+                if (alu.has_value())
+                    a.alu32(alu.value(), target, rhs.location.reg);
+                else
+                    a.multiply32(target, rhs.location.reg);
+            }
+            else
+            {
+                auto displacement = spill_slot(rhs.location.spill_slot);
+                if (alu.has_value())
+                    a.alu32(alu.value(), target, Reg::RSP, displacement);
+                else
+                    a.multiply32(target, Reg::RSP, displacement);
+            }
+
+            store(location, target);
+            break;
+        }
+        case Operation::Divide:
+        {
+            // Dividing by -1 is negating, see the same in the baseline compiler. If the divisor is a constant, it is
+            // clear up front which of the two it is. A divisor of 0 has already deoptimized, see Graph::build().
+            auto divisor = operand(*value.inputs[1]);
+            load(Reg::RAX, *value.inputs[0]);
+            if (divisor.immediate.has_value() && divisor.immediate.value() == -1)
+            {
+                a.negate32(Reg::RAX);
+            }
+            else if (divisor.immediate.has_value())
+            {
+                load(scratch_register, divisor);
+                a.sign_extend_and_divide32(scratch_register);
+            }
+            else
+            {
+                Assembler::Label divide;
+                Assembler::Label done;
+                load(scratch_register, divisor);
+                a.compare32_immediate(scratch_register, -1);
+                a.jump_if(Condition::NotEqual, divide);
+                a.negate32(Reg::RAX);
+                a.jump(done);
+                a.bind(divide);
+                a.sign_extend_and_divide32(scratch_register);
+                a.bind(done);
+            }
+            store(location, Reg::RAX);
+            break;
+        }
+        case Operation::Negate:
+        {
+            auto target = target_register(value);
+            load(target, *value.inputs[0]);
+            a.negate32(target);
+            store(location, target);
+            break;
+        }
+        case Operation::IntToByte:
+        case Operation::IntToChar:
+        case Operation::IntToShort:
+            // MOVSX and MOVZX can only get at the low byte of the legacy registers, so this goes through EAX.
+            load(Reg::RAX, *value.inputs[0]);
+            if (value.operation == Operation::IntToByte)
+                a.sign_extend8_to_32(Reg::RAX, Reg::RAX);
+            else if (value.operation == Operation::IntToChar)
+                a.zero_extend16_to_32(Reg::RAX, Reg::RAX);
+            else
+                a.sign_extend16_to_32(Reg::RAX, Reg::RAX);
+            store(location, Reg::RAX);
+            break;
+
+        case Operation::LoadStatic:
+        {
+            auto target = target_register(value);
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(value.static_field));
+            a.load32(target, Reg::RAX, 0);
+            store(location, target);
+            break;
+        }
+        case Operation::StoreStatic:
+            load(scratch_register, *value.inputs[0]);
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(value.static_field));
+            a.store64(Reg::RAX, 0, scratch_register);
+            break;
+
+        case Operation::Call:
+        {
+            // The arguments go where the operand stack of the frame starts, since it is otherwise unused, and that is
+            // where the callee's frame starts. Only callee-saved registers and spill slots are live across the call.
+            auto arguments = frame_slot(m_max_locals);
+            for (size_t i = 0; i < value.inputs.size(); i++)
+            {
+                load(Reg::RAX, *value.inputs[i]);
+                a.store64(locals_register, frame_slot(m_max_locals + i), Reg::RAX);
+            }
+
+            a.move64(Reg::RDI, vm_register);
+            a.move64_immediate(Reg::RSI, bit_cast<FlatPtr>(value.method));
+            a.lea(Reg::RDX, locals_register, arguments);
+            a.move64_immediate(Reg::RAX, bit_cast<FlatPtr>(&VM::invoke_from_compiled_code));
+            a.call(Reg::RAX);
+            a.test8(Reg::RAX, Reg::RAX);
+            a.jump_if(Condition::Equal, m_failed);
+
+            if (value.produces_value && location.kind != Location::Kind::None)
+            {
+                auto target = target_register(value);
+                a.load32(target, locals_register, arguments);
+                store(location, target);
+            }
+            break;
+        }
+
+        case Operation::Constant:
+        case Operation::Phi:
+            VERIFY_NOT_REACHED();
+    }
+}
+
+void OptimizingCompiler::emit_terminator(size_t index)
+{
+    auto& a = m_assembler;
+    auto& block = *m_order[index];
+    auto& terminator = block.terminator;
+
+    // Entries can't be fallen into, they start with a prologue.
+    auto is_next = [&](BasicBlock& successor) {
+        return index + 1 < m_order.size() && m_order[index + 1] == &successor &&
+               successor.entry == BasicBlock::Entry::None;
+    };
+
+    auto label = [&](BasicBlock& successor) -> Assembler::Label& {
+        return m_block_labels[m_order_index.get(&successor).value()];
+    };
+
+    auto has_moves = [&](BasicBlock& successor) { return !successor.phis.is_empty(); };
+
+    switch (terminator.kind)
+    {
+        case Terminator::Kind::Jump:
+        {
+            auto& successor = *terminator.successors.first();
+            emit_edge(block, successor);
+            if (!is_next(successor))
+                a.jump(label(successor));
+            break;
+        }
+
+        case Terminator::Kind::Branch:
+        {
+            auto* lhs = terminator.inputs[0];
+            auto* rhs = terminator.inputs[1];
+            auto branch_condition = condition(terminator.condition);
+            if (lhs->is_constant() && !rhs->is_constant())
+            {
+                swap(lhs, rhs);
+                branch_condition = swap_operands(branch_condition);
+            }
+
+            auto left = operand(*lhs);
+            auto right = operand(*rhs);
+            if (left.location.kind == Location::Kind::Spill && right.immediate.has_value())
+            {
+                a.compare32_immediate(Reg::RSP, spill_slot(left.location.spill_slot), right.immediate.value());
+            }
+            else
+            {
+                auto reg = Reg::RAX;
+                if (left.location.kind == Location::Kind::Register)
+                    reg = left.location.reg;
+                else
+                    load(reg, left);
+
+                if (right.immediate.has_value())
+                    a.compare32_immediate(reg, right.immediate.value());
+                else if (right.location.kind == Location::Kind::Register)
+                    a.alu32(ALU::Compare, reg, right.location.reg);
+                else
+                    a.alu32(ALU::Compare, reg, Reg::RSP, spill_slot(right.location.spill_slot));
+            }
+
+            // An edge that has moves to make can't be branched along directly, it first goes through a stub that makes
+            // them. The edge that isn't branched along is laid out right after the branch, so that gets them inline.
+            auto& taken = *terminator.successors[0];
+            auto& not_taken = *terminator.successors[1];
+            if (!has_moves(taken))
+            {
+                a.jump_if(branch_condition, label(taken));
+                emit_edge(block, not_taken);
+                if (!is_next(not_taken))
+                    a.jump(label(not_taken));
+            }
+            else if (!has_moves(not_taken))
+            {
+                a.jump_if(Assembler::invert(branch_condition), label(not_taken));
+                emit_edge(block, taken);
+                if (!is_next(taken))
+                    a.jump(label(taken));
+            }
+            else
+            {
+                Assembler::Label stub;
+                a.jump_if(Assembler::invert(branch_condition), stub);
+                emit_edge(block, taken);
+                a.jump(label(taken));
+                a.bind(stub);
+                emit_edge(block, not_taken);
+                if (!is_next(not_taken))
+                    a.jump(label(not_taken));
+            }
+            break;
+        }
+
+        case Terminator::Kind::Return:
+            if (!terminator.inputs.is_empty())
+            {
+                load(Reg::RAX, *terminator.inputs.first());
+                a.store64(result_register, 0, Reg::RAX);
+            }
+            a.jump(m_returned);
+            break;
+
+        case Terminator::Kind::Deoptimize:
+        {
+            // The interpreter gets the frame back exactly as it would have been if it had run the method all along.
+            for (size_t i = 0; i < terminator.inputs.size(); i++)
+            {
+                load(Reg::RAX, *terminator.inputs[i]);
+                a.store64(locals_register, frame_slot(i), Reg::RAX);
+            }
+
+            CompiledCode::Deoptimization deoptimization{terminator.instruction_index,
+                                                        static_cast<u16>(terminator.inputs.size() - m_max_locals)};
+            a.move64_immediate(Reg::RAX, deoptimization.encode());
+            a.store64(result_register, 0, Reg::RAX);
+            a.jump(m_deoptimized);
+            break;
+        }
+    }
+}
+
+void OptimizingCompiler::emit_edge(BasicBlock& from, BasicBlock& to)
+{
+    auto index = to.index_of_predecessor(from);
+
+    Vector<Move> moves;
+    for (auto* phi : to.phis)
+    {
+        auto& destination = m_locations[phi->id];
+        // A phi that is never used isn't live, and doesn't have anywhere to go.
+        if (destination.kind != Location::Kind::None)
+            moves.append({operand(*phi->inputs[index]), destination});
+    }
+
+    emit_parallel_move(move(moves));
+}
+
+// Every destination gets the value its source had before any of the moves, even where a destination is also the source
+// of another move. Moves whose destination isn't needed as a source anymore can go right away; if only cycles are left,
+// one of their values is set aside in RAX, which then takes its place as a source.
+void OptimizingCompiler::emit_parallel_move(Vector<Move> moves)
+{
+    auto& a = m_assembler;
+
+    moves.remove_all_matching([](auto& move) {
+        return !move.source.immediate.has_value() && move.source.location == move.destination;
+    });
+
+    auto is_source = [&](const Location& location) {
+        for (auto& move : moves)
+        {
+            if (!move.source.immediate.has_value() && move.source.location == location)
+                return true;
+        }
+        return false;
+    };
+
+    auto emit_move = [&](const Move& move) {
+        if (move.destination.kind == Location::Kind::Register)
+        {
+            load(move.destination.reg, move.source);
+            return;
+        }
+
+        auto displacement = spill_slot(move.destination.spill_slot);
+        if (move.source.immediate.has_value())
+        {
+            a.store32_immediate(Reg::RSP, displacement, move.source.immediate.value());
+        }
+        else if (move.source.location.kind == Location::Kind::Register)
+        {
+            a.store32(Reg::RSP, displacement, move.source.location.reg);
+        }
+        else
+        {
+            load(scratch_register, move.source);
+            a.store32(Reg::RSP, displacement, scratch_register);
+        }
+    };
+
+    while (!moves.is_empty())
+    {
+        Optional<size_t> ready;
+        for (size_t i = 0; i < moves.size(); i++)
+        {
+            if (!is_source(moves[i].destination))
+            {
+                ready = i;
+                break;
+            }
+        }
+
+        if (ready.has_value())
+        {
+            emit_move(moves[ready.value()]);
+            moves.remove(ready.value());
+            continue;
+        }
+
+        auto blocked = moves.first().destination;
+        load(Reg::RAX, Operand{{}, blocked});
+        for (auto& move : moves)
+        {
+            if (!move.source.immediate.has_value() && move.source.location == blocked)
+                move.source.location = {Location::Kind::Register, Reg::RAX, 0};
+        }
+    }
+}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Function.h>
+#include <AK/HashMap.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Vector.h>
+#include <LibJava/JIT/Assembler.h>
+#include <LibJava/JIT/CompiledCode.h>
+#include <LibJava/JIT/IR.h>
+#include <LibJava/ResolvedMethod.h>
+
+namespace Java::JIT
+{
+// The optimizing compiler, for methods that are still hot after running in baseline code for a while. The method is
+// turned into IR and optimized (see Optimizer.h), and then every value that is computed gets a register for as long
+// as it is live, so unlike baseline code, this doesn't go through the frame in memory for every instruction.
+// Registers are handed out by linear scan (Poletto and Sarkar), over the blocks laid out in reverse postorder. Values
+// that don't fit are spilled to the native stack for their whole lifetime, and the frame is only written back when the
+// interpreter takes over.
+// It supports even less of the instruction set than the baseline compiler, see IR.h. A method that uses anything else
+// simply stays in baseline code.
+class OptimizingCompiler
+{
+public:
+    // Reports every call that has been inlined into the compiled code, once it has been compiled.
+    static ErrorOr<NonnullOwnPtr<CompiledCode>> compile(const ResolvedMethod&,
+                                                        const Function<void(const IR::InlinedCall&)>& on_inline = {});
+
+private:
+    // Where a value lives while it is live. Constants don't have one, they are used as immediates.
+    struct Location
+    {
+        enum class Kind : u8
+        {
+            None,
+            Register,
+            // One of the slots that the prologue reserves on the native stack.
+            Spill,
+        };
+
+        Kind kind{Kind::None};
+        Assembler::Reg reg{};
+        u32 spill_slot{};
+
+        bool operator==(const Location&) const = default;
+    };
+
+    // Either an immediate or a location.
+    struct Operand
+    {
+        Optional<i32> immediate;
+        Location location;
+    };
+
+    struct Move
+    {
+        Operand source;
+        Location destination;
+    };
+
+    explicit OptimizingCompiler(IR::Graph&);
+
+    void compute_live_ranges();
+    void allocate_registers();
+    void emit_prologue();
+    void emit_epilogue(CompiledCode::Exit);
+    Vector<CompiledCode::OSREntry> emit_blocks();
+    void emit_value(IR::Value&);
+    void emit_terminator(size_t index);
+    // Copies the inputs of the phis of the successor that come from the block into the phis, all at once.
+    void emit_edge(IR::BasicBlock& from, IR::BasicBlock& to);
+    void emit_parallel_move(Vector<Move>);
+
+    Operand operand(IR::Value&) const;
+    void load(Assembler::Reg destination, const Operand&);
+    void load(Assembler::Reg destination, IR::Value& value) { load(destination, operand(value)); }
+    void store(const Location&, Assembler::Reg source);
+    // The register to compute the value in, which is either its own or a scratch register.
+    Assembler::Reg target_register(IR::Value&, Optional<Assembler::Reg> avoid = {}) const;
+
+    i32 spill_slot(u32 index) const { return index * sizeof(u64); }
+    i32 frame_slot(u32 index) const { return index * sizeof(Slot); }
+
+    IR::Graph& m_graph;
+    u16 m_max_locals{};
+    Vector<IR::BasicBlock*> m_order;
+    HashMap<IR::BasicBlock*, size_t> m_order_index;
+
+    // Every block and every value in it gets a position, in the order they are laid out: the start of the block (where
+    // its phis are), then one for each value, and one for the terminator.
+    Vector<u32> m_block_starts;
+    Vector<u32> m_block_ends;
+    Vector<u32> m_positions;
+    Vector<u32> m_call_positions;
+
+    struct LiveRange
+    {
+        IR::Value* value{};
+        u32 from{};
+        u32 to{};
+    };
+    // Indexed by the id of the value, with nothing for values that are never live.
+    Vector<Optional<LiveRange>> m_live_ranges;
+    Vector<Location> m_locations;
+    u32 m_spill_slot_count{};
+
+    Assembler m_assembler;
+    Vector<Assembler::Label> m_block_labels;
+    Assembler::Label m_returned;
+    Assembler::Label m_failed;
+    Assembler::Label m_deoptimized;
+};
+}
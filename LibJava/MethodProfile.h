@@ -0,0 +1,61 @@
+#pragma once
+
+#include <AK/StringView.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+
+namespace Java
+{
+// How a method is being executed. Methods start out in the plain interpreter and move up one tier at a time as they
+// get hotter, so that startup doesn't pay for work that only pays off in long-running code.
+enum class Tier : u8
+{
+    // Resolves symbolic references every time an instruction that uses one is executed.
+    Interpreter,
+    // Rewrites such instructions into their quick form once they've been resolved.
+    QuickenedInterpreter,
+    // Runs machine code from the baseline JIT.
+    Compiled,
+    // Runs machine code from the optimizing compiler.
+    Optimized,
+};
+
+constexpr StringView tier_name(Tier tier)
+{
+    switch (tier)
+    {
+        case Tier::Interpreter:
+            return "interpreter"sv;
+        case Tier::QuickenedInterpreter:
+            return "quickened interpreter"sv;
+        case Tier::Compiled:
+            return "compiled"sv;
+        case Tier::Optimized:
+            return "optimized"sv;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+// What we know about how hot a method is, which is what the tiering policy of the VM goes by.
+struct MethodProfile
+{
+    Tier tier{Tier::Interpreter};
+
+    u32 invocation_count{};
+
+    // Taken branches to an instruction at or before the branch itself, which is what closes a loop. They are counted
+    // in total, and for each branch on its own, indexed like the instructions of the method.
+    u32 backedge_count{};
+    Vector<u32> backedge_counts;
+
+    // Compiled code gives up when it runs into an instruction that hasn't been quickened when it was compiled, and the
+    // method goes back to being interpreted until it is hot enough to be compiled again.
+    u8 deoptimizations{};
+    // Cleared if the method uses anything that the JIT doesn't support.
+    bool is_compilable{true};
+    // Cleared if the method uses anything that the optimizing compiler doesn't support, in which case it stays in
+    // baseline code.
+    bool is_optimizable{true};
+};
+}
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include <AK/Vector.h>
+#include <LibJava/Array.h>
+#include <LibJava/ArrayKernels.h>
+#include <LibJava/NativeMethods.h>
+
+namespace Java
+{
+static ErrorOr<Array*> non_null_array(Object* object)
+{
+    if (!object)
+        return Error::from_string_literal("NullPointerException");
+
+    return static_cast<Array*>(object);
+}
+
+// The descriptor of the method already tells which type the value has, and so which type the components of the array
+// have, as both are the same.
+template<typename T>
+static T component_from_slot(Slot slot)
+{
+    if constexpr (IsSame<T, i64>)
+        return slot.as_long();
+    else if constexpr (IsSame<T, float>)
+        return slot.as_float();
+    else if constexpr (IsSame<T, double>)
+        return slot.as_double();
+    else
+        return static_cast<T>(slot.as_int());
+}
+
+// System.arraycopy(Object src, int srcPos, Object dest, int destPos, int length)
+static ErrorOr<Slot> system_arraycopy(Slot* arguments)
+{
+    auto* source = TRY(non_null_array(arguments[0].as_reference()));
+    auto source_position = arguments[1].as_int();
+    auto* destination = TRY(non_null_array(arguments[2].as_reference()));
+    auto destination_position = arguments[3].as_int();
+    auto length = arguments[4].as_int();
+
+    // "Otherwise, if any of the following is true, an ArrayStoreException is thrown and the destination is not
+    // modified: The src argument refers to an object that is not an array. [...] The src argument and dest argument
+    // refer to arrays whose component types are different primitive types."
+    auto& component_type = source->resolved_class().component_type;
+    auto& destination_component_type = destination->resolved_class().component_type;
+    if (!component_type.has_value() || !destination_component_type.has_value() ||
+        component_type.value() != destination_component_type.value())
+        return Error::from_string_literal("ArrayStoreException");
+
+    // "Otherwise, if any of the following is true, an IndexOutOfBoundsException is thrown and the destination is not
+    // modified", which is when either range doesn't lie entirely within its array.
+    if (source_position < 0 || destination_position < 0 || length < 0 || source_position > source->length() - length ||
+        destination_position > destination->length() - length)
+        return Error::from_string_literal("ArrayIndexOutOfBoundsException");
+
+    size_t size = component_size(component_type.value());
+    ArrayKernels::copy(destination->elements<u8>() + destination_position * size,
+                       source->elements<u8>() + source_position * size, length * size);
+    return Slot{};
+}
+
+// Arrays.fill(T[] a, T val)
+template<typename T>
+static ErrorOr<Slot> arrays_fill(Slot* arguments)
+{
+    auto* array = TRY(non_null_array(arguments[0].as_reference()));
+    auto value = component_from_slot<T>(arguments[1]);
+
+    ArrayKernels::fill(array->elements<u8>(), array->length(), &value, sizeof(T));
+    return Slot{};
+}
+
+// Arrays.fill(T[] a, int fromIndex, int toIndex, T val)
+template<typename T>
+static ErrorOr<Slot> arrays_fill_range(Slot* arguments)
+{
+    auto* array = TRY(non_null_array(arguments[0].as_reference()));
+    auto from = arguments[1].as_int();
+    auto to = arguments[2].as_int();
+    auto value = component_from_slot<T>(arguments[3]);
+
+    if (from > to)
+        return Error::from_string_literal("IllegalArgumentException");
+    if (from < 0 || to > array->length())
+        return Error::from_string_literal("ArrayIndexOutOfBoundsException");
+
+    ArrayKernels::fill(array->elements<u8>() + from * sizeof(T), to - from, &value, sizeof(T));
+    return Slot{};
+}
+
+// Arrays.equals(T[] a, T[] a2): "two array references are considered equal if both are null."
+static ErrorOr<Slot> arrays_equals(Slot* arguments)
+{
+    auto* a = static_cast<Array*>(arguments[0].as_reference());
+    auto* b = static_cast<Array*>(arguments[1].as_reference());
+
+    if (a == b)
+        return Slot::from_int(1);
+    if (!a || !b || a->length() != b->length())
+        return Slot::from_int(0);
+
+    auto component_type = a->resolved_class().component_type.value();
+    return Slot::from_int(ArrayKernels::equals(component_type, a->elements<u8>(), b->elements<u8>(), a->length()));
+}
+
+// Arrays.hashCode(T[] a): "If a is null, this method returns 0."
+static ErrorOr<Slot> arrays_hash_code(Slot* arguments)
+{
+    auto* array = static_cast<Array*>(arguments[0].as_reference());
+    if (!array)
+        return Slot::from_int(0);
+
+    auto component_type = array->resolved_class().component_type.value();
+    return Slot::from_int(ArrayKernels::hash_code(component_type, array->elements<u8>(), array->length()));
+}
+
+struct NativeMethodEntry
+{
+    StringView class_name;
+    StringView name;
+    StringView descriptor;
+    NativeMethod function;
+};
+
+// Booleans are stored as a byte each, which is all an u8 needs to know about them.
+static constexpr NativeMethodEntry native_methods[] = {
+    {"java/lang/System"sv, "arraycopy"sv, "(Ljava/lang/Object;ILjava/lang/Object;II)V"sv, system_arraycopy},
+    {"java/util/Arrays"sv, "fill"sv, "([ZZ)V"sv, arrays_fill<u8>},
+    {"java/util/Arrays"sv, "fill"sv, "([BB)V"sv, arrays_fill<i8>},
+    {"java/util/Arrays"sv, "fill"sv, "([CC)V"sv, arrays_fill<u16>},
+    {"java/util/Arrays"sv, "fill"sv, "([SS)V"sv, arrays_fill<i16>},
+    {"java/util/Arrays"sv, "fill"sv, "([II)V"sv, arrays_fill<i32>},
+    {"java/util/Arrays"sv, "fill"sv, "([JJ)V"sv, arrays_fill<i64>},
+    {"java/util/Arrays"sv, "fill"sv, "([FF)V"sv, arrays_fill<float>},
+    {"java/util/Arrays"sv, "fill"sv, "([DD)V"sv, arrays_fill<double>},
+    {"java/util/Arrays"sv, "fill"sv, "([ZIIZ)V"sv, arrays_fill_range<u8>},
+    {"java/util/Arrays"sv, "fill"sv, "([BIIB)V"sv, arrays_fill_range<i8>},
+    {"java/util/Arrays"sv, "fill"sv, "([CIIC)V"sv, arrays_fill_range<u16>},
+    {"java/util/Arrays"sv, "fill"sv, "([SIIS)V"sv, arrays_fill_range<i16>},
+    {"java/util/Arrays"sv, "fill"sv, "([IIII)V"sv, arrays_fill_range<i32>},
+    {"java/util/Arrays"sv, "fill"sv, "([JIIJ)V"sv, arrays_fill_range<i64>},
+    {"java/util/Arrays"sv, "fill"sv, "([FIIF)V"sv, arrays_fill_range<float>},
+    {"java/util/Arrays"sv, "fill"sv, "([DIID)V"sv, arrays_fill_range<double>},
+    {"java/util/Arrays"sv, "equals"sv, "([Z[Z)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([B[B)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([C[C)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([S[S)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([I[I)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([J[J)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([F[F)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "equals"sv, "([D[D)Z"sv, arrays_equals},
+    {"java/util/Arrays"sv, "hashCode"sv, "([Z)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([B)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([C)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([S)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([I)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([J)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([F)I"sv, arrays_hash_code},
+    {"java/util/Arrays"sv, "hashCode"sv, "([D)I"sv, arrays_hash_code},
+};
+
+bool is_native_class(StringView name)
+{
+    for (auto& native_method : native_methods)
+    {
+        if (native_method.class_name == name)
+            return true;
+    }
+
+    return false;
+}
+
+ErrorOr<NonnullRefPtr<ClassFile>> try_create_native_class_file(StringView name)
+{
+    Vector<u8> bytes;
+    auto append_u16 = [&](u16 value) {
+        bytes.append(value >> 8);
+        bytes.append(value & 0xff);
+    };
+    auto append_utf8 = [&](StringView string) {
+        bytes.append(1);
+        append_u16(string.length());
+        bytes.append(reinterpret_cast<const u8*>(string.characters_without_null_termination()), string.length());
+    };
+
+    u16 methods_count = 0;
+    for (auto& native_method : native_methods)
+    {
+        if (native_method.class_name == name)
+            methods_count++;
+    }
+
+    // 4.1 The ClassFile Structure, for a public final class with nothing but the names of the class, its superclass
+    // and its methods in the constant pool: #1 and #2 are the class, #3 and #4 java/lang/Object, and every method gets
+    // two more for its name and descriptor.
+    append_u16(0xcafe);
+    append_u16(0xbabe);
+    append_u16(0);
+    append_u16(52);
+    append_u16(5 + methods_count * 2);
+    append_utf8(name);
+    bytes.append(7);
+    append_u16(1);
+    append_utf8("java/lang/Object"sv);
+    bytes.append(7);
+    append_u16(3);
+    for (auto& native_method : native_methods)
+    {
+        if (native_method.class_name != name)
+            continue;
+
+        append_utf8(native_method.name);
+        append_utf8(native_method.descriptor);
+    }
+
+    append_u16(to_underlying(ClassFile::AccessFlags::Public | ClassFile::AccessFlags::Final |
+                             ClassFile::AccessFlags::Super));
+    append_u16(2);
+    append_u16(4);
+    append_u16(0);
+    append_u16(0);
+    append_u16(methods_count);
+    for (u16 i = 0; i < methods_count; i++)
+    {
+        append_u16(to_underlying(ClassFile::MethodInfo::AccessFlags::Public |
+                                 ClassFile::MethodInfo::AccessFlags::Static |
+                                 ClassFile::MethodInfo::AccessFlags::Native));
+        append_u16(5 + i * 2);
+        append_u16(6 + i * 2);
+        append_u16(0);
+    }
+    append_u16(0);
+
+    return ClassFile::try_parse(TRY(ByteBuffer::copy(bytes.data(), bytes.size())));
+}
+
+NativeMethod find_native_method(StringView class_name, StringView name, StringView descriptor)
+{
+    for (auto& native_method : native_methods)
+    {
+        if (native_method.class_name == class_name && native_method.name == name &&
+            native_method.descriptor == descriptor)
+            return native_method.function;
+    }
+
+    return nullptr;
+}
+}
\ No newline at end of file
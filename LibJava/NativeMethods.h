@@ -0,0 +1,24 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/StringView.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+// 4.6: ACC_NATIVE "Declared native; implemented in a language other than the Java programming language."
+// There is no class library to load classes like java/lang/System from, so the VM brings the few methods of it that
+// code working on arrays can't do without along itself, implemented in C++. They get the arguments in the local
+// variables the method would have had, and return their result the same way a method of the interpreter does.
+using NativeMethod = ErrorOr<Slot> (*)(Slot* arguments);
+
+bool is_native_class(StringView name);
+
+// A class file that declares the native methods of the class with the given name, and nothing else.
+ErrorOr<NonnullRefPtr<ClassFile>> try_create_native_class_file(StringView name);
+
+// 6.5 invokestatic: "if the method is native and the code that implements the method cannot be bound, invokestatic
+// throws an UnsatisfiedLinkError", which is what this returning nullptr comes down to.
+NativeMethod find_native_method(StringView class_name, StringView name, StringView descriptor);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <AK/BitCast.h>
+#include <AK/Types.h>
+#include <LibJava/ResolvedClass.h>
+
+namespace Java
+{
+// 2.7 Representation of Objects
+// "The Java Virtual Machine does not mandate any particular internal structure for objects."
+// Ours start with a header that is nothing but a pointer to the class of the object, followed by the instance fields
+// at the offsets their ResolvedClass has laid them out at. Objects are never constructed like C++ objects, they are
+// carved out of the Heap, whose memory starts out zeroed. That already is the default value of every field (2.3, 2.4).
+class Object
+{
+public:
+    static constexpr u32 header_size = sizeof(FlatPtr);
+
+    const ResolvedClass& resolved_class() const { return *reinterpret_cast<const ResolvedClass*>(m_header); }
+
+    void set_resolved_class(const ResolvedClass& resolved_class) { m_header = bit_cast<FlatPtr>(&resolved_class); }
+
+    // While the garbage collector runs, it keeps what it needs to know about an object here instead of its class,
+    // which it can tell apart by the low bits, as classes are aligned to at least 8 bytes. See Heap.
+    FlatPtr& header() { return m_header; }
+
+    // The offset is the one from ResolvedClass::Field, so it counts from the start of the header.
+    template<typename T>
+    ALWAYS_INLINE T read(u32 offset) const
+    {
+        T value;
+        __builtin_memcpy(&value, reinterpret_cast<const u8*>(this) + offset, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    ALWAYS_INLINE void write(u32 offset, T value)
+    {
+        __builtin_memcpy(reinterpret_cast<u8*>(this) + offset, &value, sizeof(T));
+    }
+
+private:
+    FlatPtr m_header;
+};
+
+static_assert(sizeof(Object) == Object::header_size);
+}
\ No newline at end of file
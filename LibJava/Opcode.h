@@ -213,15 +213,79 @@ namespace Java
     M(impdep1, "impdep1", 0xfe)                                                                                        \
     M(impdep2, "impdep2", 0xff)
 
+// These are not part of the specification, and never appear in a class file. An instruction that uses a symbolic
+// reference is rewritten into its quick form once the reference has been resolved, so that it doesn't have to be
+// resolved every time the instruction is executed. The values are from the range the specification leaves unused.
+#define ENUMERATE_QUICK_OPCODES(M)                                                                                     \
+    M(getstatic_quick, "getstatic_quick", 0xcb)                                                                        \
+    M(getstatic2_quick, "getstatic2_quick", 0xcc)                                                                      \
+    M(putstatic_quick, "putstatic_quick", 0xcd)                                                                        \
+    M(putstatic2_quick, "putstatic2_quick", 0xce)                                                                      \
+    M(invokestatic_quick, "invokestatic_quick", 0xcf)                                                                  \
+    M(new_quick, "new_quick", 0xd4)                                                                                    \
+    M(getfield_byte_quick, "getfield_byte_quick", 0xd5)                                                                \
+    M(getfield_char_quick, "getfield_char_quick", 0xd6)                                                                \
+    M(getfield_short_quick, "getfield_short_quick", 0xd7)                                                              \
+    M(getfield_quick, "getfield_quick", 0xd8)                                                                          \
+    M(getfield2_quick, "getfield2_quick", 0xd9)                                                                        \
+    M(getfield_reference_quick, "getfield_reference_quick", 0xda)                                                      \
+    M(putfield_boolean_quick, "putfield_boolean_quick", 0xdb)                                                          \
+    M(putfield_byte_quick, "putfield_byte_quick", 0xdc)                                                                \
+    M(putfield_short_quick, "putfield_short_quick", 0xdd)                                                              \
+    M(putfield_quick, "putfield_quick", 0xde)                                                                          \
+    M(putfield2_quick, "putfield2_quick", 0xdf)                                                                        \
+    M(putfield_reference_quick, "putfield_reference_quick", 0xe0)                                                      \
+    M(invokespecial_quick, "invokespecial_quick", 0xe1)                                                                \
+    M(newarray_quick, "newarray_quick", 0xe2)
+
+// These aren't part of the specification either. A superinstruction stands in for a whole sequence of instructions
+// that javac emits over and over again, so that it only takes a single dispatch. The instructions it was fused from
+// stay in place right behind it, see DecodedCode::fuse_superinstructions.
+#define ENUMERATE_SUPERINSTRUCTION_OPCODES(M)                                                                          \
+    M(iload_iload_iadd_istore, "iload_iload_iadd_istore", 0xd0)                                                        \
+    M(iload_iconst_if_icmpge, "iload_iconst_if_icmpge", 0xd1)                                                          \
+    M(iload_iload_if_icmpge, "iload_iload_if_icmpge", 0xd2)                                                            \
+    M(iinc_goto, "iinc_goto", 0xd3)
+
 #define M(name, name_string, value) name = value,
 enum class Opcode : u8
 {
-    ENUMERATE_JAVA_OPCODES(M)
+    ENUMERATE_JAVA_OPCODES(M) ENUMERATE_QUICK_OPCODES(M) ENUMERATE_SUPERINSTRUCTION_OPCODES(M)
 };
 #undef M
 
 #define M(name, name_string, value) {Opcode::name, name_string},
-static HashMap<Opcode, String> opcode_names{ENUMERATE_JAVA_OPCODES(M)};
+static HashMap<Opcode, String> opcode_names{ENUMERATE_JAVA_OPCODES(M) ENUMERATE_QUICK_OPCODES(M)
+                                                 ENUMERATE_SUPERINSTRUCTION_OPCODES(M)};
+#undef M
+
+constexpr bool is_quick_opcode(Opcode opcode)
+{
+    switch (opcode)
+    {
+#define M(name, name_string, value) case Opcode::name:
+        ENUMERATE_QUICK_OPCODES(M)
 #undef M
+        return true;
+        default:
+            return false;
+    }
+}
 
+// How many instructions a superinstruction was fused from, or 0 if it isn't one.
+constexpr u8 superinstruction_length(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::iload_iload_iadd_istore:
+            return 4;
+        case Opcode::iload_iconst_if_icmpge:
+        case Opcode::iload_iload_if_icmpge:
+            return 3;
+        case Opcode::iinc_goto:
+            return 2;
+        default:
+            return 0;
+    }
+}
 }
\ No newline at end of file
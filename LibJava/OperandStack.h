@@ -0,0 +1,82 @@
+#pragma once
+
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+// 2.6.2 Operand Stacks
+// "The maximum depth of the operand stack of a frame is determined at compile-time and is supplied along with the
+// code for the method associated with the frame"
+// The slots for it are carved out of the VM stack when the frame is created, right after the local variables, so
+// pushing and popping never have to allocate or move anything around.
+// "A value of type long or double contributes two units to the depth and a value of any other type contributes one
+// unit." We do the same: category 2 values live in the first of their two slots, and the second one is unused.
+// This way, they line up with the local variables of the callee when they are passed as arguments.
+// None of this checks for overflow or underflow, as the verifier has proven that the code never does either (4.10).
+class OperandStack
+{
+public:
+    // The stack may already have some slots on it, for when the interpreter takes over a frame from compiled code.
+    explicit OperandStack(Slot* base, size_t depth = 0) : m_base(base), m_top(base + depth) {}
+
+    ALWAYS_INLINE void push(Slot slot)
+    {
+        *m_top++ = slot;
+    }
+
+    ALWAYS_INLINE void push2(Slot slot)
+    {
+        *m_top = slot;
+        m_top += 2;
+    }
+
+    ALWAYS_INLINE Slot pop()
+    {
+        return *--m_top;
+    }
+
+    ALWAYS_INLINE Slot pop2()
+    {
+        m_top -= 2;
+        return *m_top;
+    }
+
+    ALWAYS_INLINE void push_int(i32 value) { push(Slot::from_int(value)); }
+
+    ALWAYS_INLINE void push_long(i64 value) { push2(Slot::from_long(value)); }
+
+    ALWAYS_INLINE void push_float(float value) { push(Slot::from_float(value)); }
+
+    ALWAYS_INLINE void push_double(double value) { push2(Slot::from_double(value)); }
+
+    ALWAYS_INLINE void push_reference(Object* object) { push(Slot::from_reference(object)); }
+
+    ALWAYS_INLINE i32 pop_int() { return pop().as_int(); }
+
+    ALWAYS_INLINE i64 pop_long() { return pop2().as_long(); }
+
+    ALWAYS_INLINE float pop_float() { return pop().as_float(); }
+
+    ALWAYS_INLINE double pop_double() { return pop2().as_double(); }
+
+    ALWAYS_INLINE Object* pop_reference() { return pop().as_reference(); }
+
+    ALWAYS_INLINE Slot& peek() { return m_top[-1]; }
+
+    // One past the topmost slot, which is where the local variables of a callee start once its arguments are popped.
+    ALWAYS_INLINE Slot* top() const { return m_top; }
+
+    ALWAYS_INLINE void drop(size_t slots)
+    {
+        m_top -= slots;
+    }
+
+    size_t size() const { return m_top - m_base; }
+
+    bool is_empty() const { return m_top == m_base; }
+
+private:
+    Slot* m_base;
+    Slot* m_top;
+};
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <LibJava/ReferenceMaps.h>
+
+namespace Java
+{
+bool ReferenceMaps::is_safepoint(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::ldc:
+        case Opcode::getstatic:
+        case Opcode::putstatic:
+        case Opcode::getfield:
+        case Opcode::putfield:
+        case Opcode::invokevirtual:
+        case Opcode::invokespecial:
+        case Opcode::invokestatic:
+        case Opcode::invokeinterface:
+        case Opcode::invokedynamic:
+        case Opcode::new_:
+        case Opcode::newarray:
+        case Opcode::anewarray:
+        case Opcode::multianewarray:
+        case Opcode::checkcast:
+        case Opcode::instanceof:
+            return true;
+        default:
+            return false;
+    }
+}
+
+NonnullOwnPtr<ReferenceMaps> ReferenceMaps::create(const DecodedCode& decoded_code,
+                                                   const Vector<Optional<Verifier::Frame>>& frames)
+{
+    auto& instructions = decoded_code.instructions();
+    size_t max_locals = decoded_code.code().max_locals;
+
+    auto maps = adopt_own(*new ReferenceMaps);
+    auto& starts = maps->m_own_starts;
+    auto& slots = maps->m_own_slots;
+    starts.ensure_capacity(instructions.size() + 1);
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        starts.append(slots.size());
+
+        // Code that control never comes to has no frame, and never runs either.
+        if (!is_safepoint(instructions[i].opcode) || !frames[i].has_value())
+            continue;
+
+        // Objects that no instance initialization method has run on yet are references all the same.
+        auto& frame = frames[i].value();
+        for (size_t j = 0; j < frame.locals.size(); j++)
+        {
+            if (frame.locals[j].is_reference())
+                slots.append(j);
+        }
+        for (size_t j = 0; j < frame.stack.size(); j++)
+        {
+            if (frame.stack[j].is_reference())
+                slots.append(max_locals + j);
+        }
+    }
+
+    starts.append(slots.size());
+    maps->m_starts = starts.span();
+    maps->m_slots = slots.span();
+    return maps;
+}
+
+ErrorOr<NonnullOwnPtr<ReferenceMaps>> ReferenceMaps::try_create_over(const DecodedCode& decoded_code,
+                                                                     Span<const u32> starts, Span<const u32> slots)
+{
+    // The garbage collector goes by these without any further checks, so they had better fit the method.
+    if (starts.size() != decoded_code.instructions().size() + 1 || starts.first() != 0 || starts.last() != slots.size())
+        return Error::from_string_literal("Reference maps don't fit the instructions of the method");
+
+    for (size_t i = 1; i < starts.size(); i++)
+    {
+        if (starts[i] < starts[i - 1])
+            return Error::from_string_literal("Reference maps don't fit the instructions of the method");
+    }
+
+    auto frame_size = decoded_code.code().max_locals + decoded_code.code().max_stacks;
+    for (auto slot : slots)
+    {
+        if (slot >= frame_size)
+            return Error::from_string_literal("Reference maps don't fit into the frame of the method");
+    }
+
+    auto maps = adopt_own(*new ReferenceMaps);
+    maps->m_starts = starts;
+    maps->m_slots = slots;
+    return maps;
+}
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <AK/Noncopyable.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Span.h>
+#include <AK/Vector.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/Opcode.h>
+#include <LibJava/Verifier.h>
+
+namespace Java
+{
+// Which slots of a frame hold references, for every instruction of a method that garbage may be collected at (its
+// safepoints). With them, the garbage collector knows exactly what it has to update when it moves an object, and it
+// doesn't keep whatever an int happens to look like alive.
+// They are picked out of the types the verifier has proven the slots to have at every instruction.
+class ReferenceMaps
+{
+    AK_MAKE_NONCOPYABLE(ReferenceMaps);
+    AK_MAKE_NONMOVABLE(ReferenceMaps);
+
+public:
+    static NonnullOwnPtr<ReferenceMaps> create(const DecodedCode&, const Vector<Optional<Verifier::Frame>>&);
+    // Over maps that were made before, as they are laid out by starts() and slots(), which have to outlive these.
+    static ErrorOr<NonnullOwnPtr<ReferenceMaps>> try_create_over(const DecodedCode&, Span<const u32> starts,
+                                                                Span<const u32> slots);
+
+    // These may allocate, call a method, or resolve a class, which initializes it, and so runs its code.
+    static bool is_safepoint(Opcode);
+
+    // The slots that hold a reference when the instruction at the index starts, counting from the first local
+    // variable of the frame. Only safepoints have any. The arguments of an invoke are among them, even though they
+    // become the local variables of the method it calls, which may well store something else in there.
+    Span<const u32> at(size_t instruction_index) const
+    {
+        auto start = m_starts[instruction_index];
+        return m_slots.slice(start, m_starts[instruction_index + 1] - start);
+    }
+
+    // Where the slots of each instruction start in slots(), with one more at the end.
+    Span<const u32> starts() const { return m_starts; }
+    Span<const u32> slots() const { return m_slots; }
+
+private:
+    ReferenceMaps() = default;
+
+    // What m_starts and m_slots view, unless they were made before.
+    Vector<u32> m_own_starts;
+    Vector<u32> m_own_slots;
+    Span<const u32> m_starts;
+    Span<const u32> m_slots;
+};
+}
\ No newline at end of file
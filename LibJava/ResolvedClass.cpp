@@ -0,0 +1,143 @@
+#include <AK/StdLibExtras.h>
+#include <LibJava/Descriptor.h>
+#include <LibJava/Object.h>
+#include <LibJava/ResolvedClass.h>
+
+namespace Java
+{
+static FieldKind field_kind(const FieldDescriptor& descriptor)
+{
+    if (descriptor.array_dimensions() > 0 || !descriptor.type().has<PrimitiveType>())
+        return FieldKind::Reference;
+
+    switch (descriptor.type().get<PrimitiveType>())
+    {
+        case PrimitiveType::Boolean:
+            return FieldKind::Boolean;
+        case PrimitiveType::Byte:
+            return FieldKind::Byte;
+        case PrimitiveType::Char:
+            return FieldKind::Char;
+        case PrimitiveType::Short:
+            return FieldKind::Short;
+        case PrimitiveType::Int:
+        case PrimitiveType::Float:
+            return FieldKind::Int;
+        case PrimitiveType::Long:
+        case PrimitiveType::Double:
+            return FieldKind::Long;
+        case PrimitiveType::ReturnAddress:
+            break;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+ErrorOr<NonnullOwnPtr<ResolvedClass>> ResolvedClass::try_create(const ClassFile& class_file,
+                                                               const ResolvedClass* super_class)
+{
+    auto resolved_class = make<ResolvedClass>();
+    resolved_class->name =
+        class_file.constant_pool()[class_file.this_class().name_index - 1].get<ClassFile::Utf8>().value;
+    resolved_class->class_file = &class_file;
+    resolved_class->super_class = super_class;
+
+    Vector<Field> fields;
+    for (auto& field : class_file.fields())
+    {
+        if (has_flag(field.access_flags, ClassFile::FieldInfo::AccessFlags::Static))
+            continue;
+
+        auto& name = class_file.constant_pool()[field.name_index - 1].get<ClassFile::Utf8>();
+        auto& descriptor = class_file.constant_pool()[field.descriptor_index - 1].get<ClassFile::Utf8>();
+        auto kind = field_kind(TRY(FieldDescriptor::try_parse(descriptor.value)));
+        fields.append({name.value, descriptor.value, kind, 0});
+    }
+
+    // The inherited fields end on a multiple of 8, and every size is a power of two, so going from the largest size
+    // down to the smallest one never needs any padding.
+    u32 offset = super_class ? super_class->instance_size : Object::header_size;
+    for (u8 size : {8, 4, 2, 1})
+    {
+        for (auto& field : fields)
+        {
+            if (field_size(field.kind) != size)
+                continue;
+
+            field.offset = offset;
+            offset += size;
+            resolved_class->fields.append(field);
+        }
+    }
+
+    if (super_class)
+        resolved_class->reference_field_offsets = super_class->reference_field_offsets;
+    for (auto& field : resolved_class->fields)
+    {
+        if (field.kind == FieldKind::Reference)
+            resolved_class->reference_field_offsets.append(field.offset);
+    }
+
+    resolved_class->instance_size = align_up_to<u32>(offset, 8);
+    return resolved_class;
+}
+
+NonnullOwnPtr<ResolvedClass> ResolvedClass::create_primitive_array(PrimitiveType component_type,
+                                                                 const ResolvedClass& object_class)
+{
+    auto resolved_class = make<ResolvedClass>();
+    resolved_class->name = [&] {
+        switch (component_type)
+        {
+            case PrimitiveType::Boolean:
+                return "[Z"sv;
+            case PrimitiveType::Byte:
+                return "[B"sv;
+            case PrimitiveType::Char:
+                return "[C"sv;
+            case PrimitiveType::Short:
+                return "[S"sv;
+            case PrimitiveType::Int:
+                return "[I"sv;
+            case PrimitiveType::Long:
+                return "[J"sv;
+            case PrimitiveType::Float:
+                return "[F"sv;
+            case PrimitiveType::Double:
+                return "[D"sv;
+            case PrimitiveType::ReturnAddress:
+                break;
+        }
+
+        VERIFY_NOT_REACHED();
+    }();
+    resolved_class->super_class = &object_class;
+    resolved_class->component_type = component_type;
+    return resolved_class;
+}
+
+const ResolvedClass::Field* ResolvedClass::find_field(StringView name, StringView descriptor) const
+{
+    for (auto* resolved_class = this; resolved_class; resolved_class = resolved_class->super_class)
+    {
+        for (auto& field : resolved_class->fields)
+        {
+            if (field.name == name && field.descriptor == descriptor)
+                return &field;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ResolvedClass::is_subclass_of(const ResolvedClass& other) const
+{
+    for (auto* resolved_class = this; resolved_class; resolved_class = resolved_class->super_class)
+    {
+        if (resolved_class == &other)
+            return true;
+    }
+
+    return false;
+}
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/StringView.h>
+#include <AK/Vector.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/Types.h>
+
+namespace Java
+{
+// How the value of an instance field is stored in an object. float and double are stored as their bits, the same way
+// they are in a Slot, so they don't need kinds of their own.
+enum class FieldKind : u8
+{
+    Boolean,
+    Byte,
+    Char,
+    Short,
+    Int,
+    Long,
+    Reference,
+};
+
+constexpr u8 field_size(FieldKind kind)
+{
+    switch (kind)
+    {
+        case FieldKind::Boolean:
+        case FieldKind::Byte:
+            return 1;
+        case FieldKind::Char:
+        case FieldKind::Short:
+            return 2;
+        case FieldKind::Int:
+            return 4;
+        case FieldKind::Long:
+        case FieldKind::Reference:
+            return 8;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+// The components of an array of a primitive type are stored the same way as a field of that type, except that booleans
+// take up a byte each as well (6.5 baload: "boolean arrays [...] are encoded as byte arrays, 8 bits per element").
+constexpr u8 component_size(PrimitiveType type)
+{
+    switch (type)
+    {
+        case PrimitiveType::Boolean:
+        case PrimitiveType::Byte:
+            return 1;
+        case PrimitiveType::Char:
+        case PrimitiveType::Short:
+            return 2;
+        case PrimitiveType::Int:
+        case PrimitiveType::Float:
+            return 4;
+        case PrimitiveType::Long:
+        case PrimitiveType::Double:
+            return 8;
+        case PrimitiveType::ReturnAddress:
+            break;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+// Everything needed to create instances of a class and to get at their fields, worked out once when the class is
+// first instantiated or one of its fields is resolved, instead of on every new, getfield and putfield.
+struct ResolvedClass
+{
+    struct Field
+    {
+        // These point into the constant pool of the class that declares the field.
+        StringView name;
+        StringView descriptor;
+        FieldKind kind{};
+        // From the start of the object, so that the header is already accounted for.
+        u32 offset{};
+    };
+
+    // The fields of the superclass come first and keep their offsets, so that code compiled against the superclass
+    // works on instances of this class as well. The fields of this class are sorted by size, largest first, which
+    // keeps every one of them naturally aligned without any padding in between.
+    static ErrorOr<NonnullOwnPtr<ResolvedClass>> try_create(const ClassFile&, const ResolvedClass* super_class);
+
+    // JLS 10.8: "The direct superclass of an array type is Object." Arrays have no class file and no fields, all there
+    // is to them is the type of their components.
+    static NonnullOwnPtr<ResolvedClass> create_primitive_array(PrimitiveType component_type,
+                                                               const ResolvedClass& object_class);
+
+    // 5.4.3.2 Field Resolution
+    // "If C declares a field with the name and descriptor specified by the field reference, field lookup succeeds."
+    // "Otherwise, if C has a superclass S, field lookup is applied recursively to S."
+    // Interfaces can only declare static fields, so there is no need to look at them here.
+    const Field* find_field(StringView name, StringView descriptor) const;
+
+    // Whether this is the given class or one of its subclasses, which is what an object has to be an instance of for
+    // the fields of the given class to be where their offsets say.
+    bool is_subclass_of(const ResolvedClass&) const;
+
+    // In internal form (4.2.1), or a field descriptor for arrays (4.4.1).
+    StringView name;
+    // Only classes that are arrays have none.
+    const ClassFile* class_file{};
+    // Only java/lang/Object has none.
+    const ResolvedClass* super_class{};
+    // Only the instance fields declared by this class itself.
+    Vector<Field> fields;
+    // Header and inherited fields included, and rounded up so that the next object starts out aligned as well.
+    u32 instance_size{};
+    // Only for arrays, whose size depends on their length, see Array::allocation_size.
+    Optional<PrimitiveType> component_type;
+    // The offsets of every instance field that holds a reference, inherited ones included, which is all the garbage
+    // collector needs to know about the fields of an object.
+    Vector<u32> reference_field_offsets;
+    // Handed out by Heap::register_class, so that the garbage collector can tell the class of an object from a few
+    // bits.
+    u32 id{};
+};
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <AK/OwnPtr.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/Descriptor.h>
+#include <LibJava/JIT/CompiledCode.h>
+#include <LibJava/MethodProfile.h>
+#include <LibJava/NativeMethods.h>
+#include <LibJava/ReferenceMaps.h>
+
+namespace Java
+{
+// Everything the interpreter needs to know to call a method, worked out once when it is first resolved (5.4.3.3)
+// instead of on every call.
+struct ResolvedMethod
+{
+    enum class ReturnKind : u8
+    {
+        Void,
+        // 2.11.1: long and double are category 2, everything else is category 1
+        Category1,
+        Category2,
+    };
+
+    const ClassFile* class_file{};
+    const ClassFile::MethodInfo* method{};
+    // Native methods have neither, they have native_method instead.
+    const ClassFile::Code* code{};
+    DecodedCode* decoded_code{};
+    NativeMethod native_method{};
+    MethodDescriptor descriptor;
+    size_t argument_slots{};
+    ReturnKind return_kind{};
+
+    // Lives in the profiles of the VM, this is just so that we don't have to look it up on every call.
+    MethodProfile* profile{};
+    OwnPtr<JIT::CompiledCode> compiled_code;
+    // Lives with the DecodedCode in the VM, and is only missing for native methods.
+    const ReferenceMaps* reference_maps{};
+};
+}
\ No newline at end of file
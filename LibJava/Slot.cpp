@@ -0,0 +1,41 @@
+#include <LibJava/Slot.h>
+
+namespace Java
+{
+Slot Slot::from_value(const Value& value)
+{
+    return value.visit([](const Byte& value) { return from_int(value.value()); },
+                       [](const Short& value) { return from_int(value.value()); },
+                       [](const Integer& value) { return from_int(value.value()); },
+                       [](const Long& value) { return from_long(value.value()); },
+                       [](const Char& value) { return from_int(value.value()); },
+                       [](const Float& value) { return from_float(value.value()); },
+                       [](const Double& value) { return from_double(value.value()); },
+                       [](const Reference& value) { return from_reference(value.object); });
+}
+
+Value Slot::to_value(PrimitiveType type) const
+{
+    switch (type)
+    {
+        case PrimitiveType::Byte:
+            // Booleans are just Bytes in disguise!
+        case PrimitiveType::Boolean:
+            return Byte(as_int());
+        case PrimitiveType::Short:
+            return Short(as_int());
+        case PrimitiveType::Int:
+            return Integer(as_int());
+        case PrimitiveType::Long:
+            return Long(as_long());
+        case PrimitiveType::Char:
+            return Char(as_int());
+        case PrimitiveType::Float:
+            return Float(as_float());
+        case PrimitiveType::Double:
+            return Double(as_double());
+        default:
+            VERIFY_NOT_REACHED();
+    }
+}
+}
\ No newline at end of file
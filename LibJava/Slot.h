@@ -0,0 +1,53 @@
+#pragma once
+
+#include <AK/BitCast.h>
+#include <AK/Types.h>
+#include <LibJava/Types.h>
+
+namespace Java
+{
+// 2.6.1 Local Variables
+// "A single local variable can hold a value of type boolean, byte, char, short, int, float, reference, or
+// returnAddress. A pair of local variables can hold a value of type long or double."
+// A Slot is a single local variable, or a single unit of operand stack depth. Unlike Value, it has no idea what is
+// stored inside of it. The instruction operating on it does: iadd only ever sees ints, dload only ever sees doubles.
+// It is wide enough for a long or a double to fit into the first slot of the pair they take up.
+class Slot
+{
+public:
+    Slot() = default;
+
+    // 2.11.1: byte, short, char and boolean are all operated on as ints
+    ALWAYS_INLINE static Slot from_int(i32 value) { return Slot(static_cast<u32>(value)); }
+
+    ALWAYS_INLINE static Slot from_long(i64 value) { return Slot(static_cast<u64>(value)); }
+
+    ALWAYS_INLINE static Slot from_float(float value) { return Slot(bit_cast<u32>(value)); }
+
+    ALWAYS_INLINE static Slot from_double(double value) { return Slot(bit_cast<u64>(value)); }
+
+    // References are just the address of the object, or zero for null.
+    ALWAYS_INLINE static Slot from_reference(Object* object) { return Slot(bit_cast<FlatPtr>(object)); }
+
+    // These are for the boundary between the VM and whoever is embedding it, the interpreter never uses them.
+    static Slot from_value(const Value&);
+    Value to_value(PrimitiveType) const;
+
+    ALWAYS_INLINE i32 as_int() const { return static_cast<i32>(m_bits); }
+
+    ALWAYS_INLINE i64 as_long() const { return static_cast<i64>(m_bits); }
+
+    ALWAYS_INLINE float as_float() const { return bit_cast<float>(static_cast<u32>(m_bits)); }
+
+    ALWAYS_INLINE double as_double() const { return bit_cast<double>(m_bits); }
+
+    ALWAYS_INLINE Object* as_reference() const { return bit_cast<Object*>(static_cast<FlatPtr>(m_bits)); }
+
+private:
+    explicit Slot(u64 bits) : m_bits(bits) {}
+
+    u64 m_bits{};
+};
+
+static_assert(sizeof(Slot) == sizeof(u64));
+}
\ No newline at end of file
@@ -47,11 +47,23 @@ enum class PrimitiveType : u8
 };
 
 // TODO: returnAddress type?
-// TODO: reference type?
 
 #undef TYPEDEF_PRIMITIVE
 
-using Value = Variant<Byte, Short, Integer, Long, Char, Float, Double>;
+class Object;
+
+// 2.4 Reference Types and Values
+// "There are three kinds of reference types: class types, array types, and interface types. Their values are
+// references to dynamically created class instances, arrays, or class instances or arrays that implement interfaces,
+// respectively." "A reference value may also be the special null reference"
+struct Reference
+{
+    Object* object{};
+
+    bool is_null() const { return object == nullptr; }
+};
+
+using Value = Variant<Byte, Short, Integer, Long, Char, Float, Double, Reference>;
 }
 
 namespace AK
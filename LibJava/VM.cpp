@@ -1,12 +1,382 @@
+#include <AK/ScopeGuard.h>
 #include <LibJava/Descriptor.h>
+#include <LibJava/JIT/Compiler.h>
+#include <LibJava/JIT/OptimizingCompiler.h>
 #include <LibJava/Opcode.h>
+#include <LibJava/OperandStack.h>
+#include <LibJava/Verifier.h>
 #include <LibJava/VM.h>
 
+// By default, every instruction is dispatched through one big switch. With PERIL_THREADED_DISPATCH, the interpreter
+// uses direct threading instead: the end of each handler jumps straight to the handler of the next instruction. That
+// gives every handler its own indirect jump, which is far easier on the branch predictor than one shared by all of
+// them.
+// The handler of an instruction is found by going through the switch the first time it is executed, which patches the
+// handler into the threaded code so that it is skipped from then on.
+#ifdef PERIL_THREADED_DISPATCH
+#    define HANDLER(name)                                                                                              \
+        case Opcode::name:                                                                                             \
+            threaded_code[m_program_counter] = &&handle_##name;                                                        \
+        handle_##name
+#    define DISPATCH()                                                                                                 \
+        do                                                                                                             \
+        {                                                                                                              \
+            COUNT_INSTRUCTION();                                                                                       \
+            instruction = instructions.data() + m_program_counter;                                                     \
+            goto* threaded_code[m_program_counter];                                                                    \
+        } while (0)
+#    define NEXT()                                                                                                     \
+        do                                                                                                             \
+        {                                                                                                              \
+            m_program_counter++;                                                                                       \
+            DISPATCH();                                                                                                \
+        } while (0)
+#    define ADVANCE(count)                                                                                             \
+        do                                                                                                             \
+        {                                                                                                              \
+            m_program_counter += count;                                                                                \
+            DISPATCH();                                                                                                \
+        } while (0)
+#    define JUMP()                                                                                                     \
+        do                                                                                                             \
+        {                                                                                                              \
+            COUNT_BACKEDGE();                                                                                          \
+            DISPATCH();                                                                                                \
+        } while (0)
+// Executes the current instruction again, after it has been quickened.
+#    define REDISPATCH()                                                                                             \
+        do                                                                                                             \
+        {                                                                                                              \
+            threaded_code[m_program_counter] = &&dispatch_through_switch;                                              \
+            DISPATCH();                                                                                                \
+        } while (0)
+#else
+#    define HANDLER(name) case Opcode::name
+#    define NEXT() break
+#    define ADVANCE(count)                                                                                             \
+        {                                                                                                              \
+            m_program_counter += count;                                                                                \
+            continue;                                                                                                  \
+        }
+#    define JUMP()                                                                                                     \
+        {                                                                                                              \
+            COUNT_BACKEDGE();                                                                                          \
+            continue;                                                                                                  \
+        }
+#    define REDISPATCH() continue
+#endif
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+// In threaded dispatch, running off the end of the method is dispatched like an instruction too.
+#    define COUNT_INSTRUCTION()                                                                                        \
+        if (m_program_counter < instructions.size())                                                                   \
+            count_instruction(instructions[m_program_counter].opcode)
+#else
+#    define COUNT_INSTRUCTION()
+#endif
+
+// A branch to an instruction at or before itself is what closes a loop. If the method has been compiled while we were
+// running that loop, the rest of it runs in compiled code, on this very frame.
+#define COUNT_BACKEDGE()                                                                                               \
+    if (m_program_counter <= instruction - instructions.data())                                                        \
+    {                                                                                                                  \
+        if (auto osr_entry = count_backedge(method, instruction - instructions.data(), operand_stack.size()))          \
+        {                                                                                                              \
+            if (on_stack_replacement)                                                                                  \
+                on_stack_replacement(class_file, *method.method, instructions[m_program_counter].pc);                  \
+            m_program_counter = program_counter_to_return_to;                                                          \
+            return run_compiled_code(method, osr_entry, locals);                                                       \
+        }                                                                                                              \
+    }
+
 namespace Java
 {
+// There is no class library to load java/lang/Object from, but every class ends up with it as its superclass, so this
+// one is built in: public class java.lang.Object { public Object() {} }
+static constexpr u8 object_class_file[] = {
+    0xca, 0xfe, 0xba, 0xbe, 0x00, 0x00, 0x00, 0x34, // magic, minor_version, major_version (Java 8)
+    0x00, 0x06,                                     // constant_pool_count
+    0x01, 0x00, 0x10,                               // #1 Utf8
+    'j', 'a', 'v', 'a', '/', 'l', 'a', 'n', 'g', '/', 'O', 'b', 'j', 'e', 'c', 't',
+    0x07, 0x00, 0x01,                               // #2 Class #1
+    0x01, 0x00, 0x06, '<', 'i', 'n', 'i', 't', '>', // #3 Utf8
+    0x01, 0x00, 0x03, '(', ')', 'V',                // #4 Utf8
+    0x01, 0x00, 0x04, 'C', 'o', 'd', 'e',           // #5 Utf8
+    0x00, 0x21,                                     // access_flags: ACC_PUBLIC | ACC_SUPER
+    0x00, 0x02, 0x00, 0x00,                         // this_class, super_class (none)
+    0x00, 0x00, 0x00, 0x00,                         // interfaces_count, fields_count
+    0x00, 0x01,                                     // methods_count
+    0x00, 0x01, 0x00, 0x03, 0x00, 0x04,             // <init>: access_flags (ACC_PUBLIC), name_index, descriptor_index
+    0x00, 0x01,                                     // attributes_count
+    0x00, 0x05, 0x00, 0x00, 0x00, 0x0d,             // Code: attribute_name_index, attribute_length
+    0x00, 0x00, 0x00, 0x01,                         // max_stack, max_locals
+    0x00, 0x00, 0x00, 0x01, 0xb1,                   // code_length, code: return
+    0x00, 0x00, 0x00, 0x00,                         // exception_table_length, attributes_count
+    0x00, 0x00,                                     // attributes_count
+};
+
+// 6.5 getfield, putfield, invokespecial: "Otherwise, if objectref is null, the [...] instruction throws a
+// NullPointerException."
+ALWAYS_INLINE static ErrorOr<Object*> non_null(Object* object)
+{
+    if (!object)
+        return Error::from_string_literal("NullPointerException");
+
+    return object;
+}
+
+// 4.10.1.9 getfield, putfield: the object has to be of the class of the field reference, or of a subclass of it. The
+// verifier can't tell without loading classes, so it is checked here instead, before the offset of the field is used
+// on the object. An object of any other class has something else at that offset, if the object even reaches that far.
+ALWAYS_INLINE static ErrorOr<Object*> instance_of(Object* object, const ResolvedClass& resolved_class)
+{
+    TRY(non_null(object));
+    if (&object->resolved_class() != &resolved_class && !object->resolved_class().is_subclass_of(resolved_class))
+        return Error::from_string_literal("VerifyError: object is not of the class of the field");
+
+    return object;
+}
+
+// The quick forms of getfield and putfield have the class of the field reference as their second operand.
+ALWAYS_INLINE static const ResolvedClass& field_class(const DecodedCode& decoded_code, const Instruction& instruction)
+{
+    return *decoded_code.resolved_class(instruction.second_operand);
+}
+
+ALWAYS_INLINE static ErrorOr<void> get_field(OperandStack& operand_stack, const ResolvedClass& resolved_class,
+                                             FieldKind kind, u32 offset)
+{
+    auto* object = TRY(instance_of(operand_stack.pop_reference(), resolved_class));
+
+    // 2.3.4: booleans are stored as 0 and 1, so they are read back just like bytes.
+    switch (kind)
+    {
+        case FieldKind::Boolean:
+        case FieldKind::Byte:
+            operand_stack.push_int(object->read<i8>(offset));
+            break;
+        case FieldKind::Char:
+            operand_stack.push_int(object->read<u16>(offset));
+            break;
+        case FieldKind::Short:
+            operand_stack.push_int(object->read<i16>(offset));
+            break;
+        case FieldKind::Int:
+            operand_stack.push_int(object->read<i32>(offset));
+            break;
+        case FieldKind::Long:
+            operand_stack.push_long(object->read<i64>(offset));
+            break;
+        case FieldKind::Reference:
+            operand_stack.push_reference(object->read<Object*>(offset));
+            break;
+    }
+
+    return {};
+}
+
+ALWAYS_INLINE static ErrorOr<void> put_field(OperandStack& operand_stack, Heap& heap,
+                                             const ResolvedClass& resolved_class, FieldKind kind, u32 offset)
+{
+    auto value = kind == FieldKind::Long ? operand_stack.pop2() : operand_stack.pop();
+    auto* object = TRY(instance_of(operand_stack.pop_reference(), resolved_class));
+
+    switch (kind)
+    {
+        // 6.5 putfield: "If the field descriptor type is boolean, then the int value is narrowed by taking the bitwise
+        // AND of value and 1"
+        case FieldKind::Boolean:
+            object->write<u8>(offset, value.as_int() & 1);
+            break;
+        case FieldKind::Byte:
+            object->write<i8>(offset, static_cast<i8>(value.as_int()));
+            break;
+        // A char is stored as the same 16 bits as a short, it only differs in how it is read back.
+        case FieldKind::Char:
+        case FieldKind::Short:
+            object->write<i16>(offset, static_cast<i16>(value.as_int()));
+            break;
+        case FieldKind::Int:
+            object->write<i32>(offset, value.as_int());
+            break;
+        case FieldKind::Long:
+            object->write<i64>(offset, value.as_long());
+            break;
+        case FieldKind::Reference:
+            object->write<Object*>(offset, value.as_reference());
+            heap.record_reference_store(object, offset);
+            break;
+    }
+
+    return {};
+}
+
+// 6.5 iaload, iastore and the other array loads and stores: "If arrayref is null, [...] throws a
+// NullPointerException." "Otherwise, if index is not within the bounds of the array referenced by arrayref, [...]
+// throws an ArrayIndexOutOfBoundsException."
+ALWAYS_INLINE static ErrorOr<Array*> array_for_index(Object* object, i32 index)
+{
+    auto* array = static_cast<Array*>(TRY(non_null(object)));
+
+    // A negative index becomes larger than any length there can be.
+    if (static_cast<u32>(index) >= static_cast<u32>(array->length()))
+        return Error::from_string_literal("ArrayIndexOutOfBoundsException");
+
+    return array;
+}
+
+template<typename T>
+ALWAYS_INLINE static ErrorOr<T> load_element(OperandStack& operand_stack)
+{
+    auto index = operand_stack.pop_int();
+    auto* array = TRY(array_for_index(operand_stack.pop_reference(), index));
+    return array->element<T>(index);
+}
+
+template<typename T>
+ALWAYS_INLINE static ErrorOr<void> store_element(OperandStack& operand_stack, T value)
+{
+    auto index = operand_stack.pop_int();
+    auto* array = TRY(array_for_index(operand_stack.pop_reference(), index));
+    array->set_element<T>(index, value);
+    return {};
+}
+
+// 6.5 newarray: Table 6.5.newarray-A. Array type codes
+static ErrorOr<PrimitiveType> newarray_component_type(u8 array_type)
+{
+    switch (array_type)
+    {
+        case 4:
+            return PrimitiveType::Boolean;
+        case 5:
+            return PrimitiveType::Char;
+        case 6:
+            return PrimitiveType::Float;
+        case 7:
+            return PrimitiveType::Double;
+        case 8:
+            return PrimitiveType::Byte;
+        case 9:
+            return PrimitiveType::Short;
+        case 10:
+            return PrimitiveType::Int;
+        case 11:
+            return PrimitiveType::Long;
+        default:
+            return Error::from_string_literal("Invalid array type in newarray");
+    }
+}
+
+// The verifier has only proven a method right for arguments of the types its descriptor says, so those are the only
+// ones it may be called with.
+static bool is_argument_of_type(const Value& argument, const FieldDescriptor& parameter)
+{
+    if (parameter.array_dimensions() > 0 || !parameter.type().has<PrimitiveType>())
+        return argument.has<Reference>();
+
+    switch (parameter.type().get<PrimitiveType>())
+    {
+        case PrimitiveType::Byte:
+            return argument.has<Byte>();
+        case PrimitiveType::Short:
+            return argument.has<Short>();
+        case PrimitiveType::Char:
+            return argument.has<Char>();
+        case PrimitiveType::Long:
+            return argument.has<Long>();
+        case PrimitiveType::Float:
+            return argument.has<Float>();
+        case PrimitiveType::Double:
+            return argument.has<Double>();
+        default:
+            return argument.has<Integer>();
+    }
+}
+
+static Opcode getfield_quick_opcode(FieldKind kind)
+{
+    switch (kind)
+    {
+        case FieldKind::Boolean:
+        case FieldKind::Byte:
+            return Opcode::getfield_byte_quick;
+        case FieldKind::Char:
+            return Opcode::getfield_char_quick;
+        case FieldKind::Short:
+            return Opcode::getfield_short_quick;
+        case FieldKind::Int:
+            return Opcode::getfield_quick;
+        case FieldKind::Long:
+            return Opcode::getfield2_quick;
+        case FieldKind::Reference:
+            return Opcode::getfield_reference_quick;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+static Opcode putfield_quick_opcode(FieldKind kind)
+{
+    switch (kind)
+    {
+        case FieldKind::Boolean:
+            return Opcode::putfield_boolean_quick;
+        case FieldKind::Byte:
+            return Opcode::putfield_byte_quick;
+        case FieldKind::Char:
+        case FieldKind::Short:
+            return Opcode::putfield_short_quick;
+        case FieldKind::Int:
+            return Opcode::putfield_quick;
+        case FieldKind::Long:
+            return Opcode::putfield2_quick;
+        case FieldKind::Reference:
+            return Opcode::putfield_reference_quick;
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+VM::VM()
+{
+    m_stack.resize(stack_size_in_slots);
+    m_stack_top = m_stack.data();
+
+    // Every frame is on the one stack, and nothing else can hold a reference yet.
+    m_heap.gather_roots = [this] {
+        Heap::Roots roots;
+        // A frame ends where the next one starts, which takes the arguments it passed to the next one along with it.
+        auto* end = m_stack_top;
+        for (auto* frame = m_current_frame; frame; end = frame->locals, frame = frame->caller)
+        {
+            if (frame->safepoint == Frame::without_references)
+                continue;
+
+            auto& reference_maps = frame->method->reference_maps;
+            if (frame->safepoint == Frame::unknown_safepoint || !reference_maps)
+            {
+                roots.ambiguous.append(Span<Slot>(frame->locals, end - frame->locals));
+                continue;
+            }
+
+            for (auto slot : reference_maps->at(frame->safepoint))
+            {
+                if (frame->locals + slot < end)
+                    roots.precise.append(frame->locals + slot);
+            }
+        }
+        return roots;
+    };
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+    m_opcode_pair_counts.resize(256 * 256);
+#endif
+}
+
 ErrorOr<void> VM::initialize_class(const ClassFile& class_file)
 {
-    if (m_static_data.contains(class_file))
+    if (m_static_data.contains(&class_file))
         return {};
 
     StaticData static_data;
@@ -15,7 +385,6 @@ ErrorOr<void> VM::initialize_class(const ClassFile& class_file)
     {
         if (has_flag(field.access_flags, ClassFile::FieldInfo::AccessFlags::Static))
         {
-            auto& name = class_file.constant_pool()[field.name_index - 1].get<ClassFile::Utf8>();
             auto& descriptor_string = class_file.constant_pool()[field.descriptor_index - 1].get<ClassFile::Utf8>();
             auto descriptor = TRY(FieldDescriptor::try_parse(descriptor_string.value));
 
@@ -37,83 +406,301 @@ ErrorOr<void> VM::initialize_class(const ClassFile& class_file)
             if (!descriptor.type().has<PrimitiveType>())
                 return Error::from_string_literal("No support for String ConstantValue");
 
-            switch (descriptor.type().get<PrimitiveType>())
-            {
-                case PrimitiveType::Byte:
-                    // Booleans are just Bytes in disguise!
-                case PrimitiveType::Boolean:
-                    static_data.fields.set(
-                        name.value, initial_value.has_value() ? Byte(initial_value.value().get<Integer>().value()) : 0);
-                    break;
-                case PrimitiveType::Short:
-                    static_data.fields.set(name.value, initial_value.has_value()
-                                                           ? Short(initial_value.value().get<Integer>().value())
-                                                           : 0);
-                    break;
-                case PrimitiveType::Int:
-                    static_data.fields.set(name.value, initial_value.has_value()
-                                                           ? Integer(initial_value.value().get<Integer>().value())
-                                                           : 0);
-                    break;
-                case PrimitiveType::Long:
-                    static_data.fields.set(
-                        name.value, initial_value.has_value() ? Long(initial_value.value().get<Long>().value()) : 0);
-                    break;
-                case PrimitiveType::Char:
-                    static_data.fields.set(
-                        name.value, initial_value.has_value() ? Char(initial_value.value().get<Integer>().value()) : 0);
-                    break;
-                case PrimitiveType::Float:
-                    static_data.fields.set(
-                        name.value, initial_value.has_value() ? Float(initial_value.value().get<Float>().value()) : 0);
-                    break;
-                case PrimitiveType::Double:
-                    static_data.fields.set(name.value, initial_value.has_value()
-                                                           ? Double(initial_value.value().get<Double>().value())
-                                                           : 0);
-                    break;
-                default:
-                    return Error::from_string_literal("Invalid primitive type in ConstantValue");
-            }
+            // 4.7.2: The ConstantValue of a boolean, byte, char, short or int field is an Integer, which is exactly
+            // what we operate on them as. Without one, a field starts out as zero, which is all zero bits for any type.
+            static_data.fields.append(initial_value.has_value() ? Slot::from_value(initial_value.value()) : Slot{});
         }
     }
 
-    m_static_data.set(class_file, move(static_data));
+    m_static_data.set(&class_file, move(static_data));
+
+    // 2.9.2 "[...] the method has the special name <clinit>, takes no arguments, and is void"
+    // "Other methods named <clinit> in a class file are of no consequence."
+    // TODO: In a class file whose version number is 51.0 or above, the method has its
+    //       ACC_STATIC flag set and takes no arguments (§4.6).
+    if (auto* class_initialization_method = class_file.find_method("<clinit>"sv, "()V"sv))
+        TRY(call(class_file, *class_initialization_method));
+
+    return {};
+}
+
+ErrorOr<const ClassFile*> VM::resolve_class(StringView name)
+{
+    if (auto it = m_resolved_classes.find(name); it != m_resolved_classes.end())
+        return it->value.ptr();
+
+    Optional<size_t> class_index;
+    if (m_class_archive)
+        class_index = m_class_archive->find(name);
 
-    for (auto& method : class_file.methods())
+    RefPtr<ClassFile> class_file;
+    if (name == "java/lang/Object"sv)
     {
-        auto& method_name = class_file.constant_pool()[method.name_index - 1].get<ClassFile::Utf8>();
+        class_file = TRY(ClassFile::try_parse_unowned({object_class_file, sizeof(object_class_file)}));
+    }
+    else if (is_native_class(name))
+    {
+        class_file = TRY(try_create_native_class_file(name));
+    }
+    else if (class_index.has_value())
+    {
+        class_file = TRY(m_class_archive->try_load(*class_index));
+        m_archived_classes.set(class_file.ptr(), *class_index);
+    }
+    else
+    {
+        class_file = TRY(on_resolve_class_file_externally(name));
+    }
 
-        if (method_name.value == "<clinit>"sv)
-        {
-            auto& descriptor_string = class_file.constant_pool()[method.descriptor_index - 1].get<ClassFile::Utf8>();
-            auto descriptor = TRY(MethodDescriptor::try_parse(descriptor_string.value));
+    auto& resolved_class_file = *class_file;
+    m_resolved_classes.set(name, class_file.release_nonnull());
 
-            if (!descriptor.return_type().has<Empty>())
-                return Error::from_string_literal("Class initilization method must have no return value");
+    TRY(initialize_class(resolved_class_file));
+    return &resolved_class_file;
+}
 
-            // TODO: In a class file whose version number is 51.0 or above, the method has its
-            //       ACC_STATIC flag set and takes no arguments (§4.6).
+ErrorOr<const ResolvedClass*> VM::lay_out_class(const ClassFile& class_file)
+{
+    if (auto it = m_class_layouts.find(&class_file); it != m_class_layouts.end())
+        return it->value.ptr();
 
-            TRY(call(class_file, method));
-            break;
-        }
+    const ResolvedClass* super_class = nullptr;
+    if (class_file.has_super_class())
+    {
+        auto& super_class_name =
+            class_file.constant_pool()[class_file.super_class().name_index - 1].get<ClassFile::Utf8>();
+        super_class = TRY(lay_out_class(*TRY(resolve_class(super_class_name.value))));
     }
 
-    return {};
+    auto resolved_class = TRY(ResolvedClass::try_create(class_file, super_class));
+    auto* resolved_class_pointer = resolved_class.ptr();
+    m_heap.register_class(*resolved_class);
+    m_class_layouts.set(&class_file, move(resolved_class));
+    return resolved_class_pointer;
+}
+
+ErrorOr<const ResolvedClass*> VM::resolve_class_to_instantiate(const ClassFile& class_file, u16 class_index)
+{
+    auto& class_to_instantiate = class_file.constant_pool()[class_index - 1].get<ClassFile::Class>();
+    auto& class_to_instantiate_name =
+        class_file.constant_pool()[class_to_instantiate.name_index - 1].get<ClassFile::Utf8>();
+
+    auto* resolved_class = TRY(resolve_class(class_to_instantiate_name.value));
+
+    // 6.5 new: "if the symbolic reference to the class, array, or interface type resolves to an interface or an
+    // abstract class, new throws an InstantiationError."
+    if (has_flag(resolved_class->access_flags(), ClassFile::AccessFlags::Interface) ||
+        has_flag(resolved_class->access_flags(), ClassFile::AccessFlags::Abstract))
+        return Error::from_string_literal("InstantiationError");
+
+    return lay_out_class(*resolved_class);
+}
+
+ErrorOr<const ResolvedClass*> VM::resolve_primitive_array_class(PrimitiveType component_type)
+{
+    auto& array_class = m_primitive_array_classes[to_underlying(component_type)];
+    if (!array_class)
+    {
+        auto* object_class = TRY(lay_out_class(*TRY(resolve_class("java/lang/Object"sv))));
+        array_class = ResolvedClass::create_primitive_array(component_type, *object_class);
+        m_heap.register_class(*array_class);
+    }
+
+    return array_class.ptr();
+}
+
+ErrorOr<VM::ResolvedField> VM::resolve_field(const ClassFile& class_file, u16 field_ref_index)
+{
+    auto& field_ref = class_file.constant_pool()[field_ref_index - 1].get<ClassFile::FieldRef>();
+    auto& class_of_field = class_file.constant_pool()[field_ref.class_index - 1].get<ClassFile::Class>();
+    auto& class_of_field_name = class_file.constant_pool()[class_of_field.name_index - 1].get<ClassFile::Utf8>();
+
+    auto& field_name_and_type =
+        class_file.constant_pool()[field_ref.name_and_type_index - 1].get<ClassFile::NameAndType>();
+    auto& field_name = class_file.constant_pool()[field_name_and_type.name_index - 1].get<ClassFile::Utf8>();
+    auto& field_descriptor =
+        class_file.constant_pool()[field_name_and_type.descriptor_index - 1].get<ClassFile::Utf8>();
+
+    auto* resolved_class = TRY(lay_out_class(*TRY(resolve_class(class_of_field_name.value))));
+
+    // Static fields aren't laid out into objects, so a getfield or putfield on one gets a NoSuchFieldError here,
+    // where 6.5 asks for an IncompatibleClassChangeError.
+    auto* field = resolved_class->find_field(field_name.value, field_descriptor.value);
+    if (!field)
+        return Error::from_string_literal("NoSuchFieldError");
+
+    return ResolvedField{resolved_class, field};
 }
 
-ErrorOr<ClassFile*> VM::resolve_class(StringView name)
+ErrorOr<VM::ResolvedStaticField> VM::resolve_static_field(const ClassFile& class_file, u16 field_ref_index)
 {
-    if (m_resolved_classes.contains(name))
-        return &m_resolved_classes.find(name)->value;
+    auto& field_ref = class_file.constant_pool()[field_ref_index - 1].get<ClassFile::FieldRef>();
+    auto& class_of_field = class_file.constant_pool()[field_ref.class_index - 1].get<ClassFile::Class>();
+    auto& class_of_field_name = class_file.constant_pool()[class_of_field.name_index - 1].get<ClassFile::Utf8>();
+
+    auto& field_name_and_type =
+        class_file.constant_pool()[field_ref.name_and_type_index - 1].get<ClassFile::NameAndType>();
+    auto& field_name = class_file.constant_pool()[field_name_and_type.name_index - 1].get<ClassFile::Utf8>();
+    auto& field_descriptor_string =
+        class_file.constant_pool()[field_name_and_type.descriptor_index - 1].get<ClassFile::Utf8>();
+    auto field_descriptor = TRY(FieldDescriptor::try_parse(field_descriptor_string.value));
+
+    auto resolved_class_of_field = TRY(resolve_class(class_of_field_name.value));
+
+    // 5.4.3.2 Field Resolution
+    // FIXME: Look at superinterfaces and superclasses as well
+    auto& static_fields = m_static_data.find(resolved_class_of_field)->value.fields;
+    size_t static_field_index = 0;
+    for (auto& field : resolved_class_of_field->fields())
+    {
+        if (!has_flag(field.access_flags, ClassFile::FieldInfo::AccessFlags::Static))
+            continue;
+
+        auto& name = resolved_class_of_field->constant_pool()[field.name_index - 1].get<ClassFile::Utf8>();
+        auto& descriptor = resolved_class_of_field->constant_pool()[field.descriptor_index - 1].get<ClassFile::Utf8>();
+        if (name.value == field_name.value && descriptor.value == field_descriptor_string.value)
+            return ResolvedStaticField{&static_fields[static_field_index], field_descriptor.is_category_2()};
+
+        static_field_index++;
+    }
+
+    return Error::from_string_literal("NoSuchFieldError");
+}
+
+ErrorOr<ResolvedMethod*> VM::resolve_method_ref(const ClassFile& class_file, u16 method_ref_index)
+{
+    auto& method_ref = class_file.constant_pool()[method_ref_index - 1].get<ClassFile::MethodRef>();
+    auto& class_of_method = class_file.constant_pool()[method_ref.class_index - 1].get<ClassFile::Class>();
+    auto& class_of_method_name = class_file.constant_pool()[class_of_method.name_index - 1].get<ClassFile::Utf8>();
+
+    auto& method_name_and_type =
+        class_file.constant_pool()[method_ref.name_and_type_index - 1].get<ClassFile::NameAndType>();
+    auto& method_name = class_file.constant_pool()[method_name_and_type.name_index - 1].get<ClassFile::Utf8>();
+    auto& method_descriptor =
+        class_file.constant_pool()[method_name_and_type.descriptor_index - 1].get<ClassFile::Utf8>();
+
+    // 5.4.3.3 Method Resolution
+    // "Otherwise, if C declares a method with the name and descriptor specified by the method reference, method
+    // lookup succeeds." "Otherwise, if C has a superclass, step 2 of method resolution is recursively invoked on the
+    // direct superclass of C."
+    // FIXME: Look at superinterfaces as well
+    auto* resolved_class = TRY(resolve_class(class_of_method_name.value));
+    while (true)
+    {
+        if (auto* method = resolved_class->find_method(method_name.value, method_descriptor.value))
+            return resolve_method(*resolved_class, *method);
+
+        if (!resolved_class->has_super_class())
+            return Error::from_string_literal("NoSuchMethodError");
+
+        auto& super_class_name =
+            resolved_class->constant_pool()[resolved_class->super_class().name_index - 1].get<ClassFile::Utf8>();
+        resolved_class = TRY(resolve_class(super_class_name.value));
+    }
+}
+
+ErrorOr<DecodedCode*> VM::link(const ClassFile& class_file, const ClassFile::MethodInfo& method)
+{
+    // 5.4 "[...] an implementation may choose to resolve each symbolic reference in a class or interface
+    // individually when it is used ("lazy" or "late" resolution)"
+    // We do the same for translating Code into DecodedCode, as most methods of a class are never executed.
+    auto& code = *TRY(method.code(class_file));
+    if (auto it = m_decoded_code.find(&code); it != m_decoded_code.end())
+        return it->value.ptr();
+
+    auto decoded_code = make<DecodedCode>(TRY(DecodedCode::try_decode(code)));
+
+    // 5.4.1: "Verification ensures that the binary representation of a class or interface is structurally correct",
+    // which nothing after this checks again. It has to see the code before it is fused or quickened.
+    // A class from the archive was verified when the archive was made, which left the reference maps in it.
+    if (auto class_index = m_archived_classes.get(&class_file); class_index.has_value())
+    {
+        auto method_index = &method - class_file.methods().data();
+        auto reference_maps =
+            TRY(m_class_archive->try_create_reference_maps(*class_index, method_index, *decoded_code));
+        m_reference_maps.set(&code, move(reference_maps));
+    }
+    else
+    {
+        auto frames = TRY(Verifier::verify(class_file, method, *decoded_code));
+        m_reference_maps.set(&code, ReferenceMaps::create(*decoded_code, frames));
+    }
+
+    if (m_superinstructions_enabled)
+        decoded_code->fuse_superinstructions(class_file);
+
+    auto* decoded_code_pointer = decoded_code.ptr();
+    m_decoded_code.set(&code, move(decoded_code));
+    return decoded_code_pointer;
+}
 
-    auto externally_resolved_class = TRY(on_resolve_class_file_externally(name));
-    m_resolved_classes.set(name, move(externally_resolved_class));
+ErrorOr<ResolvedMethod*> VM::resolve_method(const ClassFile& class_file, const ClassFile::MethodInfo& method)
+{
+    if (auto it = m_resolved_methods.find(&method); it != m_resolved_methods.end())
+        return it->value.ptr();
+
+    auto resolved_method = make<ResolvedMethod>();
+    resolved_method->class_file = &class_file;
+    resolved_method->method = &method;
+
+    auto& descriptor_string = class_file.constant_pool()[method.descriptor_index - 1].get<ClassFile::Utf8>();
+    if (has_flag(method.access_flags, ClassFile::MethodInfo::AccessFlags::Native))
+    {
+        auto& class_name = class_file.constant_pool()[class_file.this_class().name_index - 1].get<ClassFile::Utf8>();
+        auto& name = class_file.constant_pool()[method.name_index - 1].get<ClassFile::Utf8>();
+        resolved_method->native_method = find_native_method(class_name.value, name.value, descriptor_string.value);
+        if (!resolved_method->native_method)
+            return Error::from_string_literal("UnsatisfiedLinkError");
+    }
+    else
+    {
+        if (!method.has_code())
+            return Error::from_string_literal("Method to execute has no Code attribute");
+
+        resolved_method->code = TRY(method.code(class_file));
+        resolved_method->decoded_code = TRY(link(class_file, method));
+        resolved_method->reference_maps = m_reference_maps.find(resolved_method->code)->value.ptr();
+    }
+
+    resolved_method->descriptor = TRY(MethodDescriptor::try_parse(descriptor_string.value));
+    // 2.6.1: "On instance method invocation, local variable 0 is always used to pass a reference to the object on
+    // which the instance method is being invoked"
+    resolved_method->argument_slots = resolved_method->descriptor.parameter_slot_count();
+    if (!has_flag(method.access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+        resolved_method->argument_slots++;
+
+    auto& return_type = resolved_method->descriptor.return_type();
+    if (!return_type.has<FieldDescriptor>())
+        resolved_method->return_kind = ResolvedMethod::ReturnKind::Void;
+    else if (return_type.get<FieldDescriptor>().is_category_2())
+        resolved_method->return_kind = ResolvedMethod::ReturnKind::Category2;
+    else
+        resolved_method->return_kind = ResolvedMethod::ReturnKind::Category1;
+
+    // The profile outlives the ResolvedMethod, so that it stays around if we ever throw away and redo the latter.
+    auto profile = m_method_profiles.find(&method);
+    if (profile == m_method_profiles.end())
+    {
+        auto new_profile = make<MethodProfile>();
+        if (resolved_method->decoded_code)
+            new_profile->backedge_counts.resize(resolved_method->decoded_code->instructions().size());
+        m_method_profiles.set(&method, move(new_profile));
+        profile = m_method_profiles.find(&method);
+    }
+    resolved_method->profile = profile->value.ptr();
 
-    auto& externally_resolved_class_file_ref = m_resolved_classes.find(name)->value;
-    TRY(initialize_class(externally_resolved_class_file_ref));
-    return &externally_resolved_class_file_ref;
+    auto* resolved_method_pointer = resolved_method.ptr();
+    m_resolved_methods.set(&method, move(resolved_method));
+    return resolved_method_pointer;
+}
+
+const MethodProfile* VM::profile(const ClassFile::MethodInfo& method) const
+{
+    auto it = m_method_profiles.find(&method);
+    if (it == m_method_profiles.end())
+        return nullptr;
+
+    return it->value.ptr();
 }
 
 ErrorOr<Value> VM::call(const ClassFile& class_file, const ClassFile::MethodInfo& method, Span<Value> arguments)
@@ -121,716 +708,1212 @@ ErrorOr<Value> VM::call(const ClassFile& class_file, const ClassFile::MethodInfo
     auto& class_name = class_file.constant_pool()[class_file.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
     if (!m_resolved_classes.contains(class_name.value))
     {
+        // The class is shared with whoever gave it to us instead of copied, so anything its code resolves finds this
+        // very one, along with its statics.
         m_resolved_classes.set(class_name.value, class_file);
         TRY(initialize_class(class_file));
     }
 
-    if (!method.code.has_value())
-        return Error::from_string_literal("Method to execute has no Code attribute");
+    auto& resolved_method = *TRY(resolve_method(class_file, method));
+
+    // The object an instance method is invoked on comes first, as with invokevirtual.
+    size_t first_parameter = 0;
+    if (!has_flag(method.access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+    {
+        if (arguments.is_empty() || !arguments[0].has<Reference>())
+            return Error::from_string_literal("IllegalArgumentException");
+        first_parameter = 1;
+    }
+
+    auto& parameters = resolved_method.descriptor.parameters();
+    if (arguments.size() - first_parameter != parameters.size())
+        return Error::from_string_literal("IllegalArgumentException");
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        if (!is_argument_of_type(arguments[first_parameter + i], parameters[i]))
+            return Error::from_string_literal("IllegalArgumentException");
+    }
+
+    // Lay the arguments out on top of the stack the same way invokestatic would find them on its operand stack.
+    auto* locals = m_stack_top;
+    auto* slot = locals;
+    for (auto& argument : arguments)
+    {
+        auto slots = argument.has<Long>() || argument.has<Double>() ? 2 : 1;
+        if (slot + slots > m_stack.data() + m_stack.size())
+            return Error::from_string_literal("StackOverflowError");
+
+        *slot = Slot::from_value(argument);
+        slot += slots;
+    }
+
+    auto return_value = TRY(execute(resolved_method, locals));
+
+    // TODO: return null?
+    if (resolved_method.return_kind == ResolvedMethod::ReturnKind::Void)
+        return Integer(0);
+
+    auto& return_type = resolved_method.descriptor.return_type().get<FieldDescriptor>();
+    if (!return_type.type().has<PrimitiveType>() || return_type.array_dimensions() > 0)
+        return Reference{return_value.as_reference()};
 
-    auto code = method.code.value();
+    return return_value.to_value(return_type.type().get<PrimitiveType>());
+}
+
+void VM::transition_tier(ResolvedMethod& method, Tier tier)
+{
+    auto previous_tier = method.profile->tier;
+    method.profile->tier = tier;
 
-    Frame frame;
+    if (on_tier_transition)
+        on_tier_transition(*method.class_file, *method.method, previous_tier, tier);
+}
 
-    // TODO: wtf is this!
-    //       can't resize because no default construction, but this is worse!
+void VM::update_tier(ResolvedMethod& method)
+{
+    auto& profile = *method.profile;
 
-    for (auto i = 0; i < code->max_locals; i++)
-        frame.locals.append(Byte(0));
+    if (profile.tier == Tier::Interpreter && has_reached(profile, m_tiering_policy.quickened_interpreter))
+        transition_tier(method, Tier::QuickenedInterpreter);
 
-    auto argument_index = 0;
-    for (auto& arg : arguments)
+#if ARCH(X86_64)
+    if (should_compile(profile))
     {
-        frame.locals[argument_index] = move(arg);
-        argument_index++;
+        auto compiled_code = JIT::Compiler::compile(*this, method, optimize_at_backedges(profile));
+        if (compiled_code.is_error())
+        {
+            // Not being able to compile a method is perfectly fine, it just stays in the interpreter.
+            profile.is_compilable = false;
+            return;
+        }
+
+        method.compiled_code = compiled_code.release_value();
+        transition_tier(method, Tier::Compiled);
     }
 
-    m_stack.append(frame);
+    if (should_optimize(profile))
+        optimize(method);
+#endif
+}
 
-    Vector<Value> operand_stack;
+void VM::optimize(ResolvedMethod& method)
+{
+    auto& profile = *method.profile;
+
+    // Baseline code that is replaced may still be running further up the stack, so it is retired like deoptimized code.
+    auto optimized_code = JIT::OptimizingCompiler::compile(method, [this](const JIT::IR::InlinedCall& inlined_call) {
+        if (!on_inline)
+            return;
+
+        auto& caller = *inlined_call.caller;
+        auto& callee = *inlined_call.callee;
+        // Fusing only ever changes the opcode of the first instruction of a sequence, never where any of them are.
+        auto pc = caller.decoded_code->instructions()[inlined_call.instruction_index].pc;
+        on_inline(*caller.class_file, *caller.method, pc, *callee.class_file, *callee.method);
+    });
+    if (optimized_code.is_error())
+    {
+        // The method stays in baseline code, which has to stop asking to be optimized.
+        profile.is_optimizable = false;
+        auto compiled_code = JIT::Compiler::compile(*this, method);
+        if (compiled_code.is_error())
+        {
+            deoptimize(method, *method.compiled_code);
+            return;
+        }
+
+        m_retired_compiled_code.append(method.compiled_code.release_nonnull());
+        method.compiled_code = compiled_code.release_value();
+        return;
+    }
+
+    m_retired_compiled_code.append(method.compiled_code.release_nonnull());
+    method.compiled_code = optimized_code.release_value();
+    transition_tier(method, Tier::Optimized);
+}
+
+ErrorOr<void> VM::invoke(ResolvedMethod& method, OperandStack& operand_stack)
+{
+    // The arguments are already sitting on top of our operand stack, which is exactly where the local variables of the
+    // callee start. For instance methods, that includes the object they are invoked on.
+    auto return_value = TRY(execute(method, operand_stack.top() - method.argument_slots));
+
+    operand_stack.drop(method.argument_slots);
+
+    if (method.return_kind == ResolvedMethod::ReturnKind::Category1)
+        operand_stack.push(return_value);
+    else if (method.return_kind == ResolvedMethod::ReturnKind::Category2)
+        operand_stack.push2(return_value);
+
+    return {};
+}
+
+bool VM::invoke_from_compiled_code(VM* vm, ResolvedMethod* method, Slot* arguments)
+{
+    auto return_value = vm->execute(*method, arguments);
+    if (return_value.is_error())
+    {
+        vm->m_compiled_code_error = return_value.release_error();
+        return false;
+    }
+
+    *arguments = return_value.release_value();
+    return true;
+}
+
+bool VM::allocate_from_compiled_code(VM* vm, const ResolvedClass* resolved_class, Slot* result)
+{
+    auto object = vm->allocate_object(*resolved_class);
+    if (object.is_error())
+    {
+        vm->m_compiled_code_error = object.release_error();
+        return false;
+    }
+
+    *result = Slot::from_reference(object.release_value());
+    return true;
+}
+
+bool VM::allocate_array_from_compiled_code(VM* vm, const ResolvedClass* array_class, i32 length, Slot* result)
+{
+    auto array = vm->allocate_array(*array_class, length);
+    if (array.is_error())
+    {
+        vm->m_compiled_code_error = array.release_error();
+        return false;
+    }
+
+    *result = Slot::from_reference(array.release_value());
+    return true;
+}
+
+bool VM::is_subclass_from_compiled_code(const ResolvedClass* resolved_class, const ResolvedClass* of)
+{
+    return resolved_class->is_subclass_of(*of);
+}
+
+ErrorOr<Slot> VM::execute(ResolvedMethod& method, Slot* locals)
+{
+    // Native methods don't need a frame, nor do they ever move between tiers.
+    if (method.native_method)
+        return method.native_method(locals);
+
+    // 2.5.2 "If the computation in a thread requires a larger Java Virtual Machine stack than is permitted, the Java
+    // Virtual Machine throws a StackOverflowError."
+    auto* frame_end = locals + method.code->max_locals + method.code->max_stacks;
+    if (frame_end > m_stack.data() + m_stack.size() || m_native_stack.size_free() < native_stack_reserve)
+        return Error::from_string_literal("StackOverflowError");
+
+    Frame frame{m_current_frame, method.class_file, locals, &method};
+    auto* stack_top_to_return_to = m_stack_top;
+    m_current_frame = &frame;
+    m_stack_top = frame_end;
+
+    ScopeGuard pop_frame([&] {
+        m_current_frame = frame.caller;
+        m_stack_top = stack_top_to_return_to;
+    });
+
+    method.profile->invocation_count++;
+    update_tier(method);
+
+    if (method.profile->tier < Tier::Compiled)
+        return interpret(method, locals);
+
+    return run_compiled_code(method, method.compiled_code->entry(), locals);
+}
+
+ErrorOr<Slot> VM::run_compiled_code(ResolvedMethod& method, JIT::CompiledCode::Entry entry, Slot* locals)
+{
+    // The method may get compiled again while this runs, by a call further down the stack.
+    auto& compiled_code = *method.compiled_code;
+
+    // Optimized code only ever keeps ints in the frame, so there is nothing in there for the garbage collector to
+    // look at, whichever call it is in. Baseline code says where it is itself, like the interpreter.
+    if (method.profile->tier == Tier::Optimized)
+        m_current_frame->safepoint = Frame::without_references;
+
+    Slot result;
+    switch (entry(locals, &result, this))
+    {
+        case JIT::CompiledCode::Exit::Returned:
+            return result;
+        case JIT::CompiledCode::Exit::Failed:
+            return m_compiled_code_error.release_value();
+        case JIT::CompiledCode::Exit::Deoptimized:
+        {
+            // The frame is laid out the same way for both, so the interpreter can carry on right where the compiled
+            // code stopped.
+            auto deoptimization = JIT::CompiledCode::Deoptimization::decode(result);
+            deoptimize(method, compiled_code);
+            return interpret(method, locals, deoptimization.instruction_index, deoptimization.stack_depth);
+        }
+        case JIT::CompiledCode::Exit::Optimize:
+        {
+            auto resume_at = JIT::CompiledCode::Deoptimization::decode(result);
+            if (method.profile->tier == Tier::Compiled && method.compiled_code.ptr() == &compiled_code)
+                optimize(method);
+
+            // Whatever the method runs in now picks the frame up at the loop header, the same way it would from the
+            // interpreter.
+            if (method.profile->tier >= Tier::Compiled)
+            {
+                auto* compiled = method.compiled_code.ptr();
+                if (auto osr_entry = compiled->osr_entry(resume_at.instruction_index, resume_at.stack_depth))
+                {
+                    if (on_stack_replacement)
+                        on_stack_replacement(*method.class_file, *method.method,
+                                             method.decoded_code->instructions()[resume_at.instruction_index].pc);
+                    return run_compiled_code(method, osr_entry, locals);
+                }
+            }
+
+            return interpret(method, locals, resume_at.instruction_index, resume_at.stack_depth);
+        }
+    }
+
+    VERIFY_NOT_REACHED();
+}
+
+void VM::deoptimize(ResolvedMethod& method, const JIT::CompiledCode& compiled_code)
+{
+    auto& profile = *method.profile;
+
+    // Some other frame may have gotten the method compiled again in the meantime.
+    if (profile.tier < Tier::Compiled || method.compiled_code.ptr() != &compiled_code)
+        return;
+
+    m_retired_compiled_code.append(method.compiled_code.release_nonnull());
+    profile.deoptimizations++;
+    if (profile.deoptimizations >= max_deoptimizations)
+        profile.is_compilable = false;
+
+    transition_tier(method, Tier::QuickenedInterpreter);
+}
+
+ErrorOr<Slot> VM::interpret(ResolvedMethod& method, Slot* locals, u32 start_at, u16 stack_depth)
+{
+    auto& class_file = *method.class_file;
+    auto* code = method.code;
+    auto& decoded_code = *method.decoded_code;
+    auto& instructions = decoded_code.instructions();
+
+    OperandStack operand_stack(locals + code->max_locals, stack_depth);
 
     auto program_counter_to_return_to = m_program_counter;
-    m_program_counter = 0;
+    m_program_counter = start_at;
 
-    while (m_program_counter < code->code.size())
+    // Anything that may collect garbage looks up what is in the slots of this frame by the instruction it is at.
+    auto enter_safepoint = [&] { m_current_frame->safepoint = m_program_counter; };
+
+#ifdef PERIL_THREADED_DISPATCH
+    auto& threaded_code = decoded_code.threaded_code();
+    if (threaded_code.is_empty())
     {
-        auto opcode = static_cast<Opcode>(code->code[m_program_counter]);
+        // There is one more entry than there are instructions, so running off the end doesn't need a bounds check.
+        threaded_code.ensure_capacity(instructions.size() + 1);
+        for (size_t i = 0; i < instructions.size(); i++)
+            threaded_code.unchecked_append(&&dispatch_through_switch);
+        threaded_code.unchecked_append(&&reached_end);
+    }
+#endif
 
-        // TODO: type safety! (store ops should do type checking)
-        switch (opcode)
+    while (m_program_counter < instructions.size())
+    {
+        COUNT_INSTRUCTION();
+        auto* instruction = &instructions[m_program_counter];
+
+#ifdef PERIL_THREADED_DISPATCH
+    dispatch_through_switch:
+#endif
+        // Slots don't carry their type, the opcode tells us what is in them. That the two agree is what the verifier
+        // proved when the method was linked (4.10), so nothing here checks again.
+        switch (instruction->opcode)
         {
-            case Opcode::nop:
-                break;
-            case Opcode::iconst_m1:
-                operand_stack.append(Integer(-1));
-                break;
-            case Opcode::iconst_0:
-                operand_stack.append(Integer(0));
-                break;
-            case Opcode::iconst_1:
-                operand_stack.append(Integer(1));
-                break;
-            case Opcode::iconst_2:
-                operand_stack.append(Integer(2));
-                break;
-            case Opcode::iconst_3:
-                operand_stack.append(Integer(3));
-                break;
-            case Opcode::iconst_4:
-                operand_stack.append(Integer(4));
-                break;
-            case Opcode::iconst_5:
-                operand_stack.append(Integer(5));
-                break;
-            case Opcode::lconst_0:
-                operand_stack.append(Long(0));
-                break;
-            case Opcode::lconst_1:
-                operand_stack.append(Long(1));
-                break;
-            case Opcode::dconst_0:
-                operand_stack.append(Double(0));
-                break;
-            case Opcode::dconst_1:
-                operand_stack.append(Double(1));
-                break;
-            case Opcode::istore_0:
-                frame.locals[0] = operand_stack.take_first();
-                break;
-            case Opcode::istore_1:
-                frame.locals[1] = operand_stack.take_first();
-                break;
-            case Opcode::istore_2:
-                frame.locals[2] = operand_stack.take_first();
-                break;
-            case Opcode::istore_3:
-                frame.locals[3] = operand_stack.take_first();
-                break;
-            case Opcode::dstore_0:
-            case Opcode::lstore_0:
-            {
-                auto value = operand_stack.take_first();
-                frame.locals[0] = value;
-                frame.locals[1] = value;
-                break;
-            }
-            case Opcode::dstore_1:
-            case Opcode::lstore_1:
-            {
-                auto value = operand_stack.take_first();
-                frame.locals[1] = value;
-                frame.locals[2] = value;
-                break;
-            }
-            case Opcode::dstore_2:
-            case Opcode::lstore_2:
-            {
-                auto value = operand_stack.take_first();
-                frame.locals[2] = value;
-                frame.locals[3] = value;
-                break;
-            }
-            case Opcode::dstore_3:
-            case Opcode::lstore_3:
-            {
-                auto value = operand_stack.take_first();
-                frame.locals[3] = value;
-                frame.locals[4] = value;
-                break;
-            }
-            case Opcode::iload_0:
-            case Opcode::lload_0:
-            case Opcode::dload_0:
-                operand_stack.append(frame.locals[0]);
-                break;
-            case Opcode::iload_1:
-            case Opcode::lload_1:
-            case Opcode::dload_1:
-                operand_stack.append(frame.locals[1]);
-                break;
-            case Opcode::iload_2:
-            case Opcode::lload_2:
-            case Opcode::dload_2:
-                operand_stack.append(frame.locals[2]);
-                break;
-            case Opcode::iload_3:
-            case Opcode::lload_3:
-            case Opcode::dload_3:
-                operand_stack.append(frame.locals[3]);
-                break;
+            HANDLER(nop):
+                NEXT();
+            HANDLER(aconst_null):
+                operand_stack.push_reference(nullptr);
+                NEXT();
+            HANDLER(iconst_m1):
+                operand_stack.push_int(-1);
+                NEXT();
+            HANDLER(iconst_0):
+                operand_stack.push_int(0);
+                NEXT();
+            HANDLER(iconst_1):
+                operand_stack.push_int(1);
+                NEXT();
+            HANDLER(iconst_2):
+                operand_stack.push_int(2);
+                NEXT();
+            HANDLER(iconst_3):
+                operand_stack.push_int(3);
+                NEXT();
+            HANDLER(iconst_4):
+                operand_stack.push_int(4);
+                NEXT();
+            HANDLER(iconst_5):
+                operand_stack.push_int(5);
+                NEXT();
+            HANDLER(lconst_0):
+                operand_stack.push_long(0);
+                NEXT();
+            HANDLER(lconst_1):
+                operand_stack.push_long(1);
+                NEXT();
+            HANDLER(dconst_0):
+                operand_stack.push_double(0);
+                NEXT();
+            HANDLER(dconst_1):
+                operand_stack.push_double(1);
+                NEXT();
             case Opcode::istore:
+            case Opcode::astore:
+            HANDLER(fstore):
+                locals[instruction->operand] = operand_stack.pop();
+                NEXT();
             case Opcode::lstore:
-            case Opcode::dstore:
-            case Opcode::fstore:
-                frame.locals[code->code[m_program_counter + 1]] = operand_stack.take_first();
-                m_program_counter++;
-                break;
+            HANDLER(dstore):
+                locals[instruction->operand] = operand_stack.pop2();
+                NEXT();
             case Opcode::iload:
+            case Opcode::aload:
+            HANDLER(fload):
+                operand_stack.push(locals[instruction->operand]);
+                NEXT();
             case Opcode::lload:
-            case Opcode::dload:
-            case Opcode::fload:
-                operand_stack.append(frame.locals[code->code[m_program_counter + 1]]);
-                m_program_counter++;
-                break;
+            HANDLER(dload):
+                operand_stack.push2(locals[instruction->operand]);
+                NEXT();
             case Opcode::bipush:
+            HANDLER(sipush):
+                operand_stack.push_int(instruction->operand);
+                NEXT();
+            HANDLER(ldc):
             {
-                auto value = code->code[m_program_counter + 1];
-                operand_stack.append(Integer(value));
-                m_program_counter++;
-                break;
-            }
-            case Opcode::sipush:
-            {
-                auto value = (code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2]);
-                operand_stack.append(Integer(value));
-                m_program_counter += 2;
-                break;
-            }
-            case Opcode::ldc:
-            {
-                auto value_index = code->code[m_program_counter + 1];
-                auto& value = class_file.constant_pool()[value_index - 1];
+                auto& value = class_file.constant_pool()[instruction->operand - 1];
 
                 if (value.has<Integer>())
-                    operand_stack.append(value.get<Integer>());
+                    operand_stack.push_int(value.get<Integer>().value());
                 else if (value.has<Float>())
-                    operand_stack.append(value.get<Float>());
+                    operand_stack.push_float(value.get<Float>().value());
                 else
                     return Error::from_string_literal(
                         "Missing implementation for types other than Integer and Float in ldc");
 
-                m_program_counter++;
-                break;
-            }
-
-            case Opcode::i2b:
-                operand_stack.append(Byte(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::i2c:
-                operand_stack.append(Char(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::i2d:
-                operand_stack.append(Double(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::i2f:
-                operand_stack.append(Float(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::i2s:
-                operand_stack.append(Short(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::i2l:
-                operand_stack.append(Long(operand_stack.take_first().get<Integer>().value()));
-                break;
-            case Opcode::d2f:
-                operand_stack.append(Float(operand_stack.take_first().get<Double>().value()));
-                break;
-            case Opcode::d2i:
-                operand_stack.append(Integer(operand_stack.take_first().get<Double>().value()));
-                break;
-            case Opcode::d2l:
-                operand_stack.append(Long(operand_stack.take_first().get<Double>().value()));
-                break;
-            case Opcode::l2f:
-                operand_stack.append(Float(operand_stack.take_first().get<Long>().value()));
-                break;
-            case Opcode::l2i:
-                operand_stack.append(Integer(operand_stack.take_first().get<Long>().value()));
-                break;
-            case Opcode::l2d:
-                operand_stack.append(Double(operand_stack.take_first().get<Long>().value()));
-                break;
-            case Opcode::f2d:
-                operand_stack.append(Double(operand_stack.take_first().get<Float>().value()));
-                break;
-            case Opcode::f2i:
-                operand_stack.append(Integer(operand_stack.take_first().get<Float>().value()));
-                break;
-            case Opcode::f2l:
-                operand_stack.append(Long(operand_stack.take_first().get<Float>().value()));
-                break;
-            case Opcode::ldc2_w:
-            {
-                auto value_index = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto& value = class_file.constant_pool()[value_index - 1];
+                NEXT();
+            }
+
+            HANDLER(i2b):
+                operand_stack.push_int(static_cast<i8>(operand_stack.pop_int()));
+                NEXT();
+            HANDLER(i2c):
+                operand_stack.push_int(static_cast<u16>(operand_stack.pop_int()));
+                NEXT();
+            HANDLER(i2d):
+                operand_stack.push_double(operand_stack.pop_int());
+                NEXT();
+            HANDLER(i2f):
+                operand_stack.push_float(operand_stack.pop_int());
+                NEXT();
+            HANDLER(i2s):
+                operand_stack.push_int(static_cast<i16>(operand_stack.pop_int()));
+                NEXT();
+            HANDLER(i2l):
+                operand_stack.push_long(operand_stack.pop_int());
+                NEXT();
+            HANDLER(d2f):
+                operand_stack.push_float(operand_stack.pop_double());
+                NEXT();
+            HANDLER(d2i):
+                operand_stack.push_int(convert_to_integer<i32>(operand_stack.pop_double()));
+                NEXT();
+            HANDLER(d2l):
+                operand_stack.push_long(convert_to_integer<i64>(operand_stack.pop_double()));
+                NEXT();
+            HANDLER(l2f):
+                operand_stack.push_float(operand_stack.pop_long());
+                NEXT();
+            HANDLER(l2i):
+                operand_stack.push_int(operand_stack.pop_long());
+                NEXT();
+            HANDLER(l2d):
+                operand_stack.push_double(operand_stack.pop_long());
+                NEXT();
+            HANDLER(f2d):
+                operand_stack.push_double(operand_stack.pop_float());
+                NEXT();
+            HANDLER(f2i):
+                operand_stack.push_int(convert_to_integer<i32>(operand_stack.pop_float()));
+                NEXT();
+            HANDLER(f2l):
+                operand_stack.push_long(convert_to_integer<i64>(operand_stack.pop_float()));
+                NEXT();
+            HANDLER(ldc2_w):
+            {
+                auto& value = class_file.constant_pool()[instruction->operand - 1];
 
                 if (value.has<Long>())
-                    operand_stack.append(value.get<Long>());
+                    operand_stack.push_long(value.get<Long>().value());
                 else if (value.has<Double>())
-                    operand_stack.append(value.get<Double>());
+                    operand_stack.push_double(value.get<Double>().value());
                 else
                     return Error::from_string_literal("Cannot use ldc2_w on types other than Long and Double");
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::iinc:
+            HANDLER(iinc):
             {
-                auto index = code->code[m_program_counter + 1];
-                auto increment_const = code->code[m_program_counter + 2];
-
-                auto& value = frame.locals[index];
-                value.get<Integer>() += increment_const;
+                auto& value = locals[instruction->operand];
+                value = Slot::from_int(add<i32>(value.as_int(), instruction->second_operand));
+                NEXT();
+            }
+            HANDLER(iadd):
+            {
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                m_program_counter += 2;
-                break;
+                operand_stack.push_int(add<i32>(a, b));
+                NEXT();
             }
-            case Opcode::iadd:
+            HANDLER(isub):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(add<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_int(sub<i32>(a, b));
+                NEXT();
             }
-            case Opcode::isub:
+            HANDLER(imul):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(sub<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_int(mul<i32>(a, b));
+                NEXT();
             }
-            case Opcode::imul:
+            HANDLER(idiv):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(mul<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_int(TRY(div<i32>(a, b)));
+                NEXT();
             }
-            case Opcode::idiv:
+            HANDLER(dadd):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_double();
+                auto a = operand_stack.pop_double();
 
-                operand_stack.append(div<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_double(add<double>(a, b));
+                NEXT();
             }
-            case Opcode::dadd:
+            HANDLER(dsub):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_double();
+                auto a = operand_stack.pop_double();
 
-                operand_stack.append(add<Double>(move(a), move(b)));
-                break;
+                operand_stack.push_double(sub<double>(a, b));
+                NEXT();
             }
-            case Opcode::dsub:
+            HANDLER(dmul):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_double();
+                auto a = operand_stack.pop_double();
 
-                operand_stack.append(sub<Double>(move(a), move(b)));
-                break;
+                operand_stack.push_double(mul<double>(a, b));
+                NEXT();
             }
-            case Opcode::dmul:
+            HANDLER(ddiv):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_double();
+                auto a = operand_stack.pop_double();
 
-                operand_stack.append(mul<Double>(move(a), move(b)));
-                break;
+                operand_stack.push_double(TRY(div<double>(a, b)));
+                NEXT();
             }
-            case Opcode::ddiv:
+            HANDLER(fadd):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_float();
+                auto a = operand_stack.pop_float();
 
-                operand_stack.append(div<Double>(move(a), move(b)));
-                break;
+                operand_stack.push_float(add<float>(a, b));
+                NEXT();
             }
-            case Opcode::fadd:
+            HANDLER(fsub):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_float();
+                auto a = operand_stack.pop_float();
 
-                operand_stack.append(add<Float>(move(a), move(b)));
-                break;
+                operand_stack.push_float(sub<float>(a, b));
+                NEXT();
             }
-            case Opcode::fsub:
+            HANDLER(fmul):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_float();
+                auto a = operand_stack.pop_float();
 
-                operand_stack.append(sub<Float>(move(a), move(b)));
-                break;
+                operand_stack.push_float(mul<float>(a, b));
+                NEXT();
             }
-            case Opcode::fmul:
+            HANDLER(fdiv):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_float();
+                auto a = operand_stack.pop_float();
 
-                operand_stack.append(mul<Float>(move(a), move(b)));
-                break;
+                operand_stack.push_float(TRY(div<float>(a, b)));
+                NEXT();
             }
-            case Opcode::fdiv:
+            HANDLER(ladd):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(div<Float>(move(a), move(b)));
-                break;
+                operand_stack.push_long(add<i64>(a, b));
+                NEXT();
             }
-            case Opcode::ladd:
+            HANDLER(lsub):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(add<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_long(sub<i64>(a, b));
+                NEXT();
             }
-            case Opcode::lsub:
+            HANDLER(lmul):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(sub<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_long(mul<i64>(a, b));
+                NEXT();
             }
-            case Opcode::lmul:
+            HANDLER(ldiv):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(mul<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_long(TRY(div<i64>(a, b)));
+                NEXT();
             }
-            case Opcode::ldiv:
+            HANDLER(ior):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(div<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_int(a | b);
+                NEXT();
             }
-            case Opcode::ior:
+            HANDLER(ixor):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(bitwise_inclusive_or<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_int(a ^ b);
+                NEXT();
             }
-            case Opcode::ixor:
+            HANDLER(iand):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                operand_stack.append(bitwise_exclusive_or<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_int(a & b);
+                NEXT();
             }
-            case Opcode::iand:
+            HANDLER(lor):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(bitwise_and<Integer>(move(a), move(b)));
-                break;
+                operand_stack.push_long(a | b);
+                NEXT();
             }
-            case Opcode::lor:
+            HANDLER(lxor):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(bitwise_inclusive_or<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_long(a ^ b);
+                NEXT();
             }
-            case Opcode::lxor:
+            HANDLER(land):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_long();
+                auto a = operand_stack.pop_long();
 
-                operand_stack.append(bitwise_exclusive_or<Long>(move(a), move(b)));
-                break;
+                operand_stack.push_long(a & b);
+                NEXT();
             }
-            case Opcode::land:
+            HANDLER(invokestatic):
             {
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                enter_safepoint();
+                auto* resolved_method = TRY(resolve_method_ref(class_file, instruction->operand));
+                // 6.5 invokestatic: "if the resolved method is an instance method, the invokestatic instruction
+                // throws an IncompatibleClassChangeError."
+                // The verifier can't tell, so this is checked before the call site is quickened, as nothing after that,
+                // neither invokestatic_quick nor compiled code, looks at it again.
+                if (!has_flag(resolved_method->method->access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+                    return Error::from_string_literal("IncompatibleClassChangeError");
+
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    TRY(invoke(*resolved_method, operand_stack));
+                    NEXT();
+                }
+
+                auto index = decoded_code.add_resolved_method(resolved_method);
 
-                operand_stack.append(bitwise_and<Long>(move(a), move(b)));
-                break;
+                decoded_code.quicken(m_program_counter, Opcode::invokestatic_quick, index);
+                REDISPATCH();
             }
-            case Opcode::invokestatic:
+            HANDLER(invokestatic_quick):
+                enter_safepoint();
+                TRY(invoke(*decoded_code.resolved_method(instruction->operand), operand_stack));
+                NEXT();
+            // Instance initialization methods, private methods and methods of superclasses are never looked up in the
+            // class of the object, so unlike invokevirtual, the method to invoke is known once it has been resolved.
+            // FIXME: 6.5 invokespecial: with ACC_SUPER, a method of a superclass is looked up starting from the
+            //        direct superclass of the current class, not from the class in the method reference.
+            HANDLER(invokespecial):
             {
-                auto value_index = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto& value = class_file.constant_pool()[value_index - 1].get<ClassFile::MethodRef>();
-                auto& class_of_field = class_file.constant_pool()[value.class_index - 1].get<ClassFile::Class>();
-                auto& class_of_field_name =
-                    class_file.constant_pool()[class_of_field.name_index - 1].get<ClassFile::Utf8>();
+                enter_safepoint();
+                auto* resolved_method = TRY(resolve_method_ref(class_file, instruction->operand));
+                if (has_flag(resolved_method->method->access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+                    return Error::from_string_literal("IncompatibleClassChangeError");
 
-                auto& static_method_to_invoke_name_and_type =
-                    class_file.constant_pool()[value.name_and_type_index - 1].get<ClassFile::NameAndType>();
-                auto& static_method_to_invoke_name =
-                    class_file.constant_pool()[static_method_to_invoke_name_and_type.name_index - 1]
-                        .get<ClassFile::Utf8>();
-                auto& static_method_to_invoke_descriptor_string =
-                    class_file.constant_pool()[static_method_to_invoke_name_and_type.descriptor_index - 1]
-                        .get<ClassFile::Utf8>();
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    auto* receiver = operand_stack.top() - resolved_method->argument_slots;
+                    TRY(non_null(receiver->as_reference()));
+                    TRY(invoke(*resolved_method, operand_stack));
+                    NEXT();
+                }
 
-                auto static_method_to_invoke_descriptor =
-                    TRY(MethodDescriptor::try_parse(static_method_to_invoke_descriptor_string.value));
+                auto index = decoded_code.add_resolved_method(resolved_method);
 
-                const ClassFile::MethodInfo* static_method_to_invoke = nullptr;
+                decoded_code.quicken(m_program_counter, Opcode::invokespecial_quick, index);
+                REDISPATCH();
+            }
+            HANDLER(invokespecial_quick):
+            {
+                enter_safepoint();
+                auto& resolved_method = *decoded_code.resolved_method(instruction->operand);
+                auto* receiver = operand_stack.top() - resolved_method.argument_slots;
+                TRY(non_null(receiver->as_reference()));
+                TRY(invoke(resolved_method, operand_stack));
+                NEXT();
+            }
+            HANDLER(goto_):
+                m_program_counter = instruction->operand;
+                JUMP();
+            HANDLER(tableswitch):
+            {
+                auto& table = decoded_code.switch_tables()[instruction->operand];
+                auto index = operand_stack.pop_int();
+                auto low = table.cases.first().key;
+
+                if (index < low || index > table.cases.last().key)
+                    m_program_counter = table.default_target;
+                else
+                    m_program_counter = table.cases[index - low].target;
 
-                auto resolved_class_of_method = TRY(resolve_class(class_of_field_name.value));
+                JUMP();
+            }
+            HANDLER(lookupswitch):
+            {
+                auto& table = decoded_code.switch_tables()[instruction->operand];
+                auto key = operand_stack.pop_int();
 
-                for (auto& method : resolved_class_of_method->methods())
+                m_program_counter = table.default_target;
+                for (auto& switch_case : table.cases)
                 {
-                    // FIXME: Properly check return type and parameters of what we look up (overloading)
-                    auto& name = class_file.constant_pool()[method.name_index - 1].get<ClassFile::Utf8>();
-                    if (name.value == static_method_to_invoke_name.value)
+                    if (switch_case.key == key)
                     {
-                        static_method_to_invoke = &method;
+                        m_program_counter = switch_case.target;
                         break;
                     }
                 }
 
-                if (!static_method_to_invoke)
-                    return Error::from_string_literal("Unable to find method to invoke with invokestatic");
-
-                auto return_value =
-                    TRY(call(class_file, *static_method_to_invoke,
-                             {operand_stack.data(), static_method_to_invoke_descriptor.parameters().size()}));
+                JUMP();
+            }
 
-                for (auto i = 0; i < static_method_to_invoke_descriptor.parameters().size(); i++)
-                    operand_stack.remove(0);
+            HANDLER(if_icmpeq):
+            {
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                if (!static_method_to_invoke_descriptor.return_type().has<Empty>())
-                    operand_stack.append(move(return_value));
+                if (if_equal<Integer>(a, b, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::goto_:
+            HANDLER(if_icmpne):
             {
-                auto offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                m_program_counter += offset;
-                continue;
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
+
+                if (if_not_equal<Integer>(a, b, instruction->operand))
+                    JUMP();
+
+                NEXT();
             }
-            case Opcode::goto_w:
+            HANDLER(if_icmplt):
             {
-                auto offset = (((code->code[m_program_counter + 1] << 24) | code->code[m_program_counter + 2] << 16) |
-                               code->code[m_program_counter + 3] << 8) |
-                              code->code[m_program_counter + 4];
-                m_program_counter += offset;
-                continue;
-            }
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
+
+                if (if_less_than<Integer>(a, b, instruction->operand))
+                    JUMP();
 
-            case Opcode::if_icmpeq:
+                NEXT();
+            }
+            HANDLER(if_icmpge):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                if (if_equal<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                if (if_greater_than_or_equal_to<Integer>(a, b, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::if_icmpne:
+            HANDLER(if_icmpgt):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                if (if_not_equal<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                if (if_greater_than<Integer>(a, b, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::if_icmplt:
+            HANDLER(if_icmple):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                auto b = operand_stack.pop_int();
+                auto a = operand_stack.pop_int();
 
-                if (if_less_than<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                if (if_less_than_or_equal_to<Integer>(a, b, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::if_icmpge:
+            HANDLER(ifeq):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                if (if_equal<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                if (if_greater_than_or_equal_to<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                NEXT();
+            }
+            HANDLER(ifne):
+            {
+                if (if_not_equal<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::if_icmpgt:
+            HANDLER(iflt):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                if (if_less_than<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                if (if_greater_than<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                NEXT();
+            }
+            HANDLER(ifge):
+            {
+                if (if_greater_than_or_equal_to<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::if_icmple:
+            HANDLER(ifgt):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto a = operand_stack.take_first();
-                auto b = operand_stack.take_first();
+                if (if_greater_than<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                if (if_less_than_or_equal_to<Integer>(move(a), move(b), success_branch_offset))
-                    continue;
+                NEXT();
+            }
+            HANDLER(ifle):
+            {
+                if (if_less_than_or_equal_to<Integer>(operand_stack.pop_int(), 0, instruction->operand))
+                    JUMP();
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::ifeq:
+            HANDLER(if_acmpeq):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                auto* b = operand_stack.pop_reference();
+                auto* a = operand_stack.pop_reference();
 
-                if (if_equal<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
+                if (a == b)
+                {
+                    m_program_counter = instruction->operand;
+                    JUMP();
+                }
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::ifne:
+            HANDLER(if_acmpne):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                auto* b = operand_stack.pop_reference();
+                auto* a = operand_stack.pop_reference();
+
+                if (a != b)
+                {
+                    m_program_counter = instruction->operand;
+                    JUMP();
+                }
 
-                if (if_not_equal<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
+                NEXT();
+            }
+            HANDLER(ifnull):
+            {
+                if (!operand_stack.pop_reference())
+                {
+                    m_program_counter = instruction->operand;
+                    JUMP();
+                }
 
-                m_program_counter += 2;
-                break;
+                NEXT();
             }
-            case Opcode::iflt:
+            HANDLER(ifnonnull):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                if (operand_stack.pop_reference())
+                {
+                    m_program_counter = instruction->operand;
+                    JUMP();
+                }
 
-                if (if_less_than<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
+                NEXT();
+            }
 
-                m_program_counter += 2;
-                break;
+            // The instructions a superinstruction was fused from are still right behind it, so it reads their
+            // operands from there, and then skips over them. Branches are counted against the branch instruction at
+            // the end, just as if the instructions had been executed one by one.
+            HANDLER(iload_iload_iadd_istore):
+            {
+                auto a = locals[instruction->operand].as_int();
+                auto b = locals[instruction[1].operand].as_int();
+
+                locals[instruction[3].operand] = Slot::from_int(add<i32>(a, b));
+                ADVANCE(4);
             }
-            case Opcode::ifge:
+            HANDLER(iload_iconst_if_icmpge):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                auto a = locals[instruction->operand].as_int();
 
-                if (if_greater_than_or_equal_to<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
+                if (if_greater_than_or_equal_to<Integer>(a, instruction->second_operand, instruction[2].operand))
+                {
+                    instruction += 2;
+                    JUMP();
+                }
 
-                m_program_counter += 2;
-                break;
+                ADVANCE(3);
             }
-            case Opcode::ifgt:
+            HANDLER(iload_iload_if_icmpge):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                auto a = locals[instruction->operand].as_int();
+                auto b = locals[instruction[1].operand].as_int();
 
-                if (if_greater_than<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
+                if (if_greater_than_or_equal_to<Integer>(a, b, instruction[2].operand))
+                {
+                    instruction += 2;
+                    JUMP();
+                }
 
-                m_program_counter += 2;
-                break;
+                ADVANCE(3);
             }
-            case Opcode::ifle:
+            HANDLER(iinc_goto):
             {
-                auto success_branch_offset = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
+                auto& value = locals[instruction->operand];
+                value = Slot::from_int(add<i32>(value.as_int(), instruction->second_operand));
 
-                if (if_less_than_or_equal_to<Integer>(operand_stack.take_first(), 0, success_branch_offset))
-                    continue;
-
-                m_program_counter += 2;
-                break;
+                m_program_counter = instruction[1].operand;
+                instruction += 1;
+                JUMP();
             }
 
-            case Opcode::return_:
-                // TODO: return null?
+            HANDLER(return_):
                 m_program_counter = program_counter_to_return_to;
-                return Integer(0);
+                return Slot{};
             case Opcode::ireturn:
+            case Opcode::areturn:
+            HANDLER(freturn):
+                m_program_counter = program_counter_to_return_to;
+                return operand_stack.pop();
             case Opcode::dreturn:
-            case Opcode::freturn:
-            case Opcode::lreturn:
+            HANDLER(lreturn):
                 m_program_counter = program_counter_to_return_to;
-                return operand_stack.take_first();
+                return operand_stack.pop2();
+
+            HANDLER(ineg):
+                operand_stack.push_int(sub<i32>(0, operand_stack.pop_int()));
+                NEXT();
+            HANDLER(fneg):
+                operand_stack.push_float(-operand_stack.pop_float());
+                NEXT();
+            HANDLER(dneg):
+                operand_stack.push_double(-operand_stack.pop_double());
+                NEXT();
+            HANDLER(lneg):
+                operand_stack.push_long(sub<i64>(0, operand_stack.pop_long()));
+                NEXT();
+
+            HANDLER(dup):
+                operand_stack.push(operand_stack.peek());
+                NEXT();
+
+            HANDLER(pop):
+                operand_stack.pop();
+                NEXT();
+
+            HANDLER(getstatic):
+            {
+                enter_safepoint();
+                auto field = TRY(resolve_static_field(class_file, instruction->operand));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    if (field.is_category_2)
+                        operand_stack.push2(*field.slot);
+                    else
+                        operand_stack.push(*field.slot);
+                    NEXT();
+                }
 
-            case Opcode::ineg:
-                operand_stack.append(Integer(-operand_stack.take_first().get<Integer>()));
-                break;
-            case Opcode::fneg:
-                operand_stack.append(Float(-operand_stack.take_first().get<Float>()));
-                break;
-            case Opcode::dneg:
-                operand_stack.append(Double(-operand_stack.take_first().get<Double>()));
-                break;
-            case Opcode::lneg:
-                operand_stack.append(Long(-operand_stack.take_first().get<Long>()));
-                break;
+                auto index = decoded_code.add_resolved_static_field(field.slot);
 
-            case Opcode::dup:
-                operand_stack.append(operand_stack.first());
-                break;
+                decoded_code.quicken(m_program_counter,
+                                     field.is_category_2 ? Opcode::getstatic2_quick : Opcode::getstatic_quick, index);
+                REDISPATCH();
+            }
+            HANDLER(getstatic_quick):
+                operand_stack.push(*decoded_code.resolved_static_field(instruction->operand));
+                NEXT();
+            HANDLER(getstatic2_quick):
+                operand_stack.push2(*decoded_code.resolved_static_field(instruction->operand));
+                NEXT();
+
+            HANDLER(putstatic):
+            {
+                enter_safepoint();
+                auto field = TRY(resolve_static_field(class_file, instruction->operand));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    *field.slot = field.is_category_2 ? operand_stack.pop2() : operand_stack.pop();
+                    NEXT();
+                }
 
-            case Opcode::pop:
-                operand_stack.remove(0);
-                break;
+                auto index = decoded_code.add_resolved_static_field(field.slot);
 
-            case Opcode::getstatic:
+                decoded_code.quicken(m_program_counter,
+                                     field.is_category_2 ? Opcode::putstatic2_quick : Opcode::putstatic_quick, index);
+                REDISPATCH();
+            }
+            HANDLER(putstatic_quick):
+                *decoded_code.resolved_static_field(instruction->operand) = operand_stack.pop();
+                NEXT();
+            HANDLER(putstatic2_quick):
+                *decoded_code.resolved_static_field(instruction->operand) = operand_stack.pop2();
+                NEXT();
+
+            HANDLER(new_):
             {
-                auto value_index = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto& value = class_file.constant_pool()[value_index - 1].get<ClassFile::FieldRef>();
-                auto& class_of_field = class_file.constant_pool()[value.class_index - 1].get<ClassFile::Class>();
-                auto& class_of_field_name =
-                    class_file.constant_pool()[class_of_field.name_index - 1].get<ClassFile::Utf8>();
+                enter_safepoint();
+                auto* resolved_class = TRY(resolve_class_to_instantiate(class_file, instruction->operand));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    operand_stack.push_reference(TRY(allocate_object(*resolved_class)));
+                    NEXT();
+                }
 
-                auto& field_name_and_type =
-                    class_file.constant_pool()[value.name_and_type_index - 1].get<ClassFile::NameAndType>();
-                auto& field_name =
-                    class_file.constant_pool()[field_name_and_type.name_index - 1].get<ClassFile::Utf8>();
+                auto index = decoded_code.add_resolved_class(resolved_class);
 
-                auto resolved_class_of_field = TRY(resolve_class(class_of_field_name.value));
+                decoded_code.quicken(m_program_counter, Opcode::new_quick, index);
+                REDISPATCH();
+            }
+            HANDLER(new_quick):
+                enter_safepoint();
+                operand_stack.push_reference(TRY(allocate_object(*decoded_code.resolved_class(instruction->operand))));
+                NEXT();
+
+            // The quick forms have the offset of the field as their operand and the class of the field reference as
+            // their second one, and which one it is tells how to get at the value in there.
+            HANDLER(getfield):
+            {
+                enter_safepoint();
+                auto [resolved_class, field] = TRY(resolve_field(class_file, instruction->operand));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    TRY(get_field(operand_stack, *resolved_class, field->kind, field->offset));
+                    NEXT();
+                }
 
-                operand_stack.append(*m_static_data.find(*resolved_class_of_field)->value.fields.get(field_name.value));
+                auto index = decoded_code.add_resolved_class(resolved_class);
 
-                m_program_counter += 2;
-                break;
+                decoded_code.quicken(m_program_counter, getfield_quick_opcode(field->kind), field->offset, index);
+                REDISPATCH();
             }
+            HANDLER(getfield_byte_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Byte,
+                              instruction->operand));
+                NEXT();
+            HANDLER(getfield_char_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Char,
+                              instruction->operand));
+                NEXT();
+            HANDLER(getfield_short_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Short,
+                              instruction->operand));
+                NEXT();
+            HANDLER(getfield_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Int,
+                              instruction->operand));
+                NEXT();
+            HANDLER(getfield2_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Long,
+                              instruction->operand));
+                NEXT();
+            HANDLER(getfield_reference_quick):
+                TRY(get_field(operand_stack, field_class(decoded_code, *instruction), FieldKind::Reference,
+                              instruction->operand));
+                NEXT();
+
+            HANDLER(putfield):
+            {
+                enter_safepoint();
+                auto [resolved_class, field] = TRY(resolve_field(class_file, instruction->operand));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    TRY(put_field(operand_stack, m_heap, *resolved_class, field->kind, field->offset));
+                    NEXT();
+                }
 
-            case Opcode::putstatic:
+                auto index = decoded_code.add_resolved_class(resolved_class);
+
+                decoded_code.quicken(m_program_counter, putfield_quick_opcode(field->kind), field->offset, index);
+                REDISPATCH();
+            }
+            HANDLER(putfield_boolean_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Boolean,
+                              instruction->operand));
+                NEXT();
+            HANDLER(putfield_byte_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Byte,
+                              instruction->operand));
+                NEXT();
+            HANDLER(putfield_short_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Short,
+                              instruction->operand));
+                NEXT();
+            HANDLER(putfield_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Int,
+                              instruction->operand));
+                NEXT();
+            HANDLER(putfield2_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Long,
+                              instruction->operand));
+                NEXT();
+            HANDLER(putfield_reference_quick):
+                TRY(put_field(operand_stack, m_heap, field_class(decoded_code, *instruction), FieldKind::Reference,
+                              instruction->operand));
+                NEXT();
+
+            HANDLER(newarray):
             {
-                auto value_index = code->code[m_program_counter + 1] << 8 | code->code[m_program_counter + 2];
-                auto& value = class_file.constant_pool()[value_index - 1].get<ClassFile::FieldRef>();
-                auto& class_of_field = class_file.constant_pool()[value.class_index - 1].get<ClassFile::Class>();
-                auto& class_of_field_name =
-                    class_file.constant_pool()[class_of_field.name_index - 1].get<ClassFile::Utf8>();
+                enter_safepoint();
+                auto component_type = TRY(newarray_component_type(instruction->second_operand));
+                auto* array_class = TRY(resolve_primitive_array_class(component_type));
+                if (method.profile->tier == Tier::Interpreter)
+                {
+                    operand_stack.push_reference(TRY(allocate_array(*array_class, operand_stack.pop_int())));
+                    NEXT();
+                }
 
-                auto& field_name_and_type =
-                    class_file.constant_pool()[value.name_and_type_index - 1].get<ClassFile::NameAndType>();
-                auto& field_name =
-                    class_file.constant_pool()[field_name_and_type.name_index - 1].get<ClassFile::Utf8>();
+                auto index = decoded_code.add_resolved_class(array_class);
 
-                auto resolved_class_of_field = TRY(resolve_class(class_of_field_name.value));
+                decoded_code.quicken(m_program_counter, Opcode::newarray_quick, index);
+                REDISPATCH();
+            }
+            HANDLER(newarray_quick):
+            {
+                enter_safepoint();
+                auto& array_class = *decoded_code.resolved_class(instruction->operand);
+                operand_stack.push_reference(TRY(allocate_array(array_class, operand_stack.pop_int())));
+                NEXT();
+            }
+            HANDLER(arraylength):
+            {
+                auto* array = static_cast<Array*>(TRY(non_null(operand_stack.pop_reference())));
+                operand_stack.push_int(array->length());
+                NEXT();
+            }
+
+            // Boolean arrays are loaded just like byte arrays, as their components are always 0 or 1.
+            HANDLER(baload):
+                operand_stack.push_int(TRY(load_element<i8>(operand_stack)));
+                NEXT();
+            HANDLER(caload):
+                operand_stack.push_int(TRY(load_element<u16>(operand_stack)));
+                NEXT();
+            HANDLER(saload):
+                operand_stack.push_int(TRY(load_element<i16>(operand_stack)));
+                NEXT();
+            HANDLER(iaload):
+                operand_stack.push_int(TRY(load_element<i32>(operand_stack)));
+                NEXT();
+            HANDLER(laload):
+                operand_stack.push_long(TRY(load_element<i64>(operand_stack)));
+                NEXT();
+            HANDLER(faload):
+                operand_stack.push_float(TRY(load_element<float>(operand_stack)));
+                NEXT();
+            HANDLER(daload):
+                operand_stack.push_double(TRY(load_element<double>(operand_stack)));
+                NEXT();
+
+            HANDLER(bastore):
+            {
+                auto value = operand_stack.pop_int();
+                auto index = operand_stack.pop_int();
+                auto* array = TRY(array_for_index(operand_stack.pop_reference(), index));
 
-                m_static_data.find(*resolved_class_of_field)
-                    ->value.fields.set(field_name.value, operand_stack.take_first());
+                // 6.5 bastore: "If the arrayref refers to an array whose components are of type boolean, then the int
+                // value is narrowed by taking the bitwise AND of value and 1"
+                if (array->resolved_class().component_type.value() == PrimitiveType::Boolean)
+                    value &= 1;
 
-                m_program_counter += 2;
-                break;
+                array->set_element<i8>(index, static_cast<i8>(value));
+                NEXT();
             }
+            // A char is stored as the same 16 bits as a short, it only differs in how it is loaded.
+            case Opcode::castore:
+            HANDLER(sastore):
+                TRY(store_element<i16>(operand_stack, static_cast<i16>(operand_stack.pop_int())));
+                NEXT();
+            HANDLER(iastore):
+                TRY(store_element<i32>(operand_stack, operand_stack.pop_int()));
+                NEXT();
+            HANDLER(lastore):
+                TRY(store_element<i64>(operand_stack, operand_stack.pop_long()));
+                NEXT();
+            HANDLER(fastore):
+                TRY(store_element<float>(operand_stack, operand_stack.pop_float()));
+                NEXT();
+            HANDLER(dastore):
+                TRY(store_element<double>(operand_stack, operand_stack.pop_double()));
+                NEXT();
 
             default:
-                return Error::from_string_literal(String::formatted("Unhandled opcode {}", *opcode_names.get(opcode)));
+                return Error::from_string_literal(
+                    String::formatted("Unhandled opcode {}", *opcode_names.get(instruction->opcode)));
         }
 
         m_program_counter++;
     }
 
+#ifdef PERIL_THREADED_DISPATCH
+reached_end:
+#endif
     return Error::from_string_literal("Method code execution reached the end without returning");
 }
 }
\ No newline at end of file
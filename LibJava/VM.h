@@ -1,15 +1,55 @@
 #pragma once
 
+#include <AK/Array.h>
 #include <AK/Function.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/NumericLimits.h>
+#include <AK/Optional.h>
+#include <AK/StackInfo.h>
 #include <AK/Vector.h>
+#include <LibJava/Array.h>
+#include <LibJava/ClassArchive.h>
 #include <LibJava/ClassFile.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/Heap.h>
+#include <LibJava/MethodProfile.h>
+#include <LibJava/ResolvedClass.h>
+#include <LibJava/ResolvedMethod.h>
+#include <LibJava/Slot.h>
 #include <LibJava/Types.h>
 
 namespace Java
 {
+namespace JIT
+{
+class Compiler;
+class OptimizingCompiler;
+}
+
+class OperandStack;
+
 class VM
 {
 public:
+    // A method moves up to a tier once it has been called this many times, or has taken this many backward branches,
+    // which is how a loop that runs for a long time shows up.
+    struct TierThresholds
+    {
+        u32 invocations{};
+        u32 backedges{};
+    };
+
+    struct TieringPolicy
+    {
+        TierThresholds quickened_interpreter{2, 100};
+        TierThresholds compiled{1000, 10000};
+        TierThresholds optimized{10000, 100000};
+        // Without it, methods stay in the quickened interpreter for good.
+        bool enable_jit{true};
+        // Without it, methods stay in baseline code for good.
+        bool enable_optimizer{true};
+    };
+
     template<typename... Args>
     ErrorOr<Value> call(const ClassFile& class_file, const ClassFile::MethodInfo& method, Args... args)
     {
@@ -23,20 +63,92 @@ public:
         return call(class_file, method, arguments.span());
     }
 
+    VM();
+
     ErrorOr<Value> call(const ClassFile&, const ClassFile::MethodInfo&, Span<Value> arguments = {});
 
-    Function<ErrorOr<ClassFile>(StringView)> on_resolve_class_file_externally;
+    Function<ErrorOr<NonnullRefPtr<ClassFile>>(StringView)> on_resolve_class_file_externally;
+
+    void set_tiering_policy(TieringPolicy policy) { m_tiering_policy = policy; }
+
+    // Classes that are in the archive are taken from it instead of being resolved externally, and are trusted to be
+    // verified. Only before the first class is resolved.
+    void set_class_archive(RefPtr<ClassArchive> class_archive) { m_class_archive = move(class_archive); }
+
+    // Only affects code that is linked afterwards.
+    void set_superinstructions_enabled(bool enabled) { m_superinstructions_enabled = enabled; }
+
+    // Only before the first object is allocated.
+    ErrorOr<void> set_heap_configuration(Heap::Configuration configuration) { return m_heap.configure(configuration); }
+    Heap::Statistics heap_statistics() const { return m_heap.statistics(); }
+
+    Function<void(const ClassFile&, const ClassFile::MethodInfo&, Tier from, Tier to)> on_tier_transition;
+    // Called when a frame moves from the interpreter into compiled code in the middle of a method, at the loop header
+    // with the given offset into its Code.
+    Function<void(const ClassFile&, const ClassFile::MethodInfo&, u16 pc)> on_stack_replacement;
+    // Called for every call that the optimizing compiler replaced with the code of the method it calls, with the offset
+    // of the invokestatic into the Code of the caller. The caller is either the method being optimized, or a method
+    // that has been inlined into it itself.
+    Function<void(const ClassFile&, const ClassFile::MethodInfo& caller, u16 pc, const ClassFile&,
+                  const ClassFile::MethodInfo& callee)>
+        on_inline;
+
+    // Only methods that have been executed at least once have a profile.
+    const MethodProfile* profile(const ClassFile::MethodInfo&) const;
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+    u64 executed_instructions() const { return m_executed_instructions; }
+
+    // How many times the second opcode was executed right after the first, to see which sequences would be worth
+    // a superinstruction.
+    u64 opcode_pair_count(Opcode first, Opcode second) const
+    {
+        return m_opcode_pair_counts[to_underlying(first) << 8 | to_underlying(second)];
+    }
+#endif
 
 private:
+    friend class JIT::Compiler;
+    friend class JIT::OptimizingCompiler;
+
+    // 2.6 Frames
+    // The local variables and operand stack of a frame aren't stored here, they live in the VM stack right after
+    // each other, starting at locals.
     struct Frame
     {
-        // TODO: dont have empty
-        Vector<Value> locals;
+        // The garbage collector can't tell what is in the slots of a frame that is at neither, and has to assume that
+        // anything that looks like a reference is one.
+        static constexpr u32 unknown_safepoint = NumericLimits<u32>::max();
+        // Optimized code only ever has ints in its slots, see run_compiled_code.
+        static constexpr u32 without_references = unknown_safepoint - 1;
+
+        Frame* caller{};
+        const ClassFile* class_file{};
+        Slot* locals{};
+        const ResolvedMethod* method{};
+        // The instruction that the frame is at, whenever it calls out to something that may collect garbage, which is
+        // what the reference maps of the method are looked up by.
+        u32 safepoint{unknown_safepoint};
     };
 
     struct StaticData
     {
-        HashMap<String, Value> fields;
+        // One slot for each static field, in the order the class declares them. This is laid out once when the class
+        // is initialized and never grows, so quickened instructions can point right into it.
+        Vector<Slot> fields;
+    };
+
+    struct ResolvedStaticField
+    {
+        Slot* slot{};
+        bool is_category_2{};
+    };
+
+    struct ResolvedField
+    {
+        // The class the field reference names, which the object has to be an instance of, see instance_of in VM.cpp.
+        const ResolvedClass* resolved_class{};
+        const ResolvedClass::Field* field{};
     };
 
     // 2.5.1
@@ -44,62 +156,239 @@ private:
     // currently being executed.
     // If the method currently being executed by the thread is native, the value of the Java
     // Virtual Machine's pc register is undefined.
+    // For us, this "address" is the index into the DecodedCode of the method, not the offset into its raw Code.
     u16 m_program_counter{};
-    Vector<Frame> m_stack;
-    HashMap<ClassFile, StaticData> m_static_data;
-    HashMap<String, ClassFile> m_resolved_classes;
 
-    ErrorOr<void> initialize_class(const ClassFile&);
-    ErrorOr<ClassFile*> resolve_class(StringView name);
+    // 2.5.2 Java Virtual Machine Stacks
+    // "This specification permits Java Virtual Machine stacks either to be of a fixed size or to dynamically expand
+    // and contract as required by the computation."
+    // Ours is of a fixed size, and allocated up front. Frames are pushed and popped by moving m_stack_top, and the
+    // arguments a caller pushed onto its operand stack become the first local variables of the callee in place.
+    static constexpr size_t stack_size_in_slots = 64 * KiB;
+    Vector<Slot> m_stack;
+    Slot* m_stack_top{};
+    Frame* m_current_frame{};
+    // Every call goes through execute() on the native stack as well, which runs out long before m_stack does with
+    // frames that are only a few slots each. Whatever runs on top of the last frame, like a collection or compiling a
+    // method, gets to keep what is reserved. The VM is only ever used from the thread that created it.
+    static constexpr size_t native_stack_reserve = 256 * KiB;
+    StackInfo m_native_stack;
+
+    HashMap<const ClassFile*, StaticData> m_static_data;
+    RefPtr<ClassArchive> m_class_archive;
+    // The index in m_class_archive of the classes that were taken from it.
+    HashMap<const ClassFile*, size_t> m_archived_classes;
+    // These are all boxed, so that pointers to them stay valid as more are added.
+    HashMap<String, NonnullRefPtr<const ClassFile>> m_resolved_classes;
+    HashMap<const ClassFile::Code*, NonnullOwnPtr<DecodedCode>> m_decoded_code;
+    HashMap<const ClassFile::Code*, NonnullOwnPtr<ReferenceMaps>> m_reference_maps;
+    HashMap<const ClassFile::MethodInfo*, NonnullOwnPtr<ResolvedMethod>> m_resolved_methods;
+    HashMap<const ClassFile::MethodInfo*, NonnullOwnPtr<MethodProfile>> m_method_profiles;
+    HashMap<const ClassFile*, NonnullOwnPtr<ResolvedClass>> m_class_layouts;
+    // One for each PrimitiveType but returnAddress, created the first time an array of it is.
+    AK::Array<OwnPtr<ResolvedClass>, to_underlying(PrimitiveType::ReturnAddress)> m_primitive_array_classes;
+
+    Heap m_heap;
+    // There is only ever one thread running, so there is only one allocation buffer, and compiled code bumps it inline.
+    Heap::AllocationBuffer m_allocation_buffer;
+
+    TieringPolicy m_tiering_policy;
+    bool m_superinstructions_enabled{true};
+    static constexpr u8 max_deoptimizations = 4;
+    // Compiled code that has been deoptimized or replaced may still be running further up the stack, so it is kept
+    // around.
+    Vector<NonnullOwnPtr<JIT::CompiledCode>> m_retired_compiled_code;
+    // Compiled code can't return an ErrorOr, so an error from a method it called is parked here on its way out.
+    Optional<Error> m_compiled_code_error;
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+    u64 m_executed_instructions{};
+    // Indexed by the first opcode in the high byte and the second one in the low byte.
+    Vector<u64> m_opcode_pair_counts;
+    Opcode m_previous_opcode{Opcode::nop};
+
+    ALWAYS_INLINE void count_instruction(Opcode opcode)
+    {
+        m_executed_instructions++;
+        m_opcode_pair_counts[to_underlying(m_previous_opcode) << 8 | to_underlying(opcode)]++;
+        m_previous_opcode = opcode;
+    }
+#endif
+
+    ErrorOr<Slot> execute(ResolvedMethod&, Slot* locals);
+    ErrorOr<Slot> interpret(ResolvedMethod&, Slot* locals, u32 start_at = 0, u16 stack_depth = 0);
+    ErrorOr<Slot> run_compiled_code(ResolvedMethod&, JIT::CompiledCode::Entry, Slot* locals);
+    ErrorOr<void> invoke(ResolvedMethod&, OperandStack&);
+    static bool invoke_from_compiled_code(VM*, ResolvedMethod*, Slot* arguments);
+    // For when the allocation buffer has run out in compiled code.
+    static bool allocate_from_compiled_code(VM*, const ResolvedClass*, Slot* result);
+    static bool allocate_array_from_compiled_code(VM*, const ResolvedClass*, i32 length, Slot* result);
+    // For objects that aren't of the class itself, which compiled code checks for on its own.
+    static bool is_subclass_from_compiled_code(const ResolvedClass*, const ResolvedClass* of);
+
+    ALWAYS_INLINE ErrorOr<Object*> allocate(const ResolvedClass& resolved_class, size_t size)
+    {
+        auto* object = m_allocation_buffer.try_allocate(size);
+        if (!object)
+            object = TRY(m_heap.allocate(m_allocation_buffer, size));
 
-    template<typename T>
-    ALWAYS_INLINE static constexpr T add(Value&& a, Value&& b)
+        object->set_resolved_class(resolved_class);
+        return object;
+    }
+
+    ALWAYS_INLINE ErrorOr<Object*> allocate_object(const ResolvedClass& resolved_class)
     {
-        return a.get<T>() + b.get<T>();
+        return allocate(resolved_class, resolved_class.instance_size);
     }
 
-    template<typename T>
-    ALWAYS_INLINE static constexpr T sub(Value&& a, Value&& b)
+    // The components start out zeroed like fields do, which is their default value (2.3, 2.4) as well.
+    ALWAYS_INLINE ErrorOr<Array*> allocate_array(const ResolvedClass& array_class, i32 length)
     {
-        return a.get<T>() - b.get<T>();
+        // 6.5 newarray: "If count is less than zero, newarray throws a NegativeArraySizeException."
+        if (length < 0)
+            return Error::from_string_literal("NegativeArraySizeException");
+
+        auto size = Array::allocation_size(length, component_size(array_class.component_type.value()));
+        auto* array = static_cast<Array*>(TRY(allocate(array_class, size)));
+        array->set_length(length);
+        return array;
     }
 
-    template<typename T>
-    ALWAYS_INLINE static constexpr T mul(Value&& a, Value&& b)
+    void update_tier(ResolvedMethod&);
+    void optimize(ResolvedMethod&);
+    void deoptimize(ResolvedMethod&, const JIT::CompiledCode&);
+    void transition_tier(ResolvedMethod&, Tier);
+
+    ALWAYS_INLINE static bool has_reached(const MethodProfile& profile, TierThresholds thresholds, u32 scale = 1)
+    {
+        return profile.invocation_count >= thresholds.invocations * scale ||
+               profile.backedge_count >= thresholds.backedges * scale;
+    }
+
+    ALWAYS_INLINE bool should_compile(const MethodProfile& profile) const
     {
-        return a.get<T>() * b.get<T>();
+        // Every deoptimization pushes the next attempt further out, to give the method time to get the rest of its
+        // instructions quickened.
+        return profile.tier == Tier::QuickenedInterpreter && m_tiering_policy.enable_jit && profile.is_compilable &&
+               has_reached(profile, m_tiering_policy.compiled, profile.deoptimizations + 1);
     }
 
+    ALWAYS_INLINE bool should_optimize(const MethodProfile& profile) const
+    {
+        return profile.tier == Tier::Compiled && m_tiering_policy.enable_optimizer && profile.is_optimizable &&
+               has_reached(profile, m_tiering_policy.optimized, profile.deoptimizations + 1);
+    }
+
+    // Baseline code counts backward branches itself, up to this many, if the method is to be optimized at all.
+    Optional<u32> optimize_at_backedges(const MethodProfile& profile) const
+    {
+        if (!m_tiering_policy.enable_optimizer || !profile.is_optimizable)
+            return {};
+        return m_tiering_policy.optimized.backedges * (profile.deoptimizations + 1);
+    }
+
+    // Returns where to continue in compiled code if the method has been compiled in the meantime, in which case the
+    // interpreter should hand its frame over to it (on-stack replacement).
+    ALWAYS_INLINE JIT::CompiledCode::Entry count_backedge(ResolvedMethod& method, size_t branch_index,
+                                                         u16 stack_depth)
+    {
+        auto& profile = *method.profile;
+        profile.backedge_count++;
+        profile.backedge_counts[branch_index]++;
+
+        if (profile.tier == Tier::Interpreter && has_reached(profile, m_tiering_policy.quickened_interpreter))
+            transition_tier(method, Tier::QuickenedInterpreter);
+        else if (should_compile(profile))
+            update_tier(method);
+
+        if (profile.tier < Tier::Compiled)
+            return nullptr;
+
+        // m_program_counter already is the target of the branch, which is the header of the loop.
+        return method.compiled_code->osr_entry(m_program_counter, stack_depth);
+    }
+    ErrorOr<void> initialize_class(const ClassFile&);
+    ErrorOr<DecodedCode*> link(const ClassFile&, const ClassFile::MethodInfo&);
+    ErrorOr<ResolvedMethod*> resolve_method(const ClassFile&, const ClassFile::MethodInfo&);
+    ErrorOr<ResolvedMethod*> resolve_method_ref(const ClassFile&, u16 method_ref_index);
+    ErrorOr<const ClassFile*> resolve_class(StringView name);
+    ErrorOr<const ResolvedClass*> lay_out_class(const ClassFile&);
+    ErrorOr<const ResolvedClass*> resolve_class_to_instantiate(const ClassFile&, u16 class_index);
+    ErrorOr<const ResolvedClass*> resolve_primitive_array_class(PrimitiveType component_type);
+    ErrorOr<ResolvedStaticField> resolve_static_field(const ClassFile&, u16 field_ref_index);
+    ErrorOr<ResolvedField> resolve_field(const ClassFile&, u16 field_ref_index);
+
+    // 2.11.3: "The Java Virtual Machine does not indicate overflow during operations on integer data types." They
+    // wrap around instead, which signed arithmetic in C++ is not allowed to do.
     template<typename T>
-    ALWAYS_INLINE static constexpr T div(Value&& a, Value&& b)
+    ALWAYS_INLINE static constexpr T add(T a, T b)
     {
-        return a.get<T>() / b.get<T>();
+        if constexpr (IsIntegral<T>)
+            return static_cast<T>(static_cast<MakeUnsigned<T>>(a) + static_cast<MakeUnsigned<T>>(b));
+        else
+            return a + b;
     }
 
     template<typename T>
-    ALWAYS_INLINE static constexpr T bitwise_inclusive_or(Value&& a, Value&& b)
+    ALWAYS_INLINE static constexpr T sub(T a, T b)
     {
-        return a.get<T>() | b.get<T>();
+        if constexpr (IsIntegral<T>)
+            return static_cast<T>(static_cast<MakeUnsigned<T>>(a) - static_cast<MakeUnsigned<T>>(b));
+        else
+            return a - b;
     }
 
     template<typename T>
-    ALWAYS_INLINE static constexpr T bitwise_and(Value&& a, Value&& b)
+    ALWAYS_INLINE static constexpr T mul(T a, T b)
     {
-        return a.get<T>() & b.get<T>();
+        if constexpr (IsIntegral<T>)
+            return static_cast<T>(static_cast<MakeUnsigned<T>>(a) * static_cast<MakeUnsigned<T>>(b));
+        else
+            return a * b;
     }
 
+    // 6.5 idiv: "if the dividend is the negative integer of largest possible magnitude for the int type, and the
+    // divisor is -1, then overflow occurs, and the result is equal to the dividend." "if the value of the divisor in an
+    // int division is 0, idiv throws an ArithmeticException."
     template<typename T>
-    ALWAYS_INLINE static constexpr T bitwise_exclusive_or(Value&& a, Value&& b)
+    ALWAYS_INLINE static ErrorOr<T> div(T a, T b)
+    {
+        if constexpr (IsIntegral<T>)
+        {
+            if (b == 0)
+                return Error::from_string_literal("ArithmeticException");
+            if (b == -1)
+                return sub<T>(0, a);
+        }
+
+        return a / b;
+    }
+
+    // 6.5 d2i: "If the value' is NaN, the result of the conversion is an int 0. Otherwise, if the value' is not an
+    // infinity, it is rounded to an integer value V, rounding towards zero [...] if this integer value V can be
+    // represented as an int, then the result is the int value V. Otherwise, [...] the result is the smallest [or
+    // largest] representable value of type int." The same goes for d2l, f2i and f2l.
+    // A C++ cast would be undefined for anything that doesn't fit.
+    template<typename To, typename From>
+    ALWAYS_INLINE static constexpr To convert_to_integer(From value)
     {
-        return a.get<T>() ^ b.get<T>();
+        if (value != value)
+            return 0;
+        // The limits of the integer as a floating-point number are either exact, or a power of two just outside of it.
+        if (value <= static_cast<From>(NumericLimits<To>::min()))
+            return NumericLimits<To>::min();
+        if (value >= static_cast<From>(NumericLimits<To>::max()))
+            return NumericLimits<To>::max();
+
+        return static_cast<To>(value);
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_equal(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_equal(int a, int b, u32 target)
     {
         if (a == b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
@@ -107,11 +396,11 @@ private:
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_not_equal(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_not_equal(int a, int b, u32 target)
     {
         if (a != b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
@@ -119,11 +408,11 @@ private:
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_less_than(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_less_than(int a, int b, u32 target)
     {
         if (a < b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
@@ -131,11 +420,11 @@ private:
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_greater_than_or_equal_to(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_greater_than_or_equal_to(int a, int b, u32 target)
     {
         if (a >= b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
@@ -143,11 +432,11 @@ private:
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_greater_than(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_greater_than(int a, int b, u32 target)
     {
         if (a > b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
@@ -155,87 +444,15 @@ private:
     }
 
     template<typename T>
-    ALWAYS_INLINE bool if_less_than_or_equal_to(int a, int b, u16 success_branch)
+    ALWAYS_INLINE bool if_less_than_or_equal_to(int a, int b, u32 target)
     {
         if (a <= b)
         {
-            m_program_counter += success_branch;
+            m_program_counter = target;
             return true;
         }
 
         return false;
     }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_equal(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_equal<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_not_equal(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_not_equal<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_less_than(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_less_than<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_greater_than_or_equal_to(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_greater_than_or_equal_to<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_greater_than(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_greater_than<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_less_than_or_equal_to(Value&& a, Value&& b, u16 success_branch)
-    {
-        return if_less_than_or_equal_to<T>(a.get<Integer>().value(), b.get<Integer>().value(), success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_equal(Value&& a, int b, u16 success_branch)
-    {
-        return if_equal<T>(a.get<Integer>().value(), b, success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_not_equal(Value&& a, int b, u16 success_branch)
-    {
-        return if_not_equal<T>(a.get<Integer>().value(), b, success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_less_than(Value&& a, int b, u16 success_branch)
-    {
-        return if_less_than<T>(a.get<Integer>().value(), b, success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_greater_than_or_equal_to(Value&& a, int b, u16 success_branch)
-    {
-        return if_greater_than_or_equal_to<T>(a.get<Integer>().value(), b, success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_greater_than(Value&& a, int b, u16 success_branch)
-    {
-        return if_greater_than<T>(a.get<Integer>().value(), b, success_branch);
-    }
-
-    template<typename T>
-    ALWAYS_INLINE bool if_less_than_or_equal_to(Value&& a, int b, u16 success_branch)
-    {
-        return if_less_than_or_equal_to<T>(a.get<Integer>().value(), b, success_branch);
-    }
 };
 }
\ No newline at end of file
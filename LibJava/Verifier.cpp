@@ -0,0 +1,1245 @@
+#include <LibJava/Descriptor.h>
+#include <LibJava/Verifier.h>
+
+namespace Java
+{
+namespace
+{
+using Type = Verifier::Type;
+using Kind = Verifier::Type::Kind;
+using Frame = Verifier::Frame;
+
+Type type_of(const FieldDescriptor& descriptor)
+{
+    if (descriptor.array_dimensions() > 0)
+    {
+        Optional<PrimitiveType> component_type;
+        if (descriptor.type().has<PrimitiveType>())
+            component_type = descriptor.type().get<PrimitiveType>();
+        return Type::reference(descriptor.array_dimensions(), component_type);
+    }
+
+    if (!descriptor.type().has<PrimitiveType>())
+        return Type::reference();
+
+    // 2.11.1: boolean, byte, char and short are all computed with as ints.
+    switch (descriptor.type().get<PrimitiveType>())
+    {
+        case PrimitiveType::Long:
+            return Type::of(Kind::Long);
+        case PrimitiveType::Float:
+            return Type::of(Kind::Float);
+        case PrimitiveType::Double:
+            return Type::of(Kind::Double);
+        default:
+            return Type::of(Kind::Integer);
+    }
+}
+
+// Array classes are named by their descriptor (4.4.1), every other class by its binary name.
+ErrorOr<Type> type_of_class_name(StringView name)
+{
+    if (!name.starts_with('['))
+        return Type::reference();
+
+    return type_of(TRY(FieldDescriptor::try_parse(name)));
+}
+
+// newarray names the type of its components by a number (6.5 newarray).
+ErrorOr<PrimitiveType> newarray_component_type(i32 array_type)
+{
+    switch (array_type)
+    {
+        case 4:
+            return PrimitiveType::Boolean;
+        case 5:
+            return PrimitiveType::Char;
+        case 6:
+            return PrimitiveType::Float;
+        case 7:
+            return PrimitiveType::Double;
+        case 8:
+            return PrimitiveType::Byte;
+        case 9:
+            return PrimitiveType::Short;
+        case 10:
+            return PrimitiveType::Int;
+        case 11:
+            return PrimitiveType::Long;
+        default:
+            return Error::from_string_literal("Invalid array type in newarray");
+    }
+}
+
+// How many dimensions of an array are arrays of references, as an int[][] is an array of objects that are int[].
+u8 reference_dimensions(const Type& type)
+{
+    return type.component_type.has_value() ? type.array_dimensions - 1 : type.array_dimensions;
+}
+
+// 4.10.1.2 Verification Type System, for as much of it as can be told without loading any classes.
+bool is_assignable(const Type& from, const Type& to)
+{
+    if (from == to || to.kind == Kind::Top)
+        return true;
+
+    if (to.kind != Kind::Reference || !from.is_initialized_reference())
+        return false;
+
+    if (from.kind == Kind::Null || to.array_dimensions == 0)
+        return true;
+
+    if (to.component_type.has_value())
+        return from.array_dimensions == to.array_dimensions && from.component_type == to.component_type;
+
+    return from.array_dimensions > 0 && reference_dimensions(from) >= to.array_dimensions;
+}
+
+// 4.10.2.2: the type that both of the types can be assigned to, and that is as specific as can be.
+Type merge(const Type& a, const Type& b)
+{
+    if (a == b)
+        return a;
+
+    if (!a.is_initialized_reference() || !b.is_initialized_reference())
+        return Type::of(Kind::Top);
+
+    if (a.kind == Kind::Null)
+        return b;
+    if (b.kind == Kind::Null)
+        return a;
+
+    if (a.array_dimensions == 0 || b.array_dimensions == 0)
+        return Type::reference();
+
+    return Type::reference(min(reference_dimensions(a), reference_dimensions(b)));
+}
+
+bool is_branch(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+        case Opcode::goto_:
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Control never carries on to the next instruction after these.
+bool ends_flow(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::goto_:
+        case Opcode::tableswitch:
+        case Opcode::lookupswitch:
+        case Opcode::ireturn:
+        case Opcode::lreturn:
+        case Opcode::freturn:
+        case Opcode::dreturn:
+        case Opcode::areturn:
+        case Opcode::return_:
+        case Opcode::athrow:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The instructions that only take values of a primitive type and give one back, as the kinds of what they pop, from
+// the bottom of the stack up, and of what they push.
+struct Operation
+{
+    Vector<Kind, 2> operands;
+    Optional<Kind> result;
+};
+
+Optional<Operation> primitive_operation(Opcode opcode)
+{
+    switch (opcode)
+    {
+        case Opcode::iadd:
+        case Opcode::isub:
+        case Opcode::imul:
+        case Opcode::idiv:
+        case Opcode::irem:
+        case Opcode::iand:
+        case Opcode::ior:
+        case Opcode::ixor:
+        case Opcode::ishl:
+        case Opcode::ishr:
+        case Opcode::iushr:
+            return Operation{{Kind::Integer, Kind::Integer}, Kind::Integer};
+        case Opcode::ladd:
+        case Opcode::lsub:
+        case Opcode::lmul:
+        case Opcode::ldiv:
+        case Opcode::lrem:
+        case Opcode::land:
+        case Opcode::lor:
+        case Opcode::lxor:
+            return Operation{{Kind::Long, Kind::Long}, Kind::Long};
+        case Opcode::lshl:
+        case Opcode::lshr:
+        case Opcode::lushr:
+            return Operation{{Kind::Long, Kind::Integer}, Kind::Long};
+        case Opcode::fadd:
+        case Opcode::fsub:
+        case Opcode::fmul:
+        case Opcode::fdiv:
+        case Opcode::frem:
+            return Operation{{Kind::Float, Kind::Float}, Kind::Float};
+        case Opcode::dadd:
+        case Opcode::dsub:
+        case Opcode::dmul:
+        case Opcode::ddiv:
+        case Opcode::drem:
+            return Operation{{Kind::Double, Kind::Double}, Kind::Double};
+        case Opcode::ineg:
+        case Opcode::i2b:
+        case Opcode::i2c:
+        case Opcode::i2s:
+            return Operation{{Kind::Integer}, Kind::Integer};
+        case Opcode::lneg:
+            return Operation{{Kind::Long}, Kind::Long};
+        case Opcode::fneg:
+            return Operation{{Kind::Float}, Kind::Float};
+        case Opcode::dneg:
+            return Operation{{Kind::Double}, Kind::Double};
+        case Opcode::i2l:
+            return Operation{{Kind::Integer}, Kind::Long};
+        case Opcode::i2f:
+            return Operation{{Kind::Integer}, Kind::Float};
+        case Opcode::i2d:
+            return Operation{{Kind::Integer}, Kind::Double};
+        case Opcode::l2i:
+            return Operation{{Kind::Long}, Kind::Integer};
+        case Opcode::l2f:
+            return Operation{{Kind::Long}, Kind::Float};
+        case Opcode::l2d:
+            return Operation{{Kind::Long}, Kind::Double};
+        case Opcode::f2i:
+            return Operation{{Kind::Float}, Kind::Integer};
+        case Opcode::f2l:
+            return Operation{{Kind::Float}, Kind::Long};
+        case Opcode::f2d:
+            return Operation{{Kind::Float}, Kind::Double};
+        case Opcode::d2i:
+            return Operation{{Kind::Double}, Kind::Integer};
+        case Opcode::d2l:
+            return Operation{{Kind::Double}, Kind::Long};
+        case Opcode::d2f:
+            return Operation{{Kind::Double}, Kind::Float};
+        case Opcode::lcmp:
+            return Operation{{Kind::Long, Kind::Long}, Kind::Integer};
+        case Opcode::fcmpl:
+        case Opcode::fcmpg:
+            return Operation{{Kind::Float, Kind::Float}, Kind::Integer};
+        case Opcode::dcmpl:
+        case Opcode::dcmpg:
+            return Operation{{Kind::Double, Kind::Double}, Kind::Integer};
+        case Opcode::ifeq:
+        case Opcode::ifne:
+        case Opcode::iflt:
+        case Opcode::ifge:
+        case Opcode::ifgt:
+        case Opcode::ifle:
+        case Opcode::tableswitch:
+        case Opcode::lookupswitch:
+            return Operation{{Kind::Integer}, {}};
+        case Opcode::if_icmpeq:
+        case Opcode::if_icmpne:
+        case Opcode::if_icmplt:
+        case Opcode::if_icmpge:
+        case Opcode::if_icmpgt:
+        case Opcode::if_icmple:
+            return Operation{{Kind::Integer, Kind::Integer}, {}};
+        case Opcode::iconst_m1:
+        case Opcode::iconst_0:
+        case Opcode::iconst_1:
+        case Opcode::iconst_2:
+        case Opcode::iconst_3:
+        case Opcode::iconst_4:
+        case Opcode::iconst_5:
+        case Opcode::bipush:
+        case Opcode::sipush:
+            return Operation{{}, Kind::Integer};
+        case Opcode::lconst_0:
+        case Opcode::lconst_1:
+            return Operation{{}, Kind::Long};
+        case Opcode::fconst_0:
+        case Opcode::fconst_1:
+        case Opcode::fconst_2:
+            return Operation{{}, Kind::Float};
+        case Opcode::dconst_0:
+        case Opcode::dconst_1:
+            return Operation{{}, Kind::Double};
+        case Opcode::nop:
+        case Opcode::goto_:
+            return Operation{{}, {}};
+        default:
+            return {};
+    }
+}
+
+class MethodVerifier
+{
+public:
+    MethodVerifier(const ClassFile& class_file, const ClassFile::MethodInfo& method, const DecodedCode& decoded_code)
+        : m_class_file(class_file), m_method(method), m_decoded_code(decoded_code), m_code(decoded_code.code()),
+          m_instructions(decoded_code.unfused_instructions())
+    {
+    }
+
+    ErrorOr<Vector<Optional<Frame>>> verify();
+
+private:
+    ErrorOr<Frame> initial_frame();
+    ErrorOr<void> apply_stack_map_table(const Frame& initial_frame);
+    ErrorOr<Type> declared_type(const ClassFile::VerificationTypeInfo&) const;
+    ErrorOr<void> flow(u32 to, const Frame&, bool needs_frame);
+    ErrorOr<void> execute(size_t index, Frame&);
+    ErrorOr<void> execute_invoke(const Instruction&, Frame&);
+
+    ErrorOr<void> push(Frame&, const Type&) const;
+    ErrorOr<Type> pop(Frame&) const;
+    ErrorOr<Type> pop(Frame&, const Type& expected) const;
+    ErrorOr<Type> pop_array(Frame&) const;
+    ErrorOr<void> pop_array_of(Frame&, Span<const PrimitiveType> component_types) const;
+    ErrorOr<Type> load(Frame&, i32 index) const;
+    ErrorOr<void> store(Frame&, i32 index, const Type&) const;
+
+    ErrorOr<StringView> utf8(u16 index) const;
+    template<typename T>
+    ErrorOr<const T*> constant(u16 index) const;
+    ErrorOr<Type> class_type(u16 class_index) const;
+    ErrorOr<ClassFile::NameAndType> member_name_and_type(u16 index) const;
+
+    const ClassFile& m_class_file;
+    const ClassFile::MethodInfo& m_method;
+    const DecodedCode& m_decoded_code;
+    const ClassFile::Code& m_code;
+    Vector<Instruction> m_instructions;
+    // From the offset of every instruction in the code to its index.
+    Vector<Optional<u32>> m_index_of_pc;
+    Variant<FieldDescriptor, Empty> m_return_type{Empty{}};
+
+    Vector<Optional<Frame>> m_frames;
+    // 4.10.1: with a StackMapTable, the types at the instructions it has frames for are given, and are only checked
+    // against.
+    bool m_is_type_checking{};
+    Vector<bool> m_is_declared;
+    Vector<u32> m_worklist;
+    Vector<bool> m_is_queued;
+};
+
+ErrorOr<Vector<Optional<Frame>>> MethodVerifier::verify()
+{
+    m_index_of_pc.resize(m_code.code.size());
+    for (size_t i = 0; i < m_instructions.size(); i++)
+        m_index_of_pc[m_instructions[i].pc] = i;
+
+    m_frames.resize(m_instructions.size());
+    m_is_declared.resize(m_instructions.size());
+    m_is_queued.resize(m_instructions.size());
+
+    auto initial = TRY(initial_frame());
+    m_is_type_checking = m_code.stack_map_table.has_value();
+    if (m_is_type_checking)
+        TRY(apply_stack_map_table(initial));
+
+    TRY(flow(0, initial, false));
+    // Even the frames that nothing branches to are still checked.
+    for (u32 i = 0; i < m_instructions.size(); i++)
+    {
+        if (m_is_declared[i] && !m_is_queued[i])
+        {
+            m_is_queued[i] = true;
+            m_worklist.append(i);
+        }
+    }
+
+    for (auto& exception_handler : m_code.exception_table)
+    {
+        if (exception_handler.start_pc >= exception_handler.end_pc ||
+            exception_handler.end_pc > m_code.code.size() || !m_index_of_pc[exception_handler.start_pc].has_value() ||
+            (exception_handler.end_pc < m_code.code.size() && !m_index_of_pc[exception_handler.end_pc].has_value()) ||
+            exception_handler.handler_pc >= m_code.code.size() ||
+            !m_index_of_pc[exception_handler.handler_pc].has_value())
+            return Error::from_string_literal("VerifyError: exception handler is not at an instruction");
+
+        if (exception_handler.catch_type != 0)
+            TRY(constant<ClassFile::Class>(exception_handler.catch_type));
+    }
+
+    while (!m_worklist.is_empty())
+    {
+        auto index = m_worklist.take_last();
+        m_is_queued[index] = false;
+
+        auto frame = m_frames[index].value();
+        auto& instruction = m_instructions[index];
+
+        // 4.10.1.6: an exception handler gets the locals as they are both before and after the instruction that
+        // throws, and nothing but the exception on the stack.
+        auto flow_to_exception_handlers = [&](const Frame& frame) -> ErrorOr<void> {
+            for (auto& exception_handler : m_code.exception_table)
+            {
+                if (instruction.pc < exception_handler.start_pc || instruction.pc >= exception_handler.end_pc)
+                    continue;
+
+                Frame handler_frame{frame.locals, {Type::reference()}};
+                TRY(flow(m_index_of_pc[exception_handler.handler_pc].value(), handler_frame, true));
+            }
+            return {};
+        };
+        TRY(flow_to_exception_handlers(frame));
+
+        TRY(execute(index, frame));
+        TRY(flow_to_exception_handlers(frame));
+
+        if (is_branch(instruction.opcode))
+            TRY(flow(instruction.operand, frame, true));
+
+        if (instruction.opcode == Opcode::tableswitch || instruction.opcode == Opcode::lookupswitch)
+        {
+            auto& table = m_decoded_code.switch_tables()[instruction.operand];
+            TRY(flow(table.default_target, frame, true));
+            for (auto& switch_case : table.cases)
+                TRY(flow(switch_case.target, frame, true));
+        }
+
+        if (!ends_flow(instruction.opcode))
+        {
+            if (index + 1 == m_instructions.size())
+                return Error::from_string_literal("VerifyError: falling off the end of the code");
+
+            TRY(flow(index + 1, frame, false));
+        }
+    }
+
+    return move(m_frames);
+}
+
+// 4.10.1.6: the locals start out as this, unless the method is static, followed by the parameters. Only
+// java/lang/Object has nothing to invoke an instance initialization method of before this counts as initialized.
+ErrorOr<Frame> MethodVerifier::initial_frame()
+{
+    auto name = TRY(utf8(m_method.name_index));
+    auto descriptor = TRY(MethodDescriptor::try_parse(TRY(utf8(m_method.descriptor_index))));
+    m_return_type = descriptor.return_type();
+
+    Frame frame;
+    if (!has_flag(m_method.access_flags, ClassFile::MethodInfo::AccessFlags::Static))
+    {
+        auto class_name = TRY(utf8(m_class_file.this_class().name_index));
+        auto is_instance_initializer = name == "<init>"sv && class_name != "java/lang/Object"sv;
+        frame.locals.append(is_instance_initializer ? Type::of(Kind::UninitializedThis) : Type::reference());
+    }
+
+    for (auto& parameter : descriptor.parameters())
+    {
+        auto type = type_of(parameter);
+        frame.locals.append(type);
+        if (type.is_category_2())
+            frame.locals.append(Type::of(Kind::Top));
+    }
+
+    if (frame.locals.size() > m_code.max_locals)
+        return Error::from_string_literal("VerifyError: parameters don't fit into max_locals");
+
+    frame.locals.resize(m_code.max_locals);
+    return frame;
+}
+
+// 4.7.4: "the bytecode offset at which a frame applies is calculated by taking the value offset_delta specified in
+// the frame [...] and adding offset_delta + 1 to the bytecode offset of the previous frame, unless the previous frame
+// is the initial frame of the method. In that case, the bytecode offset is offset_delta."
+// The frames that only say how they differ from the previous one do so in terms of its locals as they are given, with
+// one entry for a long or double, so those are kept around as such.
+ErrorOr<void> MethodVerifier::apply_stack_map_table(const Frame& initial_frame)
+{
+    Vector<Type> locals;
+    for (size_t i = 0; i < initial_frame.locals.size(); i++)
+    {
+        if (i > 0 && initial_frame.locals[i - 1].is_category_2())
+            continue;
+        locals.append(initial_frame.locals[i]);
+    }
+    // No parameter is ever Top, so these are only what is left of max_locals.
+    while (!locals.is_empty() && locals.last().kind == Kind::Top)
+        locals.take_last();
+
+    auto types_of = [&](Span<const ClassFile::VerificationTypeInfo> infos) -> ErrorOr<Vector<Type>> {
+        Vector<Type> types;
+        for (auto& info : infos)
+            types.append(TRY(declared_type(info)));
+        return types;
+    };
+
+    size_t offset = 0;
+    auto& entries = m_code.stack_map_table->entries;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        auto& entry = entries[i];
+        offset = i == 0 ? entry.offset_delta : offset + entry.offset_delta + 1;
+        if (offset >= m_code.code.size() || !m_index_of_pc[offset].has_value())
+            return Error::from_string_literal("VerifyError: StackMapTable frame is not at an instruction");
+
+        Vector<Type> stack;
+        switch (entry.kind)
+        {
+            case ClassFile::StackMapFrame::Kind::Same:
+                break;
+            case ClassFile::StackMapFrame::Kind::SameLocals1StackItem:
+                stack = TRY(types_of(entry.stack));
+                break;
+            case ClassFile::StackMapFrame::Kind::Chop:
+                if (entry.chopped_locals > locals.size())
+                    return Error::from_string_literal("VerifyError: StackMapTable chops more locals than there are");
+                locals.shrink(locals.size() - entry.chopped_locals);
+                break;
+            case ClassFile::StackMapFrame::Kind::Append:
+                locals.extend(TRY(types_of(entry.locals)));
+                break;
+            case ClassFile::StackMapFrame::Kind::Full:
+                locals = TRY(types_of(entry.locals));
+                stack = TRY(types_of(entry.stack));
+                break;
+        }
+
+        Frame frame;
+        auto expand = [](Vector<Type>& slots, const Vector<Type>& types) {
+            for (auto& type : types)
+            {
+                slots.append(type);
+                if (type.is_category_2())
+                    slots.append(Type::of(Kind::Top));
+            }
+        };
+        expand(frame.locals, locals);
+        expand(frame.stack, stack);
+        if (frame.locals.size() > m_code.max_locals || frame.stack.size() > m_code.max_stacks)
+            return Error::from_string_literal("VerifyError: StackMapTable frame doesn't fit into the frame");
+        frame.locals.resize(m_code.max_locals);
+
+        auto index = m_index_of_pc[offset].value();
+        m_frames[index] = move(frame);
+        m_is_declared[index] = true;
+    }
+
+    return {};
+}
+
+ErrorOr<Type> MethodVerifier::declared_type(const ClassFile::VerificationTypeInfo& info) const
+{
+    using Tag = ClassFile::VerificationTypeInfo::Tag;
+    switch (info.tag)
+    {
+        case Tag::Top:
+            return Type::of(Kind::Top);
+        case Tag::Integer:
+            return Type::of(Kind::Integer);
+        case Tag::Float:
+            return Type::of(Kind::Float);
+        case Tag::Long:
+            return Type::of(Kind::Long);
+        case Tag::Double:
+            return Type::of(Kind::Double);
+        case Tag::Null:
+            return Type::of(Kind::Null);
+        case Tag::UninitializedThis:
+            return Type::of(Kind::UninitializedThis);
+        case Tag::Object:
+            return class_type(info.operand);
+        case Tag::Uninitialized:
+            if (info.operand >= m_code.code.size() || !m_index_of_pc[info.operand].has_value() ||
+                m_instructions[m_index_of_pc[info.operand].value()].opcode != Opcode::new_)
+                return Error::from_string_literal("VerifyError: Uninitialized is not at a new instruction");
+            return Type::uninitialized(info.operand);
+    }
+    VERIFY_NOT_REACHED();
+}
+
+ErrorOr<void> MethodVerifier::flow(u32 to, const Frame& frame, bool needs_frame)
+{
+    if (to >= m_instructions.size())
+        return Error::from_string_literal("VerifyError: branch target is past the end of the code");
+
+    auto enqueue = [&] {
+        if (!m_is_queued[to])
+        {
+            m_is_queued[to] = true;
+            m_worklist.append(to);
+        }
+    };
+
+    if (m_is_type_checking)
+    {
+        // 4.10.1.4: "If an instruction is the target of a branch, [...] then it must have a stack map frame". Anything
+        // else only ever gets here from the instruction right before it.
+        if (!m_is_declared[to])
+        {
+            if (needs_frame)
+                return Error::from_string_literal("VerifyError: branch target has no StackMapTable frame");
+
+            m_frames[to] = frame;
+            enqueue();
+            return {};
+        }
+
+        auto& declared = m_frames[to].value();
+        if (frame.stack.size() != declared.stack.size())
+            return Error::from_string_literal("VerifyError: stack depth differs from the StackMapTable frame");
+
+        for (size_t i = 0; i < frame.locals.size(); i++)
+        {
+            if (!is_assignable(frame.locals[i], declared.locals[i]))
+                return Error::from_string_literal("VerifyError: local variable doesn't match the StackMapTable frame");
+        }
+        for (size_t i = 0; i < frame.stack.size(); i++)
+        {
+            if (!is_assignable(frame.stack[i], declared.stack[i]))
+                return Error::from_string_literal("VerifyError: operand stack doesn't match the StackMapTable frame");
+        }
+        return {};
+    }
+
+    if (!m_frames[to].has_value())
+    {
+        m_frames[to] = frame;
+        enqueue();
+        return {};
+    }
+
+    // 4.10.2.2: the types where control merges are whatever they are on every way there.
+    auto& existing = m_frames[to].value();
+    if (frame.stack.size() != existing.stack.size())
+        return Error::from_string_literal("VerifyError: stack depth differs between branches");
+
+    bool changed = false;
+    auto merge_into = [&](Vector<Type>& existing_types, const Vector<Type>& types) {
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            auto merged = merge(existing_types[i], types[i]);
+            if (merged != existing_types[i])
+            {
+                existing_types[i] = merged;
+                changed = true;
+            }
+        }
+    };
+    merge_into(existing.locals, frame.locals);
+    merge_into(existing.stack, frame.stack);
+
+    if (changed)
+        enqueue();
+    return {};
+}
+
+ErrorOr<void> MethodVerifier::push(Frame& frame, const Type& type) const
+{
+    auto slots = type.is_category_2() ? 2 : 1;
+    if (frame.stack.size() + slots > m_code.max_stacks)
+        return Error::from_string_literal("VerifyError: operand stack overflow");
+
+    frame.stack.append(type);
+    if (type.is_category_2())
+        frame.stack.append(Type::of(Kind::Top));
+    return {};
+}
+
+// Pops a single slot, whatever is in it.
+ErrorOr<Type> MethodVerifier::pop(Frame& frame) const
+{
+    if (frame.stack.is_empty())
+        return Error::from_string_literal("VerifyError: operand stack underflow");
+
+    return frame.stack.take_last();
+}
+
+// Pops a value that has to be assignable to the given type, in as many slots as that takes.
+ErrorOr<Type> MethodVerifier::pop(Frame& frame, const Type& expected) const
+{
+    if (expected.is_category_2())
+    {
+        auto second_half = TRY(pop(frame));
+        auto value = TRY(pop(frame));
+        if (second_half.kind != Kind::Top || value.kind != expected.kind)
+            return Error::from_string_literal("VerifyError: operand is not of the expected type");
+        return value;
+    }
+
+    auto value = TRY(pop(frame));
+    if (expected.kind == Kind::Reference ? !is_assignable(value, expected) : value.kind != expected.kind)
+        return Error::from_string_literal("VerifyError: operand is not of the expected type");
+    return value;
+}
+
+ErrorOr<Type> MethodVerifier::pop_array(Frame& frame) const
+{
+    auto array = TRY(pop(frame));
+    if (array.kind != Kind::Null && (array.kind != Kind::Reference || array.array_dimensions == 0))
+        return Error::from_string_literal("VerifyError: operand is not an array");
+    return array;
+}
+
+// baload works on both byte[] and boolean[], which is why there can be more than one.
+ErrorOr<void> MethodVerifier::pop_array_of(Frame& frame, Span<const PrimitiveType> component_types) const
+{
+    TRY(pop(frame, Type::of(Kind::Integer)));
+    auto array = TRY(pop_array(frame));
+    if (array.kind == Kind::Null)
+        return {};
+
+    for (auto component_type : component_types)
+    {
+        if (array.array_dimensions == 1 && array.component_type == component_type)
+            return {};
+    }
+    return Error::from_string_literal("VerifyError: array is not of the expected type");
+}
+
+ErrorOr<Type> MethodVerifier::load(Frame& frame, i32 index) const
+{
+    if (index < 0 || static_cast<size_t>(index) >= frame.locals.size())
+        return Error::from_string_literal("VerifyError: local variable index out of range");
+
+    auto type = frame.locals[index];
+    if (type.is_category_2() &&
+        (static_cast<size_t>(index) + 1 >= frame.locals.size() || frame.locals[index + 1].kind != Kind::Top))
+        return Error::from_string_literal("VerifyError: local variable index out of range");
+
+    TRY(push(frame, type));
+    return type;
+}
+
+// 4.10.1.7: storing into the second half of a long or double leaves the first half unusable.
+ErrorOr<void> MethodVerifier::store(Frame& frame, i32 index, const Type& type) const
+{
+    auto slots = type.is_category_2() ? 2 : 1;
+    if (index < 0 || static_cast<size_t>(index) + slots > frame.locals.size())
+        return Error::from_string_literal("VerifyError: local variable index out of range");
+
+    if (index > 0 && frame.locals[index - 1].is_category_2())
+        frame.locals[index - 1] = Type::of(Kind::Top);
+
+    frame.locals[index] = type;
+    if (type.is_category_2())
+        frame.locals[index + 1] = Type::of(Kind::Top);
+    return {};
+}
+
+ErrorOr<StringView> MethodVerifier::utf8(u16 index) const
+{
+    return TRY(constant<ClassFile::Utf8>(index))->value;
+}
+
+template<typename T>
+ErrorOr<const T*> MethodVerifier::constant(u16 index) const
+{
+    auto constant_pool = m_class_file.constant_pool();
+    if (index == 0 || index > constant_pool.size() || !constant_pool[index - 1].has<T>())
+        return Error::from_string_literal("VerifyError: constant pool entry is not of the expected type");
+
+    return &constant_pool[index - 1].get<T>();
+}
+
+ErrorOr<Type> MethodVerifier::class_type(u16 class_index) const
+{
+    return type_of_class_name(TRY(utf8(TRY(constant<ClassFile::Class>(class_index))->name_index)));
+}
+
+ErrorOr<ClassFile::NameAndType> MethodVerifier::member_name_and_type(u16 index) const
+{
+    auto constant_pool = m_class_file.constant_pool();
+    if (index == 0 || index > constant_pool.size())
+        return Error::from_string_literal("VerifyError: constant pool index out of range");
+
+    u16 name_and_type_index = 0;
+    auto& member = constant_pool[index - 1];
+    if (member.has<ClassFile::FieldRef>())
+        name_and_type_index = member.get<ClassFile::FieldRef>().name_and_type_index;
+    else if (member.has<ClassFile::MethodRef>())
+        name_and_type_index = member.get<ClassFile::MethodRef>().name_and_type_index;
+    else if (member.has<ClassFile::InterfaceMethodRef>())
+        name_and_type_index = member.get<ClassFile::InterfaceMethodRef>().name_and_type_index;
+    else if (member.has<ClassFile::InvokeDynamic>())
+        name_and_type_index = member.get<ClassFile::InvokeDynamic>().name_and_type_index;
+    else
+        return Error::from_string_literal("VerifyError: constant pool entry is not a member reference");
+
+    return *TRY(constant<ClassFile::NameAndType>(name_and_type_index));
+}
+
+ErrorOr<void> MethodVerifier::execute(size_t index, Frame& frame)
+{
+    auto& instruction = m_instructions[index];
+
+    if (auto operation = primitive_operation(instruction.opcode); operation.has_value())
+    {
+        for (size_t i = operation->operands.size(); i > 0; i--)
+            TRY(pop(frame, Type::of(operation->operands[i - 1])));
+        if (operation->result.has_value())
+            TRY(push(frame, Type::of(operation->result.value())));
+        return {};
+    }
+
+    // Pops the given groups of slots and pushes them back in the given order, which counts from the top down. No
+    // category 2 value may be split in two, which it would be if the lowest slot of a group is the second half of one.
+    auto shuffle = [&](std::initializer_list<size_t> groups, std::initializer_list<size_t> order) -> ErrorOr<void> {
+        size_t count = 0;
+        for (auto group : groups)
+        {
+            count += group;
+            if (frame.stack.size() < count)
+                return Error::from_string_literal("VerifyError: operand stack underflow");
+
+            auto& lowest = frame.stack[frame.stack.size() - count];
+            if (lowest.kind == Kind::Top || (group == 1 && lowest.is_category_2()))
+                return Error::from_string_literal("VerifyError: category 2 value is split in two");
+        }
+
+        Vector<Type, 4> values;
+        for (size_t i = 0; i < count; i++)
+            values.append(TRY(pop(frame)));
+        for (auto i : order)
+        {
+            if (frame.stack.size() == m_code.max_stacks)
+                return Error::from_string_literal("VerifyError: operand stack overflow");
+            frame.stack.append(values[i]);
+        }
+        return {};
+    };
+
+    switch (instruction.opcode)
+    {
+        case Opcode::aconst_null:
+            return push(frame, Type::of(Kind::Null));
+
+        case Opcode::ldc:
+        {
+            auto constant_pool = m_class_file.constant_pool();
+            if (instruction.operand <= 0 || static_cast<size_t>(instruction.operand) > constant_pool.size())
+                return Error::from_string_literal("VerifyError: constant pool index out of range");
+
+            auto& constant = constant_pool[instruction.operand - 1];
+            if (constant.has<Integer>())
+                return push(frame, Type::of(Kind::Integer));
+            if (constant.has<Float>())
+                return push(frame, Type::of(Kind::Float));
+            if (constant.has<ClassFile::String>() || constant.has<ClassFile::Class>() ||
+                constant.has<ClassFile::MethodType>() || constant.has<ClassFile::MethodHandle>())
+                return push(frame, Type::reference());
+            return Error::from_string_literal("VerifyError: ldc of a constant that can't be loaded");
+        }
+        case Opcode::ldc2_w:
+        {
+            auto constant_pool = m_class_file.constant_pool();
+            if (instruction.operand <= 0 || static_cast<size_t>(instruction.operand) > constant_pool.size())
+                return Error::from_string_literal("VerifyError: constant pool index out of range");
+
+            auto& constant = constant_pool[instruction.operand - 1];
+            if (constant.has<Long>())
+                return push(frame, Type::of(Kind::Long));
+            if (constant.has<Double>())
+                return push(frame, Type::of(Kind::Double));
+            return Error::from_string_literal("VerifyError: ldc2_w of a constant that isn't a long or double");
+        }
+
+        case Opcode::iload:
+        case Opcode::lload:
+        case Opcode::fload:
+        case Opcode::dload:
+        case Opcode::aload:
+        {
+            auto type = TRY(load(frame, instruction.operand));
+            auto expected = instruction.opcode == Opcode::iload   ? Kind::Integer
+                            : instruction.opcode == Opcode::lload ? Kind::Long
+                            : instruction.opcode == Opcode::fload ? Kind::Float
+                            : instruction.opcode == Opcode::dload ? Kind::Double
+                                                                  : Kind::Reference;
+            if (expected == Kind::Reference ? !type.is_reference() : type.kind != expected)
+                return Error::from_string_literal("VerifyError: local variable is not of the expected type");
+            return {};
+        }
+        case Opcode::istore:
+            return store(frame, instruction.operand, TRY(pop(frame, Type::of(Kind::Integer))));
+        case Opcode::lstore:
+            return store(frame, instruction.operand, TRY(pop(frame, Type::of(Kind::Long))));
+        case Opcode::fstore:
+            return store(frame, instruction.operand, TRY(pop(frame, Type::of(Kind::Float))));
+        case Opcode::dstore:
+            return store(frame, instruction.operand, TRY(pop(frame, Type::of(Kind::Double))));
+        case Opcode::astore:
+        {
+            auto value = TRY(pop(frame));
+            if (!value.is_reference())
+                return Error::from_string_literal("VerifyError: astore of something that is not a reference");
+            return store(frame, instruction.operand, value);
+        }
+        case Opcode::iinc:
+        {
+            if (instruction.operand < 0 || static_cast<size_t>(instruction.operand) >= frame.locals.size() ||
+                frame.locals[instruction.operand].kind != Kind::Integer)
+                return Error::from_string_literal("VerifyError: iinc of a local variable that is not an int");
+            return {};
+        }
+
+        case Opcode::iaload:
+        case Opcode::baload:
+        case Opcode::caload:
+        case Opcode::saload:
+        {
+            static constexpr PrimitiveType ints[] = {PrimitiveType::Int};
+            static constexpr PrimitiveType bytes[] = {PrimitiveType::Byte, PrimitiveType::Boolean};
+            static constexpr PrimitiveType chars[] = {PrimitiveType::Char};
+            static constexpr PrimitiveType shorts[] = {PrimitiveType::Short};
+            TRY(pop_array_of(frame, instruction.opcode == Opcode::iaload   ? Span<const PrimitiveType>(ints)
+                                    : instruction.opcode == Opcode::baload ? Span<const PrimitiveType>(bytes)
+                                    : instruction.opcode == Opcode::caload ? Span<const PrimitiveType>(chars)
+                                                                           : Span<const PrimitiveType>(shorts)));
+            return push(frame, Type::of(Kind::Integer));
+        }
+        case Opcode::laload:
+        {
+            static constexpr PrimitiveType longs[] = {PrimitiveType::Long};
+            TRY(pop_array_of(frame, longs));
+            return push(frame, Type::of(Kind::Long));
+        }
+        case Opcode::faload:
+        {
+            static constexpr PrimitiveType floats[] = {PrimitiveType::Float};
+            TRY(pop_array_of(frame, floats));
+            return push(frame, Type::of(Kind::Float));
+        }
+        case Opcode::daload:
+        {
+            static constexpr PrimitiveType doubles[] = {PrimitiveType::Double};
+            TRY(pop_array_of(frame, doubles));
+            return push(frame, Type::of(Kind::Double));
+        }
+        case Opcode::aaload:
+        {
+            TRY(pop(frame, Type::of(Kind::Integer)));
+            auto array = TRY(pop_array(frame));
+            if (array.kind == Kind::Null)
+                return push(frame, Type::of(Kind::Null));
+            if (reference_dimensions(array) == 0)
+                return Error::from_string_literal("VerifyError: aaload from an array of a primitive type");
+
+            auto dimensions = static_cast<u8>(array.array_dimensions - 1);
+            auto component_type = dimensions > 0 ? array.component_type : Optional<PrimitiveType>{};
+            return push(frame, Type::reference(dimensions, component_type));
+        }
+        case Opcode::iastore:
+        case Opcode::bastore:
+        case Opcode::castore:
+        case Opcode::sastore:
+        {
+            static constexpr PrimitiveType ints[] = {PrimitiveType::Int};
+            static constexpr PrimitiveType bytes[] = {PrimitiveType::Byte, PrimitiveType::Boolean};
+            static constexpr PrimitiveType chars[] = {PrimitiveType::Char};
+            static constexpr PrimitiveType shorts[] = {PrimitiveType::Short};
+            TRY(pop(frame, Type::of(Kind::Integer)));
+            return pop_array_of(frame, instruction.opcode == Opcode::iastore   ? Span<const PrimitiveType>(ints)
+                                       : instruction.opcode == Opcode::bastore ? Span<const PrimitiveType>(bytes)
+                                       : instruction.opcode == Opcode::castore ? Span<const PrimitiveType>(chars)
+                                                                               : Span<const PrimitiveType>(shorts));
+        }
+        case Opcode::lastore:
+        {
+            static constexpr PrimitiveType longs[] = {PrimitiveType::Long};
+            TRY(pop(frame, Type::of(Kind::Long)));
+            return pop_array_of(frame, longs);
+        }
+        case Opcode::fastore:
+        {
+            static constexpr PrimitiveType floats[] = {PrimitiveType::Float};
+            TRY(pop(frame, Type::of(Kind::Float)));
+            return pop_array_of(frame, floats);
+        }
+        case Opcode::dastore:
+        {
+            static constexpr PrimitiveType doubles[] = {PrimitiveType::Double};
+            TRY(pop(frame, Type::of(Kind::Double)));
+            return pop_array_of(frame, doubles);
+        }
+        // Whether the value fits into the array is checked when it is stored (ArrayStoreException).
+        case Opcode::aastore:
+        {
+            TRY(pop(frame, Type::reference()));
+            TRY(pop(frame, Type::of(Kind::Integer)));
+            auto array = TRY(pop_array(frame));
+            if (array.kind != Kind::Null && reference_dimensions(array) == 0)
+                return Error::from_string_literal("VerifyError: aastore into an array of a primitive type");
+            return {};
+        }
+        case Opcode::arraylength:
+            TRY(pop_array(frame));
+            return push(frame, Type::of(Kind::Integer));
+
+        case Opcode::pop:
+            return shuffle({1}, {});
+        case Opcode::pop2:
+            return shuffle({2}, {});
+        case Opcode::dup:
+            return shuffle({1}, {0, 0});
+        case Opcode::dup_x1:
+            return shuffle({1, 1}, {0, 1, 0});
+        case Opcode::dup_x2:
+            return shuffle({1, 2}, {0, 2, 1, 0});
+        case Opcode::dup2:
+            return shuffle({2}, {1, 0, 1, 0});
+        case Opcode::dup2_x1:
+            return shuffle({2, 1}, {1, 0, 2, 1, 0});
+        case Opcode::dup2_x2:
+            return shuffle({2, 2}, {1, 0, 3, 2, 1, 0});
+        case Opcode::swap:
+            return shuffle({1, 1}, {0, 1});
+
+        case Opcode::if_acmpeq:
+        case Opcode::if_acmpne:
+            TRY(pop(frame, Type::reference()));
+            TRY(pop(frame, Type::reference()));
+            return {};
+        case Opcode::ifnull:
+        case Opcode::ifnonnull:
+        case Opcode::monitorenter:
+        case Opcode::monitorexit:
+        case Opcode::athrow:
+            TRY(pop(frame, Type::reference()));
+            return {};
+
+        case Opcode::ireturn:
+        case Opcode::lreturn:
+        case Opcode::freturn:
+        case Opcode::dreturn:
+        case Opcode::areturn:
+        {
+            if (!m_return_type.has<FieldDescriptor>())
+                return Error::from_string_literal("VerifyError: returning a value from a void method");
+
+            auto return_type = type_of(m_return_type.get<FieldDescriptor>());
+            auto expected = instruction.opcode == Opcode::ireturn   ? Kind::Integer
+                            : instruction.opcode == Opcode::lreturn ? Kind::Long
+                            : instruction.opcode == Opcode::freturn ? Kind::Float
+                            : instruction.opcode == Opcode::dreturn ? Kind::Double
+                                                                    : Kind::Reference;
+            if (return_type.kind != expected)
+                return Error::from_string_literal("VerifyError: return instruction doesn't match the return type");
+
+            TRY(pop(frame, return_type));
+            return {};
+        }
+        // 4.10.1.9 return: "If the method is an instance initialization method, then it must [...] have invoked an
+        // instance initialization method on this".
+        case Opcode::return_:
+        {
+            if (m_return_type.has<FieldDescriptor>())
+                return Error::from_string_literal("VerifyError: return from a method that returns a value");
+
+            for (auto& type : frame.locals)
+            {
+                if (type.kind == Kind::UninitializedThis)
+                    return Error::from_string_literal("VerifyError: returning before this has been initialized");
+            }
+            return {};
+        }
+
+        case Opcode::getstatic:
+        case Opcode::putstatic:
+        case Opcode::getfield:
+        case Opcode::putfield:
+        {
+            TRY(constant<ClassFile::FieldRef>(instruction.operand));
+            auto name_and_type = TRY(member_name_and_type(instruction.operand));
+            auto field = type_of(TRY(FieldDescriptor::try_parse(TRY(utf8(name_and_type.descriptor_index)))));
+
+            if (instruction.opcode == Opcode::getstatic)
+                return push(frame, field);
+            if (instruction.opcode == Opcode::putstatic)
+            {
+                TRY(pop(frame, field));
+                return {};
+            }
+            if (instruction.opcode == Opcode::putfield)
+                TRY(pop(frame, field));
+
+            // 4.10.1.9 putfield: the fields of this may be set before the superclass has initialized it.
+            auto object = TRY(pop(frame));
+            if (!object.is_initialized_reference() &&
+                !(instruction.opcode == Opcode::putfield && object.kind == Kind::UninitializedThis))
+                return Error::from_string_literal("VerifyError: field of something that is not an object");
+            if (object.array_dimensions > 0)
+                return Error::from_string_literal("VerifyError: field of an array");
+
+            if (instruction.opcode == Opcode::getfield)
+                return push(frame, field);
+            return {};
+        }
+
+        case Opcode::invokevirtual:
+        case Opcode::invokespecial:
+        case Opcode::invokestatic:
+        case Opcode::invokeinterface:
+        case Opcode::invokedynamic:
+            return execute_invoke(instruction, frame);
+
+        // 4.10.1.9 new: whatever an earlier pass through this same instruction created is gone by now.
+        case Opcode::new_:
+        {
+            auto type = TRY(class_type(instruction.operand));
+            if (type.array_dimensions > 0)
+                return Error::from_string_literal("VerifyError: new of an array class");
+
+            auto uninitialized = Type::uninitialized(instruction.pc);
+            for (auto& local : frame.locals)
+            {
+                if (local == uninitialized)
+                    local = Type::of(Kind::Top);
+            }
+            if (frame.stack.contains_slow(uninitialized))
+                return Error::from_string_literal("VerifyError: new while its previous object is still on the stack");
+            return push(frame, uninitialized);
+        }
+        case Opcode::newarray:
+        {
+            TRY(pop(frame, Type::of(Kind::Integer)));
+            return push(frame, Type::reference(1, TRY(newarray_component_type(instruction.second_operand))));
+        }
+        case Opcode::anewarray:
+        {
+            TRY(pop(frame, Type::of(Kind::Integer)));
+            auto component = TRY(class_type(instruction.operand));
+            if (component.array_dimensions == 255)
+                return Error::from_string_literal("VerifyError: array has more than 255 dimensions");
+            return push(frame, Type::reference(component.array_dimensions + 1, component.component_type));
+        }
+        case Opcode::multianewarray:
+        {
+            auto type = TRY(class_type(instruction.operand));
+            if (instruction.second_operand < 1 || instruction.second_operand > type.array_dimensions)
+                return Error::from_string_literal("VerifyError: multianewarray with more dimensions than its class");
+
+            for (i32 i = 0; i < instruction.second_operand; i++)
+                TRY(pop(frame, Type::of(Kind::Integer)));
+            return push(frame, type);
+        }
+
+        case Opcode::checkcast:
+            TRY(pop(frame, Type::reference()));
+            return push(frame, TRY(class_type(instruction.operand)));
+        case Opcode::instanceof:
+            TRY(class_type(instruction.operand));
+            TRY(pop(frame, Type::reference()));
+            return push(frame, Type::of(Kind::Integer));
+
+        // 4.10.1.9: "jsr and jsr_w may not be used" for version 50.0 and above, and we don't run them for anything
+        // older either.
+        case Opcode::jsr:
+        case Opcode::ret:
+            return Error::from_string_literal("VerifyError: subroutines are not supported");
+
+        default:
+            return Error::from_string_literal("VerifyError: invalid instruction");
+    }
+}
+
+ErrorOr<void> MethodVerifier::execute_invoke(const Instruction& instruction, Frame& frame)
+{
+    auto name_and_type = TRY(member_name_and_type(instruction.operand));
+    auto& member = m_class_file.constant_pool()[instruction.operand - 1];
+    bool is_method_of_the_right_kind = false;
+    switch (instruction.opcode)
+    {
+        case Opcode::invokedynamic:
+            is_method_of_the_right_kind = member.has<ClassFile::InvokeDynamic>();
+            break;
+        case Opcode::invokeinterface:
+            is_method_of_the_right_kind = member.has<ClassFile::InterfaceMethodRef>();
+            break;
+        case Opcode::invokevirtual:
+            is_method_of_the_right_kind = member.has<ClassFile::MethodRef>();
+            break;
+        // 4.4.2: invokespecial and invokestatic may also refer to a method of an interface.
+        default:
+            is_method_of_the_right_kind =
+                member.has<ClassFile::MethodRef>() || member.has<ClassFile::InterfaceMethodRef>();
+            break;
+    }
+    if (!is_method_of_the_right_kind)
+        return Error::from_string_literal("VerifyError: invoke of a constant that is not a method of the right kind");
+
+    auto name = TRY(utf8(name_and_type.name_index));
+    auto descriptor = TRY(MethodDescriptor::try_parse(TRY(utf8(name_and_type.descriptor_index))));
+
+    // 4.9.2: "Only the invokespecial instruction is allowed to invoke an instance initialization method", and nothing
+    // invokes a class or interface initialization method.
+    bool is_instance_initializer = name == "<init>"sv;
+    if (name.starts_with('<') && (!is_instance_initializer || instruction.opcode != Opcode::invokespecial))
+        return Error::from_string_literal("VerifyError: invoke of an initialization method");
+    if (is_instance_initializer && descriptor.return_type().has<FieldDescriptor>())
+        return Error::from_string_literal("VerifyError: instance initialization method returns a value");
+
+    auto& parameters = descriptor.parameters();
+    for (size_t i = parameters.size(); i > 0; i--)
+        TRY(pop(frame, type_of(parameters[i - 1])));
+
+    if (instruction.opcode != Opcode::invokestatic && instruction.opcode != Opcode::invokedynamic)
+    {
+        auto receiver = TRY(pop(frame));
+        if (is_instance_initializer)
+        {
+            // 4.10.1.9 invokespecial: once the instance initialization method has run, every copy of the object it
+            // initialized counts as initialized.
+            if (receiver.kind != Kind::Uninitialized && receiver.kind != Kind::UninitializedThis)
+                return Error::from_string_literal("VerifyError: initializing an object that is already initialized");
+
+            for (auto& local : frame.locals)
+            {
+                if (local == receiver)
+                    local = Type::reference();
+            }
+            for (auto& value : frame.stack)
+            {
+                if (value == receiver)
+                    value = Type::reference();
+            }
+        }
+        else if (!receiver.is_initialized_reference())
+        {
+            return Error::from_string_literal("VerifyError: invoke on something that is not an initialized object");
+        }
+    }
+
+    if (descriptor.return_type().has<FieldDescriptor>())
+        TRY(push(frame, type_of(descriptor.return_type().get<FieldDescriptor>())));
+    return {};
+}
+}
+
+ErrorOr<Vector<Optional<Verifier::Frame>>> Verifier::verify(const ClassFile& class_file,
+                                                             const ClassFile::MethodInfo& method,
+                                                             const DecodedCode& decoded_code)
+{
+    return MethodVerifier(class_file, method, decoded_code).verify();
+}
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/DecodedCode.h>
+#include <LibJava/Types.h>
+
+namespace Java
+{
+// 4.10 Verification of class Files
+// Proves, once for every method and before any of it runs, that every instruction finds the types it expects on the
+// operand stack and in the local variables, that the operand stack never goes below empty or above max_stack, that
+// only local variables below max_locals are used, and that every branch and exception handler goes to the start of an
+// instruction with the same stack depth whichever way control gets there. The interpreter relies on all of this
+// instead of checking it itself.
+// Code with a StackMapTable is type checked against it (4.10.1), which takes a single pass over the code, as the types
+// wherever control flow merges are given. Code without one, as in class files before version 50.0, has them worked
+// out by type inference instead (4.10.2), which keeps going over the code until the types at every instruction settle.
+// Whether one class is assignable to another isn't checked, as that would mean loading both of them. Any reference to
+// an object goes for any other, and only arrays are told apart, by how many dimensions they have and what their
+// components are.
+class Verifier
+{
+public:
+    struct Type
+    {
+        enum class Kind : u8
+        {
+            Top,
+            Integer,
+            Float,
+            Long,
+            Double,
+            Null,
+            // 4.10.1.9 new, invokespecial: what the instance initialization method or new created, before an instance
+            // initialization method has been invoked on it.
+            UninitializedThis,
+            Uninitialized,
+            Reference,
+        };
+
+        Kind kind{Kind::Top};
+        // How many dimensions the array has, for a Reference to one.
+        u8 array_dimensions{};
+        // What the innermost components of an array are, unless they are references.
+        Optional<PrimitiveType> component_type;
+        // The offset of the new instruction that created it, for Uninitialized.
+        u16 new_pc{};
+
+        static Type of(Kind kind) { return {kind}; }
+        static Type reference(u8 array_dimensions = 0, Optional<PrimitiveType> component_type = {})
+        {
+            return {Kind::Reference, array_dimensions, component_type};
+        }
+        static Type uninitialized(u16 new_pc) { return {Kind::Uninitialized, 0, {}, new_pc}; }
+
+        bool is_category_2() const { return kind == Kind::Long || kind == Kind::Double; }
+        bool is_reference() const { return kind >= Kind::Null; }
+        bool is_initialized_reference() const { return kind == Kind::Null || kind == Kind::Reference; }
+
+        bool operator==(const Type&) const = default;
+    };
+
+    struct Frame
+    {
+        // One for every slot, so long and double take up two, the second of which is Top.
+        Vector<Type> locals;
+        Vector<Type> stack;
+
+        bool operator==(const Frame&) const = default;
+    };
+
+    // The types at the start of every instruction, or nothing for the ones that control never reaches.
+    static ErrorOr<Vector<Optional<Frame>>> verify(const ClassFile&, const ClassFile::MethodInfo&, const DecodedCode&);
+};
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Runs every method that a file in Differential/ expects something of in each of the tiers, and checks that all of them
+# give what it expects. Besides the classes, each file has lines like
+#
+#   .expect method Return: 42
+#
+# where the method is one of the first class in the file, and what follows it is the last line java prints for it, or
+# the error it fails with.
+import os
+import subprocess
+import sys
+import tempfile
+
+# Keeps the source tree clean of a __pycache__ for jasm.
+sys.dont_write_bytecode = True
+import jasm  # noqa: E402
+
+MODES = {
+    'interpreter': ['--no-jit'],
+    'quickened': ['--no-jit', '--no-superinstructions', '--quicken-invocations', '0', '--quicken-backedges', '0'],
+    'default': [],
+    'aggressive': ['--jit-invocations', '2', '--jit-backedges', '3', '--optimize-invocations', '4',
+                   '--optimize-backedges', '7'],
+}
+
+
+def last_line(java, directory, class_name, method, options):
+    result = subprocess.run([java, *options, f'{class_name}.class', method], cwd=directory, capture_output=True,
+                            text=True, timeout=60)
+    if result.returncode < 0:
+        return f'Killed by signal {-result.returncode}'
+
+    lines = (result.stderr if result.returncode != 0 else result.stdout).strip().splitlines()
+    return lines[-1] if lines else ''
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(f'Usage: {sys.argv[0]} path/to/java', file=sys.stderr)
+        return 2
+
+    java = os.path.abspath(sys.argv[1])
+    corpus = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'Differential')
+    failures = 0
+    for file_name in sorted(os.listdir(corpus)):
+        if not file_name.endswith('.jasm'):
+            continue
+
+        with open(os.path.join(corpus, file_name)) as file:
+            class_files, other_lines = jasm.assemble(file.read())
+
+        with tempfile.TemporaryDirectory() as directory:
+            for class_file in class_files:
+                with open(os.path.join(directory, f'{class_file.name}.class'), 'wb') as output:
+                    output.write(class_file.bytes())
+
+            for line in other_lines:
+                directive, method, expected = line.split(maxsplit=2)
+                if directive != '.expect':
+                    raise ValueError(f'Unknown directive in "{line}"')
+
+                for mode, options in MODES.items():
+                    actual = last_line(java, directory, class_files[0].name, method, options)
+                    if actual != expected:
+                        print(f'FAIL {file_name} {method} ({mode}): expected "{expected}", got "{actual}"')
+                        failures += 1
+                    else:
+                        print(f'PASS {file_name} {method} ({mode})')
+
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,164 @@
+# Assembles class files out of a small text format, for tests that need bytecode javac would never emit.
+#
+#   .class Name [super java/lang/Object] [flags 0x0021]
+#   .field name descriptor [flags 0x0001]
+#   .method name descriptor [flags 0x0009] [stack 16] [locals 16]
+#       instructions, one per line, and labels ending in a colon
+#   .end
+#
+# Anything after // is a comment. Every other line starting with a dot is left to whoever reads the file.
+import os
+import re
+import struct
+
+OPCODE_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'LibJava', 'Opcode.h')
+OPCODES = {name.rstrip('_'): int(value, 16)
+           for name, value in re.findall(r'M\((\w+), "\w+", (0x[0-9a-f]+)\)', open(OPCODE_HEADER).read())}
+
+BRANCHES = {'ifeq', 'ifne', 'iflt', 'ifge', 'ifgt', 'ifle', 'if_icmpeq', 'if_icmpne', 'if_icmplt', 'if_icmpge',
+            'if_icmpgt', 'if_icmple', 'if_acmpeq', 'if_acmpne', 'goto', 'ifnull', 'ifnonnull'}
+LOCAL_OPERAND = {'iload', 'lload', 'fload', 'dload', 'aload', 'istore', 'lstore', 'fstore', 'dstore', 'astore'}
+FIELD_OPERAND = {'getstatic', 'putstatic', 'getfield', 'putfield'}
+METHOD_OPERAND = {'invokestatic', 'invokespecial', 'invokevirtual'}
+CLASS_OPERAND = {'new', 'anewarray', 'checkcast', 'instanceof'}
+
+
+class ClassFile:
+    def __init__(self, name, super_name='java/lang/Object', flags=0x0021):
+        self.name = name
+        self.pool = []
+        self.indices = {}
+        self.flags = flags
+        self.this_class = self.class_constant(name)
+        self.super_class = self.class_constant(super_name)
+        self.fields = []
+        self.methods = []
+
+    def constant(self, key, data, is_category_2=False):
+        if key not in self.indices:
+            self.pool.append(data)
+            self.indices[key] = len(self.pool)
+            # 4.4.5: "the next usable item in the pool is located at index n+2"
+            if is_category_2:
+                self.pool.append(b'')
+        return self.indices[key]
+
+    def utf8(self, value):
+        encoded = value.encode()
+        return self.constant(('Utf8', value), struct.pack('>BH', 1, len(encoded)) + encoded)
+
+    def class_constant(self, name):
+        return self.constant(('Class', name), struct.pack('>BH', 7, self.utf8(name)))
+
+    def name_and_type(self, name, descriptor):
+        return self.constant(('NameAndType', name, descriptor),
+                             struct.pack('>BHH', 12, self.utf8(name), self.utf8(descriptor)))
+
+    def member_ref(self, tag, owner, name, descriptor):
+        return self.constant((tag, owner, name, descriptor),
+                             struct.pack('>BHH', tag, self.class_constant(owner), self.name_and_type(name, descriptor)))
+
+    def add_field(self, name, descriptor, flags):
+        self.fields.append(struct.pack('>HHHH', flags, self.utf8(name), self.utf8(descriptor), 0))
+
+    def add_method(self, name, descriptor, flags, max_stack, max_locals, lines):
+        code = self.assemble(lines)
+        code_attribute = struct.pack('>HHI', max_stack, max_locals, len(code)) + code + struct.pack('>HH', 0, 0)
+        self.methods.append(struct.pack('>HHHH', flags, self.utf8(name), self.utf8(descriptor), 1) +
+                            struct.pack('>HI', self.utf8('Code'), len(code_attribute)) + code_attribute)
+
+    def encode(self, line, labels, pc):
+        opcode, *operands = line.split()
+        if opcode not in OPCODES:
+            raise ValueError(f'Unknown opcode in "{line}"')
+
+        encoded = bytes([OPCODES[opcode]])
+        if opcode in BRANCHES:
+            encoded += struct.pack('>h', labels.get(operands[0], pc) - pc)
+        elif opcode in LOCAL_OPERAND or opcode == 'newarray':
+            encoded += struct.pack('>B', int(operands[0]))
+        elif opcode == 'bipush':
+            encoded += struct.pack('>b', int(operands[0]))
+        elif opcode == 'sipush':
+            encoded += struct.pack('>h', int(operands[0]))
+        elif opcode == 'iinc':
+            encoded += struct.pack('>Bb', int(operands[0]), int(operands[1]))
+        elif opcode == 'ldc':
+            encoded += struct.pack('>B', self.constant(('Integer', int(operands[0])),
+                                                       struct.pack('>Bi', 3, int(operands[0]))))
+        elif opcode == 'ldc2_w' and operands[0].endswith('L'):
+            value = int(operands[0][:-1])
+            encoded += struct.pack('>H', self.constant(('Long', value), struct.pack('>Bq', 5, value), True))
+        elif opcode == 'ldc2_w':
+            value = float(operands[0])
+            encoded += struct.pack('>H', self.constant(('Double', value), struct.pack('>Bd', 6, value), True))
+        elif opcode in FIELD_OPERAND:
+            owner, name = operands[0].split('.')
+            encoded += struct.pack('>H', self.member_ref(9, owner, name, operands[1]))
+        elif opcode in METHOD_OPERAND:
+            owner, name, descriptor = re.fullmatch(r'([^.]+)\.([^(]+)(\(.*)', operands[0]).groups()
+            encoded += struct.pack('>H', self.member_ref(10, owner, name, descriptor))
+        elif opcode in CLASS_OPERAND:
+            encoded += struct.pack('>H', self.class_constant(operands[0]))
+        elif operands:
+            raise ValueError(f'Unexpected operands in "{line}"')
+        return encoded
+
+    # Branches can go forward, so the labels are only all known after a first pass.
+    def assemble(self, lines):
+        labels = {}
+        for _ in range(2):
+            code = b''
+            for line in lines:
+                if line.endswith(':'):
+                    labels[line[:-1]] = len(code)
+                else:
+                    code += self.encode(line, labels, len(code))
+        return code
+
+    def bytes(self):
+        data = struct.pack('>IHHH', 0xcafebabe, 0, 52, len(self.pool) + 1) + b''.join(self.pool)
+        data += struct.pack('>HHHH', self.flags, self.this_class, self.super_class, 0)
+        data += struct.pack('>H', len(self.fields)) + b''.join(self.fields)
+        data += struct.pack('>H', len(self.methods)) + b''.join(self.methods)
+        return data + struct.pack('>H', 0)
+
+
+def options(words, defaults):
+    values = dict(defaults)
+    for key, value in zip(words[::2], words[1::2]):
+        values[key] = value if key == 'super' else int(value, 0)
+    return values
+
+
+# Returns every class in the text as a ClassFile, in the order they are in, and the lines it didn't know about.
+def assemble(text):
+    class_files = []
+    other_lines = []
+    method = None
+    for line in text.splitlines():
+        line = line.split('//')[0].strip()
+        if not line:
+            continue
+
+        directive, *words = line.split()
+        if method is not None:
+            if directive == '.end':
+                class_files[-1].add_method(*method)
+                method = None
+            else:
+                method[-1].append(line)
+        elif directive == '.class':
+            values = options(words[1:], {'super': 'java/lang/Object', 'flags': 0x0021})
+            class_files.append(ClassFile(words[0], values['super'], values['flags']))
+        elif directive == '.field':
+            class_files[-1].add_field(words[0], words[1], options(words[2:], {'flags': 0x0001})['flags'])
+        elif directive == '.method':
+            values = options(words[2:], {'flags': 0x0009, 'stack': 16, 'locals': 16})
+            method = (words[0], words[1], values['flags'], values['stack'], values['locals'], [])
+        elif directive.startswith('.'):
+            other_lines.append(line)
+        else:
+            raise ValueError(f'Instruction outside of a method in "{line}"')
+
+    return class_files, other_lines
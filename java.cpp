@@ -1,8 +1,7 @@
-#include <AK/MemoryStream.h>
 #include <LibCore/ArgsParser.h>
-#include <LibCore/File.h>
+#include <LibCore/MappedFile.h>
 #include <LibJava/ClassFile.h>
-#include <LibJava/Descriptor.h>
+#include <LibJava/Object.h>
 #include <LibJava/VM.h>
 #include <LibMain/Main.h>
 
@@ -14,59 +13,143 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
     String method_to_call;
     args_parser.add_positional_argument(class_file_path, "Path to the class file to execute", "class-file");
     args_parser.add_positional_argument(method_to_call, "Name of the method to call", "method-name");
+    Java::VM::TieringPolicy tiering_policy;
+    bool no_jit = false;
+    args_parser.add_option(no_jit, "Interpret everything instead of compiling hot methods", "no-jit", 0);
+    bool no_superinstructions = false;
+    args_parser.add_option(no_superinstructions, "Don't fuse common instruction sequences into superinstructions",
+                           "no-superinstructions", 0);
+    args_parser.add_option(tiering_policy.quickened_interpreter.invocations,
+                           "How many calls it takes to start quickening a method", "quicken-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.quickened_interpreter.backedges,
+                           "How many backward branches it takes to start quickening a method", "quicken-backedges", 0,
+                           "count");
+    args_parser.add_option(tiering_policy.compiled.invocations, "How many calls it takes to compile a method",
+                           "jit-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.compiled.backedges, "How many backward branches it takes to compile a method",
+                           "jit-backedges", 0, "count");
+    args_parser.add_option(tiering_policy.optimized.invocations, "How many calls it takes to optimize a method",
+                           "optimize-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.optimized.backedges,
+                           "How many backward branches it takes to optimize a method", "optimize-backedges", 0,
+                           "count");
+    bool no_optimizer = false;
+    args_parser.add_option(no_optimizer, "Keep compiled methods in baseline code instead of optimizing hot ones",
+                           "no-optimizer", 0);
+    bool trace_tiers = false;
+    args_parser.add_option(trace_tiers, "Print every time a method moves to another tier or a call is inlined",
+                           "trace-tiers", 0);
+    Java::Heap::Configuration heap_configuration;
+    unsigned heap_size = heap_configuration.size / MiB;
+    args_parser.add_option(heap_size, "How big the heap is, in MiB", "heap-size", 0, "size");
+    unsigned young_generation_size = heap_configuration.young_generation_size / MiB;
+    args_parser.add_option(young_generation_size, "How much of the heap new objects are allocated in, in MiB",
+                           "young-generation-size", 0, "size");
+    args_parser.add_option(heap_configuration.collector_threads,
+                           "How many threads collect garbage, or 0 for one per processor", "gc-threads", 0, "count");
+    String class_archive_path;
+    args_parser.add_option(class_archive_path, "Take the classes that are in this class archive from it", "archive", 0,
+                           "path");
+    bool gc_statistics = false;
+    args_parser.add_option(gc_statistics, "Print how much time went into collecting garbage", "gc-statistics", 0);
 
     args_parser.parse(arguments);
 
-    auto class_file_file = TRY(Core::File::open(class_file_path, Core::OpenMode::ReadOnly));
-    auto class_file_contents = class_file_file->read_all();
-    InputMemoryStream class_file_stream(class_file_contents);
-
-    auto class_file = TRY(Java::ClassFile::try_parse(class_file_stream));
+    auto class_file = TRY(Java::ClassFile::try_parse(TRY(Core::MappedFile::map(class_file_path))));
 
     Java::VM vm;
+    tiering_policy.enable_jit = !no_jit;
+    tiering_policy.enable_optimizer = !no_optimizer;
+    vm.set_tiering_policy(tiering_policy);
+    vm.set_superinstructions_enabled(!no_superinstructions);
+    heap_configuration.size = static_cast<size_t>(heap_size) * MiB;
+    heap_configuration.young_generation_size = static_cast<size_t>(young_generation_size) * MiB;
+    TRY(vm.set_heap_configuration(heap_configuration));
+    if (!class_archive_path.is_empty())
+        vm.set_class_archive(TRY(Java::ClassArchive::try_open(TRY(Core::MappedFile::map(class_archive_path)))));
+
+    if (trace_tiers)
+    {
+        auto method_name = [](const Java::ClassFile& class_file, const Java::ClassFile::MethodInfo& method) {
+            auto constant_pool = class_file.constant_pool();
+            auto& class_name = constant_pool[class_file.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
+            auto& name = constant_pool[method.name_index - 1].get<Java::ClassFile::Utf8>();
+            auto& descriptor = constant_pool[method.descriptor_index - 1].get<Java::ClassFile::Utf8>();
+            return String::formatted("{}.{}{}", class_name.value, name.value, descriptor.value);
+        };
+
+        vm.on_tier_transition = [method_name](const Java::ClassFile& class_file,
+                                              const Java::ClassFile::MethodInfo& method, Java::Tier from,
+                                              Java::Tier to) {
+            outln("Tier: {}: {} -> {}", method_name(class_file, method), Java::tier_name(from), Java::tier_name(to));
+        };
+
+        vm.on_stack_replacement = [method_name](const Java::ClassFile& class_file,
+                                                const Java::ClassFile::MethodInfo& method, u16 pc) {
+            outln("OSR: {} at pc {}", method_name(class_file, method), pc);
+        };
+
+        vm.on_inline = [method_name](const Java::ClassFile& caller_class_file,
+                                     const Java::ClassFile::MethodInfo& caller, u16 pc,
+                                     const Java::ClassFile& callee_class_file,
+                                     const Java::ClassFile::MethodInfo& callee) {
+            outln("Inline: {} at pc {}: {}", method_name(caller_class_file, caller), pc,
+                  method_name(callee_class_file, callee));
+        };
+    }
 
-    vm.on_resolve_class_file_externally = [](auto name) -> ErrorOr<Java::ClassFile> {
+    vm.on_resolve_class_file_externally = [](auto name) -> ErrorOr<NonnullRefPtr<Java::ClassFile>> {
         outln("Resolving class {}", name);
-        auto resolving_class_file_file =
-            TRY(Core::File::open(String::formatted("{}.class", name), Core::OpenMode::ReadOnly));
-        auto class_file_contents = resolving_class_file_file->read_all();
-        InputMemoryStream resolving_class_file_stream(class_file_contents);
+        return Java::ClassFile::try_parse(TRY(Core::MappedFile::map(String::formatted("{}.class", name))));
+    };
+
+    // The method to execute must not take any parameters, so its descriptor can only differ in the return type.
+    const Java::ClassFile::MethodInfo* method = nullptr;
+    for (auto descriptor : {"()V"sv, "()Z"sv, "()B"sv, "()C"sv, "()S"sv, "()I"sv, "()J"sv, "()F"sv, "()D"sv})
+    {
+        method = class_file->find_method(method_to_call, descriptor);
+        if (method)
+            break;
+    }
+
+    if (!method)
+        return Error::from_string_literal("Could not find the method to execute");
+
+    if (!Java::has_flag(method->access_flags, Java::ClassFile::MethodInfo::AccessFlags::Public |
+                                                  Java::ClassFile::MethodInfo::AccessFlags::Static))
+        return Error::from_string_literal("Method to execute must be public and static");
+
+    auto return_value = TRY(vm.call(*class_file, *method));
+
+    // Like Object.toString(), which is the class name and the identity of the object.
+    auto reference_to_string = [](const Java::Reference& reference) {
+        if (reference.is_null())
+            return String("null");
 
-        return Java::ClassFile::try_parse(resolving_class_file_stream);
+        auto& name = reference.object->resolved_class().name;
+        return String::formatted("{}@{:x}", name, bit_cast<FlatPtr>(reference.object));
     };
 
-    for (auto& method : class_file.methods())
+    // FIXME: is there no general integral type to string?
+    outln("Return: {}", return_value.visit([](Java::Byte& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Short& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Integer& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Long& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Char& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Float& value) { return String::formatted("{}", value.value()); },
+                                           [](Java::Double& value) { return String::formatted("{}", value.value()); },
+                                           [&](Java::Reference& value) { return reference_to_string(value); }));
+
+    if (gc_statistics)
     {
-        auto& name = class_file.constant_pool()[method.name_index - 1].get<Java::ClassFile::Utf8>();
-
-        if (name.value == method_to_call)
-        {
-            if (!Java::has_flag(method.access_flags, Java::ClassFile::MethodInfo::AccessFlags::Public |
-                                                         Java::ClassFile::MethodInfo::AccessFlags::Static))
-                return Error::from_string_literal("Method to execute must be public and static");
-
-            auto descriptor_string =
-                class_file.constant_pool()[method.descriptor_index - 1].get<Java::ClassFile::Utf8>();
-
-            auto descriptor = TRY(Java::MethodDescriptor::try_parse(descriptor_string.value));
-
-            if (descriptor.parameters().size() != 0)
-                return Error::from_string_literal("Method to execute must not take any parameters");
-
-            auto return_value = TRY(vm.call(class_file, method));
-
-            // FIXME: is there no general integral type to string?
-            outln("Return: {}",
-                  return_value.visit([](Java::Byte& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Short& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Integer& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Long& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Char& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Float& value) { return String::formatted("{}", value.value()); },
-                                     [](Java::Double& value) { return String::formatted("{}", value.value()); }));
-            return 0;
-        }
+        auto statistics = vm.heap_statistics();
+        auto milliseconds = [](u64 nanoseconds) { return static_cast<double>(nanoseconds) / 1'000'000; };
+        outln("GC: {} young collections in {:.3} ms, {} old collections in {:.3} ms, longest pause {:.3} ms",
+              statistics.young_collections, milliseconds(statistics.young_pause_time), statistics.old_collections,
+              milliseconds(statistics.old_pause_time), milliseconds(statistics.longest_pause));
+        outln("GC: {} bytes allocated, {} promoted, {} reclaimed, throughput {:.2}%", statistics.allocated_bytes,
+              statistics.promoted_bytes, statistics.reclaimed_bytes, statistics.throughput() * 100);
     }
 
-    return Error::from_string_literal("Could not find the method to execute");
+    return 0;
 }
\ No newline at end of file
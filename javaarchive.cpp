@@ -0,0 +1,33 @@
+#include <LibCore/ArgsParser.h>
+#include <LibCore/File.h>
+#include <LibCore/MappedFile.h>
+#include <LibJava/ClassArchive.h>
+#include <LibJava/ClassFile.h>
+#include <LibMain/Main.h>
+
+ErrorOr<int> serenity_main(Main::Arguments arguments)
+{
+    Core::ArgsParser args_parser;
+    String archive_path;
+    Vector<String> class_file_paths;
+
+    args_parser.add_option(archive_path, "Path to write the class archive to", "output", 'o', "path");
+    args_parser.add_positional_argument(class_file_paths, "Paths to the class files to archive", "class-files");
+    args_parser.parse(arguments);
+
+    if (archive_path.is_empty())
+        return Error::from_string_literal("Need a path to write the class archive to");
+
+    Vector<NonnullRefPtr<Java::ClassFile>> class_files;
+    for (auto& class_file_path : class_file_paths)
+        class_files.append(TRY(Java::ClassFile::try_parse(TRY(Core::MappedFile::map(class_file_path)))));
+
+    auto archive = TRY(Java::ClassArchive::try_create(class_files.span()));
+
+    auto file = TRY(Core::File::open(archive_path, Core::OpenMode::WriteOnly | Core::OpenMode::Truncate));
+    if (!file->write(archive.data(), archive.size()))
+        return Error::from_string_literal("Could not write the class archive");
+
+    outln("Archived {} classes into {}", class_files.size(), archive_path);
+    return 0;
+}
\ No newline at end of file
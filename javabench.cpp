@@ -0,0 +1,135 @@
+#include <AK/QuickSort.h>
+#include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibCore/MappedFile.h>
+#include <LibJava/ClassFile.h>
+#include <LibJava/VM.h>
+#include <LibMain/Main.h>
+
+ErrorOr<int> serenity_main(Main::Arguments arguments)
+{
+    Core::ArgsParser args_parser;
+
+    String class_file_path;
+    String method_to_call;
+    int iterations = 10;
+    args_parser.add_positional_argument(class_file_path, "Path to the class file to benchmark", "class-file");
+    args_parser.add_positional_argument(method_to_call, "Name of the method to call", "method-name");
+    args_parser.add_option(iterations, "How many times to call the method", "iterations", 'i', "count");
+    Java::VM::TieringPolicy tiering_policy;
+    bool no_jit = false;
+    args_parser.add_option(no_jit, "Interpret everything instead of compiling hot methods", "no-jit", 0);
+    bool no_superinstructions = false;
+    args_parser.add_option(no_superinstructions, "Don't fuse common instruction sequences into superinstructions",
+                           "no-superinstructions", 0);
+    args_parser.add_option(tiering_policy.quickened_interpreter.invocations,
+                           "How many calls it takes to start quickening a method", "quicken-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.quickened_interpreter.backedges,
+                           "How many backward branches it takes to start quickening a method", "quicken-backedges", 0,
+                           "count");
+    args_parser.add_option(tiering_policy.compiled.invocations, "How many calls it takes to compile a method",
+                           "jit-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.compiled.backedges, "How many backward branches it takes to compile a method",
+                           "jit-backedges", 0, "count");
+    args_parser.add_option(tiering_policy.optimized.invocations, "How many calls it takes to optimize a method",
+                           "optimize-invocations", 0, "count");
+    args_parser.add_option(tiering_policy.optimized.backedges,
+                           "How many backward branches it takes to optimize a method", "optimize-backedges", 0,
+                           "count");
+    bool no_optimizer = false;
+    args_parser.add_option(no_optimizer, "Keep compiled methods in baseline code instead of optimizing hot ones",
+                           "no-optimizer", 0);
+
+    args_parser.parse(arguments);
+
+    auto class_file = TRY(Java::ClassFile::try_parse(TRY(Core::MappedFile::map(class_file_path))));
+
+    Java::VM vm;
+    tiering_policy.enable_jit = !no_jit;
+    tiering_policy.enable_optimizer = !no_optimizer;
+    vm.set_tiering_policy(tiering_policy);
+    vm.set_superinstructions_enabled(!no_superinstructions);
+
+    vm.on_resolve_class_file_externally = [](auto name) -> ErrorOr<NonnullRefPtr<Java::ClassFile>> {
+        return Java::ClassFile::try_parse(TRY(Core::MappedFile::map(String::formatted("{}.class", name))));
+    };
+
+    // The method to benchmark must not take any parameters, so its descriptor can only differ in the return type.
+    const Java::ClassFile::MethodInfo* method_to_benchmark = nullptr;
+    for (auto descriptor : {"()V"sv, "()Z"sv, "()B"sv, "()C"sv, "()S"sv, "()I"sv, "()J"sv, "()F"sv, "()D"sv})
+    {
+        method_to_benchmark = class_file->find_method(method_to_call, descriptor);
+        if (method_to_benchmark)
+            break;
+    }
+
+    if (!method_to_benchmark)
+        return Error::from_string_literal("Could not find the method to benchmark");
+
+    if (!Java::has_flag(method_to_benchmark->access_flags, Java::ClassFile::MethodInfo::AccessFlags::Public |
+                                                               Java::ClassFile::MethodInfo::AccessFlags::Static))
+        return Error::from_string_literal("Method to benchmark must be public and static");
+
+    // Call it once up front, so that initializing and linking the class isn't part of what we measure
+    TRY(vm.call(*class_file, *method_to_benchmark));
+
+#ifdef PERIL_THREADED_DISPATCH
+    outln("Dispatch: threaded");
+#else
+    outln("Dispatch: switch");
+#endif
+    outln("JIT: {}", no_jit ? "off" : "on");
+    outln("Optimizer: {}", no_jit || no_optimizer ? "off" : "on");
+    outln("Superinstructions: {}", no_superinstructions ? "off" : "on");
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+    auto executed_instructions_before = vm.executed_instructions();
+#endif
+
+    auto timer = Core::ElapsedTimer::start_new();
+
+    for (auto i = 0; i < iterations; i++)
+        TRY(vm.call(*class_file, *method_to_benchmark));
+
+    auto elapsed_nanoseconds = timer.elapsed_time().to_nanoseconds();
+
+    outln("{} iterations in {}ms, {}us per iteration", iterations, elapsed_nanoseconds / 1'000'000,
+          elapsed_nanoseconds / 1'000 / iterations);
+
+#ifdef PERIL_COUNT_INSTRUCTIONS
+    auto executed_instructions = vm.executed_instructions() - executed_instructions_before;
+    outln("{} instructions, {:.2}ns per instruction", executed_instructions,
+          static_cast<double>(elapsed_nanoseconds) / executed_instructions);
+
+    // These are what is worth fusing into a superinstruction, so it is best to look at them without any.
+    struct OpcodePair
+    {
+        Java::Opcode first;
+        Java::Opcode second;
+        u64 count;
+    };
+
+    Vector<OpcodePair> opcode_pairs;
+    for (auto& first : Java::opcode_names)
+    {
+        for (auto& second : Java::opcode_names)
+        {
+            if (auto count = vm.opcode_pair_count(first.key, second.key); count > 0)
+                opcode_pairs.append({first.key, second.key, count});
+        }
+    }
+
+    quick_sort(opcode_pairs, [](auto& a, auto& b) { return a.count > b.count; });
+
+    outln("Most frequent opcode pairs:");
+    for (size_t i = 0; i < min(opcode_pairs.size(), 10); i++)
+    {
+        auto& pair = opcode_pairs[i];
+        outln("  {} {}: {}", *Java::opcode_names.get(pair.first), *Java::opcode_names.get(pair.second), pair.count);
+    }
+#else
+    outln("Build with PERIL_COUNT_INSTRUCTIONS to see the time spent per instruction");
+#endif
+
+    return 0;
+}
\ No newline at end of file
@@ -1,6 +1,5 @@
-#include <AK/MemoryStream.h>
 #include <LibCore/ArgsParser.h>
-#include <LibCore/File.h>
+#include <LibCore/MappedFile.h>
 #include <LibJava/ClassFile.h>
 #include <LibJava/Descriptor.h>
 #include <LibJava/Disassembler.h>
@@ -17,19 +16,14 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
                            'n');
     args_parser.parse(arguments);
 
-    auto file = TRY(Core::File::open(class_file_path, Core::OpenMode::ReadOnly));
-    // Don't use Core::InputFileStream, it doesn't work that well
-    auto file_contents = file->read_all();
-    InputMemoryStream file_contents_stream(file_contents);
-
-    auto class_file = TRY(Java::ClassFile::try_parse(file_contents_stream));
-    Java::Disassembler disassembler(class_file);
+    auto class_file = TRY(Java::ClassFile::try_parse(TRY(Core::MappedFile::map(class_file_path))));
+    Java::Disassembler disassembler(*class_file);
     disassembler.set_numbered_instructions(numbered_instructions);
 
-    for (auto& method : class_file.methods())
+    for (auto& method : class_file->methods())
     {
-        auto& name = class_file.constant_pool()[method.name_index - 1].get<Java::ClassFile::Utf8>();
-        auto& descriptor = class_file.constant_pool()[method.descriptor_index - 1].get<Java::ClassFile::Utf8>();
+        auto& name = class_file->constant_pool()[method.name_index - 1].get<Java::ClassFile::Utf8>();
+        auto& descriptor = class_file->constant_pool()[method.descriptor_index - 1].get<Java::ClassFile::Utf8>();
 
         auto parsed_descriptor = TRY(Java::MethodDescriptor::try_parse(descriptor.value));
 
@@ -46,7 +40,7 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
             if (name.value == "<clinit>"sv)
             {
                 auto& this_class_name =
-                    class_file.constant_pool()[class_file.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
+                    class_file->constant_pool()[class_file->this_class().name_index - 1].get<Java::ClassFile::Utf8>();
 
                 method_builder.appendff("static"sv, name.value);
             }
@@ -83,8 +77,8 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
                 }
                 else
                 {
-                    auto& this_class_name =
-                        class_file.constant_pool()[class_file.this_class().name_index - 1].get<Java::ClassFile::Utf8>();
+                    auto& this_class_name = class_file->constant_pool()[class_file->this_class().name_index - 1]
+                                                .get<Java::ClassFile::Utf8>();
                     method_builder.appendff("{}"sv, this_class_name.value);
                 }
 